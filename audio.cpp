@@ -0,0 +1,186 @@
+#include "audio.hpp"
+
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+#include "subsystems.hpp"
+
+namespace asteroids
+{
+	namespace
+	{
+		struct effect_description
+		{
+			float duration;
+			float start_frequency;
+			float end_frequency;
+			float tone_volume;
+			float noise_volume;
+			//How much of the previous noise sample is kept, higher values give a darker rumble.
+			float noise_smoothing;
+		};
+
+		//Indexed by sound_effect.
+		constexpr std::array<effect_description,SOUND_EFFECT_COUNT> EFFECT_DESCRIPTIONS{
+			effect_description{0.08f,1200.0f,400.0f,0.35f,0.0f,0.0f},
+			effect_description{0.25f,0.0f,0.0f,0.0f,0.6f,0.6f},
+			effect_description{0.4f,600.0f,150.0f,0.3f,0.4f,0.4f},
+			effect_description{0.9f,120.0f,40.0f,0.3f,0.7f,0.85f}
+		};
+
+		std::vector<float> synthesize_effect(const effect_description& description,int sample_rate)
+		{
+			std::vector<float> samples(static_cast<std::size_t>(description.duration * sample_rate));
+			std::uint32_t noise_state = 0x9E3779B9u;
+			float noise = 0.0f;
+			float phase = 0.0f;
+			for(std::size_t i = 0;i < samples.size();++i)
+			{
+				float t = static_cast<float>(i) / static_cast<float>(samples.size());
+				float frequency = description.start_frequency + (description.end_frequency - description.start_frequency) * t;
+				phase += frequency / static_cast<float>(sample_rate);
+				phase -= std::floor(phase);
+				float tone = (phase < 0.5f) ? 1.0f : -1.0f;
+
+				noise_state = noise_state * 1664525u + 1013904223u;
+				float white_noise = static_cast<float>(noise_state >> 8) / static_cast<float>(1u << 23) - 1.0f;
+				noise = noise * description.noise_smoothing + white_noise * (1.0f - description.noise_smoothing);
+
+				float envelope = (1.0f - t) * (1.0f - t);
+				samples[i] = (tone * description.tone_volume + noise * description.noise_volume) * envelope;
+			}
+			return samples;
+		}
+	}
+
+	audio_mixer::~audio_mixer()
+	{
+		close();
+	}
+
+	bool audio_mixer::open()
+	{
+		if(device != 0)
+		{
+			return true;
+		}
+		if(!require_subsystems(SDL_INIT_AUDIO))
+		{
+			return false;
+		}
+
+		SDL_AudioSpec desired{};
+		desired.freq = AUDIO_SAMPLE_RATE;
+		desired.format = AUDIO_F32SYS;
+		desired.channels = 1;
+		desired.samples = AUDIO_BUFFER_FRAMES;
+		desired.callback = &audio_mixer::audio_callback;
+		desired.userdata = this;
+		SDL_AudioSpec obtained{};
+		device = SDL_OpenAudioDevice(nullptr,0,&desired,&obtained,0);
+		if(device == 0)
+		{
+			return false;
+		}
+		sample_rate = obtained.freq;
+		buffer_frames = obtained.samples;
+
+		//The callback isn't running yet, so this is the last point where allocating is fine.
+		for(std::size_t i = 0;i < effects.size();++i)
+		{
+			effects[i] = synthesize_effect(EFFECT_DESCRIPTIONS[i],sample_rate);
+		}
+		voices.fill(voice{});
+		SDL_PauseAudioDevice(device,0);
+		return true;
+	}
+
+	void audio_mixer::close()
+	{
+		if(device != 0)
+		{
+			SDL_CloseAudioDevice(device);
+			device = 0;
+		}
+	}
+
+	bool audio_mixer::is_open() const noexcept
+	{
+		return device != 0;
+	}
+
+	sound_event_queue& audio_mixer::get_queue() noexcept
+	{
+		return queue;
+	}
+
+	void audio_mixer::report(std::ostream& stream) const
+	{
+		std::uint64_t callbacks = callback_count.load(std::memory_order_relaxed);
+		double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+		double average = (callbacks > 0) ? (static_cast<double>(total_callback_counter.load(std::memory_order_relaxed)) / callbacks * 1000000.0 / frequency) : 0.0;
+		double maximum = static_cast<double>(max_callback_counter.load(std::memory_order_relaxed)) * 1000000.0 / frequency;
+		double budget = (sample_rate > 0) ? (static_cast<double>(buffer_frames) * 1000000.0 / sample_rate) : 0.0;
+		stream << "Audio: " << callbacks << " callbacks, " << std::fixed << std::setprecision(2) << average << " us average, " << maximum << " us max (budget "
+				<< budget << " us), " << underrun_count.load(std::memory_order_relaxed) << " underruns, " << queue.get_dropped_count() << " dropped events" << std::endl;
+		stream.unsetf(std::ios_base::floatfield);
+	}
+
+	void SDLCALL audio_mixer::audio_callback(void* user_data,Uint8* stream,int length)
+	{
+		auto* mixer = static_cast<audio_mixer*>(user_data);
+		Uint64 start = SDL_GetPerformanceCounter();
+		//SDL asks for the next buffer while the previous one plays, a gap longer than one and a half buffers means the device ran dry.
+		if(mixer->last_callback_counter != 0 && mixer->sample_rate > 0)
+		{
+			Uint64 buffer_counter = static_cast<Uint64>(mixer->buffer_frames) * SDL_GetPerformanceFrequency() / static_cast<Uint64>(mixer->sample_rate);
+			if((start - mixer->last_callback_counter) > (buffer_counter + buffer_counter / 2))
+			{
+				mixer->underrun_count.fetch_add(1,std::memory_order_relaxed);
+			}
+		}
+		mixer->last_callback_counter = start;
+
+		mixer->mix(reinterpret_cast<float*>(stream),static_cast<std::size_t>(length) / sizeof(float));
+
+		std::uint64_t elapsed = SDL_GetPerformanceCounter() - start;
+		mixer->callback_count.fetch_add(1,std::memory_order_relaxed);
+		mixer->total_callback_counter.fetch_add(elapsed,std::memory_order_relaxed);
+		if(elapsed > mixer->max_callback_counter.load(std::memory_order_relaxed))
+		{
+			mixer->max_callback_counter.store(elapsed,std::memory_order_relaxed);
+		}
+	}
+
+	void audio_mixer::mix(float* output,std::size_t frame_count)
+	{
+		sound_effect effect{};
+		while(queue.try_pop(effect))
+		{
+			//When every voice is busy the one started longest ago is replaced.
+			const auto& samples = effects[static_cast<std::size_t>(effect)];
+			voices[next_voice] = voice{samples.data(),samples.size(),0};
+			next_voice = (next_voice + 1) % voices.size();
+		}
+
+		std::fill(output,output + frame_count,0.0f);
+		for(auto& voice : voices)
+		{
+			if(voice.position >= voice.length)
+			{
+				continue;
+			}
+			std::size_t count = std::min(frame_count,voice.length - voice.position);
+			const float* samples = voice.samples + voice.position;
+			for(std::size_t i = 0;i < count;++i)
+			{
+				output[i] += samples[i];
+			}
+			voice.position += count;
+		}
+		for(std::size_t i = 0;i < frame_count;++i)
+		{
+			output[i] = std::clamp(output[i],-1.0f,1.0f);
+		}
+	}
+}
\ No newline at end of file
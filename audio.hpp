@@ -0,0 +1,61 @@
+#ifndef ASTEROIDS_AUDIO_HPP
+#define ASTEROIDS_AUDIO_HPP
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <SDL.h>
+#include "spsc_queue.hpp"
+
+namespace asteroids
+{
+	inline constexpr int AUDIO_SAMPLE_RATE = 48000;
+	inline constexpr Uint16 AUDIO_BUFFER_FRAMES = 256;
+	inline constexpr std::size_t AUDIO_VOICE_COUNT = 16;
+
+	//Plays sound effects from the SDL audio callback. The game thread is the only producer of 'get_queue()' and the callback
+	//is the only consumer, the callback never locks or allocates: effects are synthesized into fixed buffers when the device is opened.
+	class audio_mixer
+	{
+	public:
+		audio_mixer() = default;
+		audio_mixer(const audio_mixer&) = delete;
+		audio_mixer& operator = (const audio_mixer&) = delete;
+		~audio_mixer();
+
+		bool open();
+		void close();
+		bool is_open() const noexcept;
+		sound_event_queue& get_queue() noexcept;
+		void report(std::ostream& stream) const;
+
+	private:
+		struct voice
+		{
+			const float* samples;
+			std::size_t length;
+			std::size_t position;
+		};
+
+		static void SDLCALL audio_callback(void* user_data,Uint8* stream,int length);
+		void mix(float* output,std::size_t frame_count);
+
+		SDL_AudioDeviceID device{};
+		int sample_rate{};
+		std::size_t buffer_frames{};
+		sound_event_queue queue{};
+		std::array<std::vector<float>,SOUND_EFFECT_COUNT> effects{};
+		std::array<voice,AUDIO_VOICE_COUNT> voices{};
+		std::size_t next_voice{};
+		Uint64 last_callback_counter{};
+		std::atomic<std::uint64_t> callback_count{};
+		std::atomic<std::uint64_t> underrun_count{};
+		std::atomic<std::uint64_t> total_callback_counter{};
+		std::atomic<std::uint64_t> max_callback_counter{};
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+"""Compares two asteroids_microbench result files and flags regressions."""
+
+import argparse
+import json
+import sys
+
+
+def load_results(path):
+    with open(path) as file:
+        return {entry["name"]: entry for entry in json.load(file)["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("baseline", help="stored baseline JSON")
+    parser.add_argument("current", help="JSON written by the current run")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="relative slowdown that counts as a regression (default: 0.10)")
+    arguments = parser.parse_args()
+
+    baseline = load_results(arguments.baseline)
+    current = load_results(arguments.current)
+
+    regressions = 0
+    print(f"{'benchmark':<36}{'baseline ns':>14}{'current ns':>14}{'change':>10}")
+    for name in sorted(baseline.keys() | current.keys()):
+        if name not in current:
+            print(f"{name:<36}{'':>14}{'missing':>14}")
+            continue
+        if name not in baseline:
+            print(f"{name:<36}{'new':>14}{current[name]['ns_per_op']:>14.1f}")
+            continue
+        old = baseline[name]["ns_per_op"]
+        new = current[name]["ns_per_op"]
+        change = (new - old) / old if old > 0 else 0.0
+        marker = ""
+        if change > arguments.threshold:
+            marker = "  REGRESSION"
+            regressions += 1
+        print(f"{name:<36}{old:>14.1f}{new:>14.1f}{change:>+10.1%}{marker}")
+
+    if regressions:
+        print(f"{regressions} benchmark(s) regressed by more than {arguments.threshold:.0%}.")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,613 @@
+#include <array>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <charconv>
+#include <algorithm>
+
+#include "scene.hpp"
+#include "utility.hpp"
+#include "entities.hpp"
+
+//Compares the live mesh::update, mesh::check_collision_with and intersect_rects (the candidates) against frozen copies of the
+//implementations they replaced (the references). A faster candidate has to agree on every generated case before it goes in.
+namespace
+{
+	constexpr std::size_t CHUNK_SIZE = 4096;
+	constexpr float POSITION_OFFSET_RANGE = 120.0f;
+	constexpr float ROTATION_RANGE = 64.0f;
+
+	constexpr std::array<asteroids::prototype_id,8> FUZZ_PROTOTYPES{
+		asteroids::prototype_id::player,
+		asteroids::prototype_id::destruction_fragment,
+		asteroids::prototype_id::big_rock_0,
+		asteroids::prototype_id::big_rock_1,
+		asteroids::prototype_id::small_rock_0,
+		asteroids::prototype_id::small_rock_1,
+		asteroids::prototype_id::bullet,
+		asteroids::prototype_id::ufo
+	};
+
+	struct fuzz_case
+	{
+		asteroids::prototype_id prototype_a;
+		asteroids::prototype_id prototype_b;
+		SDL_FPoint position_a;
+		SDL_FPoint position_b;
+		float rotation_a;
+		float rotation_b;
+	};
+
+	struct frozen_decomposition
+	{
+		asteroids::prototype_id prototype;
+		std::size_t vertex_count;
+		std::vector<std::vector<std::size_t>> parts;
+	};
+
+	//Convex parts of every fuzzed prototype as the decomposition produced them when the harness was written. The reference
+	//uses these, so a change to the decomposition shows up as a mismatch instead of being copied into the reference.
+	const std::vector<frozen_decomposition>& get_frozen_decompositions()
+	{
+		static const std::vector<frozen_decomposition> decompositions{
+			{asteroids::prototype_id::player,3,{{0,1,2}}},
+			{asteroids::prototype_id::destruction_fragment,4,{{0,1,2,3}}},
+			{asteroids::prototype_id::big_rock_0,5,{{0,1,2,3,4}}},
+			{asteroids::prototype_id::big_rock_1,4,{{0,1,2,3}}},
+			{asteroids::prototype_id::small_rock_0,5,{{0,1,2,3,4}}},
+			{asteroids::prototype_id::small_rock_1,4,{{0,1,2,3}}},
+			{asteroids::prototype_id::bullet,4,{{0,1,2,3}}},
+			{asteroids::prototype_id::ufo,8,{{7,0,1,2},{7,2,3,4,5,6}}}
+		};
+		return decompositions;
+	}
+
+	const frozen_decomposition& get_frozen_decomposition(asteroids::prototype_id prototype)
+	{
+		const auto& decompositions = get_frozen_decompositions();
+		return *std::find_if(decompositions.begin(),decompositions.end(),[&](const frozen_decomposition& decomposition){
+			return decomposition.prototype == prototype;
+		});
+	}
+
+	//Reference implementations, copied from the code as it was when the harness was written. Don't optimize these.
+	//Concave meshes are tested part by part over the frozen decompositions, which check_decompositions() validates.
+	struct reference_mesh
+	{
+		const std::vector<SDL_FPoint>* vertices{};
+		std::vector<std::vector<std::size_t>> parts{};
+		SDL_FPoint position{};
+		float rotation{};
+		std::vector<SDL_FPoint> transformed_vertices{};
+		std::vector<std::vector<SDL_FPoint>> part_edge_normals{};
+		SDL_FRect transformed_bounding_box{};
+	};
+
+	void reference_update(reference_mesh& mesh)
+	{
+		mesh.transformed_vertices.clear();
+		mesh.part_edge_normals.resize(mesh.parts.size());
+		mesh.transformed_bounding_box = {};
+		SDL_FPoint bounding_box_min{std::numeric_limits<float>::infinity(),std::numeric_limits<float>::infinity()};
+		SDL_FPoint bounding_box_max{std::numeric_limits<float>::infinity(),std::numeric_limits<float>::infinity()};
+		for(const auto& vertex : *mesh.vertices)
+		{
+			SDL_FPoint point{};
+			point.x = std::cos(mesh.rotation) * vertex.x - std::sin(mesh.rotation) * vertex.y + mesh.position.x;
+			point.y = std::sin(mesh.rotation) * vertex.x + std::cos(mesh.rotation) * vertex.y + mesh.position.y;
+			if(std::isinf(bounding_box_min.x) || bounding_box_min.x > point.x)
+			{
+				bounding_box_min.x = point.x;
+			}
+			if(std::isinf(bounding_box_min.y) || bounding_box_min.y > point.y)
+			{
+				bounding_box_min.y = point.y;
+			}
+			if(std::isinf(bounding_box_max.x) || bounding_box_max.x < point.x)
+			{
+				bounding_box_max.x = point.x;
+			}
+			if(std::isinf(bounding_box_max.y) || bounding_box_max.y < point.y)
+			{
+				bounding_box_max.y = point.y;
+			}
+			mesh.transformed_vertices.push_back(point);
+		}
+		mesh.transformed_bounding_box = {bounding_box_min.x,bounding_box_min.y,bounding_box_max.x - bounding_box_min.x,bounding_box_max.y - bounding_box_min.y};
+
+		for(std::size_t part = 0;part < mesh.parts.size();++part)
+		{
+			const auto& indices = mesh.parts[part];
+			auto& normals = mesh.part_edge_normals[part];
+			normals.clear();
+			for(std::size_t i = 0;i < indices.size();++i)
+			{
+				SDL_FPoint current = mesh.transformed_vertices[indices[i]];
+				SDL_FPoint next = mesh.transformed_vertices[indices[(i + 1) % indices.size()]];
+				SDL_FPoint diff{next.x - current.x,next.y - current.y};
+				float magnitude = std::hypot(diff.x,diff.y);
+				normals.push_back({-(diff.y / magnitude),diff.x / magnitude});
+			}
+		}
+	}
+
+	bool reference_intersect_rects(const SDL_FRect& a,const SDL_FRect& b)
+	{
+		return ((a.x + a.w) >= b.x) && (a.x <= (b.x + b.w)) && ((a.y + a.h) >= b.y) && (a.y <= (b.y + b.h));
+	}
+
+	bool reference_check_collision(const reference_mesh& a,const reference_mesh& b)
+	{
+		if(!reference_intersect_rects(a.transformed_bounding_box,b.transformed_bounding_box))
+		{
+			return false;
+		}
+		auto separated_on_normals = [&](const std::vector<SDL_FPoint>& normals,const std::vector<std::size_t>& a_part,const std::vector<std::size_t>& b_part){
+			for(const auto& normal : normals)
+			{
+				float min = std::numeric_limits<float>::infinity();
+				float max = std::numeric_limits<float>::infinity();
+				float other_min = std::numeric_limits<float>::infinity();
+				float other_max = std::numeric_limits<float>::infinity();
+				for(std::size_t index : a_part)
+				{
+					const SDL_FPoint& vertex = a.transformed_vertices[index];
+					float value = normal.x * vertex.x + normal.y * vertex.y;
+					if(std::isinf(min) || value < min)
+					{
+						min = value;
+					}
+					if(std::isinf(max) || value > max)
+					{
+						max = value;
+					}
+				}
+				for(std::size_t index : b_part)
+				{
+					const SDL_FPoint& vertex = b.transformed_vertices[index];
+					float value = normal.x * vertex.x + normal.y * vertex.y;
+					if(std::isinf(other_min) || value < other_min)
+					{
+						other_min = value;
+					}
+					if(std::isinf(other_max) || value > other_max)
+					{
+						other_max = value;
+					}
+				}
+				if(!((min < other_max && min > other_min) || (other_min < max && other_min > min)))
+				{
+					return true;
+				}
+			}
+			return false;
+		};
+		for(std::size_t i = 0;i < a.parts.size();++i)
+		{
+			for(std::size_t j = 0;j < b.parts.size();++j)
+			{
+				if(!separated_on_normals(a.part_edge_normals[i],a.parts[i],b.parts[j]) && !separated_on_normals(b.part_edge_normals[j],a.parts[i],b.parts[j]))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	reference_mesh make_reference_mesh(asteroids::prototype_id prototype,SDL_FPoint position,float rotation)
+	{
+		reference_mesh mesh{};
+		const asteroids::mesh& prototype_mesh = asteroids::get_prototype_mesh(prototype);
+		mesh.vertices = &prototype_mesh.get_vertices();
+		mesh.parts = get_frozen_decomposition(prototype).parts;
+		mesh.position = position;
+		mesh.rotation = rotation;
+		return mesh;
+	}
+
+	asteroids::mesh make_candidate_mesh(asteroids::prototype_id prototype,SDL_FPoint position,float rotation)
+	{
+		asteroids::mesh mesh = asteroids::get_prototype_mesh(prototype);
+		mesh.position = position;
+		mesh.rotation = rotation;
+		return mesh;
+	}
+
+	double polygon_area(const std::vector<SDL_FPoint>& vertices,const std::vector<std::size_t>& polygon)
+	{
+		double area = 0;
+		for(std::size_t i = 0;i < polygon.size();++i)
+		{
+			const SDL_FPoint& current = vertices[polygon[i]];
+			const SDL_FPoint& next = vertices[polygon[(i + 1) % polygon.size()]];
+			area += static_cast<double>(current.x) * next.y - static_cast<double>(next.x) * current.y;
+		}
+		return area / 2;
+	}
+
+	//The parts have to index the polygon's vertices, be convex, wind the same way as the polygon and add up to its area.
+	bool check_decomposition(std::ostream& stream,const char* name,asteroids::prototype_id prototype,const std::vector<SDL_FPoint>& vertices,
+			const std::vector<std::vector<std::size_t>>& parts)
+	{
+		std::vector<std::size_t> whole(vertices.size());
+		for(std::size_t i = 0;i < whole.size();++i)
+		{
+			whole[i] = i;
+		}
+		double area = polygon_area(vertices,whole);
+		double parts_area = 0;
+		bool parts_convex = true;
+		for(const auto& part : parts)
+		{
+			if(std::any_of(part.begin(),part.end(),[&](std::size_t index){ return index >= vertices.size(); }))
+			{
+				stream << "Prototype " << static_cast<int>(prototype) << " has " << name << " parts beyond its " << vertices.size() << " vertices." << std::endl;
+				return false;
+			}
+			parts_area += polygon_area(vertices,part);
+			for(std::size_t j = 0;j < part.size();++j)
+			{
+				const SDL_FPoint& a = vertices[part[j]];
+				const SDL_FPoint& b = vertices[part[(j + 1) % part.size()]];
+				const SDL_FPoint& c = vertices[part[(j + 2) % part.size()]];
+				double cross = (static_cast<double>(b.x) - a.x) * (static_cast<double>(c.y) - a.y) - (static_cast<double>(b.y) - a.y) * (static_cast<double>(c.x) - a.x);
+				parts_convex = parts_convex && (cross * area >= 0);
+			}
+		}
+		if(!parts_convex || std::abs(parts_area - area) > std::abs(area) * 1e-6)
+		{
+			stream << "Prototype " << static_cast<int>(prototype) << " has a bad " << name << " convex decomposition: convex parts " << parts_convex
+					<< ", area " << area << " vs " << parts_area << " in " << parts.size() << " parts." << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	//Every prototype has to be a valid polygon that both its own and the frozen decomposition cover.
+	bool check_decompositions(std::ostream& stream)
+	{
+		bool ok = true;
+		for(auto prototype : FUZZ_PROTOTYPES)
+		{
+			const asteroids::mesh& mesh = asteroids::get_prototype_mesh(prototype);
+			const frozen_decomposition& frozen = get_frozen_decomposition(prototype);
+			if(!mesh.is_valid() || mesh.get_vertices().size() != frozen.vertex_count)
+			{
+				stream << "Prototype " << static_cast<int>(prototype) << " isn't the polygon the harness was written for: valid " << mesh.is_valid()
+						<< ", " << mesh.get_vertices().size() << " vertices instead of " << frozen.vertex_count << "." << std::endl;
+				ok = false;
+				continue;
+			}
+			std::vector<std::vector<std::size_t>> parts{};
+			for(std::size_t i = 0;i < mesh.get_convex_part_count();++i)
+			{
+				parts.push_back(mesh.get_convex_part(i));
+			}
+			ok = check_decomposition(stream,"frozen",prototype,mesh.get_vertices(),frozen.parts) && ok;
+			ok = check_decomposition(stream,"candidate",prototype,mesh.get_vertices(),parts) && ok;
+		}
+		return ok;
+	}
+
+	bool within(float reference,float candidate,float tolerance)
+	{
+		return (reference == candidate) || std::abs(reference - candidate) <= tolerance;
+	}
+
+	bool same_rect(const SDL_FRect& a,const SDL_FRect& b,float tolerance)
+	{
+		return within(a.x,b.x,tolerance) && within(a.y,b.y,tolerance) && within(a.w,b.w,tolerance) && within(a.h,b.h,tolerance);
+	}
+
+	bool same_update(const reference_mesh& reference,const asteroids::mesh& candidate,float tolerance)
+	{
+		const auto& vertices = candidate.get_transformed_vertices();
+		if(vertices.size() != reference.transformed_vertices.size() || !same_rect(reference.transformed_bounding_box,candidate.get_transformed_bounding_box(),tolerance))
+		{
+			return false;
+		}
+		for(std::size_t i = 0;i < vertices.size();++i)
+		{
+			if(!within(reference.transformed_vertices[i].x,vertices[i].x,tolerance) || !within(reference.transformed_vertices[i].y,vertices[i].y,tolerance))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//Name of the first operation the candidate disagrees on, nothing when the case passes.
+	std::optional<std::string> check_case(const fuzz_case& fuzz,float tolerance)
+	{
+		reference_mesh reference_a = make_reference_mesh(fuzz.prototype_a,fuzz.position_a,fuzz.rotation_a);
+		reference_mesh reference_b = make_reference_mesh(fuzz.prototype_b,fuzz.position_b,fuzz.rotation_b);
+		asteroids::mesh candidate_a = make_candidate_mesh(fuzz.prototype_a,fuzz.position_a,fuzz.rotation_a);
+		asteroids::mesh candidate_b = make_candidate_mesh(fuzz.prototype_b,fuzz.position_b,fuzz.rotation_b);
+		reference_update(reference_a);
+		reference_update(reference_b);
+		candidate_a.update();
+		candidate_b.update();
+		if(!same_update(reference_a,candidate_a,tolerance) || !same_update(reference_b,candidate_b,tolerance))
+		{
+			return "mesh_update";
+		}
+		if(reference_intersect_rects(reference_a.transformed_bounding_box,reference_b.transformed_bounding_box) !=
+			asteroids::intersect_rects(candidate_a.get_transformed_bounding_box(),candidate_b.get_transformed_bounding_box()))
+		{
+			return "intersect_rects";
+		}
+		if(reference_check_collision(reference_a,reference_b) != candidate_a.check_collision_with(candidate_b))
+		{
+			return "check_collision_with";
+		}
+		return std::nullopt;
+	}
+
+	fuzz_case generate_case(std::mt19937_64& random_engine)
+	{
+		std::uniform_int_distribution<std::size_t> prototype_range{0,FUZZ_PROTOTYPES.size() - 1};
+		std::uniform_real_distribution<float> x_range{0.0f,1024.0f};
+		std::uniform_real_distribution<float> y_range{0.0f,768.0f};
+		std::uniform_real_distribution<float> offset_range{-POSITION_OFFSET_RANGE,POSITION_OFFSET_RANGE};
+		std::uniform_real_distribution<float> rotation_range{-ROTATION_RANGE,ROTATION_RANGE};
+		fuzz_case fuzz{};
+		fuzz.prototype_a = FUZZ_PROTOTYPES[prototype_range(random_engine)];
+		fuzz.prototype_b = FUZZ_PROTOTYPES[prototype_range(random_engine)];
+		fuzz.position_a = {x_range(random_engine),y_range(random_engine)};
+		fuzz.position_b = {fuzz.position_a.x + offset_range(random_engine),fuzz.position_a.y + offset_range(random_engine)};
+		fuzz.rotation_a = rotation_range(random_engine);
+		fuzz.rotation_b = rotation_range(random_engine);
+		return fuzz;
+	}
+
+	//Greedily applies simplifications that keep the same operation failing until none of them does anymore.
+	//None of them grows the offset between the meshes, the pass limit only guards against float rounding ping-pong.
+	fuzz_case minimize_case(fuzz_case fuzz,const std::string& failure,float tolerance)
+	{
+		constexpr std::size_t MAX_PASSES = 256;
+		auto simplifications = std::array<void(*)(fuzz_case&),8>{
+			[](fuzz_case& c){ c.rotation_a = 0.0f; },
+			[](fuzz_case& c){ c.rotation_b = 0.0f; },
+			[](fuzz_case& c){ c.rotation_a = std::round(c.rotation_a * 64.0f) / 64.0f; c.rotation_b = std::round(c.rotation_b * 64.0f) / 64.0f; },
+			[](fuzz_case& c){ SDL_FPoint offset{c.position_b.x - c.position_a.x,c.position_b.y - c.position_a.y}; c.position_a = {512,384}; c.position_b = {512 + offset.x,384 + offset.y}; },
+			[](fuzz_case& c){ SDL_FPoint offset{std::trunc(c.position_b.x - c.position_a.x),std::trunc(c.position_b.y - c.position_a.y)}; c.position_a = {std::round(c.position_a.x),std::round(c.position_a.y)}; c.position_b = {c.position_a.x + offset.x,c.position_a.y + offset.y}; },
+			[](fuzz_case& c){ c.position_b = {(c.position_a.x + c.position_b.x) * 0.5f,(c.position_a.y + c.position_b.y) * 0.5f}; },
+			[](fuzz_case& c){ c.prototype_a = asteroids::prototype_id::bullet; },
+			[](fuzz_case& c){ c.prototype_b = asteroids::prototype_id::bullet; }
+		};
+		bool progressed = true;
+		for(std::size_t pass = 0;progressed && pass < MAX_PASSES;++pass)
+		{
+			progressed = false;
+			for(auto simplify : simplifications)
+			{
+				fuzz_case simpler = fuzz;
+				simplify(simpler);
+				if(std::memcmp(&simpler,&fuzz,sizeof(fuzz_case)) == 0)
+				{
+					continue;
+				}
+				auto result = check_case(simpler,tolerance);
+				if(result && *result == failure)
+				{
+					fuzz = simpler;
+					progressed = true;
+				}
+			}
+		}
+		return fuzz;
+	}
+
+	void print_case(std::ostream& stream,const fuzz_case& fuzz)
+	{
+		stream << std::hexfloat << "  a: prototype " << static_cast<int>(fuzz.prototype_a) << ", position {" << fuzz.position_a.x << "," << fuzz.position_a.y
+				<< "}, rotation " << fuzz.rotation_a << "\n  b: prototype " << static_cast<int>(fuzz.prototype_b) << ", position {" << fuzz.position_b.x << ","
+				<< fuzz.position_b.y << "}, rotation " << fuzz.rotation_b << std::defaultfloat << std::endl;
+	}
+
+	struct throughput
+	{
+		double reference_ns{};
+		double candidate_ns{};
+	};
+
+	template<typename F>
+	double time_ns(F&& function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		function();
+		auto end = std::chrono::steady_clock::now();
+		return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	}
+
+	template<typename T>
+	void do_not_optimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void* sink{};
+		sink = &value;
+#endif
+	}
+
+	//Times both implementations on the same chunk, each operation separately so a regression can be attributed.
+	//Returns how many pairs of the chunk the reference found colliding.
+	std::size_t measure_chunk(const std::vector<fuzz_case>& cases,std::array<throughput,3>& totals)
+	{
+		std::vector<reference_mesh> reference_meshes{};
+		std::vector<asteroids::mesh> candidate_meshes{};
+		reference_meshes.reserve(cases.size() * 2);
+		candidate_meshes.reserve(cases.size() * 2);
+		for(const auto& fuzz : cases)
+		{
+			reference_meshes.push_back(make_reference_mesh(fuzz.prototype_a,fuzz.position_a,fuzz.rotation_a));
+			reference_meshes.push_back(make_reference_mesh(fuzz.prototype_b,fuzz.position_b,fuzz.rotation_b));
+			candidate_meshes.push_back(make_candidate_mesh(fuzz.prototype_a,fuzz.position_a,fuzz.rotation_a));
+			candidate_meshes.push_back(make_candidate_mesh(fuzz.prototype_b,fuzz.position_b,fuzz.rotation_b));
+		}
+
+		totals[0].reference_ns += time_ns([&]{
+			for(auto& mesh : reference_meshes)
+			{
+				reference_update(mesh);
+			}
+		});
+		totals[0].candidate_ns += time_ns([&]{
+			for(auto& mesh : candidate_meshes)
+			{
+				mesh.update();
+			}
+		});
+
+		std::size_t hits = 0;
+		totals[1].reference_ns += time_ns([&]{
+			for(std::size_t i = 0;i < reference_meshes.size();i += 2)
+			{
+				hits += reference_intersect_rects(reference_meshes[i].transformed_bounding_box,reference_meshes[i + 1].transformed_bounding_box);
+			}
+		});
+		totals[1].candidate_ns += time_ns([&]{
+			for(std::size_t i = 0;i < candidate_meshes.size();i += 2)
+			{
+				hits += asteroids::intersect_rects(candidate_meshes[i].get_transformed_bounding_box(),candidate_meshes[i + 1].get_transformed_bounding_box());
+			}
+		});
+		std::size_t collisions = 0;
+		totals[2].reference_ns += time_ns([&]{
+			for(std::size_t i = 0;i < reference_meshes.size();i += 2)
+			{
+				collisions += reference_check_collision(reference_meshes[i],reference_meshes[i + 1]);
+			}
+		});
+		totals[2].candidate_ns += time_ns([&]{
+			for(std::size_t i = 0;i < candidate_meshes.size();i += 2)
+			{
+				hits += candidate_meshes[i].check_collision_with(candidate_meshes[i + 1]);
+			}
+		});
+		do_not_optimize(hits);
+		return collisions;
+	}
+
+	//The whole argument has to be a number in range, "12abc" or an overflowing count is rejected instead of being cut short or throwing.
+	template<typename T>
+	bool parse_argument(const char* text,T& value)
+	{
+		const char* end = text + std::strlen(text);
+		auto [last,error] = std::from_chars(text,end,value);
+		return error == std::errc{} && last == end;
+	}
+
+	void print_usage(const char* program)
+	{
+		std::cerr << "Usage: " << program << " [--cases count] [--seed seed] [--tolerance pixels] [--max-failures count]" << std::endl;
+	}
+}
+
+int main(int argc,char** argv)
+{
+	std::size_t case_count = 1000000;
+	std::uint64_t seed = 0xf022;
+	float tolerance = 0.0f;
+	std::size_t max_reported_failures = 5;
+	for(int i = 1;i < argc;++i)
+	{
+		std::string argument = argv[i];
+		if(argument == "--cases" && (i + 1) < argc)
+		{
+			if(!parse_argument(argv[++i],case_count))
+			{
+				std::cerr << "Invalid case count " << argv[i] << "." << std::endl;
+				print_usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(argument == "--seed" && (i + 1) < argc)
+		{
+			if(!parse_argument(argv[++i],seed))
+			{
+				std::cerr << "Invalid seed " << argv[i] << "." << std::endl;
+				print_usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(argument == "--tolerance" && (i + 1) < argc)
+		{
+			if(!parse_argument(argv[++i],tolerance) || !std::isfinite(tolerance) || tolerance < 0.0f)
+			{
+				std::cerr << "Invalid tolerance " << argv[i] << ", it has to be a non-negative number of pixels." << std::endl;
+				print_usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(argument == "--max-failures" && (i + 1) < argc)
+		{
+			if(!parse_argument(argv[++i],max_reported_failures))
+			{
+				std::cerr << "Invalid failure count " << argv[i] << "." << std::endl;
+				print_usage(argv[0]);
+				return 1;
+			}
+		}
+		else
+		{
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if(!check_decompositions(std::cout))
+	{
+		return 1;
+	}
+
+	std::mt19937_64 random_engine{seed};
+	std::array<throughput,3> totals{};
+	std::vector<fuzz_case> chunk{};
+	std::size_t failure_count = 0;
+	std::size_t collision_count = 0;
+	for(std::size_t done = 0;done < case_count;done += chunk.size())
+	{
+		chunk.clear();
+		for(std::size_t i = 0;i < CHUNK_SIZE && (done + i) < case_count;++i)
+		{
+			chunk.push_back(generate_case(random_engine));
+		}
+		for(const auto& fuzz : chunk)
+		{
+			auto failure = check_case(fuzz,tolerance);
+			if(!failure)
+			{
+				continue;
+			}
+			failure_count += 1;
+			if(failure_count <= max_reported_failures)
+			{
+				std::cout << "Mismatch in " << *failure << ", minimized case:" << std::endl;
+				print_case(std::cout,minimize_case(fuzz,*failure,tolerance));
+			}
+		}
+		collision_count += measure_chunk(chunk,totals);
+	}
+
+	constexpr std::array<const char*,3> OPERATION_NAMES{"mesh_update (2 meshes)","intersect_rects","check_collision_with"};
+	std::cout << std::left << std::setw(24) << "operation" << std::right << std::setw(16) << "reference" << std::setw(16) << "candidate" << "  (million cases/s)" << std::endl;
+	for(std::size_t i = 0;i < totals.size();++i)
+	{
+		auto rate = [&](double ns){ return (ns > 0.0) ? static_cast<double>(case_count) * 1000.0 / ns : 0.0; };
+		std::cout << std::left << std::setw(24) << OPERATION_NAMES[i] << std::right << std::fixed << std::setprecision(2)
+				<< std::setw(16) << rate(totals[i].reference_ns) << std::setw(16) << rate(totals[i].candidate_ns) << std::endl;
+	}
+	std::cout.unsetf(std::ios_base::floatfield);
+	std::cout << "Checked " << case_count << " cases (" << collision_count << " colliding), " << failure_count << " mismatches." << std::endl;
+	return (failure_count == 0) ? 0 : 1;
+}
\ No newline at end of file
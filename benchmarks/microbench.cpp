@@ -0,0 +1,580 @@
+#include <array>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <fstream>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include "scene.hpp"
+#include "random.hpp"
+#include "scenario.hpp"
+#include "dirty_rects.hpp"
+#include "utility.hpp"
+#include "entities.hpp"
+#include "scripting.hpp"
+#include "timer_wheel.hpp"
+
+namespace
+{
+	struct benchmark_result
+	{
+		std::string name;
+		std::size_t iterations;
+		double ns_per_op;
+		double min_ns_per_op;
+		double max_ns_per_op;
+	};
+
+	constexpr std::size_t REPETITIONS = 5;
+	constexpr double MIN_REPETITION_TIME_NS = 50'000'000.0;
+	constexpr float TICK_DELTA_TIME = 1.0f / 60.0f;
+	constexpr std::uint64_t POPULATION_SEED = 0x5eed;
+	constexpr std::size_t SHOOTER_COUNT = 100000;
+	constexpr float SHOOTER_RELOAD_TIME = 3.0f;
+	constexpr std::size_t SCRIPTED_AGENT_COUNT = 10000;
+	constexpr std::size_t RANDOM_DRAW_COUNT = 4096;
+	constexpr std::size_t SCENARIO_ROCK_COUNT = 20000;
+	constexpr std::size_t DIRTY_RECT_ITEM_COUNT = 1000;
+	constexpr std::size_t DIRTY_RECT_MOVING_COUNT = 8;
+	constexpr std::size_t SPATIAL_QUERY_POPULATION = 10000;
+	constexpr std::size_t SPATIAL_QUERY_POINT_COUNT = 256;
+	constexpr float SPATIAL_QUERY_RADIUS = 100.0f;
+	constexpr std::size_t SPATIAL_QUERY_NEAREST_COUNT = 8;
+
+	template<typename T>
+	void do_not_optimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void* sink{};
+		sink = &value;
+#endif
+	}
+
+	class benchmark_runner
+	{
+	public:
+		explicit benchmark_runner(std::string _filter) : filter(std::move(_filter))
+		{}
+
+		//'run' executes 'batch' with an iteration count and has to return the nanoseconds spent on exactly those iterations.
+		void run(const std::string& name,const std::function<double(std::size_t)>& batch)
+		{
+			if(!filter.empty() && name.find(filter) == std::string::npos)
+			{
+				return;
+			}
+
+			std::size_t iterations = 1;
+			while(true)
+			{
+				double elapsed = batch(iterations);
+				if(elapsed >= MIN_REPETITION_TIME_NS || iterations >= (std::size_t{1} << 30))
+				{
+					break;
+				}
+				double scale = (elapsed > 0.0) ? (MIN_REPETITION_TIME_NS / elapsed) * 1.2 : 10.0;
+				iterations = static_cast<std::size_t>(static_cast<double>(iterations) * std::clamp(scale,1.5,10.0)) + 1;
+			}
+
+			std::array<double,REPETITIONS> samples{};
+			for(auto& sample : samples)
+			{
+				sample = batch(iterations) / static_cast<double>(iterations);
+			}
+			std::sort(samples.begin(),samples.end());
+
+			benchmark_result result{name,iterations,samples[REPETITIONS / 2],samples.front(),samples.back()};
+			std::cout << result.name << ": " << result.ns_per_op << " ns/op (" << result.iterations << " iterations)" << std::endl;
+			results.push_back(result);
+		}
+
+		void write_json(std::ostream& stream) const
+		{
+			stream << "{\n\t\"benchmarks\": [\n";
+			for(std::size_t i = 0;i < results.size();++i)
+			{
+				const auto& result = results[i];
+				stream << "\t\t{\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+						<< ", \"ns_per_op\": " << result.ns_per_op << ", \"min_ns_per_op\": " << result.min_ns_per_op
+						<< ", \"max_ns_per_op\": " << result.max_ns_per_op << "}" << ((i + 1 < results.size()) ? ",\n" : "\n");
+			}
+			stream << "\t]\n}\n";
+		}
+
+	private:
+		std::string filter;
+		std::vector<benchmark_result> results{};
+	};
+
+	template<typename F>
+	double time_ns(F&& function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		function();
+		auto end = std::chrono::steady_clock::now();
+		return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	}
+
+	void populate_scene(asteroids::scene& scene,std::size_t population)
+	{
+		std::mt19937_64 random_engine{POPULATION_SEED};
+		std::uniform_real_distribution<float> x_range{64.0f,960.0f};
+		std::uniform_real_distribution<float> y_range{64.0f,704.0f};
+		std::uniform_real_distribution<float> angle_range{0.0f,asteroids::CONSTANT_PI * 2.0f};
+		std::uniform_int_distribution<std::size_t> template_range{0,asteroids::ROCK_TEMPLATES.size() - 1};
+
+		std::size_t projectile_count = population / 4;
+		std::size_t ufo_count = population / 20;
+		std::size_t rock_count = population - projectile_count - ufo_count;
+
+		for(std::size_t i = 0;i < rock_count;++i)
+		{
+			const auto& rock_template = asteroids::ROCK_TEMPLATES[template_range(random_engine)];
+			scene.add_rock(asteroids::rock{{x_range(random_engine),y_range(random_engine)},angle_range(random_engine),rock_template.speed,
+											rock_template.aword_points,rock_template.spawns_smaller_rocks_on_desstruction,rock_template.$mesh});
+		}
+		for(std::size_t i = 0;i < projectile_count;++i)
+		{
+			scene.add_projectile(asteroids::projectile{{x_range(random_engine),y_range(random_engine)},angle_range(random_engine),600,true,true,asteroids::BULLET_MESH});
+		}
+		for(std::size_t i = 0;i < ufo_count;++i)
+		{
+			SDL_FPoint direction = ((i % 2) == 0) ? SDL_FPoint{1,0} : SDL_FPoint{-1,0};
+			scene.add_ufo(asteroids::ufo{{x_range(random_engine),y_range(random_engine)},100,2000,3.0f,direction,asteroids::UFO_MESH});
+		}
+	}
+
+	void benchmark_mesh(benchmark_runner& runner)
+	{
+		runner.run("mesh_update",[](std::size_t iterations){
+			asteroids::mesh mesh = asteroids::BIG_ROCK_MESHES[0];
+			return time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					mesh.rotation += 0.01f;
+					mesh.position.x += 0.5f;
+					mesh.update();
+					do_not_optimize(mesh.get_transformed_bounding_box());
+				}
+			});
+		});
+
+		auto collision_benchmark = [&](const std::string& name,asteroids::mesh a,asteroids::mesh b,bool expected){
+			a.update();
+			b.update();
+			if(a.check_collision_with(b) != expected)
+			{
+				std::cerr << name << ": unexpected collision result, the benchmark setup is wrong." << std::endl;
+			}
+			runner.run(name,[a,b](std::size_t iterations){
+				return time_ns([&]{
+					for(std::size_t i = 0;i < iterations;++i)
+					{
+						bool result = a.check_collision_with(b);
+						do_not_optimize(result);
+					}
+				});
+			});
+		};
+
+		asteroids::mesh rock_a = asteroids::BIG_ROCK_MESHES[0];
+		asteroids::mesh rock_b = asteroids::BIG_ROCK_MESHES[1];
+		rock_a.position = {400,400};
+		rock_b.position = {420,410};
+		rock_b.rotation = 0.5f;
+		collision_benchmark("mesh_collision_overlapping",rock_a,rock_b,true);
+
+		asteroids::mesh player = asteroids::PLAYER_MESH;
+		asteroids::mesh bullet = asteroids::BULLET_MESH;
+		player.position = {400,400};
+		bullet.position = {420,420};
+		collision_benchmark("mesh_collision_separated",player,bullet,false);
+
+		rock_b.position = {800,100};
+		collision_benchmark("mesh_collision_aabb_rejected",rock_a,rock_b,false);
+	}
+
+	void benchmark_entity(benchmark_runner& runner)
+	{
+		const auto& rock_template = asteroids::ROCK_TEMPLATES[0];
+		const asteroids::rock prototype{{512,384},0.25f,rock_template.speed,rock_template.aword_points,
+										rock_template.spawns_smaller_rocks_on_desstruction,rock_template.$mesh};
+
+		runner.run("entity_copy",[&](std::size_t iterations){
+			std::vector<asteroids::rock> copies{};
+			copies.reserve(iterations);
+			return time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					copies.push_back(prototype);
+				}
+			});
+		});
+
+		runner.run("entity_move",[&](std::size_t iterations){
+			std::vector<asteroids::rock> sources(iterations,prototype);
+			std::vector<asteroids::rock> destinations{};
+			destinations.reserve(iterations);
+			return time_ns([&]{
+				for(auto& source : sources)
+				{
+					destinations.push_back(std::move(source));
+				}
+			});
+		});
+	}
+
+	//Both variants model UFO-style shooters that fire whenever their reload countdown runs out, one operation is one 60 Hz frame.
+	void benchmark_timers(benchmark_runner& runner)
+	{
+		std::mt19937_64 random_engine{POPULATION_SEED};
+		std::uniform_real_distribution<float> phase_range{0.0f,SHOOTER_RELOAD_TIME};
+		std::vector<float> phases(SHOOTER_COUNT);
+		for(auto& phase : phases)
+		{
+			phase = phase_range(random_engine);
+		}
+
+		runner.run("shooters_polled_" + std::to_string(SHOOTER_COUNT),[&](std::size_t iterations){
+			std::vector<float> shoot_timers = phases;
+			std::size_t shots = 0;
+			double elapsed = time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					for(auto& shoot_timer : shoot_timers)
+					{
+						if(shoot_timer > 0.0f)
+						{
+							shoot_timer -= TICK_DELTA_TIME;
+							if(shoot_timer < 0.0f)
+							{
+								shoot_timer = 0.0f;
+							}
+						}
+						if(shoot_timer <= 0.0f)
+						{
+							shoot_timer = SHOOTER_RELOAD_TIME;
+							++shots;
+						}
+					}
+				}
+			});
+			do_not_optimize(shots);
+			return elapsed;
+		});
+
+		runner.run("shooters_timer_wheel_" + std::to_string(SHOOTER_COUNT),[&](std::size_t iterations){
+			asteroids::timer_wheel timers{};
+			for(std::size_t i = 0;i < phases.size();++i)
+			{
+				timers.schedule_seconds(phases[i],{asteroids::timer_kind::script_resume,{static_cast<std::uint32_t>(i),1}});
+			}
+			const std::uint64_t ticks_per_frame = static_cast<std::uint64_t>(TICK_DELTA_TIME / asteroids::TIMER_WHEEL_RESOLUTION + 0.5f);
+			const std::uint64_t reload_ticks = asteroids::seconds_to_timer_ticks(SHOOTER_RELOAD_TIME);
+			std::size_t shots = 0;
+			double elapsed = time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					timers.advance(ticks_per_frame,[&](const asteroids::timer_event& event){
+						timers.schedule(reload_ticks,event);
+						++shots;
+					});
+				}
+			});
+			do_not_optimize(shots);
+			return elapsed;
+		});
+	}
+
+	asteroids::script_task run_counting_agent(std::size_t& counter)
+	{
+		while(true)
+		{
+			co_await asteroids::next_tick();
+			++counter;
+		}
+	}
+
+	void benchmark_scripts(benchmark_runner& runner)
+	{
+		runner.run("scripted_agents_tick_" + std::to_string(SCRIPTED_AGENT_COUNT),[](std::size_t iterations){
+			asteroids::timer_wheel timers{};
+			asteroids::script_scheduler scripts{timers};
+			std::size_t counter = 0;
+			for(std::size_t i = 0;i < SCRIPTED_AGENT_COUNT;++i)
+			{
+				scripts.start(run_counting_agent(counter),asteroids::script_kind::none);
+			}
+			double elapsed = time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					scripts.run_tick();
+				}
+			});
+			do_not_optimize(counter);
+			return elapsed;
+		});
+	}
+
+	//One operation is a batch of draws for a single entity and tick, drawn one at a time versus with the vectorized fill.
+	void benchmark_random(benchmark_runner& runner)
+	{
+		const asteroids::counter_rng random_generator{POPULATION_SEED};
+		std::vector<std::uint32_t> draws(RANDOM_DRAW_COUNT);
+		runner.run("counter_rng_bits_" + std::to_string(RANDOM_DRAW_COUNT),[&](std::size_t iterations){
+			double elapsed = time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					for(std::size_t j = 0;j < draws.size();++j)
+					{
+						draws[j] = random_generator.bits(i,1,asteroids::random_stream::split_rock,static_cast<std::uint32_t>(j));
+					}
+					do_not_optimize(draws.back());
+				}
+			});
+			return elapsed;
+		});
+		runner.run("counter_rng_fill_" + std::to_string(RANDOM_DRAW_COUNT),[&](std::size_t iterations){
+			double elapsed = time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					random_generator.fill_bits(i,1,asteroids::random_stream::split_rock,0,draws.data(),draws.size());
+					do_not_optimize(draws.back());
+				}
+			});
+			return elapsed;
+		});
+	}
+
+	//One operation adopts a compiled scenario of 20k rocks into a fresh scene, the same work '--scenario' does after mapping the file.
+	//The adopted meshes are transformed and indexed by the first update, so the second line times the load together with it.
+	void benchmark_scenario(benchmark_runner& runner)
+	{
+		std::istringstream text{"rock_grid big_rock_0 200 " + std::to_string(SCENARIO_ROCK_COUNT / 200) + " 0 0 5 7 45\n"};
+		std::vector<std::uint8_t> compiled{};
+		asteroids::scenario_view scenario{};
+		if(!asteroids::compile_scenario(text,compiled,std::cerr) || !scenario.open(compiled.data(),compiled.size()))
+		{
+			return;
+		}
+		runner.run("scenario_load_" + std::to_string(SCENARIO_ROCK_COUNT),[&](std::size_t iterations){
+			double elapsed = 0.0;
+			for(std::size_t i = 0;i < iterations;++i)
+			{
+				asteroids::scene scene{POPULATION_SEED};
+				elapsed += time_ns([&]{
+					scene.load_scenario(scenario);
+				});
+				do_not_optimize(scene.get_rocks().size());
+			}
+			return elapsed;
+		});
+		runner.run("scenario_load_first_update_" + std::to_string(SCENARIO_ROCK_COUNT),[&](std::size_t iterations){
+			double elapsed = 0.0;
+			for(std::size_t i = 0;i < iterations;++i)
+			{
+				asteroids::scene scene{POPULATION_SEED};
+				elapsed += time_ns([&]{
+					scene.load_scenario(scenario);
+					scene.update(TICK_DELTA_TIME,asteroids::player_input{});
+				});
+				do_not_optimize(scene.get_rocks().size());
+			}
+			return elapsed;
+		});
+	}
+
+	//One operation is a frame of dirty-rect tracking over 1000 drawables of which 8 move, what the software renderer path does before clearing anything.
+	void benchmark_dirty_rects(benchmark_runner& runner)
+	{
+		std::mt19937 generator{POPULATION_SEED};
+		std::uniform_real_distribution<float> x_distribution{0.0f,1000.0f};
+		std::uniform_real_distribution<float> y_distribution{0.0f,740.0f};
+		std::vector<SDL_FRect> bounds(DIRTY_RECT_ITEM_COUNT);
+		for(auto& rect : bounds)
+		{
+			rect = {x_distribution(generator),y_distribution(generator),24.0f,24.0f};
+		}
+		runner.run("dirty_rects_frame_" + std::to_string(DIRTY_RECT_ITEM_COUNT),[&](std::size_t iterations){
+			asteroids::dirty_rect_tracker tracker{1024,768};
+			tracker.begin_frame();
+			tracker.end_frame();
+			return time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					tracker.begin_frame();
+					for(std::size_t j = 0;j < bounds.size();++j)
+					{
+						if(j < DIRTY_RECT_MOVING_COUNT)
+						{
+							bounds[j].x = std::fmod(bounds[j].x + 1.0f,1000.0f);
+						}
+						tracker.add(j,bounds[j],0);
+					}
+					do_not_optimize(tracker.end_frame().size());
+				}
+			});
+		});
+	}
+
+	//One operation is one query around a random point of a scene with 10k entities. The linear variant scans every entity the way code without the index would.
+	void benchmark_spatial_queries(benchmark_runner& runner)
+	{
+		asteroids::scene scene{POPULATION_SEED};
+		populate_scene(scene,SPATIAL_QUERY_POPULATION);
+		std::mt19937_64 random_engine{POPULATION_SEED};
+		std::uniform_real_distribution<float> x_range{0.0f,1024.0f};
+		std::uniform_real_distribution<float> y_range{0.0f,768.0f};
+		std::uniform_real_distribution<float> angle_range{0.0f,asteroids::CONSTANT_PI * 2.0f};
+		std::vector<SDL_FPoint> points(SPATIAL_QUERY_POINT_COUNT);
+		std::vector<SDL_FPoint> directions(SPATIAL_QUERY_POINT_COUNT);
+		for(std::size_t i = 0;i < SPATIAL_QUERY_POINT_COUNT;++i)
+		{
+			points[i] = {x_range(random_engine),y_range(random_engine)};
+			float angle = angle_range(random_engine);
+			directions[i] = {std::cos(angle),std::sin(angle)};
+		}
+		const asteroids::collision_mask layers = ~asteroids::collision_mask{0};
+		const std::string suffix = "_" + std::to_string(SPATIAL_QUERY_POPULATION);
+		std::vector<asteroids::spatial_hit> hits{};
+
+		runner.run("spatial_query_radius" + suffix,[&](std::size_t iterations){
+			return time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					hits.clear();
+					scene.query_radius(points[i % SPATIAL_QUERY_POINT_COUNT],SPATIAL_QUERY_RADIUS,layers,hits);
+					do_not_optimize(hits.size());
+				}
+			});
+		});
+		runner.run("linear_query_radius" + suffix,[&](std::size_t iterations){
+			return time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					const SDL_FPoint& point = points[i % SPATIAL_QUERY_POINT_COUNT];
+					std::size_t found = 0;
+					auto scan = [&](const auto& entities){
+						for(const auto& entity : entities)
+						{
+							SDL_FRect bounds = entity.get_mesh().get_transformed_bounding_box();
+							float dx = std::max({bounds.x - point.x,0.0f,point.x - (bounds.x + bounds.w)});
+							float dy = std::max({bounds.y - point.y,0.0f,point.y - (bounds.y + bounds.h)});
+							found += ((dx * dx + dy * dy) <= SPATIAL_QUERY_RADIUS * SPATIAL_QUERY_RADIUS) ? 1 : 0;
+						}
+					};
+					scan(scene.get_rocks());
+					scan(scene.get_projectiles());
+					scan(scene.get_ufos());
+					do_not_optimize(found);
+				}
+			});
+		});
+		runner.run("spatial_query_nearest" + suffix,[&](std::size_t iterations){
+			return time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					hits.clear();
+					scene.query_nearest(points[i % SPATIAL_QUERY_POINT_COUNT],SPATIAL_QUERY_NEAREST_COUNT,layers,hits);
+					do_not_optimize(hits.size());
+				}
+			});
+		});
+		runner.run("spatial_raycast" + suffix,[&](std::size_t iterations){
+			return time_ns([&]{
+				for(std::size_t i = 0;i < iterations;++i)
+				{
+					asteroids::spatial_hit hit{};
+					bool found = scene.raycast(points[i % SPATIAL_QUERY_POINT_COUNT],directions[i % SPATIAL_QUERY_POINT_COUNT],2000.0f,layers,hit);
+					do_not_optimize(found);
+				}
+			});
+		});
+	}
+
+	void benchmark_scene(benchmark_runner& runner)
+	{
+		constexpr std::size_t TICKS_PER_SCENE = 8;
+		const std::array<bool,SDL_NUM_SCANCODES> keyboard_keys{};
+		auto run_scene = [&](const std::string& name,std::size_t population,const asteroids::update_schedule& schedule){
+			runner.run(name,[&](std::size_t iterations){
+				double elapsed = 0.0;
+				for(std::size_t done = 0;done < iterations;done += TICKS_PER_SCENE)
+				{
+					asteroids::scene scene{POPULATION_SEED};
+					scene.set_update_schedule(schedule);
+					populate_scene(scene,population);
+					std::size_t ticks = std::min(TICKS_PER_SCENE,iterations - done);
+					elapsed += time_ns([&]{
+						for(std::size_t i = 0;i < ticks;++i)
+						{
+							scene.update(TICK_DELTA_TIME,keyboard_keys,keyboard_keys);
+						}
+					});
+					do_not_optimize(scene.get_rocks().size());
+				}
+				return elapsed;
+			});
+		};
+		for(std::size_t population : {10,100,1000,10000})
+		{
+			run_scene("scene_update_" + std::to_string(population),population,{});
+		}
+		for(std::size_t population : {100,1000})
+		{
+			run_scene("scene_update_multi_rate_" + std::to_string(population),population,asteroids::MULTI_RATE_SCHEDULE);
+		}
+	}
+}
+
+int main(int argc,char** argv)
+{
+	std::string output_path = "microbench.json";
+	std::string filter{};
+	for(int i = 1;i < argc;++i)
+	{
+		std::string argument = argv[i];
+		if(argument == "--out" && (i + 1) < argc)
+		{
+			output_path = argv[++i];
+		}
+		else if(argument == "--filter" && (i + 1) < argc)
+		{
+			filter = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--out results.json] [--filter name]" << std::endl;
+			return 1;
+		}
+	}
+
+	benchmark_runner runner{filter};
+	benchmark_mesh(runner);
+	benchmark_entity(runner);
+	benchmark_timers(runner);
+	benchmark_scripts(runner);
+	benchmark_random(runner);
+	benchmark_scenario(runner);
+	benchmark_dirty_rects(runner);
+	benchmark_spatial_queries(runner);
+	benchmark_scene(runner);
+
+	std::ofstream output{output_path};
+	if(!output)
+	{
+		std::cerr << "Couldn't open " << output_path << " for writing." << std::endl;
+		return 1;
+	}
+	runner.write_json(output);
+	std::cout << "Results written to " << output_path << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,439 @@
+#include "broadcast.hpp"
+
+#include <array>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr char BROADCAST_MAGIC[8] = {'A','S','T','R','B','C','S','T'};
+		constexpr std::size_t BROADCAST_SLOT_ALIGNMENT = 64;
+
+		std::size_t get_slot_stride(std::uint32_t max_entities) noexcept
+		{
+			std::size_t slot_size = sizeof(broadcast_slot_header) + static_cast<std::size_t>(max_entities) * sizeof(entity_state);
+			return (slot_size + BROADCAST_SLOT_ALIGNMENT - 1) / BROADCAST_SLOT_ALIGNMENT * BROADCAST_SLOT_ALIGNMENT;
+		}
+
+		//Readers map the memory read-only. Lock-free atomic loads are plain loads, so they don't need write access,
+		//but std::atomic_ref only takes non-const objects.
+		std::uint64_t load_shared(const std::uint64_t& value,std::memory_order order) noexcept
+		{
+			return std::atomic_ref<std::uint64_t>{const_cast<std::uint64_t&>(value)}.load(order);
+		}
+
+		void store_shared(std::uint64_t& value,std::uint64_t new_value,std::memory_order order) noexcept
+		{
+			std::atomic_ref<std::uint64_t>{value}.store(new_value,order);
+		}
+
+		std::string get_shared_name(const std::string& name)
+		{
+#ifdef _WIN32
+			return "Local\\" + ((!name.empty() && name.front() == '/') ? name.substr(1) : name);
+#else
+			return (!name.empty() && name.front() == '/') ? name : "/" + name;
+#endif
+		}
+	}
+
+	broadcast_publisher::~broadcast_publisher()
+	{
+		close();
+	}
+
+	bool broadcast_publisher::open(const std::string& name,std::uint32_t slot_count,std::uint32_t max_entities)
+	{
+		close();
+		if(slot_count < 2 || max_entities == 0)
+		{
+			return false;
+		}
+		std::size_t slot_stride = get_slot_stride(max_entities);
+		std::size_t shared_size = sizeof(broadcast_header) + slot_count * slot_stride;
+		shared_name = get_shared_name(name);
+#ifdef _WIN32
+		mapping_handle = CreateFileMappingA(INVALID_HANDLE_VALUE,nullptr,PAGE_READWRITE,static_cast<DWORD>(static_cast<std::uint64_t>(shared_size) >> 32),static_cast<DWORD>(shared_size),shared_name.c_str());
+		if(!mapping_handle)
+		{
+			return false;
+		}
+		//Another game already publishes under this name.
+		if(GetLastError() == ERROR_ALREADY_EXISTS)
+		{
+			close();
+			return false;
+		}
+		data = static_cast<std::uint8_t*>(MapViewOfFile(mapping_handle,FILE_MAP_WRITE,0,0,shared_size));
+		if(!data)
+		{
+			close();
+			return false;
+		}
+#else
+		//Readers of an old ring keep their own copy of it, truncating it under them would crash them instead.
+		shm_unlink(shared_name.c_str());
+		int descriptor = shm_open(shared_name.c_str(),O_RDWR | O_CREAT | O_EXCL,0644);
+		if(descriptor < 0)
+		{
+			return false;
+		}
+		//New shared memory reads back as zeros, so every slot starts out empty.
+		if(ftruncate(descriptor,static_cast<off_t>(shared_size)) != 0)
+		{
+			::close(descriptor);
+			shm_unlink(shared_name.c_str());
+			return false;
+		}
+		void* mapping = mmap(nullptr,shared_size,PROT_READ | PROT_WRITE,MAP_SHARED,descriptor,0);
+		::close(descriptor);
+		if(mapping == MAP_FAILED)
+		{
+			shm_unlink(shared_name.c_str());
+			return false;
+		}
+		data = static_cast<std::uint8_t*>(mapping);
+#endif
+		size = shared_size;
+		published_count = 0;
+		truncated_count = 0;
+		last_tick = 0;
+		auto& header = *reinterpret_cast<broadcast_header*>(data);
+		header.version = BROADCAST_VERSION;
+		header.slot_count = slot_count;
+		header.max_entities = max_entities;
+		header.slot_stride = static_cast<std::uint32_t>(slot_stride);
+		//Readers check the magic last, so they never see a half written header.
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(header.magic,BROADCAST_MAGIC,sizeof(header.magic));
+		return true;
+	}
+
+	void broadcast_publisher::close()
+	{
+		if(data)
+		{
+			store_shared(reinterpret_cast<broadcast_header*>(data)->closed,1,std::memory_order_release);
+		}
+#ifdef _WIN32
+		if(data)
+		{
+			UnmapViewOfFile(data);
+		}
+		if(mapping_handle)
+		{
+			CloseHandle(mapping_handle);
+			mapping_handle = nullptr;
+		}
+#else
+		if(data)
+		{
+			munmap(data,size);
+			shm_unlink(shared_name.c_str());
+		}
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	bool broadcast_publisher::is_open() const noexcept
+	{
+		return data != nullptr;
+	}
+
+	void broadcast_publisher::publish(const scene& scene)
+	{
+		if(!data || (published_count > 0 && scene.get_tick() == last_tick))
+		{
+			return;
+		}
+		auto& header = *reinterpret_cast<broadcast_header*>(data);
+		auto& slot = *reinterpret_cast<broadcast_slot_header*>(data + sizeof(broadcast_header) + (published_count % header.slot_count) * header.slot_stride);
+		//Seqlock: the odd sequence tells readers the slot is being written, the release fence keeps the payload stores after it.
+		store_shared(slot.sequence,published_count * 2 + 1,std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		//The states are written straight into the slot, nothing is staged in between.
+		std::size_t total_count = write_entity_states(scene,reinterpret_cast<entity_state*>(&slot + 1),header.max_entities);
+		slot.tick = scene.get_tick();
+		slot.points = scene.get_player().points;
+		slot.entity_count = static_cast<std::uint32_t>(std::min<std::size_t>(total_count,header.max_entities));
+		slot.total_entity_count = static_cast<std::uint32_t>(total_count);
+		store_shared(slot.sequence,published_count * 2 + 2,std::memory_order_release);
+		if(total_count > header.max_entities)
+		{
+			truncated_count += 1;
+		}
+		last_tick = scene.get_tick();
+		published_count += 1;
+		store_shared(header.published_count,published_count,std::memory_order_release);
+	}
+
+	std::uint64_t broadcast_publisher::get_published_count() const noexcept
+	{
+		return published_count;
+	}
+
+	std::uint64_t broadcast_publisher::get_truncated_count() const noexcept
+	{
+		return truncated_count;
+	}
+
+	broadcast_reader::~broadcast_reader()
+	{
+		close();
+	}
+
+	bool broadcast_reader::open(const std::string& name)
+	{
+		close();
+		std::string shared_name = get_shared_name(name);
+#ifdef _WIN32
+		mapping_handle = OpenFileMappingA(FILE_MAP_READ,FALSE,shared_name.c_str());
+		if(!mapping_handle)
+		{
+			return false;
+		}
+		data = static_cast<const std::uint8_t*>(MapViewOfFile(mapping_handle,FILE_MAP_READ,0,0,0));
+		if(!data)
+		{
+			close();
+			return false;
+		}
+		MEMORY_BASIC_INFORMATION information{};
+		if(VirtualQuery(data,&information,sizeof(information)) == 0)
+		{
+			close();
+			return false;
+		}
+		size = information.RegionSize;
+#else
+		int descriptor = shm_open(shared_name.c_str(),O_RDONLY,0);
+		if(descriptor < 0)
+		{
+			return false;
+		}
+		struct stat status{};
+		if(fstat(descriptor,&status) != 0 || status.st_size <= 0)
+		{
+			::close(descriptor);
+			return false;
+		}
+		void* mapping = mmap(nullptr,static_cast<std::size_t>(status.st_size),PROT_READ,MAP_SHARED,descriptor,0);
+		::close(descriptor);
+		if(mapping == MAP_FAILED)
+		{
+			return false;
+		}
+		data = static_cast<const std::uint8_t*>(mapping);
+		size = static_cast<std::size_t>(status.st_size);
+#endif
+		const broadcast_header& header = get_header();
+		bool valid = size >= sizeof(broadcast_header) && std::memcmp(header.magic,BROADCAST_MAGIC,sizeof(header.magic)) == 0;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		valid = valid && header.version == BROADCAST_VERSION && header.slot_count >= 2 && header.max_entities > 0 && header.slot_stride == get_slot_stride(header.max_entities) &&
+			size >= sizeof(broadcast_header) + static_cast<std::size_t>(header.slot_count) * header.slot_stride;
+		if(!valid)
+		{
+			close();
+			return false;
+		}
+		next_index = load_shared(header.published_count,std::memory_order_acquire);
+		next_index = (next_index > 0) ? (next_index - 1) : 0;
+		overwritten_count = 0;
+		read_count = 0;
+		return true;
+	}
+
+	void broadcast_reader::close()
+	{
+#ifdef _WIN32
+		if(data)
+		{
+			UnmapViewOfFile(data);
+		}
+		if(mapping_handle)
+		{
+			CloseHandle(mapping_handle);
+			mapping_handle = nullptr;
+		}
+#else
+		if(data)
+		{
+			munmap(const_cast<std::uint8_t*>(data),size);
+		}
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	bool broadcast_reader::is_open() const noexcept
+	{
+		return data != nullptr;
+	}
+
+	broadcast_read_result broadcast_reader::read_next(broadcast_frame& frame)
+	{
+		while(true)
+		{
+			broadcast_read_result result = visit_next([&frame](const broadcast_tick_view& view){
+				frame.tick = view.tick;
+				frame.points = view.points;
+				frame.total_entity_count = view.total_entity_count;
+				frame.entities.assign(view.entities,view.entities + view.entity_count);
+			});
+			if(result != broadcast_read_result::overwritten)
+			{
+				return result;
+			}
+		}
+	}
+
+	std::uint64_t broadcast_reader::get_lag() const noexcept
+	{
+		if(!data)
+		{
+			return 0;
+		}
+		return load_shared(get_header().published_count,std::memory_order_relaxed) - next_index;
+	}
+
+	std::uint64_t broadcast_reader::get_overwritten_count() const noexcept
+	{
+		return overwritten_count;
+	}
+
+	std::uint64_t broadcast_reader::get_read_count() const noexcept
+	{
+		return read_count;
+	}
+
+	broadcast_read_result broadcast_reader::begin_read(broadcast_tick_view& view,std::uint64_t& sequence)
+	{
+		if(!data)
+		{
+			return broadcast_read_result::closed;
+		}
+		const broadcast_header& header = get_header();
+		std::uint64_t published = load_shared(header.published_count,std::memory_order_acquire);
+		if(next_index >= published)
+		{
+			return (load_shared(header.closed,std::memory_order_acquire) != 0) ? broadcast_read_result::closed : broadcast_read_result::no_new_tick;
+		}
+		//The slot after the newest one may be being written already, a reader that far behind skips to the oldest slot that is safe to read.
+		if((published - next_index) >= header.slot_count)
+		{
+			std::uint64_t oldest = published - header.slot_count + 1;
+			overwritten_count += oldest - next_index;
+			next_index = oldest;
+		}
+		const broadcast_slot_header& slot = get_slot(next_index);
+		sequence = load_shared(slot.sequence,std::memory_order_acquire);
+		if(sequence != next_index * 2 + 2)
+		{
+			overwritten_count += 1;
+			next_index += 1;
+			return broadcast_read_result::overwritten;
+		}
+		view.tick = slot.tick;
+		view.points = slot.points;
+		view.entities = reinterpret_cast<const entity_state*>(&slot + 1);
+		//A torn count must never send the caller past the slot.
+		view.entity_count = std::min<std::size_t>(slot.entity_count,header.max_entities);
+		view.total_entity_count = slot.total_entity_count;
+		return broadcast_read_result::tick;
+	}
+
+	broadcast_read_result broadcast_reader::end_read(std::uint64_t sequence)
+	{
+		//Keeps the payload loads before the sequence is checked again.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		bool intact = load_shared(get_slot(next_index).sequence,std::memory_order_relaxed) == sequence;
+		next_index += 1;
+		if(!intact)
+		{
+			overwritten_count += 1;
+			return broadcast_read_result::overwritten;
+		}
+		read_count += 1;
+		return broadcast_read_result::tick;
+	}
+
+	const broadcast_header& broadcast_reader::get_header() const noexcept
+	{
+		return *reinterpret_cast<const broadcast_header*>(data);
+	}
+
+	const broadcast_slot_header& broadcast_reader::get_slot(std::uint64_t index) const noexcept
+	{
+		const broadcast_header& header = get_header();
+		return *reinterpret_cast<const broadcast_slot_header*>(data + sizeof(broadcast_header) + (index % header.slot_count) * header.slot_stride);
+	}
+
+	int run_spectator(const std::string& name,std::ostream& log)
+	{
+		broadcast_reader reader{};
+		if(!reader.open(name))
+		{
+			log << "Nothing is broadcast under " << name << "." << std::endl;
+			return 1;
+		}
+		broadcast_frame frame{};
+		bool has_frame = false;
+		auto report_time = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+		while(true)
+		{
+			broadcast_read_result result = reader.read_next(frame);
+			if(result == broadcast_read_result::tick)
+			{
+				has_frame = true;
+				continue;
+			}
+			if(result == broadcast_read_result::closed)
+			{
+				break;
+			}
+			if(std::chrono::steady_clock::now() >= report_time)
+			{
+				report_time += std::chrono::seconds(1);
+				if(has_frame)
+				{
+					std::array<std::size_t,static_cast<std::size_t>(prototype_id::ufo) + 1> counts{};
+					for(const auto& state : frame.entities)
+					{
+						if(static_cast<std::size_t>(state.prototype) < counts.size())
+						{
+							counts[static_cast<std::size_t>(state.prototype)] += 1;
+						}
+					}
+					std::size_t rocks = counts[static_cast<std::size_t>(prototype_id::big_rock_0)] + counts[static_cast<std::size_t>(prototype_id::big_rock_1)] +
+						counts[static_cast<std::size_t>(prototype_id::small_rock_0)] + counts[static_cast<std::size_t>(prototype_id::small_rock_1)];
+					log << "Tick " << frame.tick << ": " << frame.points << " points, " << rocks << " rocks, " << counts[static_cast<std::size_t>(prototype_id::bullet)] << " projectiles, "
+						<< counts[static_cast<std::size_t>(prototype_id::ufo)] << " UFOs, " << counts[static_cast<std::size_t>(prototype_id::destruction_fragment)] << " particles";
+					if(frame.total_entity_count > frame.entities.size())
+					{
+						log << " (" << (frame.total_entity_count - frame.entities.size()) << " entities didn't fit)";
+					}
+					log << "." << std::endl;
+				}
+				log << "Read " << reader.get_read_count() << " ticks, " << reader.get_lag() << " behind, " << reader.get_overwritten_count() << " overwritten." << std::endl;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		log << "The broadcast ended after " << reader.get_read_count() << " ticks, " << reader.get_overwritten_count() << " were overwritten before they were read." << std::endl;
+		return 0;
+	}
+}
\ No newline at end of file
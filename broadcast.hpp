@@ -0,0 +1,162 @@
+#ifndef ASTEROIDS_BROADCAST_HPP
+#define ASTEROIDS_BROADCAST_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include "scene.hpp"
+#include "snapshot.hpp"
+
+namespace asteroids
+{
+	inline constexpr std::uint32_t DEFAULT_BROADCAST_SLOTS = 64;
+	inline constexpr std::uint32_t DEFAULT_BROADCAST_MAX_ENTITIES = 4096;
+	inline constexpr std::uint32_t BROADCAST_VERSION = 1;
+
+	//The shared memory is a raw image of these structures, readers have to be built for the same architecture as the game.
+	//The sequences and counters are only accessed through std::atomic_ref, so they are plain integers here.
+	struct alignas(64) broadcast_header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t slot_count;
+		std::uint32_t max_entities;
+		std::uint32_t slot_stride;
+		//Ticks published so far, tick n is in slot n % slot_count.
+		alignas(8) std::uint64_t published_count;
+		alignas(8) std::uint64_t closed;
+	};
+
+	//Followed by 'max_entities' entity states. The sequence is 2n + 1 while tick n is written into the slot and 2n + 2 once it is complete.
+	struct broadcast_slot_header
+	{
+		alignas(8) std::uint64_t sequence;
+		std::uint64_t tick;
+		std::uint64_t points;
+		std::uint32_t entity_count;
+		//Entities in the scene, more than 'entity_count' when they didn't fit into the slot.
+		std::uint32_t total_entity_count;
+	};
+
+	static_assert(std::atomic_ref<std::uint64_t>::is_always_lock_free,"Shared memory needs lock-free atomics to be used by several processes.");
+
+	//Zero-copy view of a slot, only valid until the read is validated.
+	struct broadcast_tick_view
+	{
+		std::uint64_t tick;
+		std::uint64_t points;
+		const entity_state* entities;
+		std::size_t entity_count;
+		std::size_t total_entity_count;
+	};
+
+	struct broadcast_frame
+	{
+		std::uint64_t tick{};
+		std::uint64_t points{};
+		std::size_t total_entity_count{};
+		std::vector<entity_state> entities{};
+	};
+
+	enum class broadcast_read_result : std::uint8_t
+	{
+		tick,
+		no_new_tick,
+		//The writer lapped the reader while it was reading, the tick is lost.
+		overwritten,
+		closed
+	};
+
+	//Publishes the entities of every tick into a ring of slots in named shared memory. The writer never waits for readers,
+	//a reader that falls a whole ring behind loses the ticks that were overwritten and is told so.
+	class broadcast_publisher
+	{
+	public:
+		broadcast_publisher() = default;
+		broadcast_publisher(const broadcast_publisher&) = delete;
+		broadcast_publisher& operator = (const broadcast_publisher&) = delete;
+		~broadcast_publisher();
+
+		//Replaces a ring left behind under 'name', readers that still have it mapped see it stop instead of crashing.
+		bool open(const std::string& name,std::uint32_t slot_count = DEFAULT_BROADCAST_SLOTS,std::uint32_t max_entities = DEFAULT_BROADCAST_MAX_ENTITIES);
+		void close();
+		bool is_open() const noexcept;
+		//Does nothing when the scene's tick is the one published last, so it can be called every frame.
+		void publish(const scene& scene);
+		std::uint64_t get_published_count() const noexcept;
+		//Ticks that had more entities than fit into a slot.
+		std::uint64_t get_truncated_count() const noexcept;
+
+	private:
+		std::uint8_t* data{};
+		std::size_t size{};
+		std::string shared_name{};
+		std::uint64_t published_count{};
+		std::uint64_t truncated_count{};
+		std::uint64_t last_tick{};
+#ifdef _WIN32
+		void* mapping_handle{};
+#endif
+	};
+
+	//Any number of readers can follow one publisher, each only reads the shared memory and keeps its own position.
+	class broadcast_reader
+	{
+	public:
+		broadcast_reader() = default;
+		broadcast_reader(const broadcast_reader&) = delete;
+		broadcast_reader& operator = (const broadcast_reader&) = delete;
+		~broadcast_reader();
+
+		//Starts at the newest published tick.
+		bool open(const std::string& name);
+		void close();
+		bool is_open() const noexcept;
+
+		//Calls 'function' with a broadcast_tick_view pointing into shared memory. The writer may change the slot while it runs,
+		//so 'function' must not trust what it reads until this returns broadcast_read_result::tick, anything else means it has to be discarded.
+		template<typename F>
+		broadcast_read_result visit_next(F&& function)
+		{
+			broadcast_tick_view view{};
+			std::uint64_t sequence{};
+			broadcast_read_result result = begin_read(view,sequence);
+			if(result != broadcast_read_result::tick)
+			{
+				return result;
+			}
+			function(view);
+			return end_read(sequence);
+		}
+		//Copies the next tick, skipping ticks that are overwritten while being read.
+		broadcast_read_result read_next(broadcast_frame& frame);
+
+		//Ticks published that this reader hasn't read yet.
+		std::uint64_t get_lag() const noexcept;
+		std::uint64_t get_overwritten_count() const noexcept;
+		std::uint64_t get_read_count() const noexcept;
+
+	private:
+		broadcast_read_result begin_read(broadcast_tick_view& view,std::uint64_t& sequence);
+		broadcast_read_result end_read(std::uint64_t sequence);
+		const broadcast_header& get_header() const noexcept;
+		const broadcast_slot_header& get_slot(std::uint64_t index) const noexcept;
+
+		const std::uint8_t* data{};
+		std::size_t size{};
+		std::uint64_t next_index{};
+		std::uint64_t overwritten_count{};
+		std::uint64_t read_count{};
+#ifdef _WIN32
+		void* mapping_handle{};
+#endif
+	};
+
+	//Follows the broadcast 'name' and prints what it sees once a second until the publisher closes it.
+	int run_spectator(const std::string& name,std::ostream& log);
+}
+
+#endif
\ No newline at end of file
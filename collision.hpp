@@ -0,0 +1,80 @@
+#ifndef ASTEROIDS_COLLISION_HPP
+#define ASTEROIDS_COLLISION_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace asteroids
+{
+	enum class collision_layer : std::uint8_t
+	{
+		player,
+		rock,
+		ufo,
+		friendly_projectile,
+		hostile_projectile,
+		particle
+	};
+
+	inline constexpr std::size_t COLLISION_LAYER_COUNT = 6;
+
+	constexpr const char* get_collision_layer_name(collision_layer layer) noexcept
+	{
+		constexpr std::array<const char*,COLLISION_LAYER_COUNT> NAMES{"player","rock","ufo","friendly_projectile","hostile_projectile","particle"};
+		return NAMES[static_cast<std::size_t>(layer)];
+	}
+
+	//Bit 'n' stands for the layer with the value 'n'.
+	using collision_mask = std::uint32_t;
+
+	constexpr collision_mask get_layer_bit(collision_layer layer) noexcept
+	{
+		return collision_mask{1} << static_cast<std::uint32_t>(layer);
+	}
+
+	//Layers every layer collides with. The matrix has to be symmetric, the scene tests each pair of layers once.
+	inline constexpr std::array<collision_mask,COLLISION_LAYER_COUNT> COLLISION_MATRIX{
+		get_layer_bit(collision_layer::rock) | get_layer_bit(collision_layer::ufo) | get_layer_bit(collision_layer::hostile_projectile),
+		get_layer_bit(collision_layer::player) | get_layer_bit(collision_layer::friendly_projectile),
+		get_layer_bit(collision_layer::player) | get_layer_bit(collision_layer::friendly_projectile),
+		get_layer_bit(collision_layer::rock) | get_layer_bit(collision_layer::ufo),
+		get_layer_bit(collision_layer::player),
+		0
+	};
+
+	constexpr collision_mask get_collision_mask(collision_layer layer) noexcept
+	{
+		return COLLISION_MATRIX[static_cast<std::size_t>(layer)];
+	}
+
+	constexpr bool layers_collide(collision_layer a,collision_layer b) noexcept
+	{
+		return (get_collision_mask(a) & get_layer_bit(b)) != 0;
+	}
+
+	constexpr bool is_collision_matrix_symmetric() noexcept
+	{
+		for(std::size_t a = 0;a < COLLISION_LAYER_COUNT;++a)
+		{
+			for(std::size_t b = 0;b < COLLISION_LAYER_COUNT;++b)
+			{
+				if(layers_collide(static_cast<collision_layer>(a),static_cast<collision_layer>(b)) != layers_collide(static_cast<collision_layer>(b),static_cast<collision_layer>(a)))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	static_assert(is_collision_matrix_symmetric());
+
+	//A pair is tested only when each side's mask contains the other side's layer.
+	constexpr bool filter_collision_pair(collision_layer a_layer,collision_mask a_mask,collision_layer b_layer,collision_mask b_mask) noexcept
+	{
+		return (a_mask & get_layer_bit(b_layer)) != 0 && (b_mask & get_layer_bit(a_layer)) != 0;
+	}
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "commands.hpp"
+
+namespace asteroids
+{
+	void command_buffer::push(const command& _command)
+	{
+		if(std::holds_alternative<spawn_rock_command>(_command))
+		{
+			pending_rock_count += 1;
+		}
+		else if(std::holds_alternative<split_rock_command>(_command))
+		{
+			pending_rock_count += SPLIT_ROCK_FRAGMENT_COUNT;
+		}
+		else if(std::holds_alternative<spawn_projectile_command>(_command))
+		{
+			pending_projectile_count += 1;
+		}
+		else if(std::holds_alternative<spawn_ufo_command>(_command))
+		{
+			pending_ufo_count += 1;
+		}
+		commands.push_back(_command);
+	}
+
+	void command_buffer::clear() noexcept
+	{
+		commands.clear();
+		pending_rock_count = 0;
+		pending_projectile_count = 0;
+		pending_ufo_count = 0;
+	}
+
+	const std::vector<command>& command_buffer::get_commands() const noexcept
+	{
+		return commands;
+	}
+
+	std::size_t command_buffer::get_pending_rock_count() const noexcept
+	{
+		return pending_rock_count;
+	}
+
+	std::size_t command_buffer::get_pending_projectile_count() const noexcept
+	{
+		return pending_projectile_count;
+	}
+
+	std::size_t command_buffer::get_pending_ufo_count() const noexcept
+	{
+		return pending_ufo_count;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#ifndef ASTEROIDS_COMMANDS_HPP
+#define ASTEROIDS_COMMANDS_HPP
+
+#include <vector>
+#include <variant>
+#include <cstdint>
+#include <cstddef>
+#include <SDL_rect.h>
+#include "entity_pool.hpp"
+#include "fixed_point.hpp"
+#include "spsc_queue.hpp"
+
+namespace asteroids
+{
+	struct rock_template;
+
+	inline constexpr std::size_t SPLIT_ROCK_FRAGMENT_COUNT = 4;
+	inline constexpr std::size_t PLAYER_DEATH_PARTICLE_COUNT = 6;
+
+	enum class entity_kind : std::uint8_t
+	{
+		rock,
+		projectile,
+		ufo
+	};
+
+	inline constexpr std::size_t ENTITY_KIND_COUNT = 3;
+
+	struct spawn_rock_command
+	{
+		SDL_FPoint position;
+		float rotation;
+		const rock_template* $template;
+		fixed_vector fixed_position{};
+		binary_angle fixed_rotation{};
+	};
+
+	struct split_rock_command
+	{
+		SDL_FPoint position;
+		std::uint32_t rock_id;
+		fixed_vector fixed_position{};
+	};
+
+	struct spawn_projectile_command
+	{
+		SDL_FPoint position;
+		float rotation;
+		float move_speed;
+		bool player_friendly;
+		fixed_vector fixed_position{};
+		binary_angle fixed_rotation{};
+	};
+
+	struct spawn_ufo_command
+	{
+		SDL_FPoint position;
+		SDL_FPoint direction;
+		fixed_vector fixed_position{};
+	};
+
+	struct spawn_particles_command
+	{
+		SDL_FPoint position;
+		std::size_t count;
+	};
+
+	struct destroy_command
+	{
+		entity_kind kind;
+		entity_handle handle;
+	};
+
+	struct add_points_command
+	{
+		std::uintmax_t points;
+	};
+
+	struct kill_player_command
+	{};
+
+	struct play_sound_command
+	{
+		sound_effect effect;
+	};
+
+	using command = std::variant<
+		spawn_rock_command,
+		split_rock_command,
+		spawn_projectile_command,
+		spawn_ufo_command,
+		spawn_particles_command,
+		destroy_command,
+		add_points_command,
+		kill_player_command,
+		play_sound_command
+	>;
+
+	class command_buffer
+	{
+	public:
+		void push(const command& _command);
+		void clear() noexcept;
+		const std::vector<command>& get_commands() const noexcept;
+		std::size_t get_pending_rock_count() const noexcept;
+		std::size_t get_pending_projectile_count() const noexcept;
+		std::size_t get_pending_ufo_count() const noexcept;
+
+	private:
+		std::vector<command> commands{};
+		std::size_t pending_rock_count{};
+		std::size_t pending_projectile_count{};
+		std::size_t pending_ufo_count{};
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "dirty_rects.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace asteroids
+{
+	namespace
+	{
+		//Lines are rasterized on the pixels the bounds round to, one more pixel on every side covers the rounding.
+		constexpr int LINE_PADDING = 1;
+		//Ends the merge early when the rects would outgrow MAX_DIRTY_RECTS by far anyway.
+		constexpr std::size_t MAX_UNMERGED_DIRTY_RECTS = MAX_DIRTY_RECTS * 8;
+
+		SDL_Rect unite_int_rects(const SDL_Rect& a,const SDL_Rect& b) noexcept
+		{
+			int left = std::min(a.x,b.x);
+			int top = std::min(a.y,b.y);
+			int right = std::max(a.x + a.w,b.x + b.w);
+			int bottom = std::max(a.y + a.h,b.y + b.h);
+			return {left,top,right - left,bottom - top};
+		}
+	}
+
+	std::uint64_t hash_outline(const SDL_FPoint* points,std::size_t count) noexcept
+	{
+		std::uint64_t hash = 1469598103934665603ull;
+		for(std::size_t i = 0;i < count;++i)
+		{
+			std::uint64_t bits{};
+			std::memcpy(&bits,&points[i],sizeof(bits));
+			hash = (hash ^ bits) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool intersect_int_rects(const SDL_Rect& a,const SDL_Rect& b) noexcept
+	{
+		return a.x < (b.x + b.w) && b.x < (a.x + a.w) && a.y < (b.y + b.h) && b.y < (a.y + a.h);
+	}
+
+	dirty_rect_tracker::dirty_rect_tracker(int _width,int _height) : width(_width),height(_height)
+	{}
+
+	void dirty_rect_tracker::invalidate() noexcept
+	{
+		full_redraw = true;
+	}
+
+	void dirty_rect_tracker::begin_frame()
+	{
+		std::swap(previous_items,current_items);
+		current_items.clear();
+	}
+
+	void dirty_rect_tracker::add(std::uint64_t key,const SDL_FRect& bounds,std::uint64_t stamp)
+	{
+		current_items.push_back({key,bounds,stamp});
+	}
+
+	const std::vector<SDL_Rect>& dirty_rect_tracker::end_frame()
+	{
+		dirty_rects.clear();
+		auto by_key = [](const item& a,const item& b){ return a.key < b.key; };
+		std::sort(current_items.begin(),current_items.end(),by_key);
+
+		if(!full_redraw)
+		{
+			//Both lists are sorted by key, so one merge walk pairs every drawable with its previous frame.
+			std::size_t i = 0;
+			std::size_t j = 0;
+			while((i < previous_items.size() || j < current_items.size()) && !full_redraw)
+			{
+				if(j == current_items.size() || (i < previous_items.size() && previous_items[i].key < current_items[j].key))
+				{
+					mark_dirty(previous_items[i++].bounds);
+				}
+				else if(i == previous_items.size() || current_items[j].key < previous_items[i].key)
+				{
+					mark_dirty(current_items[j++].bounds);
+				}
+				else
+				{
+					const item& before = previous_items[i++];
+					const item& after = current_items[j++];
+					if(before.stamp != after.stamp || std::memcmp(&before.bounds,&after.bounds,sizeof(SDL_FRect)) != 0)
+					{
+						mark_dirty(before.bounds);
+						mark_dirty(after.bounds);
+					}
+				}
+				if(dirty_rects.size() > MAX_UNMERGED_DIRTY_RECTS)
+				{
+					merge_dirty_rects();
+					full_redraw = dirty_rects.size() > MAX_DIRTY_RECTS;
+				}
+			}
+		}
+		if(!full_redraw)
+		{
+			merge_dirty_rects();
+			dirty_area = 0;
+			for(const auto& rect : dirty_rects)
+			{
+				dirty_area += static_cast<std::uint64_t>(rect.w) * static_cast<std::uint64_t>(rect.h);
+			}
+			full_redraw = dirty_rects.size() > MAX_DIRTY_RECTS || static_cast<double>(dirty_area) > static_cast<double>(width) * height * MAX_DIRTY_AREA_SHARE;
+		}
+		if(full_redraw)
+		{
+			dirty_rects.assign(1,SDL_Rect{0,0,width,height});
+			dirty_area = static_cast<std::uint64_t>(width) * static_cast<std::uint64_t>(height);
+		}
+		//The flag describes the frame just finished, the next one starts incremental again.
+		last_frame_full = full_redraw;
+		full_redraw = false;
+		return dirty_rects;
+	}
+
+	bool dirty_rect_tracker::is_full_redraw() const noexcept
+	{
+		return last_frame_full;
+	}
+
+	std::uint64_t dirty_rect_tracker::get_dirty_area() const noexcept
+	{
+		return dirty_area;
+	}
+
+	void dirty_rect_tracker::mark_dirty(const SDL_FRect& bounds)
+	{
+		int left = std::max(static_cast<int>(std::floor(bounds.x)) - LINE_PADDING,0);
+		int top = std::max(static_cast<int>(std::floor(bounds.y)) - LINE_PADDING,0);
+		int right = std::min(static_cast<int>(std::ceil(bounds.x + bounds.w)) + LINE_PADDING + 1,width);
+		int bottom = std::min(static_cast<int>(std::ceil(bounds.y + bounds.h)) + LINE_PADDING + 1,height);
+		if(left < right && top < bottom)
+		{
+			dirty_rects.push_back({left,top,right - left,bottom - top});
+		}
+	}
+
+	//Unites overlapping rects until none overlap, so no pixel is cleared, redrawn or presented twice.
+	void dirty_rect_tracker::merge_dirty_rects()
+	{
+		bool merged = true;
+		while(merged)
+		{
+			merged = false;
+			for(std::size_t i = 0;i < dirty_rects.size();++i)
+			{
+				for(std::size_t j = i + 1;j < dirty_rects.size();)
+				{
+					if(intersect_int_rects(dirty_rects[i],dirty_rects[j]))
+					{
+						dirty_rects[i] = unite_int_rects(dirty_rects[i],dirty_rects[j]);
+						dirty_rects[j] = dirty_rects.back();
+						dirty_rects.pop_back();
+						merged = true;
+					}
+					else
+					{
+						++j;
+					}
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef ASTEROIDS_DIRTY_RECTS_HPP
+#define ASTEROIDS_DIRTY_RECTS_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <SDL_rect.h>
+
+namespace asteroids
+{
+	//More regions than this aren't worth clipping and presenting one by one, the whole target is redrawn instead.
+	inline constexpr std::size_t MAX_DIRTY_RECTS = 32;
+	//Same for a dirty area above this share of the target.
+	inline constexpr double MAX_DIRTY_AREA_SHARE = 0.5;
+
+	//Fingerprint of an outline, so a mesh that turned in place without changing its bounding box is still redrawn.
+	std::uint64_t hash_outline(const SDL_FPoint* points,std::size_t count) noexcept;
+
+	//Compares what is drawn this frame with what was drawn the previous one and yields the regions that changed:
+	//the old and new bounds of everything that moved, changed its outline or color, appeared or disappeared.
+	class dirty_rect_tracker
+	{
+	public:
+		dirty_rect_tracker(int _width,int _height);
+
+		//The next frame is redrawn and presented whole, for example after the target's contents were lost.
+		void invalidate() noexcept;
+		void begin_frame();
+		//'key' has to identify the same drawable across frames, 'stamp' changes whenever its pixels would.
+		void add(std::uint64_t key,const SDL_FRect& bounds,std::uint64_t stamp);
+		//Regions to clear, redraw and present, already padded for line rasterization, clipped and merged.
+		const std::vector<SDL_Rect>& end_frame();
+		bool is_full_redraw() const noexcept;
+		std::uint64_t get_dirty_area() const noexcept;
+
+	private:
+		struct item
+		{
+			std::uint64_t key;
+			SDL_FRect bounds;
+			std::uint64_t stamp;
+		};
+
+		void mark_dirty(const SDL_FRect& bounds);
+		void merge_dirty_rects();
+
+		int width{};
+		int height{};
+		bool full_redraw{true};
+		bool last_frame_full{};
+		std::vector<item> previous_items{};
+		std::vector<item> current_items{};
+		std::vector<SDL_Rect> dirty_rects{};
+		std::uint64_t dirty_area{};
+	};
+
+	bool intersect_int_rects(const SDL_Rect& a,const SDL_Rect& b) noexcept;
+}
+
+#endif
\ No newline at end of file
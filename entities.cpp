@@ -1,17 +1,321 @@
 #include "entities.hpp"
 
 #include <cmath>
+#include <span>
+#include <limits>
 #include <iostream>
+#include <algorithm>
 #include "utility.hpp"
 
 namespace asteroids
 {
+	namespace
+	{
+		double cross_product(const SDL_FPoint& a,const SDL_FPoint& b,const SDL_FPoint& c)
+		{
+			return (static_cast<double>(b.x) - a.x) * (static_cast<double>(c.y) - a.y) - (static_cast<double>(b.y) - a.y) * (static_cast<double>(c.x) - a.x);
+		}
+
+		bool segments_touch(const SDL_FPoint& a,const SDL_FPoint& b,const SDL_FPoint& c,const SDL_FPoint& d)
+		{
+			double d1 = cross_product(c,d,a);
+			double d2 = cross_product(c,d,b);
+			double d3 = cross_product(a,b,c);
+			double d4 = cross_product(a,b,d);
+			if(((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+			{
+				return true;
+			}
+			auto on_segment = [](const SDL_FPoint& p,const SDL_FPoint& q,const SDL_FPoint& r){
+				return std::min(p.x,q.x) <= r.x && r.x <= std::max(p.x,q.x) && std::min(p.y,q.y) <= r.y && r.y <= std::max(p.y,q.y);
+			};
+			return (d1 == 0 && on_segment(c,d,a)) || (d2 == 0 && on_segment(c,d,b)) || (d3 == 0 && on_segment(a,b,c)) || (d4 == 0 && on_segment(a,b,d));
+		}
+
+		//Collinear vertices are allowed, SAT only gets a duplicate axis out of them.
+		bool is_convex(const std::vector<SDL_FPoint>& vertices,const std::vector<std::uint16_t>& polygon,double winding)
+		{
+			std::size_t length = polygon.size();
+			for(std::size_t i = 0;i < length;++i)
+			{
+				if(cross_product(vertices[polygon[i]],vertices[polygon[(i + 1) % length]],vertices[polygon[(i + 2) % length]]) * winding < 0)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool is_simple_polygon(const std::vector<SDL_FPoint>& vertices)
+		{
+			std::size_t length = vertices.size();
+			for(std::size_t i = 0;i < length;++i)
+			{
+				for(std::size_t j = i + 2;j < length;++j)
+				{
+					if(i == 0 && j == (length - 1))
+					{
+						continue;
+					}
+					if(segments_touch(vertices[i],vertices[i + 1],vertices[j],vertices[(j + 1) % length]))
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		//Splits a simple polygon into triangles by ear clipping, then removes every diagonal whose two sides still form
+		//a convex polygon when merged (Hertel-Mehlhorn). That's at most four times the optimal number of parts.
+		bool decompose_into_convex_parts(const std::vector<SDL_FPoint>& vertices,double winding,std::vector<std::vector<std::uint16_t>>& parts)
+		{
+			std::vector<std::uint16_t> remaining(vertices.size());
+			for(std::size_t i = 0;i < remaining.size();++i)
+			{
+				remaining[i] = static_cast<std::uint16_t>(i);
+			}
+			while(remaining.size() > 3)
+			{
+				bool clipped = false;
+				for(std::size_t i = 0;i < remaining.size() && !clipped;++i)
+				{
+					std::uint16_t previous = remaining[(i + remaining.size() - 1) % remaining.size()];
+					std::uint16_t current = remaining[i];
+					std::uint16_t next = remaining[(i + 1) % remaining.size()];
+					if(cross_product(vertices[previous],vertices[current],vertices[next]) * winding <= 0)
+					{
+						continue;
+					}
+					bool ear = true;
+					for(std::uint16_t other : remaining)
+					{
+						if(other == previous || other == current || other == next)
+						{
+							continue;
+						}
+						if(	cross_product(vertices[previous],vertices[current],vertices[other]) * winding >= 0 &&
+							cross_product(vertices[current],vertices[next],vertices[other]) * winding >= 0 &&
+							cross_product(vertices[next],vertices[previous],vertices[other]) * winding >= 0	)
+						{
+							ear = false;
+							break;
+						}
+					}
+					if(ear)
+					{
+						parts.push_back({previous,current,next});
+						remaining.erase(remaining.begin() + static_cast<std::ptrdiff_t>(i));
+						clipped = true;
+					}
+				}
+				if(!clipped)
+				{
+					return false;
+				}
+			}
+			if(cross_product(vertices[remaining[0]],vertices[remaining[1]],vertices[remaining[2]]) != 0)
+			{
+				parts.push_back(remaining);
+			}
+
+			bool merged = true;
+			while(merged)
+			{
+				merged = false;
+				for(std::size_t a = 0;a < parts.size() && !merged;++a)
+				{
+					for(std::size_t b = a + 1;b < parts.size() && !merged;++b)
+					{
+						const auto& first = parts[a];
+						const auto& second = parts[b];
+						for(std::size_t i = 0;i < first.size() && !merged;++i)
+						{
+							std::uint16_t from = first[i];
+							std::uint16_t to = first[(i + 1) % first.size()];
+							for(std::size_t j = 0;j < second.size();++j)
+							{
+								if(second[j] != to || second[(j + 1) % second.size()] != from)
+								{
+									continue;
+								}
+								//Walks 'first' from 'to' around to 'from', then 'second' from after 'from' up to before 'to'.
+								std::vector<std::uint16_t> polygon{};
+								for(std::size_t k = 0;k < first.size();++k)
+								{
+									polygon.push_back(first[(i + 1 + k) % first.size()]);
+								}
+								for(std::size_t k = 2;k < second.size();++k)
+								{
+									polygon.push_back(second[(j + k) % second.size()]);
+								}
+								if(is_convex(vertices,polygon,winding))
+								{
+									parts[a] = std::move(polygon);
+									parts.erase(parts.begin() + static_cast<std::ptrdiff_t>(b));
+									merged = true;
+								}
+								break;
+							}
+						}
+					}
+				}
+			}
+			return true;
+		}
+
+		void expand_rect(SDL_FPoint& min,SDL_FPoint& max,const SDL_FPoint& point,bool first)
+		{
+			if(first)
+			{
+				min = point;
+				max = point;
+				return;
+			}
+			min.x = std::min(min.x,point.x);
+			min.y = std::min(min.y,point.y);
+			max.x = std::max(max.x,point.x);
+			max.y = std::max(max.y,point.y);
+		}
+
+		//Separating axis test of two convex polygons, true when none of 'normals' separates their projections.
+		bool overlap_on_normals(std::span<const SDL_FPoint> normals,std::span<const SDL_FPoint> vertices,std::span<const SDL_FPoint> other_vertices)
+		{
+			for(const auto& normal : normals)
+			{
+				float min = std::numeric_limits<float>::infinity();
+				float max = std::numeric_limits<float>::infinity();
+				float other_min = std::numeric_limits<float>::infinity();
+				float other_max = std::numeric_limits<float>::infinity();
+				for(const auto& vertex : vertices)
+				{
+					float value = dot_product(normal,vertex);
+					if(std::isinf(min) || value < min)
+					{
+						min = value;
+					}
+					if(std::isinf(max) || value > max)
+					{
+						max = value;
+					}
+				}
+				for(const auto& vertex : other_vertices)
+				{
+					float value = dot_product(normal,vertex);
+					if(std::isinf(other_min) || value < other_min)
+					{
+						other_min = value;
+					}
+					if(std::isinf(other_max) || value > other_max)
+					{
+						other_max = value;
+					}
+				}
+				if(!((min < other_max && min > other_min) || (other_min < max && other_min > min)))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool overlap_on_fixed_normals(std::span<const fixed_vector> normals,std::span<const fixed_vector> vertices,std::span<const fixed_vector> other_vertices)
+		{
+			auto project = [](const fixed_vector& normal,std::span<const fixed_vector> vertices,std::int64_t& min,std::int64_t& max){
+				min = std::numeric_limits<std::int64_t>::max();
+				max = std::numeric_limits<std::int64_t>::min();
+				for(const auto& vertex : vertices)
+				{
+					std::int64_t value = static_cast<std::int64_t>(normal.x) * vertex.x + static_cast<std::int64_t>(normal.y) * vertex.y;
+					min = std::min(min,value);
+					max = std::max(max,value);
+				}
+			};
+			for(const auto& normal : normals)
+			{
+				std::int64_t min{};
+				std::int64_t max{};
+				std::int64_t other_min{};
+				std::int64_t other_max{};
+				project(normal,vertices,min,max);
+				project(normal,other_vertices,other_min,other_max);
+				if(!((min < other_max && min > other_min) || (other_min < max && other_min > min)))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool intersect_fixed_rects(const fixed_rect& a,const fixed_rect& b)
+		{
+			return (a.x + a.w) >= b.x && a.x <= (b.x + b.w) && (a.y + a.h) >= b.y && a.y <= (b.y + b.h);
+		}
+	}
+
 	mesh::mesh(const std::vector<SDL_FPoint>& _vertices,SDL_FPoint _position,float _rotation)
-		: vertices(_vertices),position(_position),rotation(_rotation)
+		: position(_position),rotation(_rotation)
 	{
+		if(_vertices.empty())
+		{
+			//Moved-from entities are reset to an empty mesh, those share one geometry instead of allocating their own.
+			static const std::shared_ptr<const shared_geometry> EMPTY_GEOMETRY = std::make_shared<const shared_geometry>();
+			geometry = EMPTY_GEOMETRY;
+			update();
+			return;
+		}
+		auto shared = std::make_shared<shared_geometry>();
+		std::vector<SDL_FPoint>& vertices = shared->vertices;
+		vertices = _vertices;
+		shared->fixed_local_vertices.resize(((vertices.size() + 3) / 4) * 8);
+		for(std::size_t i = 0;i < vertices.size();++i)
+		{
+			auto to_local = [](float value){
+				long rounded = std::lround(value * (1 << FIXED_VERTEX_SHIFT));
+				return static_cast<std::int16_t>(std::clamp<long>(rounded,std::numeric_limits<std::int16_t>::min(),std::numeric_limits<std::int16_t>::max()));
+			};
+			shared->fixed_local_vertices[i * 2] = to_local(vertices[i].x);
+			shared->fixed_local_vertices[i * 2 + 1] = to_local(vertices[i].y);
+		}
+
+		//SAT is only exact for convex polygons, so concave meshes are split into convex parts once here.
+		double signed_area = 0;
+		for(std::size_t i = 0;i < vertices.size();++i)
+		{
+			const SDL_FPoint& current = vertices[i];
+			const SDL_FPoint& next = vertices[(i + 1) % vertices.size()];
+			signed_area += static_cast<double>(current.x) * next.y - static_cast<double>(next.x) * current.y;
+		}
+		shared->valid = vertices.size() >= 3 && vertices.size() <= std::numeric_limits<std::uint16_t>::max() && signed_area != 0 && is_simple_polygon(vertices);
+		if(shared->valid)
+		{
+			double winding = (signed_area > 0) ? 1.0 : -1.0;
+			std::vector<std::uint16_t> polygon(vertices.size());
+			for(std::size_t i = 0;i < polygon.size();++i)
+			{
+				polygon[i] = static_cast<std::uint16_t>(i);
+			}
+			std::vector<std::vector<std::uint16_t>> parts{};
+			if(!is_convex(vertices,polygon,winding) && decompose_into_convex_parts(vertices,winding,parts))
+			{
+				for(const auto& part : parts)
+				{
+					shared->part_vertex_indices.insert(shared->part_vertex_indices.end(),part.begin(),part.end());
+					shared->part_ends.push_back(static_cast<std::uint16_t>(shared->part_vertex_indices.size()));
+				}
+			}
+		}
+		geometry = std::move(shared);
+		resize_part_buffers();
 		update();
 	}
 
+	mesh::mesh(const mesh& _mesh,deferred_transform_t)
+		: position(_mesh.position),rotation(_mesh.rotation),geometry(_mesh.geometry)
+	{
+		resize_part_buffers();
+	}
+
 	mesh::mesh(const mesh& _mesh)
 	{
 		*this = _mesh;
@@ -28,11 +332,16 @@ namespace asteroids
 		{
 			position = _mesh.position;
 			rotation = _mesh.rotation;
-			vertices = _mesh.vertices;
+			geometry = _mesh.geometry;
 			transformed_vertices = _mesh.transformed_vertices;
 			transformed_bounding_box = _mesh.transformed_bounding_box;
 			transformed_edge_normals = _mesh.transformed_edge_normals;
-			update();
+			parts = _mesh.parts ? std::make_unique<part_buffers>(*_mesh.parts) : nullptr;
+			fixed_transformed_vertices = _mesh.fixed_transformed_vertices;
+			fixed_edge_normals = _mesh.fixed_edge_normals;
+			fixed_bounding_box = _mesh.fixed_bounding_box;
+			fixed_position = _mesh.fixed_position;
+			fixed_rotation = _mesh.fixed_rotation;
 		}
 		return *this;
 	}
@@ -43,21 +352,31 @@ namespace asteroids
 		{
 			position = _mesh.position;
 			rotation = _mesh.rotation;
-			vertices = std::move(_mesh.vertices);
+			geometry = std::move(_mesh.geometry);
 			transformed_vertices = std::move(_mesh.transformed_vertices);
 			transformed_bounding_box = _mesh.transformed_bounding_box;
 			transformed_edge_normals = std::move(_mesh.transformed_edge_normals);
-			update();
-
+			parts = std::move(_mesh.parts);
+			fixed_transformed_vertices = std::move(_mesh.fixed_transformed_vertices);
+			fixed_edge_normals = std::move(_mesh.fixed_edge_normals);
+			fixed_bounding_box = _mesh.fixed_bounding_box;
+			fixed_position = _mesh.fixed_position;
+			fixed_rotation = _mesh.fixed_rotation;
 		}
 		return *this;
 	}
 
 	void mesh::update()
 	{
-		transformed_vertices = {};
-		transformed_edge_normals = {};
+		//Clearing keeps the capacity, so after the first call a mesh transforms without allocating.
+		//The first call sizes both buffers at once instead of growing them vertex by vertex.
+		transformed_vertices.clear();
+		transformed_edge_normals.clear();
+		transformed_vertices.reserve(geometry->vertices.size());
+		transformed_edge_normals.reserve(geometry->part_vertex_indices.empty() ? geometry->vertices.size() : geometry->part_vertex_indices.size());
 		transformed_bounding_box = {};
+		const float cosine = std::cos(rotation);
+		const float sine = std::sin(rotation);
 
 		SDL_FPoint bounding_box_min_transformed{
 			std::numeric_limits<float>::infinity(),
@@ -68,11 +387,11 @@ namespace asteroids
 			std::numeric_limits<float>::infinity()
 		};
 
-		for(const auto& vertex : vertices)
+		for(const auto& vertex : geometry->vertices)
 		{
 			SDL_FPoint new_point{};
-			new_point.x = std::cos(rotation) * vertex.x - std::sin(rotation) * vertex.y + position.x;
-			new_point.y = std::sin(rotation) * vertex.x + std::cos(rotation) * vertex.y + position.y;
+			new_point.x = cosine * vertex.x - sine * vertex.y + position.x;
+			new_point.y = sine * vertex.x + cosine * vertex.y + position.y;
 			if(std::isinf(bounding_box_min_transformed.x) || bounding_box_min_transformed.x > new_point.x)
 			{
 				bounding_box_min_transformed.x = new_point.x;
@@ -96,16 +415,175 @@ namespace asteroids
 		transformed_bounding_box.w = bounding_box_max_transformed.x - bounding_box_min_transformed.x;
 		transformed_bounding_box.h = bounding_box_max_transformed.y - bounding_box_min_transformed.y;
 
-		std::size_t length = transformed_vertices.size();
+		for(std::size_t part = 0;part < get_convex_part_count();++part)
+		{
+			std::size_t begin = get_part_begin(part);
+			std::size_t end = get_part_end(part);
+			SDL_FPoint part_min{};
+			SDL_FPoint part_max{};
+			for(std::size_t i = begin;i < end;++i)
+			{
+				SDL_FPoint current = transformed_vertices[get_part_vertex(i)];
+				SDL_FPoint next = transformed_vertices[get_part_vertex((i + 1 < end) ? (i + 1) : begin)];
+				SDL_FPoint diff{
+					next.x - current.x,
+					next.y - current.y
+				};
+				transformed_edge_normals.push_back(perpendicular(normalize(diff)));
+				expand_rect(part_min,part_max,current,i == begin);
+				if(parts)
+				{
+					parts->vertices[i] = current;
+				}
+			}
+			if(parts)
+			{
+				parts->bounding_boxes[part] = {part_min.x,part_min.y,part_max.x - part_min.x,part_max.y - part_min.y};
+			}
+		}
+	}
+
+	void mesh::set_fixed_pose(fixed_vector _position,binary_angle _rotation) noexcept
+	{
+		fixed_position = _position;
+		fixed_rotation = _rotation;
+		position = {from_fixed(_position.x),from_fixed(_position.y)};
+		rotation = angle_to_radians(_rotation);
+	}
+
+	void mesh::update_fixed(fixed_vector _position,binary_angle _rotation)
+	{
+		fixed_position = _position;
+		fixed_rotation = _rotation;
+		position = {from_fixed(_position.x),from_fixed(_position.y)};
+		rotation = angle_to_radians(_rotation);
+
+		std::size_t length = geometry->vertices.size();
+		fixed_transformed_vertices.resize(length);
+		fixed_edge_normals.resize(geometry->part_vertex_indices.empty() ? length : geometry->part_vertex_indices.size());
+		transformed_vertices.resize(length);
+		fixed_bounding_box = {};
+		transformed_bounding_box = {};
+		if(length == 0)
+		{
+			return;
+		}
+		transform_fixed_vertices(geometry->fixed_local_vertices.data(),length,_rotation,_position,fixed_transformed_vertices.data());
+
+		fixed_vector bounding_box_min = fixed_transformed_vertices[0];
+		fixed_vector bounding_box_max = fixed_transformed_vertices[0];
 		for(std::size_t i = 0;i < length;++i)
 		{
-			SDL_FPoint current = transformed_vertices[i];
-			SDL_FPoint next = transformed_vertices[(i + 1) % length];
-			SDL_FPoint diff{
-				next.x - current.x,
-				next.y - current.y
-			};
-			transformed_edge_normals.push_back(perpendicular(normalize(diff)));
+			const fixed_vector& current = fixed_transformed_vertices[i];
+			bounding_box_min.x = std::min(bounding_box_min.x,current.x);
+			bounding_box_min.y = std::min(bounding_box_min.y,current.y);
+			bounding_box_max.x = std::max(bounding_box_max.x,current.x);
+			bounding_box_max.y = std::max(bounding_box_max.y,current.y);
+			transformed_vertices[i] = {from_fixed(current.x),from_fixed(current.y)};
+		}
+		fixed_bounding_box = {bounding_box_min.x,bounding_box_min.y,bounding_box_max.x - bounding_box_min.x,bounding_box_max.y - bounding_box_min.y};
+		transformed_bounding_box = {from_fixed(fixed_bounding_box.x),from_fixed(fixed_bounding_box.y),from_fixed(fixed_bounding_box.w),from_fixed(fixed_bounding_box.h)};
+
+		for(std::size_t part = 0;part < get_convex_part_count();++part)
+		{
+			std::size_t begin = get_part_begin(part);
+			std::size_t end = get_part_end(part);
+			fixed_vector part_min = fixed_transformed_vertices[get_part_vertex(begin)];
+			fixed_vector part_max = part_min;
+			for(std::size_t i = begin;i < end;++i)
+			{
+				const fixed_vector& current = fixed_transformed_vertices[get_part_vertex(i)];
+				const fixed_vector& next = fixed_transformed_vertices[get_part_vertex((i + 1 < end) ? (i + 1) : begin)];
+				//SAT only compares projections against each other, so the edge normals don't need to be normalized.
+				fixed_edge_normals[i] = {-(next.y - current.y),next.x - current.x};
+				if(parts)
+				{
+					parts->fixed_vertices[i] = current;
+					parts->vertices[i] = transformed_vertices[get_part_vertex(i)];
+				}
+				part_min.x = std::min(part_min.x,current.x);
+				part_min.y = std::min(part_min.y,current.y);
+				part_max.x = std::max(part_max.x,current.x);
+				part_max.y = std::max(part_max.y,current.y);
+			}
+			if(parts)
+			{
+				fixed_rect& box = parts->fixed_bounding_boxes[part];
+				box = {part_min.x,part_min.y,part_max.x - part_min.x,part_max.y - part_min.y};
+				parts->bounding_boxes[part] = {from_fixed(box.x),from_fixed(box.y),from_fixed(box.w),from_fixed(box.h)};
+			}
+		}
+	}
+
+	void mesh::move_to(SDL_FPoint _position)
+	{
+		//A mesh that was never transformed has nothing to move yet.
+		if(transformed_vertices.size() != geometry->vertices.size())
+		{
+			position = _position;
+			update();
+			return;
+		}
+		SDL_FPoint offset{_position.x - position.x,_position.y - position.y};
+		position = _position;
+		for(auto& vertex : transformed_vertices)
+		{
+			vertex.x += offset.x;
+			vertex.y += offset.y;
+		}
+		transformed_bounding_box.x += offset.x;
+		transformed_bounding_box.y += offset.y;
+		if(parts)
+		{
+			for(auto& vertex : parts->vertices)
+			{
+				vertex.x += offset.x;
+				vertex.y += offset.y;
+			}
+			for(auto& box : parts->bounding_boxes)
+			{
+				box.x += offset.x;
+				box.y += offset.y;
+			}
+		}
+	}
+
+	void mesh::move_to_fixed(fixed_vector _position)
+	{
+		if(fixed_transformed_vertices.size() != geometry->vertices.size())
+		{
+			update_fixed(_position,fixed_rotation);
+			return;
+		}
+		//Vertices are rotated first and offset by the position last, so moving them is exact in fixed point.
+		fixed_vector offset{_position.x - fixed_position.x,_position.y - fixed_position.y};
+		fixed_position = _position;
+		position = {from_fixed(_position.x),from_fixed(_position.y)};
+		for(std::size_t i = 0;i < fixed_transformed_vertices.size();++i)
+		{
+			fixed_vector& vertex = fixed_transformed_vertices[i];
+			vertex = {vertex.x + offset.x,vertex.y + offset.y};
+			transformed_vertices[i] = {from_fixed(vertex.x),from_fixed(vertex.y)};
+		}
+		fixed_bounding_box.x += offset.x;
+		fixed_bounding_box.y += offset.y;
+		transformed_bounding_box = {from_fixed(fixed_bounding_box.x),from_fixed(fixed_bounding_box.y),from_fixed(fixed_bounding_box.w),from_fixed(fixed_bounding_box.h)};
+		if(!parts)
+		{
+			return;
+		}
+		for(std::size_t i = 0;i < parts->fixed_vertices.size();++i)
+		{
+			fixed_vector& vertex = parts->fixed_vertices[i];
+			vertex = {vertex.x + offset.x,vertex.y + offset.y};
+			parts->vertices[i] = {from_fixed(vertex.x),from_fixed(vertex.y)};
+		}
+		for(std::size_t part = 0;part < parts->fixed_bounding_boxes.size();++part)
+		{
+			fixed_rect& box = parts->fixed_bounding_boxes[part];
+			box.x += offset.x;
+			box.y += offset.y;
+			parts->bounding_boxes[part] = {from_fixed(box.x),from_fixed(box.y),from_fixed(box.w),from_fixed(box.h)};
 		}
 	}
 
@@ -115,53 +593,66 @@ namespace asteroids
 		{
 			return false;
 		}
-		auto for_each_normal = [](	const std::vector<SDL_FPoint>& in_normals,
-									const std::vector<SDL_FPoint>& transformed_vertices,
-									const std::vector<SDL_FPoint>& other_transformed_vertices	)
+		//Two convex meshes skip the part loop, most pairs in the game are rocks, bullets and the player.
+		if(geometry->part_ends.empty() && other.geometry->part_ends.empty())
+		{
+			return	overlap_on_normals(transformed_edge_normals,transformed_vertices,other.transformed_vertices) &&
+					overlap_on_normals(other.transformed_edge_normals,transformed_vertices,other.transformed_vertices);
+		}
+		for(std::size_t part = 0;part < get_convex_part_count();++part)
 		{
-			for(const auto& normal : in_normals)
+			for(std::size_t other_part = 0;other_part < other.get_convex_part_count();++other_part)
 			{
-				float min = std::numeric_limits<float>::infinity();
-				float max = std::numeric_limits<float>::infinity();
-				float other_min = std::numeric_limits<float>::infinity();
-				float other_max = std::numeric_limits<float>::infinity();
-				for(const auto& vertex : transformed_vertices)
-				{
-					float value = dot_product(normal,vertex);
-					if(std::isinf(min) || value < min)
-					{
-						min = value;
-					}
-					if(std::isinf(max) || value > max)
-					{
-						max = value;
-					}
-				}
-				for(const auto& vertex : other_transformed_vertices)
+				//A convex mesh has no part boxes, its only part was already tested with the whole bounding box.
+				const SDL_FRect& box = parts ? parts->bounding_boxes[part] : transformed_bounding_box;
+				const SDL_FRect& other_box = other.parts ? other.parts->bounding_boxes[other_part] : other.transformed_bounding_box;
+				if(!intersect_rects(box,other_box))
 				{
-					float value = dot_product(normal,vertex);
-					if(std::isinf(other_min) || value < other_min)
-					{
-						other_min = value;
-					}
-					if(std::isinf(other_max) || value > other_max)
-					{
-						other_max = value;
-					}
+					continue;
 				}
-				if(!((min < other_max && min > other_min) || (other_min < max && other_min > min)))
+				auto vertices = get_part_vertices(part);
+				auto other_vertices = other.get_part_vertices(other_part);
+				if(	overlap_on_normals(get_part_normals(part),vertices,other_vertices) &&
+					overlap_on_normals(other.get_part_normals(other_part),vertices,other_vertices)	)
 				{
-					return false;
+					return true;
 				}
 			}
-			return true;
-		};
+		}
+		return false;
+	}
 
-		if(!for_each_normal(transformed_edge_normals,transformed_vertices,other.transformed_vertices))
+	bool mesh::check_collision_with_fixed(const mesh& other) const
+	{
+		if(!intersect_fixed_rects(fixed_bounding_box,other.fixed_bounding_box))
 		{
 			return false;
 		}
-		return for_each_normal(other.transformed_edge_normals,transformed_vertices,other.transformed_vertices);
+		if(geometry->part_ends.empty() && other.geometry->part_ends.empty())
+		{
+			return	overlap_on_fixed_normals(fixed_edge_normals,fixed_transformed_vertices,other.fixed_transformed_vertices) &&
+					overlap_on_fixed_normals(other.fixed_edge_normals,fixed_transformed_vertices,other.fixed_transformed_vertices);
+		}
+		for(std::size_t part = 0;part < get_convex_part_count();++part)
+		{
+			for(std::size_t other_part = 0;other_part < other.get_convex_part_count();++other_part)
+			{
+				const fixed_rect& box = parts ? parts->fixed_bounding_boxes[part] : fixed_bounding_box;
+				const fixed_rect& other_box = other.parts ? other.parts->fixed_bounding_boxes[other_part] : other.fixed_bounding_box;
+				if(!intersect_fixed_rects(box,other_box))
+				{
+					continue;
+				}
+				auto vertices = get_fixed_part_vertices(part);
+				auto other_vertices = other.get_fixed_part_vertices(other_part);
+				if(	overlap_on_fixed_normals(get_fixed_part_normals(part),vertices,other_vertices) &&
+					overlap_on_fixed_normals(other.get_fixed_part_normals(other_part),vertices,other_vertices)	)
+				{
+					return true;
+				}
+			}
+		}
+		return false;
 	}
 
 	SDL_FRect mesh::get_transformed_bounding_box() const
@@ -169,30 +660,137 @@ namespace asteroids
 		return transformed_bounding_box;
 	}
 
+	fixed_rect mesh::get_fixed_bounding_box() const
+	{
+		return fixed_bounding_box;
+	}
+
+	fixed_vector mesh::get_fixed_position() const
+	{
+		return fixed_position;
+	}
+
+	binary_angle mesh::get_fixed_rotation() const
+	{
+		return fixed_rotation;
+	}
+
 	const std::vector<SDL_FPoint>& mesh::get_transformed_vertices() const
 	{
 		return transformed_vertices;
 	}
 
+	const std::vector<SDL_FPoint>& mesh::get_vertices() const
+	{
+		return geometry->vertices;
+	}
+
+	bool mesh::is_valid() const noexcept
+	{
+		return geometry->valid;
+	}
+
+	std::size_t mesh::get_convex_part_count() const noexcept
+	{
+		if(!geometry->part_ends.empty())
+		{
+			return geometry->part_ends.size();
+		}
+		return geometry->vertices.empty() ? 0 : 1;
+	}
+
+	std::vector<std::size_t> mesh::get_convex_part(std::size_t index) const
+	{
+		std::vector<std::size_t> part{};
+		for(std::size_t i = get_part_begin(index);i < get_part_end(index);++i)
+		{
+			part.push_back(get_part_vertex(i));
+		}
+		return part;
+	}
+
+	void mesh::resize_part_buffers()
+	{
+		//Concave meshes transform their parts in place, so the part buffers are sized once per mesh.
+		if(!geometry->part_ends.empty())
+		{
+			parts = std::make_unique<part_buffers>();
+			parts->bounding_boxes.resize(geometry->part_ends.size());
+			parts->vertices.resize(geometry->part_vertex_indices.size());
+			parts->fixed_bounding_boxes.resize(geometry->part_ends.size());
+			parts->fixed_vertices.resize(geometry->part_vertex_indices.size());
+		}
+	}
+
+	std::size_t mesh::get_part_begin(std::size_t part) const noexcept
+	{
+		return (part == 0) ? 0 : geometry->part_ends[part - 1];
+	}
+
+	std::size_t mesh::get_part_end(std::size_t part) const noexcept
+	{
+		return geometry->part_ends.empty() ? geometry->vertices.size() : geometry->part_ends[part];
+	}
+
+	std::size_t mesh::get_part_vertex(std::size_t offset) const noexcept
+	{
+		return geometry->part_vertex_indices.empty() ? offset : geometry->part_vertex_indices[offset];
+	}
+
+	std::span<const SDL_FPoint> mesh::get_part_vertices(std::size_t part) const noexcept
+	{
+		if(geometry->part_ends.empty())
+		{
+			return transformed_vertices;
+		}
+		return std::span<const SDL_FPoint>(parts->vertices).subspan(get_part_begin(part),get_part_end(part) - get_part_begin(part));
+	}
+
+	std::span<const SDL_FPoint> mesh::get_part_normals(std::size_t part) const noexcept
+	{
+		return std::span<const SDL_FPoint>(transformed_edge_normals).subspan(get_part_begin(part),get_part_end(part) - get_part_begin(part));
+	}
+
+	std::span<const fixed_vector> mesh::get_fixed_part_vertices(std::size_t part) const noexcept
+	{
+		if(geometry->part_ends.empty())
+		{
+			return fixed_transformed_vertices;
+		}
+		return std::span<const fixed_vector>(parts->fixed_vertices).subspan(get_part_begin(part),get_part_end(part) - get_part_begin(part));
+	}
+
+	std::span<const fixed_vector> mesh::get_fixed_part_normals(std::size_t part) const noexcept
+	{
+		return std::span<const fixed_vector>(fixed_edge_normals).subspan(get_part_begin(part),get_part_end(part) - get_part_begin(part));
+	}
+
 	entity::entity(SDL_FPoint _position,float _rotation,float _move_speed,float _rotation_speed,const asteroids::mesh & _mesh)
 		: position(_position),rotation(_rotation),move_speed(_move_speed),rotation_speed(_rotation_speed),$mesh(_mesh)
 	{
 		update();
 	}
 
-	entity::entity(const entity& _entity)
-		: position(_entity.position),rotation(_entity.rotation),move_speed(_entity.move_speed),
-			rotation_speed(_entity.rotation_speed),$mesh(_entity.$mesh),destroyed(_entity.destroyed),forward(_entity.forward)
+	entity::entity(SDL_FPoint _position,float _rotation,float _move_speed,float _rotation_speed,const asteroids::mesh& _mesh,deferred_transform_t)
+		: position(_position),rotation(_rotation),move_speed(_move_speed),rotation_speed(_rotation_speed),$mesh(_mesh,deferred_transform)
 	{
-		update();
+		$mesh.position = position;
+		$mesh.rotation = rotation;
 	}
 
+	entity::entity(const entity& _entity)
+		: position(_entity.position),rotation(_entity.rotation),move_speed(_entity.move_speed),
+			rotation_speed(_entity.rotation_speed),destroyed(_entity.destroyed),id(_entity.id),prototype(_entity.prototype),
+			fixed_position(_entity.fixed_position),fixed_rotation(_entity.fixed_rotation),layer(_entity.layer),mask(_entity.mask),
+			$mesh(_entity.$mesh),forward(_entity.forward),fixed_forward(_entity.fixed_forward)
+	{}
+
 	entity::entity(entity&& _entity) noexcept
 		: position(_entity.position),rotation(_entity.rotation),move_speed(_entity.move_speed),
-		rotation_speed(_entity.rotation_speed),$mesh(std::move(_entity.$mesh)),destroyed(_entity.destroyed),forward(_entity.forward)
-	{
-		update();
-	}
+		rotation_speed(_entity.rotation_speed),destroyed(_entity.destroyed),id(_entity.id),prototype(_entity.prototype),
+		fixed_position(_entity.fixed_position),fixed_rotation(_entity.fixed_rotation),layer(_entity.layer),mask(_entity.mask),
+		$mesh(std::move(_entity.$mesh)),forward(_entity.forward),fixed_forward(_entity.fixed_forward)
+	{}
 
 	entity& entity::operator = (const entity& _entity)
 	{
@@ -204,8 +802,14 @@ namespace asteroids
 			rotation_speed = _entity.rotation_speed;
 			$mesh = _entity.$mesh;
 			destroyed = _entity.destroyed;
+			id = _entity.id;
+			prototype = _entity.prototype;
+			fixed_position = _entity.fixed_position;
+			fixed_rotation = _entity.fixed_rotation;
+			layer = _entity.layer;
+			mask = _entity.mask;
 			forward = _entity.forward;
-			update();
+			fixed_forward = _entity.fixed_forward;
 		}
 		return *this;
 	}
@@ -220,7 +824,14 @@ namespace asteroids
 			rotation_speed = _entity.rotation_speed;
 			$mesh = std::move(_entity.$mesh);
 			destroyed = _entity.destroyed;
+			id = _entity.id;
+			prototype = _entity.prototype;
+			fixed_position = _entity.fixed_position;
+			fixed_rotation = _entity.fixed_rotation;
+			layer = _entity.layer;
+			mask = _entity.mask;
 			forward = _entity.forward;
+			fixed_forward = _entity.fixed_forward;
 			_entity.$mesh = {{}};
 		}
 		return *this;
@@ -235,6 +846,47 @@ namespace asteroids
 		forward.y = std::sin(rotation);
 	}
 
+	void entity::update_fixed()
+	{
+		$mesh.update_fixed(fixed_position,fixed_rotation);
+		fixed_forward = {fixed_cos(fixed_rotation),fixed_sin(fixed_rotation)};
+		forward = {from_fixed(fixed_forward.x),from_fixed(fixed_forward.y)};
+	}
+
+	void entity::follow_position()
+	{
+		if($mesh.rotation != rotation)
+		{
+			update();
+			return;
+		}
+		$mesh.move_to(position);
+	}
+
+	void entity::follow_fixed_position()
+	{
+		if($mesh.get_fixed_rotation() != fixed_rotation)
+		{
+			update_fixed();
+			return;
+		}
+		$mesh.move_to_fixed(fixed_position);
+	}
+
+	void entity::sync_float_pose() noexcept
+	{
+		position = {from_fixed(fixed_position.x),from_fixed(fixed_position.y)};
+		rotation = angle_to_radians(fixed_rotation);
+	}
+
+	void entity::set_fixed_pose(fixed_vector _position,binary_angle _rotation) noexcept
+	{
+		fixed_position = _position;
+		fixed_rotation = _rotation;
+		sync_float_pose();
+		$mesh.set_fixed_pose(_position,_rotation);
+	}
+
 	const mesh& entity::get_mesh() const
 	{
 		return $mesh;
@@ -245,20 +897,83 @@ namespace asteroids
 		return forward;
 	}
 
+	fixed_vector entity::get_fixed_forward() const
+	{
+		return fixed_forward;
+	}
+
+	std::uint64_t entity::get_state_hash() const noexcept
+	{
+		std::uint64_t hash = hash_value(STATE_HASH_SEED,position);
+		hash = hash_value(hash,rotation);
+		hash = hash_value(hash,move_speed);
+		hash = hash_value(hash,rotation_speed);
+		hash = hash_value(hash,destroyed);
+		hash = hash_value(hash,id);
+		hash = hash_value(hash,prototype);
+		hash = hash_value(hash,fixed_position);
+		hash = hash_value(hash,fixed_rotation);
+		hash = hash_value(hash,layer);
+		return hash_value(hash,mask);
+	}
+
+	void entity::save_state(binary_writer& writer) const
+	{
+		writer.write(position);
+		writer.write(rotation);
+		writer.write(move_speed);
+		writer.write(rotation_speed);
+		writer.write(destroyed);
+		writer.write(id);
+		writer.write(prototype);
+		writer.write($mesh.position);
+		writer.write($mesh.rotation);
+		writer.write(fixed_position);
+		writer.write(fixed_rotation);
+		writer.write($mesh.get_fixed_position());
+		writer.write($mesh.get_fixed_rotation());
+	}
+
+	bool entity::load_state(binary_reader& reader)
+	{
+		SDL_FPoint mesh_position{};
+		float mesh_rotation{};
+		fixed_vector mesh_fixed_position{};
+		binary_angle mesh_fixed_rotation{};
+		if(!(reader.read(position) && reader.read(rotation) && reader.read(move_speed) && reader.read(rotation_speed) &&
+			reader.read(destroyed) && reader.read(id) && reader.read(prototype) && reader.read(mesh_position) && reader.read(mesh_rotation) &&
+			reader.read(fixed_position) && reader.read(fixed_rotation) && reader.read(mesh_fixed_position) && reader.read(mesh_fixed_rotation)))
+		{
+			return false;
+		}
+		//The mesh and the forward vector lag one update behind the entity, so they are rebuilt from their own pose.
+		$mesh.update_fixed(mesh_fixed_position,mesh_fixed_rotation);
+		fixed_forward = {fixed_cos(mesh_fixed_rotation),fixed_sin(mesh_fixed_rotation)};
+		$mesh.position = mesh_position;
+		$mesh.rotation = mesh_rotation;
+		$mesh.update();
+		forward.x = std::cos(mesh_rotation);
+		forward.y = std::sin(mesh_rotation);
+		return true;
+	}
+
 	player::player(SDL_FPoint _position,float _rotation,float _move_speed,float _rotation_speed,const asteroids::mesh& _mesh)
 		: entity(_position,_rotation,_move_speed,_rotation_speed,_mesh)
-	{}
+	{
+		layer = collision_layer::player;
+		mask = get_collision_mask(layer);
+	}
 
 	player::player(const player& _player) : entity(_player),
-											points(_player.points),dead(_player.dead),max_invulnerability_timer(_player.max_invulnerability_timer),
-											max_respawn_timer(_player.max_respawn_timer),max_shoot_timer(_player.max_shoot_timer),invulnerability_timer(_player.invulnerability_timer),
-											respawn_timer(_player.respawn_timer),shoot_timer(_player.shoot_timer),velocity(_player.velocity)
+											velocity(_player.velocity),fixed_velocity(_player.fixed_velocity),points(_player.points),
+											max_invulnerability_timer(_player.max_invulnerability_timer),max_respawn_timer(_player.max_respawn_timer),
+											max_shoot_timer(_player.max_shoot_timer),dead(_player.dead),invulnerable(_player.invulnerable),shoot_ready(_player.shoot_ready)
 	{}
 
 	player::player(player&& _player) noexcept : entity(std::move(_player)),
-												points(_player.points),dead(_player.dead),max_invulnerability_timer(_player.max_invulnerability_timer),
-												max_respawn_timer(_player.max_respawn_timer),max_shoot_timer(_player.max_shoot_timer),invulnerability_timer(_player.invulnerability_timer),
-												respawn_timer(_player.respawn_timer),shoot_timer(_player.shoot_timer),velocity(_player.velocity)
+												velocity(_player.velocity),fixed_velocity(_player.fixed_velocity),points(_player.points),
+												max_invulnerability_timer(_player.max_invulnerability_timer),max_respawn_timer(_player.max_respawn_timer),
+												max_shoot_timer(_player.max_shoot_timer),dead(_player.dead),invulnerable(_player.invulnerable),shoot_ready(_player.shoot_ready)
 	{}
 
 	player& player::operator = (const player& _player)
@@ -271,10 +986,10 @@ namespace asteroids
 			max_invulnerability_timer = _player.max_invulnerability_timer;
 			max_respawn_timer = _player.max_respawn_timer;
 			max_shoot_timer = _player.max_shoot_timer;
-			invulnerability_timer = _player.invulnerability_timer;
-			respawn_timer = _player.respawn_timer;
-			shoot_timer = _player.shoot_timer;
+			invulnerable = _player.invulnerable;
+			shoot_ready = _player.shoot_ready;
 			velocity = _player.velocity;
+			fixed_velocity = _player.fixed_velocity;
 		}
 		return *this;
 	}
@@ -289,50 +1004,14 @@ namespace asteroids
 			max_invulnerability_timer = _player.max_invulnerability_timer;
 			max_respawn_timer = _player.max_respawn_timer;
 			max_shoot_timer = _player.max_shoot_timer;
-			invulnerability_timer = _player.invulnerability_timer;
-			respawn_timer = _player.respawn_timer;
-			shoot_timer = _player.shoot_timer;
+			invulnerable = _player.invulnerable;
+			shoot_ready = _player.shoot_ready;
 			velocity = _player.velocity;
+			fixed_velocity = _player.fixed_velocity;
 		}
 		return *this;
 	}
 
-	void player::update(float delta_time)
-	{
-		entity::update();
-		if(invulnerability_timer > 0.0f)
-		{
-			invulnerability_timer -= delta_time;
-			if(invulnerability_timer < 0.0f)
-			{
-				invulnerability_timer = 0.0f;
-			}
-		}
-
-		if(shoot_timer > 0.0f)
-		{
-			shoot_timer -= delta_time;
-			if(shoot_timer < 0.0f)
-			{
-				shoot_timer = 0.0f;
-			}
-		}
-
-		if(respawn_timer > 0.0f)
-		{
-			respawn_timer -= delta_time;
-			if(respawn_timer < 0.0f)
-			{
-				respawn_timer = 0.0f;
-				dead = false;
-				position = {512,384}; //TODO: This shouldn't be hardcoded.
-				rotation = 0;
-				velocity = {};
-				make_invulnerable();
-			}
-		}
-	}
-
 	bool player::is_dead() const noexcept
 	{
 		return dead;
@@ -340,33 +1019,98 @@ namespace asteroids
 
 	bool player::is_invulnerable() const noexcept
 	{
-		return invulnerability_timer > 0.0f;
+		return invulnerable;
 	}
 
 	bool player::can_shoot() const noexcept
 	{
-		return shoot_timer <= 0.0f;
+		return shoot_ready;
 	}
 
 	void player::make_it_shoot() noexcept
 	{
-		shoot_timer = max_shoot_timer;
+		shoot_ready = false;
+	}
+
+	void player::make_ready_to_shoot() noexcept
+	{
+		shoot_ready = true;
 	}
 
 	void player::make_invulnerable() noexcept
 	{
-		invulnerability_timer = max_invulnerability_timer;
+		invulnerable = true;
+	}
+
+	void player::end_invulnerability() noexcept
+	{
+		invulnerable = false;
 	}
 
 	void player::kill() noexcept
 	{
 		dead = true;
-		respawn_timer = max_respawn_timer;
+	}
+
+	void player::respawn(SDL_FPoint _position) noexcept
+	{
+		dead = false;
+		position = _position;
+		rotation = 0;
+		velocity = {};
+		fixed_position = {to_fixed(position.x),to_fixed(position.y)};
+		fixed_rotation = 0;
+		fixed_velocity = {};
+		make_invulnerable();
+	}
+
+	std::uint64_t player::get_state_hash() const noexcept
+	{
+		std::uint64_t hash = hash_value(entity::get_state_hash(),velocity);
+		hash = hash_value(hash,fixed_velocity);
+		hash = hash_value(hash,points);
+		hash = hash_value(hash,max_invulnerability_timer);
+		hash = hash_value(hash,max_respawn_timer);
+		hash = hash_value(hash,max_shoot_timer);
+		hash = hash_value(hash,dead);
+		hash = hash_value(hash,invulnerable);
+		return hash_value(hash,shoot_ready);
+	}
+
+	void player::save_state(binary_writer& writer) const
+	{
+		entity::save_state(writer);
+		writer.write(velocity);
+		writer.write(fixed_velocity);
+		writer.write(points);
+		writer.write(max_invulnerability_timer);
+		writer.write(max_respawn_timer);
+		writer.write(max_shoot_timer);
+		writer.write(dead);
+		writer.write(invulnerable);
+		writer.write(shoot_ready);
+	}
+
+	bool player::load_state(binary_reader& reader)
+	{
+		return entity::load_state(reader) && reader.read(velocity) && reader.read(fixed_velocity) && reader.read(points) && reader.read(max_invulnerability_timer) &&
+				reader.read(max_respawn_timer) && reader.read(max_shoot_timer) && reader.read(dead) && reader.read(invulnerable) &&
+				reader.read(shoot_ready);
 	}
 
 	rock::rock(SDL_FPoint _position,float _rotation,float _move_speed,std::uintmax_t _award_points,bool _spawns_smaller_rocks_on_destruction,const asteroids::mesh& _mesh)
 		 : entity(_position,_rotation,_move_speed,0,_mesh),award_points(_award_points),spawns_smaller_rocks_on_destruction(_spawns_smaller_rocks_on_destruction)
-	{}
+	{
+		layer = collision_layer::rock;
+		mask = get_collision_mask(layer);
+	}
+
+	rock::rock(SDL_FPoint _position,float _rotation,float _move_speed,std::uintmax_t _award_points,bool _spawns_smaller_rocks_on_destruction,const asteroids::mesh& _mesh,deferred_transform_t)
+		 : entity(_position,_rotation,_move_speed,0,_mesh,deferred_transform),award_points(_award_points),spawns_smaller_rocks_on_destruction(_spawns_smaller_rocks_on_destruction)
+	{
+		layer = collision_layer::rock;
+		mask = get_collision_mask(layer);
+	}
 
 	rock::rock(const rock& _rock) : entity(_rock),award_points(_rock.award_points),spawns_smaller_rocks_on_destruction(_rock.spawns_smaller_rocks_on_destruction)
 	{}
@@ -396,16 +1140,64 @@ namespace asteroids
 		return *this;
 	}
 
-	void rock::update(float delta_time)
+	void rock::update(float delta_time,bool transform)
 	{
-		entity::update();
+		if(transform)
+		{
+			entity::update();
+		}
+		else
+		{
+			follow_position();
+		}
 		position.x += get_forward().x * move_speed * delta_time;
 		position.y += get_forward().y * move_speed * delta_time;
 	}
 
+	void rock::update_fixed(fixed delta_time,bool transform)
+	{
+		if(transform)
+		{
+			entity::update_fixed();
+		}
+		else
+		{
+			follow_fixed_position();
+		}
+		fixed speed = to_fixed(move_speed);
+		fixed_position.x += fixed_multiply(fixed_multiply(get_fixed_forward().x,speed),delta_time);
+		fixed_position.y += fixed_multiply(fixed_multiply(get_fixed_forward().y,speed),delta_time);
+		sync_float_pose();
+	}
+
+	std::uint64_t rock::get_state_hash() const noexcept
+	{
+		return hash_value(hash_value(entity::get_state_hash(),award_points),spawns_smaller_rocks_on_destruction);
+	}
+
+	void rock::save_state(binary_writer& writer) const
+	{
+		entity::save_state(writer);
+		writer.write(award_points);
+		writer.write(spawns_smaller_rocks_on_destruction);
+	}
+
+	bool rock::load_state(binary_reader& reader)
+	{
+		return entity::load_state(reader) && reader.read(award_points) && reader.read(spawns_smaller_rocks_on_destruction);
+	}
+
 	projectile::projectile(SDL_FPoint _position,float _rotation,float _move_speed,bool _physical,bool _player_friendly,const asteroids::mesh& _mesh)
 		: entity(_position,_rotation,_move_speed,0,_mesh),physical(_physical),player_friendly(_player_friendly)
-	{}
+	{
+		assign_collision_layer();
+	}
+
+	projectile::projectile(SDL_FPoint _position,float _rotation,float _move_speed,bool _physical,bool _player_friendly,const asteroids::mesh& _mesh,deferred_transform_t)
+		: entity(_position,_rotation,_move_speed,0,_mesh,deferred_transform),physical(_physical),player_friendly(_player_friendly)
+	{
+		assign_collision_layer();
+	}
 
 	projectile::projectile(const projectile& _projectile) : entity(_projectile),physical(_projectile.physical),player_friendly(_projectile.player_friendly)
 	{}
@@ -435,16 +1227,77 @@ namespace asteroids
 		return *this;
 	}
 
-	void projectile::update(float delta_time)
+	void projectile::update(float delta_time,bool transform)
 	{
-		entity::update();
+		if(transform)
+		{
+			entity::update();
+		}
+		else
+		{
+			follow_position();
+		}
 		position.x += get_forward().x * move_speed * delta_time;
 		position.y += get_forward().y * move_speed * delta_time;
 	}
 
+	void projectile::update_fixed(fixed delta_time,bool transform)
+	{
+		if(transform)
+		{
+			entity::update_fixed();
+		}
+		else
+		{
+			follow_fixed_position();
+		}
+		fixed speed = to_fixed(move_speed);
+		fixed_position.x += fixed_multiply(fixed_multiply(get_fixed_forward().x,speed),delta_time);
+		fixed_position.y += fixed_multiply(fixed_multiply(get_fixed_forward().y,speed),delta_time);
+		sync_float_pose();
+	}
+
+	std::uint64_t projectile::get_state_hash() const noexcept
+	{
+		return hash_value(hash_value(entity::get_state_hash(),physical),player_friendly);
+	}
+
+	void projectile::save_state(binary_writer& writer) const
+	{
+		entity::save_state(writer);
+		writer.write(physical);
+		writer.write(player_friendly);
+	}
+
+	bool projectile::load_state(binary_reader& reader)
+	{
+		if(!(entity::load_state(reader) && reader.read(physical) && reader.read(player_friendly)))
+		{
+			return false;
+		}
+		assign_collision_layer();
+		return true;
+	}
+
+	void projectile::assign_collision_layer() noexcept
+	{
+		layer = player_friendly ? collision_layer::friendly_projectile : collision_layer::hostile_projectile;
+		mask = physical ? get_collision_mask(layer) : 0;
+	}
+
 	ufo::ufo(SDL_FPoint _position,float _move_speed,std::uintmax_t _award_points,float _max_shoot_timer,SDL_FPoint _direction,const asteroids::mesh& _mesh)
 		: entity(_position,0,_move_speed,0,_mesh),award_points(_award_points),max_shoot_timer(_max_shoot_timer),direction(_direction)
-	{}
+	{
+		layer = collision_layer::ufo;
+		mask = get_collision_mask(layer);
+	}
+
+	ufo::ufo(SDL_FPoint _position,float _move_speed,std::uintmax_t _award_points,float _max_shoot_timer,SDL_FPoint _direction,const asteroids::mesh& _mesh,deferred_transform_t)
+		: entity(_position,0,_move_speed,0,_mesh,deferred_transform),award_points(_award_points),max_shoot_timer(_max_shoot_timer),direction(_direction)
+	{
+		layer = collision_layer::ufo;
+		mask = get_collision_mask(layer);
+	}
 
 	ufo::ufo(const ufo& _ufo)
 		: entity(_ufo),award_points(_ufo.award_points),max_shoot_timer(_ufo.max_shoot_timer),direction(_ufo.direction)
@@ -478,28 +1331,51 @@ namespace asteroids
 		return *this;
 	}
 
-	bool ufo::can_shoot() const noexcept
+	void ufo::update(float delta_time,bool transform)
 	{
-		return shoot_timer <= 0.0f;
+		if(transform)
+		{
+			entity::update();
+		}
+		else
+		{
+			follow_position();
+		}
+		position.x += direction.x * move_speed * delta_time;
+		position.y += direction.y * move_speed * delta_time;
 	}
 
-	void ufo::make_it_shoot() noexcept
+	void ufo::update_fixed(fixed delta_time,bool transform)
 	{
-		shoot_timer = max_shoot_timer;
+		if(transform)
+		{
+			entity::update_fixed();
+		}
+		else
+		{
+			follow_fixed_position();
+		}
+		fixed speed = to_fixed(move_speed);
+		fixed_position.x += fixed_multiply(fixed_multiply(to_fixed(direction.x),speed),delta_time);
+		fixed_position.y += fixed_multiply(fixed_multiply(to_fixed(direction.y),speed),delta_time);
+		sync_float_pose();
 	}
 
-	void ufo::update(float delta_time)
+	std::uint64_t ufo::get_state_hash() const noexcept
 	{
-		entity::update();
-		if(shoot_timer > 0.0f)
-		{
-			shoot_timer -= delta_time;
-			if(shoot_timer < 0.0f)
-			{
-				shoot_timer = 0.0f;
-			}
-		}
-		position.x += direction.x * move_speed * delta_time;
-		position.y += direction.y * move_speed * delta_time;
+		return hash_value(hash_value(hash_value(entity::get_state_hash(),award_points),max_shoot_timer),direction);
+	}
+
+	void ufo::save_state(binary_writer& writer) const
+	{
+		entity::save_state(writer);
+		writer.write(award_points);
+		writer.write(max_shoot_timer);
+		writer.write(direction);
+	}
+
+	bool ufo::load_state(binary_reader& reader)
+	{
+		return entity::load_state(reader) && reader.read(award_points) && reader.read(max_shoot_timer) && reader.read(direction);
 	}
 }
\ No newline at end of file
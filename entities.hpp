@@ -1,12 +1,39 @@
 #ifndef ASTEROIDS_ENTITIES_HPP
 #define ASTEROIDS_ENTITIES_HPP
 
+#include <span>
+#include <memory>
 #include <vector>
 #include <cstdint>
 #include <SDL_rect.h>
+#include "collision.hpp"
+#include "state_hash.hpp"
+#include "fixed_point.hpp"
+#include "serialization.hpp"
 
 namespace asteroids
 {
+	enum class prototype_id : std::uint8_t
+	{
+		none,
+		player,
+		destruction_fragment,
+		big_rock_0,
+		big_rock_1,
+		small_rock_0,
+		small_rock_1,
+		bullet,
+		ufo
+	};
+
+	//Tag for constructors that share a prototype mesh's geometry without transforming it, whoever owns the result has to
+	//call update() or update_fixed() before the mesh is used.
+	struct deferred_transform_t
+	{
+		explicit deferred_transform_t() = default;
+	};
+	inline constexpr deferred_transform_t deferred_transform{};
+
 	class mesh
 	{
 	public:
@@ -14,21 +41,77 @@ namespace asteroids
 		float rotation{};
 
 		mesh(const std::vector<SDL_FPoint>& _vertices,SDL_FPoint _position = {0,0},float _rotation = 0);
+		mesh(const mesh& _mesh,deferred_transform_t);
 		mesh(const mesh& _mesh);
 		mesh(mesh&& _mesh) noexcept;
 		mesh& operator = (const mesh& _mesh);
 		mesh& operator = (mesh&& _mesh) noexcept;
 
 		void update();
+		//Integer counterpart of update(), the float vertices and bounding box are derived from the fixed point results.
+		void update_fixed(fixed_vector _position,binary_angle _rotation);
+		//Moves the transformed mesh to '_position' keeping its rotation, a fraction of the cost of update() for meshes that don't turn.
+		void move_to(SDL_FPoint _position);
+		//Integer counterpart of move_to(), gives the same result as update_fixed() with the current rotation.
+		void move_to_fixed(fixed_vector _position);
+		//Takes the pose update_fixed() would without transforming anything, for meshes created with deferred_transform.
+		void set_fixed_pose(fixed_vector _position,binary_angle _rotation) noexcept;
 		bool check_collision_with(const mesh& other) const;
+		bool check_collision_with_fixed(const mesh& other) const;
 		SDL_FRect get_transformed_bounding_box() const;
+		fixed_rect get_fixed_bounding_box() const;
+		fixed_vector get_fixed_position() const;
+		binary_angle get_fixed_rotation() const;
 		const std::vector<SDL_FPoint>& get_transformed_vertices() const;
+		const std::vector<SDL_FPoint>& get_vertices() const;
+		//False when the vertices don't form a simple polygon, such a mesh is tested as a single part like before decomposition.
+		bool is_valid() const noexcept;
+		std::size_t get_convex_part_count() const noexcept;
+		//Indices into get_vertices() of the convex part 'index', in the polygon's winding order.
+		std::vector<std::size_t> get_convex_part(std::size_t index) const;
 
 	private:
-		std::vector<SDL_FPoint> vertices{};
+		//What doesn't change once a mesh is created, copies share it so they only own their transformed buffers.
+		struct shared_geometry
+		{
+			std::vector<SDL_FPoint> vertices{};
+			//All empty for convex meshes, which are a single part made of all vertices.
+			std::vector<std::uint16_t> part_vertex_indices{};
+			std::vector<std::uint16_t> part_ends{};
+			std::vector<std::int16_t> fixed_local_vertices{};
+			bool valid{};
+		};
+
+		//Only concave meshes have them. The part vertices are copies of the transformed vertices laid out part after part,
+		//so SAT walks every part contiguously.
+		struct part_buffers
+		{
+			std::vector<SDL_FRect> bounding_boxes{};
+			std::vector<SDL_FPoint> vertices{};
+			std::vector<fixed_rect> fixed_bounding_boxes{};
+			std::vector<fixed_vector> fixed_vertices{};
+		};
+
+		void resize_part_buffers();
+		std::size_t get_part_begin(std::size_t part) const noexcept;
+		std::size_t get_part_end(std::size_t part) const noexcept;
+		std::size_t get_part_vertex(std::size_t offset) const noexcept;
+		std::span<const SDL_FPoint> get_part_vertices(std::size_t part) const noexcept;
+		std::span<const SDL_FPoint> get_part_normals(std::size_t part) const noexcept;
+		std::span<const fixed_vector> get_fixed_part_vertices(std::size_t part) const noexcept;
+		std::span<const fixed_vector> get_fixed_part_normals(std::size_t part) const noexcept;
+
+		std::shared_ptr<const shared_geometry> geometry{};
 		std::vector<SDL_FPoint> transformed_vertices{};
 		SDL_FRect transformed_bounding_box{};
+		//One normal per edge of every convex part, laid out like 'part_vertex_indices'.
 		std::vector<SDL_FPoint> transformed_edge_normals{};
+		std::unique_ptr<part_buffers> parts{};
+		std::vector<fixed_vector> fixed_transformed_vertices{};
+		std::vector<fixed_vector> fixed_edge_normals{};
+		fixed_rect fixed_bounding_box{};
+		fixed_vector fixed_position{};
+		binary_angle fixed_rotation{};
 	};
 
 	class entity
@@ -39,26 +122,50 @@ namespace asteroids
 		float move_speed{};
 		float rotation_speed{};
 		bool destroyed{};
+		std::uint32_t id{};
+		prototype_id prototype{};
+		fixed_vector fixed_position{};
+		binary_angle fixed_rotation{};
+		//Set by the derived constructors, the scene only tests pairs whose masks contain each other's layers.
+		collision_layer layer{};
+		collision_mask mask{};
 
 		entity(SDL_FPoint _position,float _rotation,float _move_speed,float _rotation_speed,const mesh& _mesh);
+		//Leaves the mesh at the entity's pose untransformed and the forward vector unset until update() or update_fixed() is called.
+		entity(SDL_FPoint _position,float _rotation,float _move_speed,float _rotation_speed,const mesh& _mesh,deferred_transform_t);
 		entity(const entity& _entity);
 		entity(entity&& _entity) noexcept;
 		entity& operator = (const entity& _entity);
 		entity& operator = (entity&& _entity) noexcept;
 
 		void update();
+		void update_fixed();
+		//Moves the mesh along with 'position' without transforming it again, falls back to update() once the entity turned.
+		void follow_position();
+		void follow_fixed_position();
+		//Copies the fixed point pose into 'position' and 'rotation' for rendering and snapshots.
+		void sync_float_pose() noexcept;
+		//Fixed point counterpart of the pose a deferred_transform constructor takes, the mesh stays untransformed.
+		void set_fixed_pose(fixed_vector _position,binary_angle _rotation) noexcept;
 		const mesh& get_mesh() const;
 		SDL_FPoint get_forward() const;
+		fixed_vector get_fixed_forward() const;
+		//Hash of the same state save_state() writes, except for the mesh pose which follows from the entity's.
+		std::uint64_t get_state_hash() const noexcept;
+		void save_state(binary_writer& writer) const;
+		bool load_state(binary_reader& reader);
 
 	private:
 		mesh $mesh;
 		SDL_FPoint forward{};
+		fixed_vector fixed_forward{};
 	};
 
 	class player : public entity
 	{
 	public:
 		SDL_FPoint velocity{};
+		fixed_vector fixed_velocity{};
 		std::uintmax_t points{};
 		float max_invulnerability_timer{};
 		float max_respawn_timer{};
@@ -70,19 +177,23 @@ namespace asteroids
 		player& operator = (const player& _player);
 		player& operator = (player&& _player) noexcept;
 
-		void update(float delta_time);
 		bool is_dead() const noexcept;
 		bool is_invulnerable() const noexcept;
 		bool can_shoot() const noexcept;
 		void make_it_shoot() noexcept;
+		void make_ready_to_shoot() noexcept;
 		void make_invulnerable() noexcept;
+		void end_invulnerability() noexcept;
 		void kill() noexcept;
+		void respawn(SDL_FPoint _position) noexcept;
+		std::uint64_t get_state_hash() const noexcept;
+		void save_state(binary_writer& writer) const;
+		bool load_state(binary_reader& reader);
 
 	private:
 		bool dead{};
-		float invulnerability_timer{};
-		float respawn_timer{};
-		float shoot_timer{};
+		bool invulnerable{};
+		bool shoot_ready{true};
 	};
 
 	class rock : public entity
@@ -92,12 +203,18 @@ namespace asteroids
 		bool spawns_smaller_rocks_on_destruction{};
 
 		rock(SDL_FPoint _position,float _rotation,float _move_speed,std::uintmax_t _award_points,bool _spawns_smaller_rocks_on_destruction,const asteroids::mesh& _mesh);
+		rock(SDL_FPoint _position,float _rotation,float _move_speed,std::uintmax_t _award_points,bool _spawns_smaller_rocks_on_destruction,const asteroids::mesh& _mesh,deferred_transform_t);
 		rock(const rock& _rock);
 		rock(rock&& _rock) noexcept;
 		rock& operator = (const rock& _rock);
 		rock& operator = (rock&& _rock) noexcept;
 
-		void update(float delta_time);
+		//Without 'transform' the mesh only follows the entity's position, see entity::follow_position().
+		void update(float delta_time,bool transform = true);
+		void update_fixed(fixed delta_time,bool transform = true);
+		std::uint64_t get_state_hash() const noexcept;
+		void save_state(binary_writer& writer) const;
+		bool load_state(binary_reader& reader);
 	};
 
 	class projectile : public entity
@@ -107,12 +224,21 @@ namespace asteroids
 		bool player_friendly{};
 
 		projectile(SDL_FPoint _position,float _rotation,float _move_speed,bool _physical,bool _player_friendly,const asteroids::mesh& _mesh);
+		projectile(SDL_FPoint _position,float _rotation,float _move_speed,bool _physical,bool _player_friendly,const asteroids::mesh& _mesh,deferred_transform_t);
 		projectile(const projectile& _projectile);
 		projectile(projectile&& _projectile) noexcept;
 		projectile& operator = (const projectile& _projectile);
 		projectile& operator = (projectile&& _projectile) noexcept;
 
-		void update(float delta_time);
+		//Without 'transform' the mesh only follows the entity's position, see entity::follow_position().
+		void update(float delta_time,bool transform = true);
+		void update_fixed(fixed delta_time,bool transform = true);
+		std::uint64_t get_state_hash() const noexcept;
+		void save_state(binary_writer& writer) const;
+		bool load_state(binary_reader& reader);
+
+	private:
+		void assign_collision_layer() noexcept;
 	};
 
 	class ufo : public entity
@@ -123,17 +249,18 @@ namespace asteroids
 		SDL_FPoint direction{};
 
 		ufo(SDL_FPoint _position,float _move_speed,std::uintmax_t _award_points,float _max_shoot_timer,SDL_FPoint _direction,const asteroids::mesh& _mesh);
+		ufo(SDL_FPoint _position,float _move_speed,std::uintmax_t _award_points,float _max_shoot_timer,SDL_FPoint _direction,const asteroids::mesh& _mesh,deferred_transform_t);
 		ufo(const ufo& _ufo);
 		ufo(ufo&& _ufo) noexcept;
 		ufo& operator = (const ufo& _ufo);
 		ufo& operator = (ufo&& _ufo) noexcept;
 
-		bool can_shoot() const noexcept;
-		void make_it_shoot() noexcept;
-		void update(float delta_time);
-
-	private:
-		float shoot_timer{};
+		//Without 'transform' the mesh only follows the entity's position, see entity::follow_position().
+		void update(float delta_time,bool transform = true);
+		void update_fixed(fixed delta_time,bool transform = true);
+		std::uint64_t get_state_hash() const noexcept;
+		void save_state(binary_writer& writer) const;
+		bool load_state(binary_reader& reader);
 	};
 }
 
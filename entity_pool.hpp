@@ -0,0 +1,273 @@
+#ifndef ASTEROIDS_ENTITY_POOL_HPP
+#define ASTEROIDS_ENTITY_POOL_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <optional>
+#include "serialization.hpp"
+
+namespace asteroids
+{
+	//Stable reference to an entity stored in an entity_pool. A default constructed handle is never valid.
+	struct entity_handle
+	{
+		std::uint32_t slot{};
+		std::uint32_t generation{};
+
+		friend bool operator == (const entity_handle& a,const entity_handle& b) noexcept = default;
+	};
+
+	//Values are kept densely packed so iteration stays linear, handles go through a slot table that follows the values around.
+	//Removing swaps the last value into the hole and bumps the slot generation so stale handles stop resolving.
+	template<typename T>
+	class entity_pool
+	{
+	public:
+		entity_handle insert(const T& value)
+		{
+			return emplace_slot(value);
+		}
+
+		entity_handle insert(T&& value)
+		{
+			return emplace_slot(std::move(value));
+		}
+
+		bool remove(entity_handle handle)
+		{
+			if(!is_valid(handle))
+			{
+				return false;
+			}
+			std::uint32_t dense_index = slots[handle.slot].dense_index;
+			std::uint32_t last_index = static_cast<std::uint32_t>(values.size() - 1);
+			if(dense_index != last_index)
+			{
+				values[dense_index] = std::move(values[last_index]);
+				dense_to_slot[dense_index] = dense_to_slot[last_index];
+				slots[dense_to_slot[dense_index]].dense_index = dense_index;
+			}
+			values.pop_back();
+			dense_to_slot.pop_back();
+			retire_slot(handle.slot);
+			return true;
+		}
+
+		bool is_valid(entity_handle handle) const noexcept
+		{
+			return handle.slot < slots.size() && handle.generation != 0 && slots[handle.slot].generation == handle.generation;
+		}
+
+		T* find(entity_handle handle) noexcept
+		{
+			return is_valid(handle) ? &values[slots[handle.slot].dense_index] : nullptr;
+		}
+
+		const T* find(entity_handle handle) const noexcept
+		{
+			return is_valid(handle) ? &values[slots[handle.slot].dense_index] : nullptr;
+		}
+
+		entity_handle get_handle(std::size_t index) const noexcept
+		{
+			std::uint32_t slot = dense_to_slot[index];
+			return {slot,slots[slot].generation};
+		}
+
+		T& operator [] (std::size_t index) noexcept
+		{
+			return values[index];
+		}
+
+		const T& operator [] (std::size_t index) const noexcept
+		{
+			return values[index];
+		}
+
+		std::size_t size() const noexcept
+		{
+			return values.size();
+		}
+
+		void reserve(std::size_t capacity)
+		{
+			values.reserve(capacity);
+			dense_to_slot.reserve(capacity);
+		}
+
+		//Appends the 'count' values returned by 'make(i)' in order, reusing free slots first. Returns the index of the first one.
+		template<typename F>
+		std::size_t append(std::size_t count,F&& make)
+		{
+			std::size_t first = values.size();
+			reserve(first + count);
+			if(count > free_slots.size())
+			{
+				slots.reserve(slots.size() + count - free_slots.size());
+			}
+			for(std::size_t i = 0;i < count;++i)
+			{
+				emplace_slot(made_value<F>{make,i});
+			}
+			return first;
+		}
+
+		void clear() noexcept
+		{
+			for(auto slot : dense_to_slot)
+			{
+				retire_slot(slot);
+			}
+			values.clear();
+			dense_to_slot.clear();
+		}
+
+		const std::vector<T>& get_values() const noexcept
+		{
+			return values;
+		}
+
+		//'save_value' writes one value, 'load_value' reads one back and returns an empty optional on failure.
+		template<typename F>
+		void save_state(binary_writer& writer,F&& save_value) const
+		{
+			writer.write(static_cast<std::uint32_t>(slots.size()));
+			for(const auto& slot : slots)
+			{
+				writer.write(slot.generation);
+			}
+			writer.write(static_cast<std::uint32_t>(free_slots.size()));
+			for(auto slot : free_slots)
+			{
+				writer.write(slot);
+			}
+			writer.write(static_cast<std::uint32_t>(values.size()));
+			for(std::size_t i = 0;i < values.size();++i)
+			{
+				writer.write(dense_to_slot[i]);
+				save_value(writer,values[i]);
+			}
+		}
+
+		template<typename F>
+		bool load_state(binary_reader& reader,F&& load_value)
+		{
+			values.clear();
+			dense_to_slot.clear();
+			slots.clear();
+			free_slots.clear();
+
+			std::uint32_t slot_count{};
+			if(!reader.read(slot_count) || slot_count > reader.get_remaining() / sizeof(std::uint32_t))
+			{
+				return false;
+			}
+			slots.resize(slot_count);
+			for(auto& slot : slots)
+			{
+				if(!reader.read(slot.generation))
+				{
+					return false;
+				}
+			}
+
+			std::uint32_t free_count{};
+			if(!reader.read(free_count) || free_count > slot_count)
+			{
+				return false;
+			}
+			free_slots.resize(free_count);
+			for(auto& slot : free_slots)
+			{
+				if(!reader.read(slot) || slot >= slot_count)
+				{
+					return false;
+				}
+			}
+
+			std::uint32_t value_count{};
+			if(!reader.read(value_count) || value_count > slot_count)
+			{
+				return false;
+			}
+			values.reserve(value_count);
+			dense_to_slot.reserve(value_count);
+			for(std::uint32_t i = 0;i < value_count;++i)
+			{
+				std::uint32_t slot{};
+				if(!reader.read(slot) || slot >= slot_count)
+				{
+					return false;
+				}
+				std::optional<T> value = load_value(reader);
+				if(!value)
+				{
+					return false;
+				}
+				slots[slot].dense_index = i;
+				dense_to_slot.push_back(slot);
+				values.push_back(std::move(*value));
+			}
+			return true;
+		}
+
+	private:
+		struct slot_entry
+		{
+			std::uint32_t dense_index{};
+			std::uint32_t generation{1};
+		};
+
+		//Converts into the value 'make' returns, so the value is constructed directly in the pool instead of being moved there.
+		template<typename F>
+		struct made_value
+		{
+			F& make;
+			std::size_t index;
+
+			operator T() const
+			{
+				return make(index);
+			}
+		};
+
+		void retire_slot(std::uint32_t slot)
+		{
+			//Generation 0 is reserved for invalid handles.
+			if(++slots[slot].generation == 0)
+			{
+				slots[slot].generation = 1;
+			}
+			free_slots.push_back(slot);
+		}
+
+		template<typename U>
+		entity_handle emplace_slot(U&& value)
+		{
+			std::uint32_t slot{};
+			if(!free_slots.empty())
+			{
+				slot = free_slots.back();
+				free_slots.pop_back();
+			}
+			else
+			{
+				slot = static_cast<std::uint32_t>(slots.size());
+				slots.push_back({});
+			}
+			slots[slot].dense_index = static_cast<std::uint32_t>(values.size());
+			values.emplace_back(std::forward<U>(value));
+			dense_to_slot.push_back(slot);
+			return {slot,slots[slot].generation};
+		}
+
+		std::vector<T> values{};
+		std::vector<std::uint32_t> dense_to_slot{};
+		std::vector<slot_entry> slots{};
+		std::vector<std::uint32_t> free_slots{};
+	};
+}
+
+#endif
\ No newline at end of file
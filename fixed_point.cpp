@@ -0,0 +1,198 @@
+#include "fixed_point.hpp"
+
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ASTEROIDS_FIXED_POINT_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr std::size_t QUARTER_SINE_STEPS = 1024;
+		constexpr double TABLE_PI = 3.14159265358979323846;
+		constexpr double ANGLE_UNITS_PER_RADIAN = 4294967296.0 / (2.0 * TABLE_PI);
+
+		//Evaluated by the compiler with plain IEEE double arithmetic, so the table doesn't depend on the libm it ends up linked with.
+		constexpr double taylor_sine(double x)
+		{
+			double term = x;
+			double sum = x;
+			for(int i = 1;i < 16;++i)
+			{
+				term *= -(x * x) / ((2.0 * i) * (2.0 * i + 1.0));
+				sum += term;
+			}
+			return sum;
+		}
+
+		constexpr std::array<fixed,QUARTER_SINE_STEPS + 1> make_quarter_sine_table()
+		{
+			std::array<fixed,QUARTER_SINE_STEPS + 1> table{};
+			for(std::size_t i = 0;i <= QUARTER_SINE_STEPS;++i)
+			{
+				double value = taylor_sine((TABLE_PI / 2.0) * static_cast<double>(i) / QUARTER_SINE_STEPS) * FIXED_ONE;
+				table[i] = static_cast<fixed>(value + 0.5);
+			}
+			return table;
+		}
+
+		constexpr std::array<fixed,QUARTER_SINE_STEPS + 1> QUARTER_SINE_TABLE = make_quarter_sine_table();
+
+		//'offset' is the position inside a quadrant as 30 bit fraction of the quadrant.
+		fixed quarter_sine(std::uint32_t offset) noexcept
+		{
+			std::uint32_t index = offset >> 20;
+			std::int64_t fraction = offset & ((1u << 20) - 1);
+			if(index >= QUARTER_SINE_STEPS)
+			{
+				return QUARTER_SINE_TABLE[QUARTER_SINE_STEPS];
+			}
+			std::int64_t a = QUARTER_SINE_TABLE[index];
+			std::int64_t b = QUARTER_SINE_TABLE[index + 1];
+			return static_cast<fixed>(a + (((b - a) * fraction) >> 20));
+		}
+	}
+
+	fixed to_fixed(float value) noexcept
+	{
+		return static_cast<fixed>(std::llround(static_cast<double>(value) * FIXED_ONE));
+	}
+
+	float from_fixed(fixed value) noexcept
+	{
+		return static_cast<float>(value) / FIXED_ONE;
+	}
+
+	fixed fixed_multiply(fixed a,fixed b) noexcept
+	{
+		return static_cast<fixed>((static_cast<std::int64_t>(a) * b) >> FIXED_SHIFT);
+	}
+
+	binary_angle radians_to_angle(float radians) noexcept
+	{
+		return static_cast<binary_angle>(static_cast<std::uint64_t>(std::llround(static_cast<double>(radians) * ANGLE_UNITS_PER_RADIAN)));
+	}
+
+	float angle_to_radians(binary_angle angle) noexcept
+	{
+		return static_cast<float>(static_cast<std::int32_t>(angle) / ANGLE_UNITS_PER_RADIAN);
+	}
+
+	std::int64_t to_angular_speed(float radians_per_second) noexcept
+	{
+		return std::llround(static_cast<double>(radians_per_second) * ANGLE_UNITS_PER_RADIAN);
+	}
+
+	binary_angle advance_angle(binary_angle angle,std::int64_t angular_speed,fixed delta_time) noexcept
+	{
+		return angle + static_cast<binary_angle>(static_cast<std::uint64_t>((angular_speed * delta_time) >> FIXED_SHIFT));
+	}
+
+	fixed fixed_sin(binary_angle angle) noexcept
+	{
+		std::uint32_t quadrant = angle >> 30;
+		std::uint32_t offset = angle & ((1u << 30) - 1);
+		switch(quadrant)
+		{
+			case 0:
+				return quarter_sine(offset);
+			case 1:
+				return quarter_sine((1u << 30) - offset);
+			case 2:
+				return -quarter_sine(offset);
+			default:
+				return -quarter_sine((1u << 30) - offset);
+		}
+	}
+
+	fixed fixed_cos(binary_angle angle) noexcept
+	{
+		return fixed_sin(angle + (1u << 30));
+	}
+
+	binary_angle fixed_atan2(fixed y,fixed x) noexcept
+	{
+		if(x == 0 && y == 0)
+		{
+			return 0;
+		}
+		//Reduce to the first octant, then bisect the angle whose tangent matches using the sine table.
+		std::int64_t ax = (x < 0) ? -static_cast<std::int64_t>(x) : x;
+		std::int64_t ay = (y < 0) ? -static_cast<std::int64_t>(y) : y;
+		bool swapped = ay > ax;
+		std::int64_t numerator = swapped ? ax : ay;
+		std::int64_t denominator = swapped ? ay : ax;
+
+		binary_angle low = 0;
+		binary_angle high = 1u << 29;
+		while(high - low > 1)
+		{
+			binary_angle middle = low + (high - low) / 2;
+			if(numerator * fixed_cos(middle) >= denominator * fixed_sin(middle))
+			{
+				low = middle;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+
+		binary_angle angle = swapped ? ((1u << 30) - low) : low;
+		if(x < 0)
+		{
+			angle = (1u << 31) - angle;
+		}
+		if(y < 0)
+		{
+			angle = 0u - angle;
+		}
+		return angle;
+	}
+
+	std::int64_t fixed_distance_squared(const fixed_vector& a,const fixed_vector& b) noexcept
+	{
+		std::int64_t dx = static_cast<std::int64_t>(a.x) - b.x;
+		std::int64_t dy = static_cast<std::int64_t>(a.y) - b.y;
+		return dx * dx + dy * dy;
+	}
+
+	void transform_fixed_vertices(const std::int16_t* local,std::size_t count,binary_angle angle,fixed_vector position,fixed_vector* output) noexcept
+	{
+		constexpr int RESULT_SHIFT = FIXED_VERTEX_SHIFT + FIXED_TRIG_SHIFT - FIXED_SHIFT;
+		const std::int16_t c = static_cast<std::int16_t>(fixed_cos(angle) >> (FIXED_SHIFT - FIXED_TRIG_SHIFT));
+		const std::int16_t s = static_cast<std::int16_t>(fixed_sin(angle) >> (FIXED_SHIFT - FIXED_TRIG_SHIFT));
+		std::size_t i = 0;
+#ifdef ASTEROIDS_FIXED_POINT_SSE2
+		//_mm_madd_epi16 produces x*c - y*s and x*s + y*c for four vertices at once with exact 32 bit sums.
+		const __m128i rotate_x = _mm_set_epi16(static_cast<std::int16_t>(-s),c,static_cast<std::int16_t>(-s),c,static_cast<std::int16_t>(-s),c,static_cast<std::int16_t>(-s),c);
+		const __m128i rotate_y = _mm_set_epi16(c,s,c,s,c,s,c,s);
+		const __m128i offset_x = _mm_set1_epi32(position.x);
+		const __m128i offset_y = _mm_set1_epi32(position.y);
+		alignas(16) fixed_vector block[4]{};
+		for(;i + 4 <= count;i += 4)
+		{
+			__m128i vertices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(local + i * 2));
+			__m128i x = _mm_add_epi32(_mm_srai_epi32(_mm_madd_epi16(vertices,rotate_x),RESULT_SHIFT),offset_x);
+			__m128i y = _mm_add_epi32(_mm_srai_epi32(_mm_madd_epi16(vertices,rotate_y),RESULT_SHIFT),offset_y);
+			_mm_store_si128(reinterpret_cast<__m128i*>(&block[0]),_mm_unpacklo_epi32(x,y));
+			_mm_store_si128(reinterpret_cast<__m128i*>(&block[2]),_mm_unpackhi_epi32(x,y));
+			output[i] = block[0];
+			output[i + 1] = block[1];
+			output[i + 2] = block[2];
+			output[i + 3] = block[3];
+		}
+#endif
+		for(;i < count;++i)
+		{
+			std::int32_t vx = local[i * 2];
+			std::int32_t vy = local[i * 2 + 1];
+			output[i].x = ((vx * c + vy * -s) >> RESULT_SHIFT) + position.x;
+			output[i].y = ((vx * s + vy * c) >> RESULT_SHIFT) + position.y;
+		}
+	}
+}
\ No newline at end of file
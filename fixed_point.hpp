@@ -0,0 +1,59 @@
+#ifndef ASTEROIDS_FIXED_POINT_HPP
+#define ASTEROIDS_FIXED_POINT_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+namespace asteroids
+{
+	//Q16.16 fixed point number.
+	using fixed = std::int32_t;
+	//Angle where the full turn is 2^32, so wrapping around is plain unsigned overflow.
+	using binary_angle = std::uint32_t;
+
+	inline constexpr int FIXED_SHIFT = 16;
+	inline constexpr fixed FIXED_ONE = fixed{1} << FIXED_SHIFT;
+	//Local mesh vertices are stored as Q8.8 and rotated with Q1.14 sines, which keeps the products inside 32 bits.
+	inline constexpr int FIXED_VERTEX_SHIFT = 8;
+	inline constexpr int FIXED_TRIG_SHIFT = 14;
+
+	enum class simulation_mode : std::uint8_t
+	{
+		floating_point,
+		fixed_point
+	};
+
+	struct fixed_vector
+	{
+		fixed x{};
+		fixed y{};
+	};
+
+	struct fixed_rect
+	{
+		fixed x{};
+		fixed y{};
+		fixed w{};
+		fixed h{};
+	};
+
+	fixed to_fixed(float value) noexcept;
+	float from_fixed(fixed value) noexcept;
+	fixed fixed_multiply(fixed a,fixed b) noexcept;
+	binary_angle radians_to_angle(float radians) noexcept;
+	float angle_to_radians(binary_angle angle) noexcept;
+	//Angular speed in radians per second converted to binary angle units per second.
+	std::int64_t to_angular_speed(float radians_per_second) noexcept;
+	binary_angle advance_angle(binary_angle angle,std::int64_t angular_speed,fixed delta_time) noexcept;
+
+	//Table-driven, identical on every compiler and platform.
+	fixed fixed_sin(binary_angle angle) noexcept;
+	fixed fixed_cos(binary_angle angle) noexcept;
+	binary_angle fixed_atan2(fixed y,fixed x) noexcept;
+	std::int64_t fixed_distance_squared(const fixed_vector& a,const fixed_vector& b) noexcept;
+
+	//'local' holds interleaved Q8.8 x/y pairs padded with zeros to a multiple of four vertices.
+	void transform_fixed_vertices(const std::int16_t* local,std::size_t count,binary_angle angle,fixed_vector position,fixed_vector* output) noexcept;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,372 @@
+#include "flight_recorder.hpp"
+
+#include <cmath>
+#include <atomic>
+#include <cstring>
+#include <cstddef>
+#include <iomanip>
+#include <algorithm>
+#include "mapped_file.hpp"
+#include "state_hash.hpp"
+#include "frame_governor.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr char FLIGHT_RECORDER_MAGIC[8] = {'A','S','T','R','F','L','T','1'};
+		constexpr std::uint32_t FLIGHT_RECORDER_VERSION = 1;
+
+		//The file is a raw image of these structures, so it is decoded on a machine of the same endianness.
+		struct file_header
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t frame_capacity;
+			std::uint64_t seed;
+			double frame_budget_milliseconds;
+			//Only advanced once the frame's record is complete.
+			std::uint64_t frame_count;
+			std::uint64_t skipped_state_count;
+		};
+
+		struct frame_record
+		{
+			std::uint64_t frame;
+			flight_frame data;
+		};
+
+		//A slot whose size is 0 is empty or was being rewritten.
+		struct state_slot_header
+		{
+			std::uint64_t frame;
+			std::uint64_t tick;
+			std::uint32_t size;
+			std::uint32_t reserved;
+		};
+
+		constexpr std::size_t STATE_SLOT_STRIDE = sizeof(state_slot_header) + FLIGHT_RECORDER_STATE_SLOT_SIZE;
+
+		constexpr std::size_t get_state_offset(std::uint32_t frame_capacity) noexcept
+		{
+			std::size_t offset = sizeof(file_header) + static_cast<std::size_t>(frame_capacity) * sizeof(frame_record);
+			return (offset + 7) & ~std::size_t{7};
+		}
+
+		constexpr std::size_t get_file_size(std::uint32_t frame_capacity) noexcept
+		{
+			return get_state_offset(frame_capacity) + STATE_SLOT_STRIDE * FLIGHT_RECORDER_STATE_SLOTS;
+		}
+
+		//Keeps the compiler from moving the stores that complete a record after the store that publishes it.
+		//A crash stops the process between two stores, so ordering them within the thread is all that is needed.
+		void publish_fence() noexcept
+		{
+			std::atomic_signal_fence(std::memory_order_release);
+		}
+
+		void write_input(std::ostream& log,std::uint8_t input)
+		{
+			constexpr char KEYS[] = {'A','D','L','R','S'};
+			for(std::size_t i = 0;i < sizeof(KEYS);++i)
+			{
+				log << (((input >> i) & 1) ? KEYS[i] : '-');
+			}
+		}
+
+		void write_state(std::ostream& log,const state_slot_header& header,const std::uint8_t* state)
+		{
+			log << "  state after frame " << header.frame << " (tick " << header.tick << ", " << header.size << " bytes): ";
+			scene scene{0};
+			if(!scene.load_state(state,header.size))
+			{
+				log << "couldn't be loaded" << std::endl;
+				return;
+			}
+			const player& $player = scene.get_player();
+			log << "player " << ($player.is_dead() ? "dead" : "alive") << " at (" << $player.position.x << "," << $player.position.y << ") with "
+				<< $player.points << " points, " << scene.get_rocks().size() << " rocks, " << scene.get_projectiles().size() << " projectiles, "
+				<< scene.get_ufos().size() << " UFOs, " << scene.get_particles().size() << " particles" << std::endl;
+		}
+	}
+
+	std::uint32_t get_flight_recorder_capacity(std::uint32_t seconds,double frame_budget_milliseconds) noexcept
+	{
+		if(!std::isfinite(frame_budget_milliseconds) || frame_budget_milliseconds <= 0.0)
+		{
+			frame_budget_milliseconds = DEFAULT_FRAME_BUDGET_MILLISECONDS;
+		}
+		//Clamped as a double, converting a value out of the integer's range is undefined.
+		double frames = std::ceil(seconds * 1000.0 / frame_budget_milliseconds);
+		return static_cast<std::uint32_t>(std::clamp(frames,2.0,static_cast<double>(MAX_FLIGHT_RECORDER_FRAMES)));
+	}
+
+	flight_frame make_flight_frame(const scene& scene,std::uint8_t input,float delta_time) noexcept
+	{
+		flight_frame frame{};
+		frame.tick = scene.get_tick();
+		frame.state_hash = combine_state_hashes(scene.get_state_hashes());
+		frame.points = scene.get_player().points;
+		frame.delta_time = delta_time;
+		frame.rocks = static_cast<std::uint32_t>(scene.get_rocks().size());
+		frame.projectiles = static_cast<std::uint32_t>(scene.get_projectiles().size());
+		frame.ufos = static_cast<std::uint32_t>(scene.get_ufos().size());
+		frame.particles = static_cast<std::uint32_t>(scene.get_particles().size());
+		frame.input = input;
+		frame.flags = scene.get_player().is_dead() ? FLIGHT_FRAME_PLAYER_DEAD : 0;
+		return frame;
+	}
+
+	flight_recorder::~flight_recorder()
+	{
+		close();
+	}
+
+	bool flight_recorder::open(const std::string& path,std::uint32_t _frame_capacity,std::uint64_t seed,double frame_budget_milliseconds)
+	{
+		close();
+		if(_frame_capacity < 2)
+		{
+			return false;
+		}
+		std::size_t file_size = get_file_size(_frame_capacity);
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(),GENERIC_READ | GENERIC_WRITE,FILE_SHARE_READ,nullptr,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,nullptr);
+		if(file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		file_handle = file;
+		mapping_handle = CreateFileMappingA(file,nullptr,PAGE_READWRITE,static_cast<DWORD>(static_cast<std::uint64_t>(file_size) >> 32),static_cast<DWORD>(file_size),nullptr);
+		if(!mapping_handle)
+		{
+			close();
+			return false;
+		}
+		data = static_cast<std::uint8_t*>(MapViewOfFile(mapping_handle,FILE_MAP_WRITE,0,0,file_size));
+		if(!data)
+		{
+			close();
+			return false;
+		}
+#else
+		descriptor = ::open(path.c_str(),O_RDWR | O_CREAT | O_TRUNC,0644);
+		if(descriptor < 0)
+		{
+			return false;
+		}
+		//A fresh file reads back as zeros, so every slot starts out empty.
+		if(ftruncate(descriptor,static_cast<off_t>(file_size)) != 0)
+		{
+			close();
+			return false;
+		}
+		void* mapping = mmap(nullptr,file_size,PROT_READ | PROT_WRITE,MAP_SHARED,descriptor,0);
+		if(mapping == MAP_FAILED)
+		{
+			close();
+			return false;
+		}
+		data = static_cast<std::uint8_t*>(mapping);
+#endif
+		size = file_size;
+		frame_capacity = _frame_capacity;
+		frame_count = 0;
+		state_count = 0;
+		file_header header{};
+		std::memcpy(header.magic,FLIGHT_RECORDER_MAGIC,sizeof(header.magic));
+		header.version = FLIGHT_RECORDER_VERSION;
+		header.frame_capacity = frame_capacity;
+		header.seed = seed;
+		header.frame_budget_milliseconds = frame_budget_milliseconds;
+		std::memcpy(data,&header,sizeof(header));
+		state_buffer.reserve(FLIGHT_RECORDER_STATE_SLOT_SIZE);
+		return true;
+	}
+
+	void flight_recorder::close()
+	{
+#ifdef _WIN32
+		if(data)
+		{
+			UnmapViewOfFile(data);
+		}
+		if(mapping_handle)
+		{
+			CloseHandle(mapping_handle);
+			mapping_handle = nullptr;
+		}
+		if(file_handle)
+		{
+			CloseHandle(file_handle);
+			file_handle = nullptr;
+		}
+#else
+		if(data)
+		{
+			munmap(data,size);
+		}
+		if(descriptor >= 0)
+		{
+			::close(descriptor);
+			descriptor = -1;
+		}
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	bool flight_recorder::is_open() const noexcept
+	{
+		return data != nullptr;
+	}
+
+	void flight_recorder::record_frame(const flight_frame& frame,const scene* state_source)
+	{
+		if(!data)
+		{
+			return;
+		}
+		frame_record record{frame_count,frame};
+		std::memcpy(data + sizeof(file_header) + (frame_count % frame_capacity) * sizeof(frame_record),&record,sizeof(record));
+		if(state_source && (frame_count % FLIGHT_RECORDER_STATE_INTERVAL) == 0)
+		{
+			state_buffer.clear();
+			state_source->save_state(state_buffer);
+			if(state_buffer.size() <= FLIGHT_RECORDER_STATE_SLOT_SIZE)
+			{
+				std::uint8_t* slot = data + get_state_offset(frame_capacity) + (state_count % FLIGHT_RECORDER_STATE_SLOTS) * STATE_SLOT_STRIDE;
+				state_slot_header slot_header{};
+				std::memcpy(slot,&slot_header,sizeof(slot_header));
+				publish_fence();
+				std::memcpy(slot + sizeof(slot_header),state_buffer.data(),state_buffer.size());
+				slot_header = {frame_count,state_source->get_tick(),static_cast<std::uint32_t>(state_buffer.size()),0};
+				publish_fence();
+				std::memcpy(slot,&slot_header,sizeof(slot_header));
+				state_count += 1;
+			}
+			else
+			{
+				std::uint64_t skipped{};
+				std::memcpy(&skipped,data + offsetof(file_header,skipped_state_count),sizeof(skipped));
+				skipped += 1;
+				std::memcpy(data + offsetof(file_header,skipped_state_count),&skipped,sizeof(skipped));
+			}
+		}
+		frame_count += 1;
+		publish_fence();
+		std::memcpy(data + offsetof(file_header,frame_count),&frame_count,sizeof(frame_count));
+	}
+
+	int decode_flight_recorder(const std::string& path,std::ostream& log)
+	{
+		mapped_file file{};
+		file_header header{};
+		if(!file.open(path) || file.get_size() < sizeof(header))
+		{
+			log << "Couldn't read flight recording " << path << "." << std::endl;
+			return 1;
+		}
+		std::memcpy(&header,file.get_data(),sizeof(header));
+		if(std::memcmp(header.magic,FLIGHT_RECORDER_MAGIC,sizeof(header.magic)) != 0 || header.version != FLIGHT_RECORDER_VERSION ||
+			header.frame_capacity < 2 || file.get_size() < get_file_size(header.frame_capacity))
+		{
+			log << path << " isn't a flight recording." << std::endl;
+			return 1;
+		}
+		const std::uint8_t* frames = file.get_data() + sizeof(file_header);
+		const std::uint8_t* states = file.get_data() + get_state_offset(header.frame_capacity);
+
+		std::vector<std::pair<state_slot_header,const std::uint8_t*>> saved_states{};
+		for(std::size_t i = 0;i < FLIGHT_RECORDER_STATE_SLOTS;++i)
+		{
+			state_slot_header slot_header{};
+			std::memcpy(&slot_header,states + i * STATE_SLOT_STRIDE,sizeof(slot_header));
+			if(slot_header.size > 0 && slot_header.size <= FLIGHT_RECORDER_STATE_SLOT_SIZE)
+			{
+				saved_states.emplace_back(slot_header,states + i * STATE_SLOT_STRIDE + sizeof(slot_header));
+			}
+		}
+		std::sort(saved_states.begin(),saved_states.end(),[](const auto& a,const auto& b){ return a.first.frame < b.first.frame; });
+
+		//The slot after the newest frame may hold the oldest one half overwritten, it is left out once the ring has wrapped.
+		std::uint64_t first = (header.frame_count >= header.frame_capacity) ? (header.frame_count - header.frame_capacity + 1) : 0;
+		log << "Flight recording of " << header.frame_count << " frames (seed " << header.seed << ", frame budget " << header.frame_budget_milliseconds
+			<< " ms), the last " << (header.frame_count - first) << " follow." << std::endl;
+		if(header.skipped_state_count > 0)
+		{
+			log << header.skipped_state_count << " scene states didn't fit their slot and weren't saved." << std::endl;
+		}
+		log << std::fixed << std::setprecision(2);
+		std::size_t next_state = 0;
+		std::uint64_t over_budget_count = 0;
+		std::uint64_t worst_frame = first;
+		float worst_milliseconds = -1.0f;
+		for(std::uint64_t i = first;i < header.frame_count;++i)
+		{
+			frame_record record{};
+			std::memcpy(&record,frames + (i % header.frame_capacity) * sizeof(frame_record),sizeof(record));
+			if(record.frame != i)
+			{
+				log << std::setw(8) << i << "  record missing or overwritten" << std::endl;
+				continue;
+			}
+			const flight_frame& frame = record.data;
+			float work_milliseconds = frame.simulation_milliseconds + frame.render_milliseconds;
+			bool over_budget = work_milliseconds > header.frame_budget_milliseconds;
+			over_budget_count += over_budget ? 1 : 0;
+			if(work_milliseconds > worst_milliseconds)
+			{
+				worst_milliseconds = work_milliseconds;
+				worst_frame = i;
+			}
+			log << std::setw(8) << i << "  tick " << std::setw(7) << frame.tick << "  dt " << std::setw(6) << frame.delta_time * 1000.0f << "  sim " << std::setw(6)
+				<< frame.simulation_milliseconds << "  render " << std::setw(6) << frame.render_milliseconds << "  present " << std::setw(6) << frame.present_milliseconds << "  input ";
+			write_input(log,frame.input);
+			log << "  rocks " << frame.rocks << " projectiles " << frame.projectiles << " ufos " << frame.ufos << " particles " << frame.particles
+				<< "  points " << frame.points << "  shed " << get_shedding_level_name(static_cast<shedding_level>(frame.shedding_level)) << "  hash "
+				<< std::hex << std::setw(16) << std::setfill('0') << frame.state_hash << std::dec << std::setfill(' ');
+			if(frame.flags & FLIGHT_FRAME_PLAYER_DEAD)
+			{
+				log << "  dead";
+			}
+			if(frame.flags & FLIGHT_FRAME_REPLAY)
+			{
+				log << "  replay";
+			}
+			if(frame.flags & FLIGHT_FRAME_NETWORK_CLIENT)
+			{
+				log << "  client";
+			}
+			if(over_budget)
+			{
+				log << "  OVER BUDGET";
+			}
+			log << std::endl;
+			while(next_state < saved_states.size() && saved_states[next_state].first.frame <= i)
+			{
+				if(saved_states[next_state].first.frame == i)
+				{
+					write_state(log,saved_states[next_state].first,saved_states[next_state].second);
+				}
+				next_state += 1;
+			}
+		}
+		if(header.frame_count > first)
+		{
+			log << over_budget_count << " of " << (header.frame_count - first) << " frames over budget, the slowest was frame " << worst_frame << " with "
+				<< worst_milliseconds << " ms of simulation and rendering." << std::endl;
+		}
+		log.unsetf(std::ios_base::floatfield);
+		return 0;
+	}
+}
\ No newline at end of file
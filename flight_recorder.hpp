@@ -0,0 +1,89 @@
+#ifndef ASTEROIDS_FLIGHT_RECORDER_HPP
+#define ASTEROIDS_FLIGHT_RECORDER_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include "scene.hpp"
+
+namespace asteroids
+{
+	inline constexpr std::uint32_t DEFAULT_FLIGHT_RECORDER_SECONDS = 60;
+	//About 72 MiB of frames, longer windows are cut down to it.
+	inline constexpr std::uint32_t MAX_FLIGHT_RECORDER_FRAMES = 1 << 20;
+	//A scene state is stored every this many frames, alternating between two slots so one is always complete.
+	inline constexpr std::uint32_t FLIGHT_RECORDER_STATE_INTERVAL = 300;
+	inline constexpr std::size_t FLIGHT_RECORDER_STATE_SLOTS = 2;
+	inline constexpr std::size_t FLIGHT_RECORDER_STATE_SLOT_SIZE = 1024 * 1024;
+
+	enum flight_frame_flags : std::uint8_t
+	{
+		FLIGHT_FRAME_PLAYER_DEAD = 1,
+		FLIGHT_FRAME_REPLAY = 2,
+		FLIGHT_FRAME_NETWORK_CLIENT = 4
+	};
+
+	//What the game knows about one frame, timings are in milliseconds.
+	struct flight_frame
+	{
+		std::uint64_t tick;
+		std::uint64_t state_hash;
+		std::uint64_t points;
+		float delta_time;
+		float simulation_milliseconds;
+		float render_milliseconds;
+		float present_milliseconds;
+		std::uint32_t rocks;
+		std::uint32_t projectiles;
+		std::uint32_t ufos;
+		std::uint32_t particles;
+		std::uint8_t input;
+		std::uint8_t shedding_level;
+		std::uint8_t flags;
+	};
+
+	flight_frame make_flight_frame(const scene& scene,std::uint8_t input,float delta_time) noexcept;
+	//Frames in 'seconds' at one frame per budget, clamped to [2, MAX_FLIGHT_RECORDER_FRAMES]. Budgets that aren't positive count at the default budget.
+	std::uint32_t get_flight_recorder_capacity(std::uint32_t seconds,double frame_budget_milliseconds) noexcept;
+
+	//Keeps the last frames and a recent scene state in a file mapped into memory. Records are plain stores into the mapping,
+	//so they are in the page cache as soon as they are written and survive the process crashing or being killed.
+	//Only a crash of the whole machine can lose them.
+	class flight_recorder
+	{
+	public:
+		flight_recorder() = default;
+		flight_recorder(const flight_recorder&) = delete;
+		flight_recorder& operator = (const flight_recorder&) = delete;
+		~flight_recorder();
+
+		//Creates or truncates 'path' to hold 'frame_capacity' frames.
+		bool open(const std::string& path,std::uint32_t frame_capacity,std::uint64_t seed,double frame_budget_milliseconds);
+		void close();
+		bool is_open() const noexcept;
+		//'state_source' is saved every FLIGHT_RECORDER_STATE_INTERVAL frames, nullptr when the scene isn't what is played (network clients).
+		void record_frame(const flight_frame& frame,const scene* state_source);
+
+	private:
+		std::uint8_t* data{};
+		std::size_t size{};
+		std::uint32_t frame_capacity{};
+		std::uint64_t frame_count{};
+		std::uint64_t state_count{};
+		std::vector<std::uint8_t> state_buffer{};
+#ifdef _WIN32
+		void* file_handle{};
+		void* mapping_handle{};
+#else
+		int descriptor{-1};
+#endif
+	};
+
+	//Prints the recorded frames oldest first, marks frames over the recorded budget and lists the saved scene states where they
+	//fall in the timeline. Returns 0 on success and 1 when the file isn't a flight recording.
+	int decode_flight_recorder(const std::string& path,std::ostream& log);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "frame_governor.hpp"
+
+#include <iomanip>
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr double AVERAGE_WEIGHT = 0.1;
+		constexpr std::size_t ESCALATE_AFTER_FRAMES = 10;
+		constexpr std::size_t RELAX_AFTER_FRAMES = 120;
+		//Work has to fall this far below the budget before a level is given back.
+		constexpr double RELAX_BUDGET_SHARE = 0.75;
+		constexpr shedding_level HIGHEST_LEVEL = shedding_level::defer_particle_bursts;
+	}
+
+	frame_governor::frame_governor(double _budget_milliseconds) : budget_milliseconds(_budget_milliseconds)
+	{}
+
+	bool frame_governor::record_frame(double simulation_milliseconds,double render_milliseconds,const scene& scene,std::ostream& log)
+	{
+		if(frame_count == 0)
+		{
+			average_simulation_milliseconds = simulation_milliseconds;
+			average_render_milliseconds = render_milliseconds;
+		}
+		else
+		{
+			average_simulation_milliseconds += (simulation_milliseconds - average_simulation_milliseconds) * AVERAGE_WEIGHT;
+			average_render_milliseconds += (render_milliseconds - average_render_milliseconds) * AVERAGE_WEIGHT;
+		}
+		frame_count += 1;
+
+		double average = average_simulation_milliseconds + average_render_milliseconds;
+		frames_over_budget = (average > budget_milliseconds) ? (frames_over_budget + 1) : 0;
+		frames_under_budget = (average < budget_milliseconds * RELAX_BUDGET_SHARE) ? (frames_under_budget + 1) : 0;
+
+		shedding_level previous_level = level;
+		if(frames_over_budget >= ESCALATE_AFTER_FRAMES && level != HIGHEST_LEVEL)
+		{
+			level = static_cast<shedding_level>(static_cast<std::uint8_t>(level) + 1);
+			frames_over_budget = 0;
+		}
+		else if(frames_under_budget >= RELAX_AFTER_FRAMES && level != shedding_level::none)
+		{
+			level = static_cast<shedding_level>(static_cast<std::uint8_t>(level) - 1);
+			frames_under_budget = 0;
+		}
+		if(level == previous_level)
+		{
+			return false;
+		}
+
+		log << "Frame governor: " << get_shedding_level_name(previous_level) << " -> " << get_shedding_level_name(level) << " at frame " << frame_count
+			<< std::fixed << std::setprecision(2) << " (simulation " << average_simulation_milliseconds << " ms, render " << average_render_milliseconds
+			<< " ms, budget " << budget_milliseconds << " ms; " << scene.get_particles().size() << " particles, " << scene.get_rocks().size() << " rocks, "
+			<< scene.get_projectiles().size() << " projectiles; " << scene.get_shed_particle_count() << " particles shed, "
+			<< scene.get_deferred_particle_burst_count() << " bursts deferred so far)" << std::endl;
+		log.unsetf(std::ios_base::floatfield);
+		return true;
+	}
+
+	shedding_level frame_governor::get_level() const noexcept
+	{
+		return level;
+	}
+
+	load_shedding frame_governor::get_load_shedding() const noexcept
+	{
+		load_shedding shedding{};
+		if(level >= shedding_level::decimate_particles)
+		{
+			shedding.particle_fraction = 0.5f;
+			shedding.particle_cap = 512;
+		}
+		if(level >= shedding_level::defer_particle_bursts)
+		{
+			shedding.particle_fraction = 0.25f;
+			shedding.particle_cap = 128;
+			shedding.particle_bursts_per_tick = 2;
+		}
+		return shedding;
+	}
+
+	bool frame_governor::should_cull_offscreen_rendering() const noexcept
+	{
+		return level >= shedding_level::cull_offscreen_rendering;
+	}
+
+	double frame_governor::get_budget_milliseconds() const noexcept
+	{
+		return budget_milliseconds;
+	}
+
+	const char* get_shedding_level_name(shedding_level level) noexcept
+	{
+		switch(level)
+		{
+			case shedding_level::cull_offscreen_rendering:
+				return "cull off-screen rendering";
+			case shedding_level::decimate_particles:
+				return "decimate particles";
+			case shedding_level::defer_particle_bursts:
+				return "defer particle bursts";
+			default:
+				return "none";
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef ASTEROIDS_FRAME_GOVERNOR_HPP
+#define ASTEROIDS_FRAME_GOVERNOR_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include "scene.hpp"
+
+namespace asteroids
+{
+	inline constexpr double DEFAULT_FRAME_BUDGET_MILLISECONDS = 1000.0 / 60.0;
+
+	//Every level keeps the shedding of the ones below it.
+	enum class shedding_level : std::uint8_t
+	{
+		none,
+		cull_offscreen_rendering,
+		decimate_particles,
+		defer_particle_bursts
+	};
+
+	//Watches simulation and render time (without waiting for the present) and raises the shedding level after a few frames
+	//over budget, it only lowers it again after a longer stretch comfortably under budget so levels don't flap.
+	class frame_governor
+	{
+	public:
+		explicit frame_governor(double _budget_milliseconds = DEFAULT_FRAME_BUDGET_MILLISECONDS);
+
+		//Returns true when the level changed, changes are logged together with the timings and the scene's shedding counters.
+		bool record_frame(double simulation_milliseconds,double render_milliseconds,const scene& scene,std::ostream& log);
+		shedding_level get_level() const noexcept;
+		load_shedding get_load_shedding() const noexcept;
+		bool should_cull_offscreen_rendering() const noexcept;
+		double get_budget_milliseconds() const noexcept;
+
+	private:
+		double budget_milliseconds{};
+		double average_simulation_milliseconds{};
+		double average_render_milliseconds{};
+		std::size_t frames_over_budget{};
+		std::size_t frames_under_budget{};
+		std::uint64_t frame_count{};
+		shedding_level level{};
+	};
+
+	const char* get_shedding_level_name(shedding_level level) noexcept;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,327 @@
+#ifndef ASTEROIDS_FUSED_PASS_HPP
+#define ASTEROIDS_FUSED_PASS_HPP
+
+#include <array>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "collision.hpp"
+#include "commands.hpp"
+#include "entities.hpp"
+#include "fixed_point.hpp"
+#include "entity_pool.hpp"
+#include "state_hash.hpp"
+#include "spatial_index.hpp"
+
+namespace asteroids
+{
+	enum class update_class : std::uint8_t
+	{
+		rock,
+		ufo,
+		projectile,
+		particle
+	};
+
+	inline constexpr std::size_t UPDATE_CLASS_COUNT = 4;
+
+	constexpr const char* get_update_class_name(update_class $class) noexcept
+	{
+		constexpr std::array<const char*,UPDATE_CLASS_COUNT> NAMES{"rock","ufo","projectile","particle"};
+		return NAMES[static_cast<std::size_t>($class)];
+	}
+
+	//How often each class is simulated, the defaults simulate everything fully once per tick.
+	//Like load shedding, anything else changes the simulation, so it has to stay off while recording or in lockstep.
+	struct update_schedule
+	{
+		//Rocks and UFOs are transformed every 'interval' ticks, staggered by id. In between their meshes only follow their positions,
+		//so they still move and collide every tick. That is exact in fixed point and off by float rounding otherwise.
+		std::uint32_t rock_interval{1};
+		std::uint32_t ufo_interval{1};
+		//Projectiles move and are collision-tested this many times per tick, a 600 pixels/s bullet covers 10 pixels per tick at 60 Hz.
+		std::uint32_t projectile_substeps{1};
+		//Particles are integrated every 'interval' ticks over the time since and are drawn extrapolated in between.
+		std::uint32_t particle_interval{1};
+	};
+
+	//Rates that keep what the player interacts with exact while cutting most of the transform work of slow and cosmetic classes.
+	inline constexpr update_schedule MULTI_RATE_SCHEDULE{4,2,2,2};
+
+	struct update_cost
+	{
+		//Entity updates including substeps, for particles every particle integrated.
+		std::uint64_t updates{};
+		//Updates that transformed the mesh instead of moving it.
+		std::uint64_t transforms{};
+		std::uint64_t nanoseconds{};
+	};
+
+	using update_cost_array = std::array<update_cost,UPDATE_CLASS_COUNT>;
+
+	//Which screen edges the mesh is completely past.
+	struct screen_exit
+	{
+		bool left;
+		bool right;
+		bool top;
+		bool bottom;
+	};
+
+	template<simulation_mode MODE>
+	screen_exit get_screen_exit(const mesh& mesh) noexcept
+	{
+		if constexpr(MODE == simulation_mode::fixed_point)
+		{
+			fixed_rect bounding_box = mesh.get_fixed_bounding_box();
+			return {(bounding_box.x + bounding_box.w) <= 0,bounding_box.x >= to_fixed(1024),(bounding_box.y + bounding_box.h) <= 0,bounding_box.y >= to_fixed(768)};
+		}
+		else
+		{
+			SDL_FRect bounding_box = mesh.get_transformed_bounding_box();
+			return {(bounding_box.x + bounding_box.w) <= 0,bounding_box.x >= 1024,(bounding_box.y + bounding_box.h) <= 0,bounding_box.y >= 768};
+		}
+	}
+
+	inline screen_exit get_screen_exit(const mesh& mesh,simulation_mode mode) noexcept
+	{
+		return (mode == simulation_mode::fixed_point) ? get_screen_exit<simulation_mode::fixed_point>(mesh) : get_screen_exit<simulation_mode::floating_point>(mesh);
+	}
+
+	//What the collision pass needs from an entity, captured while the entity is hot so the pair loops never go back to it.
+	struct collider
+	{
+		std::size_t index;
+		collision_mask mask;
+		const mesh* shape;
+	};
+
+	using collision_bucket_array = std::array<std::vector<collider>,COLLISION_LAYER_COUNT>;
+
+	//Cull policies decide whether an entity past the screen edges is destroyed instead of updated.
+	struct cull_past_any_edge
+	{
+		template<typename T>
+		static bool should_cull(const T&,const screen_exit& exit) noexcept
+		{
+			return exit.left || exit.right || exit.top || exit.bottom;
+		}
+	};
+
+	//For entities that spawn off screen and fly in, only the edges they are heading away through count.
+	struct cull_heading_past_edge
+	{
+		template<typename T>
+		static bool should_cull(const T& entity,const screen_exit& exit) noexcept
+		{
+			return (exit.left && entity.direction.x < 0) || (exit.right && entity.direction.x > 0) || (exit.top && entity.direction.y < 0) || (exit.bottom && entity.direction.y > 0);
+		}
+	};
+
+	//Collide policies register the surviving entity with the collision pass.
+	struct collide_by_layer
+	{
+		template<typename T>
+		static void add_collider(const T& entity,std::size_t index,collision_bucket_array& buckets)
+		{
+			buckets[static_cast<std::size_t>(entity.layer)].push_back({index,entity.mask,&entity.get_mesh()});
+		}
+	};
+
+	struct collide_never
+	{
+		template<typename T>
+		static void add_collider(const T&,std::size_t,collision_bucket_array&) noexcept
+		{}
+	};
+
+	//Index policies keep the entity's entry in the spatial index in step with its new pose.
+	struct index_by_bounds
+	{
+		template<typename T>
+		static void update_index(const T& entity,entity_handle handle,spatial_index& spatial)
+		{
+			spatial.update(entity.layer,handle,entity.get_mesh().get_transformed_bounding_box());
+		}
+	};
+
+	struct index_never
+	{
+		template<typename T>
+		static void update_index(const T&,entity_handle,spatial_index&) noexcept
+		{}
+	};
+
+	template<typename T>
+	struct fused_pass_traits;
+
+	template<>
+	struct fused_pass_traits<rock>
+	{
+		static constexpr entity_kind KIND = entity_kind::rock;
+		using cull_policy = cull_past_any_edge;
+		using collide_policy = collide_by_layer;
+		using index_policy = index_by_bounds;
+		static constexpr update_class CLASS = update_class::rock;
+
+		static std::uint32_t get_interval(const update_schedule& schedule) noexcept
+		{
+			return schedule.rock_interval;
+		}
+
+		static std::uint32_t get_substeps(const update_schedule&) noexcept
+		{
+			return 1;
+		}
+	};
+
+	template<>
+	struct fused_pass_traits<ufo>
+	{
+		static constexpr entity_kind KIND = entity_kind::ufo;
+		using cull_policy = cull_heading_past_edge;
+		using collide_policy = collide_by_layer;
+		using index_policy = index_by_bounds;
+		static constexpr update_class CLASS = update_class::ufo;
+
+		static std::uint32_t get_interval(const update_schedule& schedule) noexcept
+		{
+			return schedule.ufo_interval;
+		}
+
+		static std::uint32_t get_substeps(const update_schedule&) noexcept
+		{
+			return 1;
+		}
+	};
+
+	template<>
+	struct fused_pass_traits<projectile>
+	{
+		static constexpr entity_kind KIND = entity_kind::projectile;
+		using cull_policy = cull_past_any_edge;
+		using collide_policy = collide_by_layer;
+		using index_policy = index_by_bounds;
+		static constexpr update_class CLASS = update_class::projectile;
+
+		static std::uint32_t get_interval(const update_schedule&) noexcept
+		{
+			return 1;
+		}
+
+		static std::uint32_t get_substeps(const update_schedule& schedule) noexcept
+		{
+			return schedule.projectile_substeps;
+		}
+	};
+
+	struct fused_pass_context
+	{
+		float delta_time;
+		fixed fixed_delta_time;
+		command_buffer& commands;
+		collision_bucket_array& buckets;
+		spatial_index& spatial;
+		std::uint64_t tick;
+		const update_schedule& schedule;
+		update_cost_array& costs;
+		std::array<entity_state_hash,ENTITY_KIND_COUNT>& state_hashes;
+	};
+
+	//One walk over a pool: cull, update, reindex, rehash and register for collisions while each entity is in cache.
+	//Entities move after the cull test, so the test sees last tick's bounding box like the update that follows does.
+	//A substepped class only covers its first substep here, run_substep_kernel() moves it through the others.
+	template<simulation_mode MODE,typename T>
+	void run_fused_kernel(const fused_pass_context& context,entity_pool<T>& pool)
+	{
+		using traits = fused_pass_traits<T>;
+		auto start = std::chrono::steady_clock::now();
+		const std::uint32_t interval = std::max<std::uint32_t>(traits::get_interval(context.schedule),1);
+		const std::uint32_t substeps = std::max<std::uint32_t>(traits::get_substeps(context.schedule),1);
+		update_cost& cost = context.costs[static_cast<std::size_t>(traits::CLASS)];
+		entity_state_hash& state_hash = context.state_hashes[static_cast<std::size_t>(traits::KIND)];
+		for(std::size_t i = 0;i < pool.size();++i)
+		{
+			T& entity = pool[i];
+			if(traits::cull_policy::should_cull(entity,get_screen_exit<MODE>(entity.get_mesh())))
+			{
+				context.commands.push(destroy_command{traits::KIND,pool.get_handle(i)});
+				continue;
+			}
+			bool transform = (interval == 1) || ((context.tick + entity.id) % interval) == 0;
+			if constexpr(MODE == simulation_mode::fixed_point)
+			{
+				entity.update_fixed(context.fixed_delta_time / static_cast<fixed>(substeps),transform);
+			}
+			else
+			{
+				entity.update(context.delta_time / static_cast<float>(substeps),transform);
+			}
+			cost.updates += 1;
+			cost.transforms += transform ? 1 : 0;
+			traits::index_policy::update_index(entity,pool.get_handle(i),context.spatial);
+			state_hash.update(pool.get_handle(i),entity.get_state_hash());
+			traits::collide_policy::add_collider(entity,i,context.buckets);
+		}
+		cost.nanoseconds += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	//Moves every entity of a substepped class through one more substep. Nothing is culled or registered again,
+	//the colliders registered by run_fused_kernel() point at the meshes moved here.
+	template<simulation_mode MODE,typename T>
+	void run_substep_kernel(const fused_pass_context& context,entity_pool<T>& pool)
+	{
+		using traits = fused_pass_traits<T>;
+		auto start = std::chrono::steady_clock::now();
+		const std::uint32_t substeps = std::max<std::uint32_t>(traits::get_substeps(context.schedule),1);
+		update_cost& cost = context.costs[static_cast<std::size_t>(traits::CLASS)];
+		entity_state_hash& state_hash = context.state_hashes[static_cast<std::size_t>(traits::KIND)];
+		for(std::size_t i = 0;i < pool.size();++i)
+		{
+			T& entity = pool[i];
+			if constexpr(MODE == simulation_mode::fixed_point)
+			{
+				entity.update_fixed(context.fixed_delta_time / static_cast<fixed>(substeps),false);
+			}
+			else
+			{
+				entity.update(context.delta_time / static_cast<float>(substeps),false);
+			}
+			traits::index_policy::update_index(entity,pool.get_handle(i),context.spatial);
+			state_hash.update(pool.get_handle(i),entity.get_state_hash());
+		}
+		cost.updates += pool.size();
+		cost.nanoseconds += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	//Pools are walked in argument order, which is also the order their destroy commands are queued in.
+	template<typename... Ts>
+	void run_fused_pass(simulation_mode mode,const fused_pass_context& context,entity_pool<Ts>&... pools)
+	{
+		if(mode == simulation_mode::fixed_point)
+		{
+			(run_fused_kernel<simulation_mode::fixed_point>(context,pools),...);
+		}
+		else
+		{
+			(run_fused_kernel<simulation_mode::floating_point>(context,pools),...);
+		}
+	}
+
+	template<typename T>
+	void run_substep_pass(simulation_mode mode,const fused_pass_context& context,entity_pool<T>& pool)
+	{
+		if(mode == simulation_mode::fixed_point)
+		{
+			run_substep_kernel<simulation_mode::fixed_point>(context,pool);
+		}
+		else
+		{
+			run_substep_kernel<simulation_mode::floating_point>(context,pool);
+		}
+	}
+}
+
+#endif
\ No newline at end of file
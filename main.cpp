@@ -1,64 +1,639 @@
 #include <array>
+#include <algorithm>
 #include <cmath>
 #include <vector>
 #include <random>
 #include <limits>
 #include <chrono>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <charconv>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #define SDL_MAIN_HANDLED
 #include <SDL.h>
-#include <SDL_image.h>
 
+#include "audio.hpp"
 #include "scene.hpp"
+#include "replay.hpp"
+#include "flight_recorder.hpp"
+#include "broadcast.hpp"
+#include "scenario.hpp"
+#include "server.hpp"
+#include "network.hpp"
+#include "frame_governor.hpp"
+#include "mapped_file.hpp"
+#include "dirty_rects.hpp"
+#include "texture_atlas.hpp"
 #include "utility.hpp"
 #include "entities.hpp"
+#include "snapshot.hpp"
+#include "particles.hpp"
+#include "subsystems.hpp"
 
-void render_mesh(SDL_Renderer* renderer,const asteroids::mesh& mesh)
+constexpr double STARTUP_TARGET_MILLISECONDS = 250.0;
+
+//Everything a frame draws, collected before drawing so the dirty-rect path can compare it with the previous frame and redraw it per region.
+struct draw_list
+{
+	struct item
+	{
+		std::uint64_t key;
+		SDL_Color color;
+		SDL_FRect bounds;
+		std::size_t first;
+		std::size_t count;
+		//What the texture atlas path draws instead of the outline, prototype_id::none always draws the outline.
+		asteroids::prototype_id prototype;
+		SDL_FPoint position;
+		float rotation;
+	};
+
+	std::vector<item> items{};
+	std::vector<SDL_FPoint> points{};
+
+	void clear() noexcept
+	{
+		items.clear();
+		points.clear();
+	}
+};
+
+constexpr SDL_Color WHITE_COLOR{255,255,255,255};
+constexpr SDL_Color BLUE_COLOR{0,128,255,255};
+constexpr SDL_Color RED_COLOR{255,0,0,255};
+
+//Keys of different kinds of drawables never collide, ids are only unique within a kind.
+std::uint64_t make_draw_key(std::uint64_t kind,std::uint32_t id) noexcept
+{
+	return (kind << 56) | id;
+}
+
+SDL_FRect get_outline_bounds(const SDL_FPoint* points,std::size_t count) noexcept
+{
+	SDL_FPoint min = points[0];
+	SDL_FPoint max = points[0];
+	for(std::size_t i = 1;i < count;++i)
+	{
+		min.x = std::min(min.x,points[i].x);
+		min.y = std::min(min.y,points[i].y);
+		max.x = std::max(max.x,points[i].x);
+		max.y = std::max(max.y,points[i].y);
+	}
+	return {min.x,min.y,max.x - min.x,max.y - min.y};
+}
+
+void add_mesh(draw_list& list,std::uint64_t key,SDL_Color color,const asteroids::mesh& mesh,asteroids::prototype_id prototype,bool cull_offscreen = false)
 {
+	SDL_FRect bounding_box = mesh.get_transformed_bounding_box();
+	if(cull_offscreen)
+	{
+		if((bounding_box.x + bounding_box.w) < 0 || bounding_box.x > 1024 || (bounding_box.y + bounding_box.h) < 0 || bounding_box.y > 768)
+		{
+			return;
+		}
+	}
 	const auto& vertices = mesh.get_transformed_vertices();
 	if(vertices.size() > 0)
 	{
-		SDL_RenderDrawLinesF(renderer,vertices.data(),static_cast<int>(vertices.size()));
-		SDL_RenderDrawLineF(renderer,vertices.back().x,vertices.back().y,vertices.front().x,vertices.front().y);
+		//The outline is closed by repeating the first vertex, so one line strip draws it.
+		std::size_t first = list.points.size();
+		list.points.insert(list.points.end(),vertices.begin(),vertices.end());
+		list.points.push_back(vertices.front());
+		list.items.push_back({key,color,bounding_box,first,vertices.size() + 1,prototype,mesh.position,mesh.rotation});
 	}
 }
 
-int main()
+void add_particles(draw_list& list,const asteroids::particle_system& particles,float extrapolation)
 {
-	SDL_SetMainReady();
-	if(SDL_Init(SDL_INIT_EVERYTHING) != 0)
+	//Outlines of every particle are built into the list's buffer in one go and drawn back to back with a single draw color.
+	const auto& shape = asteroids::DESTRUCTION_FRAGMENT_MESH.get_vertices();
+	std::size_t first = list.points.size();
+	particles.build_outlines(shape,list.points,extrapolation);
+
+	const std::size_t stride = shape.size() + 1;
+	for(std::size_t i = 0;first + i * stride < list.points.size();++i)
 	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,"Error!","Couldn't init SDL library.",nullptr);
+		const SDL_FPoint* outline = list.points.data() + first + i * stride;
+		SDL_FPoint position = particles.get_position(i);
+		SDL_FPoint velocity = particles.get_velocity(i);
+		SDL_FPoint direction = particles.get_direction(i);
+		list.items.push_back({make_draw_key(4,particles.get_id(i)),BLUE_COLOR,get_outline_bounds(outline,stride),first + i * stride,stride,asteroids::prototype_id::destruction_fragment,
+							{position.x + velocity.x * extrapolation,position.y + velocity.y * extrapolation},std::atan2(direction.y,direction.x)});
+	}
+}
+
+void build_scene_draw_list(draw_list& list,const asteroids::scene& scene,bool cull_offscreen)
+{
+	list.clear();
+	const auto& player = scene.get_player();
+	if(!player.is_dead())
+	{
+		add_mesh(list,make_draw_key(0,0),player.is_invulnerable() ? BLUE_COLOR : WHITE_COLOR,player.get_mesh(),player.prototype);
+	}
+
+	for(const auto& rock : scene.get_rocks())
+	{
+		add_mesh(list,make_draw_key(1,rock.id),WHITE_COLOR,rock.get_mesh(),rock.prototype,cull_offscreen);
+	}
+
+	for(const auto& projectile : scene.get_projectiles())
+	{
+		SDL_Color color = RED_COLOR;
+		if(!projectile.physical)
+		{
+			color = BLUE_COLOR;
+		}
+		else if(projectile.player_friendly)
+		{
+			color = WHITE_COLOR;
+		}
+		add_mesh(list,make_draw_key(2,projectile.id),color,projectile.get_mesh(),projectile.prototype,cull_offscreen);
+	}
+
+	for(const auto& ufo : scene.get_ufos())
+	{
+		add_mesh(list,make_draw_key(3,ufo.id),RED_COLOR,ufo.get_mesh(),ufo.prototype,cull_offscreen);
+	}
+
+	add_particles(list,scene.get_particles(),scene.get_particle_lag());
+}
+
+void build_snapshot_draw_list(draw_list& list,const asteroids::snapshot& snapshot,bool cull_offscreen)
+{
+	list.clear();
+	for(const auto& state : snapshot.entities)
+	{
+		if(state.flags & asteroids::ENTITY_STATE_DEAD)
+		{
+			continue;
+		}
+		SDL_Color color = WHITE_COLOR;
+		if((state.flags & asteroids::ENTITY_STATE_INVULNERABLE) || state.prototype == asteroids::prototype_id::destruction_fragment)
+		{
+			color = BLUE_COLOR;
+		}
+		else if(state.flags & asteroids::ENTITY_STATE_HOSTILE)
+		{
+			color = RED_COLOR;
+		}
+		add_mesh(list,make_draw_key(static_cast<std::uint64_t>(state.prototype),state.id),color,asteroids::make_entity_state_mesh(state),state.prototype,cull_offscreen);
+	}
+}
+
+//Only items crossing 'clip' are submitted, SDL clips their lines to the renderer's clip rect.
+//With 'atlas' items are copied from their prototype's pre-rasterized outlines, items it doesn't have are still drawn line by line.
+void render_draw_list(SDL_Renderer* renderer,const draw_list& list,const SDL_Rect* clip = nullptr,const asteroids::texture_atlas* atlas = nullptr)
+{
+	SDL_Color current_color{0,0,0,0};
+	for(const auto& item : list.items)
+	{
+		if(clip)
+		{
+			SDL_Rect bounds{static_cast<int>(std::floor(item.bounds.x)) - 1,static_cast<int>(std::floor(item.bounds.y)) - 1,static_cast<int>(std::ceil(item.bounds.w)) + 3,static_cast<int>(std::ceil(item.bounds.h)) + 3};
+			if(!asteroids::intersect_int_rects(bounds,*clip))
+			{
+				continue;
+			}
+		}
+		if(atlas && atlas->draw(renderer,item.prototype,item.position,item.rotation,item.color))
+		{
+			continue;
+		}
+		if(item.color.r != current_color.r || item.color.g != current_color.g || item.color.b != current_color.b || item.color.a != current_color.a)
+		{
+			SDL_SetRenderDrawColor(renderer,item.color.r,item.color.g,item.color.b,item.color.a);
+			current_color = item.color;
+		}
+		SDL_RenderDrawLinesF(renderer,list.points.data() + item.first,static_cast<int>(item.count));
+	}
+}
+
+//Same scene for both paths: 'population' rocks, projectiles and UFOs spread over the window, simulated without input.
+void fill_render_benchmark_scene(asteroids::scene& scene,std::size_t population)
+{
+	std::mt19937 random_engine{1};
+	std::uniform_real_distribution<float> x_range{0.0f,1024.0f};
+	std::uniform_real_distribution<float> y_range{0.0f,768.0f};
+	std::uniform_real_distribution<float> angle_range{0.0f,asteroids::CONSTANT_PI * 2.0f};
+	std::uniform_int_distribution<std::size_t> template_range{0,asteroids::ROCK_TEMPLATES.size() - 1};
+	for(std::size_t i = 0;i < population;++i)
+	{
+		SDL_FPoint position{x_range(random_engine),y_range(random_engine)};
+		float angle = angle_range(random_engine);
+		if((i % 20) == 0)
+		{
+			asteroids::ufo ufo{position,100,2000,3.0f,((i % 40) == 0) ? SDL_FPoint{1,0} : SDL_FPoint{-1,0},asteroids::UFO_MESH};
+			ufo.prototype = asteroids::prototype_id::ufo;
+			scene.add_ufo(std::move(ufo));
+		}
+		else if((i % 4) == 0)
+		{
+			asteroids::projectile projectile{position,angle,600,true,true,asteroids::BULLET_MESH};
+			projectile.prototype = asteroids::prototype_id::bullet;
+			scene.add_projectile(std::move(projectile));
+		}
+		else
+		{
+			const auto& rock_template = asteroids::ROCK_TEMPLATES[template_range(random_engine)];
+			asteroids::rock rock{position,angle,rock_template.speed,rock_template.aword_points,rock_template.spawns_smaller_rocks_on_desstruction,rock_template.$mesh};
+			rock.prototype = rock_template.prototype;
+			scene.add_rock(std::move(rock));
+		}
+	}
+}
+
+//Times building, drawing and presenting frames of the same scene line by line and from 'atlas', which may not have been created.
+void run_render_benchmark(SDL_Renderer* renderer,const asteroids::texture_atlas& atlas,std::size_t population,std::ostream& log)
+{
+	constexpr std::size_t FRAME_COUNT = 300;
+	draw_list list{};
+	auto run = [&](const asteroids::texture_atlas* frame_atlas){
+		asteroids::scene scene{1};
+		fill_render_benchmark_scene(scene,population);
+		double seconds = 0.0;
+		for(std::size_t i = 0;i < FRAME_COUNT;++i)
+		{
+			scene.update(1.0f / 60.0f,asteroids::player_input{});
+			Uint64 start = SDL_GetPerformanceCounter();
+			build_scene_draw_list(list,scene,false);
+			SDL_SetRenderDrawColor(renderer,0,0,0,255);
+			SDL_RenderClear(renderer);
+			render_draw_list(renderer,list,nullptr,frame_atlas);
+			SDL_RenderPresent(renderer);
+			seconds += static_cast<double>(SDL_GetPerformanceCounter() - start) / static_cast<double>(SDL_GetPerformanceFrequency());
+		}
+		return seconds * 1000.0 / static_cast<double>(FRAME_COUNT);
+	};
+	log << std::fixed << std::setprecision(3) << "Render benchmark, " << population << " entities, " << FRAME_COUNT << " frames: lines " << run(nullptr) << " ms per frame";
+	if(atlas.is_created())
+	{
+		log << ", texture atlas " << run(&atlas) << " ms per frame";
+	}
+	log << std::endl;
+	log.unsetf(std::ios_base::floatfield);
+}
+
+std::uint64_t pack_color(SDL_Color color) noexcept
+{
+	return (static_cast<std::uint64_t>(color.r) << 24) | (static_cast<std::uint64_t>(color.g) << 16) | (static_cast<std::uint64_t>(color.b) << 8) | color.a;
+}
+
+//The whole argument has to be a number in range, "12abc" or "99999" as a port is rejected instead of being cut short or throwing.
+template<typename T>
+bool parse_argument(const char* text,T& value)
+{
+	const char* end = text + std::strlen(text);
+	auto [last,error] = std::from_chars(text,end,value);
+	return error == std::errc{} && last == end;
+}
+
+void print_usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [--server [port] | --connect host[:port] | --loopback-test clients entities seconds |" << std::endl;
+	std::cerr << "       --record file | --replay file | --replay-headless file | --compile-scenario text binary | --diff-hash-logs a b |" << std::endl;
+	std::cerr << "       --decode-flight-recorder file | --render-benchmark entities | --spectate name]" << std::endl;
+	std::cerr << "       [--scenario binary] [--fixed-point] [--frame-budget milliseconds] [--dirty-rects] [--atlas] [--multi-rate]" << std::endl;
+	std::cerr << "       [--hash-log file [--hash-log-detailed]] [--flight-recorder file] [--flight-recorder-seconds seconds] [--no-flight-recorder]" << std::endl;
+	std::cerr << "       [--broadcast name]" << std::endl;
+}
+
+int main(int argc,char** argv)
+{
+	std::unique_ptr<asteroids::game_client> client{};
+	std::unique_ptr<asteroids::replay_reader> replay{};
+	std::string record_path{};
+	asteroids::simulation_mode simulation_mode = asteroids::simulation_mode::floating_point;
+	double frame_budget_milliseconds = asteroids::DEFAULT_FRAME_BUDGET_MILLISECONDS;
+	asteroids::mapped_file scenario_file{};
+	asteroids::scenario_view scenario{};
+	bool dirty_rect_rendering = false;
+	bool multi_rate = false;
+	std::string headless_replay_path{};
+	std::string hash_log_path{};
+	bool detailed_hash_log = false;
+	bool flight_recording = true;
+	std::string flight_recorder_path{};
+	std::uint32_t flight_recorder_seconds = asteroids::DEFAULT_FLIGHT_RECORDER_SECONDS;
+	bool atlas_rendering = false;
+	std::size_t render_benchmark_population = 0;
+	std::string broadcast_name{};
+	for(int i = 1;i < argc;++i)
+	{
+		std::string argument = argv[i];
+		if(argument == "--server")
+		{
+			//The port is optional, so the next argument is only taken as one when it is a number.
+			std::uint16_t port = asteroids::DEFAULT_SERVER_PORT;
+			if((i + 1) < argc && parse_argument(argv[i + 1],port))
+			{
+				++i;
+			}
+			return asteroids::run_server(port,std::cout);
+		}
+		else if(argument == "--loopback-test" && (i + 3) < argc)
+		{
+			std::size_t client_count{};
+			std::size_t entity_count{};
+			double seconds{};
+			if(!parse_argument(argv[i + 1],client_count) || !parse_argument(argv[i + 2],entity_count) || !parse_argument(argv[i + 3],seconds) || !(seconds > 0.0))
+			{
+				std::cerr << "Invalid loopback test " << argv[i + 1] << " " << argv[i + 2] << " " << argv[i + 3] << "." << std::endl;
+				print_usage(argv[0]);
+				return 1;
+			}
+			return asteroids::run_loopback_test(client_count,entity_count,seconds,std::cout);
+		}
+		else if(argument == "--connect" && (i + 1) < argc)
+		{
+			std::string host = argv[++i];
+			std::uint16_t port = asteroids::DEFAULT_SERVER_PORT;
+			if(auto colon = host.find(':');colon != std::string::npos)
+			{
+				if(!parse_argument(host.c_str() + colon + 1,port) || port == 0)
+				{
+					std::cerr << "Invalid port in " << host << "." << std::endl;
+					print_usage(argv[0]);
+					return 1;
+				}
+				host = host.substr(0,colon);
+			}
+			asteroids::network_address server_address{};
+			client = std::make_unique<asteroids::game_client>();
+			if(!asteroids::resolve_address(host,port,server_address) || !client->connect(server_address))
+			{
+				std::cerr << "Couldn't connect to " << host << ":" << port << "." << std::endl;
+				return 1;
+			}
+		}
+		else if(argument == "--record" && (i + 1) < argc)
+		{
+			record_path = argv[++i];
+		}
+		else if(argument == "--replay" && (i + 1) < argc)
+		{
+			replay = std::make_unique<asteroids::replay_reader>();
+			if(!replay->open(argv[++i]))
+			{
+				std::cerr << "Couldn't read replay " << argv[i] << "." << std::endl;
+				return 1;
+			}
+		}
+		else if(argument == "--scenario" && (i + 1) < argc)
+		{
+			if(!scenario_file.open(argv[++i]) || !scenario.open(scenario_file.get_data(),scenario_file.get_size()))
+			{
+				std::cerr << "Couldn't load scenario " << argv[i] << "." << std::endl;
+				return 1;
+			}
+		}
+		else if(argument == "--compile-scenario" && (i + 2) < argc)
+		{
+			std::ifstream input{argv[i + 1]};
+			std::vector<std::uint8_t> output{};
+			if(!input || !asteroids::compile_scenario(input,output,std::cerr))
+			{
+				std::cerr << "Couldn't compile scenario " << argv[i + 1] << "." << std::endl;
+				return 1;
+			}
+			std::ofstream file{argv[i + 2],std::ios::binary};
+			if(!file.write(reinterpret_cast<const char*>(output.data()),static_cast<std::streamsize>(output.size())))
+			{
+				std::cerr << "Couldn't write " << argv[i + 2] << "." << std::endl;
+				return 1;
+			}
+			return 0;
+		}
+		else if(argument == "--frame-budget" && (i + 1) < argc)
+		{
+			if(!parse_argument(argv[++i],frame_budget_milliseconds) || !std::isfinite(frame_budget_milliseconds) || frame_budget_milliseconds <= 0.0)
+			{
+				std::cerr << "Invalid frame budget " << argv[i] << ", it has to be a positive number of milliseconds." << std::endl;
+				print_usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(argument == "--dirty-rects")
+		{
+			dirty_rect_rendering = true;
+		}
+		else if(argument == "--multi-rate")
+		{
+			multi_rate = true;
+		}
+		else if(argument == "--fixed-point")
+		{
+			simulation_mode = asteroids::simulation_mode::fixed_point;
+		}
+		else if(argument == "--replay-headless" && (i + 1) < argc)
+		{
+			headless_replay_path = argv[++i];
+		}
+		else if(argument == "--hash-log" && (i + 1) < argc)
+		{
+			hash_log_path = argv[++i];
+		}
+		else if(argument == "--hash-log-detailed")
+		{
+			detailed_hash_log = true;
+		}
+		else if(argument == "--diff-hash-logs" && (i + 2) < argc)
+		{
+			return asteroids::diff_state_hash_logs(argv[i + 1],argv[i + 2],std::cout);
+		}
+		else if(argument == "--flight-recorder" && (i + 1) < argc)
+		{
+			flight_recorder_path = argv[++i];
+		}
+		else if(argument == "--flight-recorder-seconds" && (i + 1) < argc)
+		{
+			if(!parse_argument(argv[++i],flight_recorder_seconds))
+			{
+				std::cerr << "Invalid flight recorder length " << argv[i] << "." << std::endl;
+				print_usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(argument == "--no-flight-recorder")
+		{
+			flight_recording = false;
+		}
+		else if(argument == "--atlas")
+		{
+			atlas_rendering = true;
+		}
+		else if(argument == "--render-benchmark" && (i + 1) < argc)
+		{
+			if(!parse_argument(argv[++i],render_benchmark_population) || render_benchmark_population == 0)
+			{
+				std::cerr << "Invalid render benchmark population " << argv[i] << "." << std::endl;
+				print_usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(argument == "--decode-flight-recorder" && (i + 1) < argc)
+		{
+			return asteroids::decode_flight_recorder(argv[i + 1],std::cout);
+		}
+		else if(argument == "--broadcast" && (i + 1) < argc)
+		{
+			broadcast_name = argv[++i];
+		}
+		else if(argument == "--spectate" && (i + 1) < argc)
+		{
+			return asteroids::run_spectator(argv[i + 1],std::cout);
+		}
+		else
+		{
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+	//Replays only store the seed and the inputs, so a recording can't reproduce the entities a scenario puts into the scene.
+	if(scenario_file.is_open() && !record_path.empty())
+	{
+		std::cerr << "--scenario can't be combined with --record, recordings always start from the seeded scene." << std::endl;
 		return 1;
 	}
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0)
+	//Visual replays and network clients seek or get their state from elsewhere, only local play and headless replays are hashed.
+	asteroids::state_hash_log_writer hash_log{};
+	if(!hash_log_path.empty() && !client && !replay && !hash_log.open(hash_log_path,detailed_hash_log))
 	{
-		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,"Error!","Couldn't init SDL2_image library.",nullptr);
-		SDL_Quit();
+		std::cerr << "Couldn't open " << hash_log_path << " for state hashes." << std::endl;
 		return 1;
 	}
+	if(!headless_replay_path.empty())
+	{
+		return asteroids::run_replay_headless(headless_replay_path,std::cout,hash_log.is_open() ? &hash_log : nullptr);
+	}
+
+	SDL_SetMainReady();
+	asteroids::startup_profiler startup_profiler{};
+	if(!asteroids::require_subsystems(SDL_INIT_VIDEO))
+	{
+		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,"Error!","Couldn't init SDL library.",nullptr);
+		return 1;
+	}
+	startup_profiler.mark("SDL video init");
 
 	SDL_Window* window = SDL_CreateWindow("Asteroids Clone",SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED,1024,768,SDL_WINDOW_SHOWN);
 	if(!window)
 	{
 		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,"Error!","Couldn't create a window.",nullptr);
-		IMG_Quit();
-		SDL_Quit();
+		asteroids::shutdown_subsystems();
 		return 1;
 	}
+	startup_profiler.mark("window creation");
+
 	SDL_Renderer* renderer = SDL_CreateRenderer(window,-1,SDL_RENDERER_ACCELERATED);
 	if(!renderer)
 	{
 		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,"Error!","Couldn't create a renderer.",nullptr);
 		SDL_DestroyWindow(window);
-		IMG_Quit();
-		SDL_Quit();
+		asteroids::shutdown_subsystems();
 		return 1;
 	}
+	//Without a GPU SDL falls back to its software renderer, which redraws and uploads the whole window every frame unless only the regions that changed are.
+	SDL_RendererInfo renderer_info{};
+	if(!dirty_rect_rendering && SDL_GetRendererInfo(renderer,&renderer_info) == 0 && (renderer_info.flags & SDL_RENDERER_SOFTWARE))
+	{
+		dirty_rect_rendering = true;
+	}
+	if(dirty_rect_rendering)
+	{
+		//Drawing straight into the window surface lets partial frames be presented region by region.
+		SDL_DestroyRenderer(renderer);
+		SDL_Surface* window_surface = SDL_GetWindowSurface(window);
+		renderer = window_surface ? SDL_CreateSoftwareRenderer(window_surface) : nullptr;
+		if(!renderer)
+		{
+			SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,"Error!","Couldn't create a software renderer.",nullptr);
+			SDL_DestroyWindow(window);
+			asteroids::shutdown_subsystems();
+			return 1;
+		}
+	}
+	startup_profiler.mark("renderer creation");
 
-	asteroids::scene scene{};
+	std::uint64_t seed = replay ? replay->get_seed() : static_cast<std::uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+	if(!replay && scenario_file.is_open())
+	{
+		seed = scenario.get_seed();
+	}
+	asteroids::audio_mixer audio_mixer{};
+	asteroids::scene scene{seed,simulation_mode};
+	asteroids::replay_writer replay_writer{};
+	if(replay)
+	{
+		replay->seek(scene,0);
+	}
+	else if(scenario_file.is_open())
+	{
+		scene.load_scenario(scenario);
+		scenario_file.close();
+	}
+	else if(!record_path.empty() && !replay_writer.open(record_path,seed))
+	{
+		std::cerr << "Couldn't open " << record_path << " for recording." << std::endl;
+	}
+	//Other rates change the simulation, recordings and replays need it updated like it was played.
+	if(multi_rate && !client && !replay && !replay_writer.is_open())
+	{
+		scene.set_update_schedule(asteroids::MULTI_RATE_SCHEDULE);
+	}
+	asteroids::frame_governor frame_governor{frame_budget_milliseconds};
+	std::string preference_path = asteroids::get_preference_path();
+	asteroids::flight_recorder flight_recorder{};
+	if(flight_recording)
+	{
+		if(flight_recorder_path.empty() && !preference_path.empty())
+		{
+			flight_recorder_path = preference_path + "flight_recorder.bin";
+		}
+		std::uint32_t frame_capacity = asteroids::get_flight_recorder_capacity(flight_recorder_seconds,frame_budget_milliseconds);
+		if(flight_recorder_path.empty() || !flight_recorder.open(flight_recorder_path,frame_capacity,seed,frame_budget_milliseconds))
+		{
+			std::cerr << "Couldn't open the flight recorder" << (flight_recorder_path.empty() ? std::string{} : " " + flight_recorder_path) << "." << std::endl;
+		}
+	}
+	//Network clients only have interpolated snapshots, there is no scene to broadcast.
+	asteroids::broadcast_publisher broadcast{};
+	if(!broadcast_name.empty() && !client && !broadcast.open(broadcast_name))
+	{
+		std::cerr << "Couldn't open the broadcast " << broadcast_name << "." << std::endl;
+	}
+	float replay_clock = 0.0f;
+	bool replay_paused = false;
 	std::array<bool,SDL_NUM_SCANCODES> keyboard_keys{};
 	std::array<bool,SDL_NUM_SCANCODES> keyboard_keys_once{};
+	startup_profiler.mark("scene creation");
+	asteroids::texture_atlas texture_atlas{};
+	if(atlas_rendering || render_benchmark_population > 0)
+	{
+		if(!texture_atlas.create(renderer,preference_path,std::cout))
+		{
+			std::cerr << "Couldn't create the texture atlas, outlines are drawn line by line." << std::endl;
+		}
+		startup_profiler.mark("texture atlas");
+	}
+	if(render_benchmark_population > 0)
+	{
+		run_render_benchmark(renderer,texture_atlas,render_benchmark_population,std::cout);
+		texture_atlas.destroy();
+		SDL_DestroyRenderer(renderer);
+		SDL_DestroyWindow(window);
+		asteroids::shutdown_subsystems();
+		return 0;
+	}
+	const asteroids::texture_atlas* frame_atlas = (atlas_rendering && texture_atlas.is_created()) ? &texture_atlas : nullptr;
+	bool first_frame_presented = false;
+	draw_list frame_draw_list{};
+	asteroids::dirty_rect_tracker dirty_rect_tracker{1024,768};
+	std::uint64_t partial_frame_count = 0;
+	std::uint64_t full_frame_count = 0;
+	double presented_area_share = 0.0;
 
 	Uint64 timer_start = SDL_GetPerformanceCounter();
 	SDL_Event event{};
@@ -87,6 +662,13 @@ int main()
 				case SDL_KEYUP:
 					keyboard_keys[event.key.keysym.scancode] = false;
 				break;
+				case SDL_WINDOWEVENT:
+					//The window surface may have been overwritten while hidden or covered.
+					if(event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_RESTORED)
+					{
+						dirty_rect_tracker.invalidate();
+					}
+				break;
 			}
 		}
 
@@ -95,60 +677,187 @@ int main()
 			is_running = false;
 		}
 
-		scene.update(delta_time,keyboard_keys,keyboard_keys_once);
-
-		SDL_SetRenderDrawColor(renderer,0,0,0,255);
-		SDL_RenderClear(renderer);
-
-		const auto& player = scene.get_player();
-		if(player.is_invulnerable())
+		//Simulation and render work are timed separately from the present, which may wait for vsync.
+		Uint64 simulation_start = SDL_GetPerformanceCounter();
+		Uint64 render_start = simulation_start;
+		bool cull_offscreen = frame_governor.should_cull_offscreen_rendering();
+		asteroids::player_input input = asteroids::make_player_input(keyboard_keys,keyboard_keys_once);
+		if(client)
+		{
+			double now = static_cast<double>(timer_end) / SDL_GetPerformanceFrequency();
+			client->send_input(input);
+			client->poll(now);
+			render_start = SDL_GetPerformanceCounter();
+			build_snapshot_draw_list(frame_draw_list,client->get_interpolated_snapshot(now),cull_offscreen);
+		}
+		else if(replay)
 		{
-			SDL_SetRenderDrawColor(renderer,0,128,255,255);
+			std::uint32_t seek_step = replay->get_keyframe_interval();
+			if(keyboard_keys_once[SDL_SCANCODE_SPACE])
+			{
+				replay_paused = !replay_paused;
+			}
+			if(keyboard_keys_once[SDL_SCANCODE_RIGHT])
+			{
+				scene.set_sound_queue(nullptr);
+				replay->seek(scene,replay->get_current_tick() + seek_step);
+				replay_clock = 0.0f;
+			}
+			if(keyboard_keys_once[SDL_SCANCODE_LEFT])
+			{
+				scene.set_sound_queue(nullptr);
+				replay->seek(scene,(replay->get_current_tick() > seek_step) ? (replay->get_current_tick() - seek_step) : 0);
+				replay_clock = 0.0f;
+			}
+			if(!replay_paused)
+			{
+				replay_clock += delta_time;
+				while(replay->get_current_tick() < replay->get_tick_count() && replay_clock >= replay->peek_delta_time())
+				{
+					replay_clock -= replay->peek_delta_time();
+					replay->step(scene);
+				}
+			}
+			broadcast.publish(scene);
+			render_start = SDL_GetPerformanceCounter();
+			build_scene_draw_list(frame_draw_list,scene,cull_offscreen);
 		}
 		else
 		{
-			SDL_SetRenderDrawColor(renderer,255,255,255,255);
+			replay_writer.record_tick(scene,input,delta_time);
+			scene.update(delta_time,input);
+			if(hash_log.is_open())
+			{
+				scene.write_state_hashes(hash_log);
+			}
+			broadcast.publish(scene);
+			render_start = SDL_GetPerformanceCounter();
+			build_scene_draw_list(frame_draw_list,scene,cull_offscreen);
+		}
+		const std::vector<SDL_Rect>* dirty_rects = nullptr;
+		if(dirty_rect_rendering)
+		{
+			dirty_rect_tracker.begin_frame();
+			for(const auto& item : frame_draw_list.items)
+			{
+				dirty_rect_tracker.add(item.key,item.bounds,asteroids::hash_outline(frame_draw_list.points.data() + item.first,item.count) ^ pack_color(item.color));
+			}
+			dirty_rects = &dirty_rect_tracker.end_frame();
+			for(const auto& rect : *dirty_rects)
+			{
+				SDL_RenderSetClipRect(renderer,&rect);
+				SDL_SetRenderDrawColor(renderer,0,0,0,255);
+				SDL_RenderFillRect(renderer,&rect);
+				render_draw_list(renderer,frame_draw_list,&rect,frame_atlas);
+			}
+			SDL_RenderSetClipRect(renderer,nullptr);
+			SDL_RenderFlush(renderer);
 		}
-		if(!player.is_dead())
+		else
 		{
-			render_mesh(renderer,player.get_mesh());
+			SDL_SetRenderDrawColor(renderer,0,0,0,255);
+			SDL_RenderClear(renderer);
+			render_draw_list(renderer,frame_draw_list,nullptr,frame_atlas);
 		}
-
-		SDL_SetRenderDrawColor(renderer,255,255,255,255);
-		for(const auto& rock : scene.get_rocks())
+		Uint64 render_end = SDL_GetPerformanceCounter();
+		double counter_milliseconds = 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+		if(frame_governor.record_frame(static_cast<double>(render_start - simulation_start) * counter_milliseconds,static_cast<double>(render_end - render_start) * counter_milliseconds,scene,std::cout))
 		{
-			render_mesh(renderer,rock.get_mesh());
+			//Shedding simulation work would make recordings and replays diverge from what was played, only rendering is shed then.
+			if(!client && !replay && !replay_writer.is_open())
+			{
+				scene.set_load_shedding(frame_governor.get_load_shedding());
+			}
 		}
 
-		for(const auto& projectile : scene.get_projectiles())
+		if(dirty_rects)
 		{
-			if(!projectile.physical)
+			if(!dirty_rects->empty())
 			{
-				SDL_SetRenderDrawColor(renderer,0,128,255,255);
+				SDL_UpdateWindowSurfaceRects(window,dirty_rects->data(),static_cast<int>(dirty_rects->size()));
 			}
-			else if(projectile.player_friendly)
+			if(dirty_rect_tracker.is_full_redraw())
 			{
-				SDL_SetRenderDrawColor(renderer,255,255,255,255);
+				++full_frame_count;
 			}
 			else
 			{
-				SDL_SetRenderDrawColor(renderer,255,0,0,255);
+				++partial_frame_count;
 			}
-			render_mesh(renderer,projectile.get_mesh());
+			presented_area_share += static_cast<double>(dirty_rect_tracker.get_dirty_area()) / (1024.0 * 768.0);
 		}
-
-		SDL_SetRenderDrawColor(renderer,255,0,0,255);
-		for(const auto& ufo : scene.get_ufos())
+		else
+		{
+			SDL_RenderPresent(renderer);
+		}
+		if(flight_recorder.is_open())
 		{
-			render_mesh(renderer,ufo.get_mesh());
+			asteroids::flight_frame frame = asteroids::make_flight_frame(scene,asteroids::pack_player_input(input),delta_time);
+			frame.simulation_milliseconds = static_cast<float>(static_cast<double>(render_start - simulation_start) * counter_milliseconds);
+			frame.render_milliseconds = static_cast<float>(static_cast<double>(render_end - render_start) * counter_milliseconds);
+			frame.present_milliseconds = static_cast<float>(static_cast<double>(SDL_GetPerformanceCounter() - render_end) * counter_milliseconds);
+			frame.shedding_level = static_cast<std::uint8_t>(frame_governor.get_level());
+			frame.flags |= client ? asteroids::FLIGHT_FRAME_NETWORK_CLIENT : (replay ? asteroids::FLIGHT_FRAME_REPLAY : 0);
+			flight_recorder.record_frame(frame,client ? nullptr : &scene);
 		}
+		if(!first_frame_presented)
+		{
+			startup_profiler.mark("first frame");
+			startup_profiler.report(std::cout,STARTUP_TARGET_MILLISECONDS);
+			first_frame_presented = true;
 
-		SDL_RenderPresent(renderer);
+			//Audio isn't needed for the first frame, so the device is opened after it was presented.
+			if(audio_mixer.open())
+			{
+				scene.set_sound_queue(&audio_mixer.get_queue());
+			}
+			else
+			{
+				std::cerr << "Couldn't open an audio device, sound is disabled." << std::endl;
+			}
+		}
 	}
 	
+	replay_writer.close();
+	if(broadcast.is_open())
+	{
+		std::cout << "Broadcast " << broadcast.get_published_count() << " ticks, " << broadcast.get_truncated_count() << " had more entities than fit into a slot." << std::endl;
+		broadcast.close();
+	}
+	if(!hash_log.close())
+	{
+		std::cerr << "Couldn't write all state hashes to " << hash_log_path << "." << std::endl;
+	}
+	std::cout << "Collisions: " << scene.get_tested_collision_pair_count() << " pairs tested, rejected without a geometry test:";
+	for(std::size_t i = 0;i < asteroids::COLLISION_LAYER_COUNT;++i)
+	{
+		auto layer = static_cast<asteroids::collision_layer>(i);
+		std::cout << " " << asteroids::get_collision_layer_name(layer) << " " << scene.get_rejected_collision_pair_count(layer);
+	}
+	std::cout << std::endl;
+	if(!client)
+	{
+		std::cout << "Update cost:";
+		for(std::size_t i = 0;i < asteroids::UPDATE_CLASS_COUNT;++i)
+		{
+			auto $class = static_cast<asteroids::update_class>(i);
+			const auto& cost = scene.get_update_cost($class);
+			std::cout << " " << asteroids::get_update_class_name($class) << " " << cost.updates << " updates (" << cost.transforms << " transformed) " << (static_cast<double>(cost.nanoseconds) / 1000000.0) << " ms";
+		}
+		std::cout << std::endl;
+	}
+	if(dirty_rect_rendering && (partial_frame_count + full_frame_count) > 0)
+	{
+		std::cout << "Dirty rects: " << partial_frame_count << " partial frames, " << full_frame_count << " full frames, " << (presented_area_share * 100.0 / static_cast<double>(partial_frame_count + full_frame_count)) << "% of the window presented on average." << std::endl;
+	}
+	if(audio_mixer.is_open())
+	{
+		audio_mixer.report(std::cout);
+		audio_mixer.close();
+	}
+	texture_atlas.destroy();
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
-	IMG_Quit();
-	SDL_Quit();
+	asteroids::shutdown_subsystems();
 	return 0;
 }
\ No newline at end of file
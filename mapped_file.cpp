@@ -0,0 +1,149 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace asteroids
+{
+	mapped_file::mapped_file(mapped_file&& _mapped_file) noexcept
+		: data(std::exchange(_mapped_file.data,nullptr)),size(std::exchange(_mapped_file.size,0))
+#ifdef _WIN32
+		,file_handle(std::exchange(_mapped_file.file_handle,nullptr)),mapping_handle(std::exchange(_mapped_file.mapping_handle,nullptr))
+#else
+		,descriptor(std::exchange(_mapped_file.descriptor,-1))
+#endif
+	{}
+
+	mapped_file& mapped_file::operator = (mapped_file&& _mapped_file) noexcept
+	{
+		if(this != &_mapped_file)
+		{
+			close();
+			data = std::exchange(_mapped_file.data,nullptr);
+			size = std::exchange(_mapped_file.size,0);
+#ifdef _WIN32
+			file_handle = std::exchange(_mapped_file.file_handle,nullptr);
+			mapping_handle = std::exchange(_mapped_file.mapping_handle,nullptr);
+#else
+			descriptor = std::exchange(_mapped_file.descriptor,-1);
+#endif
+		}
+		return *this;
+	}
+
+	mapped_file::~mapped_file()
+	{
+		close();
+	}
+
+	bool mapped_file::open(const std::string& path)
+	{
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,nullptr);
+		if(file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		file_handle = file;
+		LARGE_INTEGER file_size{};
+		if(!GetFileSizeEx(file,&file_size) || file_size.QuadPart == 0)
+		{
+			close();
+			return false;
+		}
+		mapping_handle = CreateFileMappingA(file,nullptr,PAGE_READONLY,0,0,nullptr);
+		if(!mapping_handle)
+		{
+			close();
+			return false;
+		}
+		data = static_cast<const std::uint8_t*>(MapViewOfFile(mapping_handle,FILE_MAP_READ,0,0,0));
+		if(!data)
+		{
+			close();
+			return false;
+		}
+		size = static_cast<std::size_t>(file_size.QuadPart);
+#else
+		descriptor = ::open(path.c_str(),O_RDONLY);
+		if(descriptor < 0)
+		{
+			return false;
+		}
+		struct stat status{};
+		if(fstat(descriptor,&status) != 0 || status.st_size <= 0)
+		{
+			close();
+			return false;
+		}
+		void* mapping = mmap(nullptr,static_cast<std::size_t>(status.st_size),PROT_READ,MAP_PRIVATE,descriptor,0);
+		if(mapping == MAP_FAILED)
+		{
+			close();
+			return false;
+		}
+		data = static_cast<const std::uint8_t*>(mapping);
+		size = static_cast<std::size_t>(status.st_size);
+		//Scenarios are read front to back.
+		madvise(mapping,size,MADV_SEQUENTIAL);
+#endif
+		return true;
+	}
+
+	void mapped_file::close()
+	{
+#ifdef _WIN32
+		if(data)
+		{
+			UnmapViewOfFile(data);
+		}
+		if(mapping_handle)
+		{
+			CloseHandle(mapping_handle);
+			mapping_handle = nullptr;
+		}
+		if(file_handle)
+		{
+			CloseHandle(file_handle);
+			file_handle = nullptr;
+		}
+#else
+		if(data)
+		{
+			munmap(const_cast<std::uint8_t*>(data),size);
+		}
+		if(descriptor >= 0)
+		{
+			::close(descriptor);
+			descriptor = -1;
+		}
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	bool mapped_file::is_open() const noexcept
+	{
+		return data != nullptr;
+	}
+
+	const std::uint8_t* mapped_file::get_data() const noexcept
+	{
+		return data;
+	}
+
+	std::size_t mapped_file::get_size() const noexcept
+	{
+		return size;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef ASTEROIDS_MAPPED_FILE_HPP
+#define ASTEROIDS_MAPPED_FILE_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace asteroids
+{
+	//Read-only memory mapping of a whole file, pages are loaded by the OS on first access instead of being read up front.
+	class mapped_file
+	{
+	public:
+		mapped_file() = default;
+		mapped_file(const mapped_file&) = delete;
+		mapped_file(mapped_file&& _mapped_file) noexcept;
+		mapped_file& operator = (const mapped_file&) = delete;
+		mapped_file& operator = (mapped_file&& _mapped_file) noexcept;
+		~mapped_file();
+
+		bool open(const std::string& path);
+		void close();
+		bool is_open() const noexcept;
+		const std::uint8_t* get_data() const noexcept;
+		std::size_t get_size() const noexcept;
+
+	private:
+		const std::uint8_t* data{};
+		std::size_t size{};
+#ifdef _WIN32
+		void* file_handle{};
+		void* mapping_handle{};
+#else
+		int descriptor{-1};
+#endif
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "network.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+namespace asteroids
+{
+	namespace
+	{
+		bool initialize_sockets()
+		{
+#ifdef _WIN32
+			static bool initialized = false;
+			if(!initialized)
+			{
+				WSADATA data{};
+				initialized = WSAStartup(MAKEWORD(2,2),&data) == 0;
+			}
+			return initialized;
+#else
+			return true;
+#endif
+		}
+
+		sockaddr_in make_sockaddr(const network_address& address)
+		{
+			sockaddr_in result{};
+			result.sin_family = AF_INET;
+			result.sin_addr.s_addr = htonl(address.ipv4);
+			result.sin_port = htons(address.port);
+			return result;
+		}
+	}
+
+	bool network_address::operator == (const network_address& other) const noexcept
+	{
+		return ipv4 == other.ipv4 && port == other.port;
+	}
+
+	bool network_address::operator != (const network_address& other) const noexcept
+	{
+		return !(*this == other);
+	}
+
+	bool resolve_address(const std::string& host,std::uint16_t port,network_address& address)
+	{
+		if(!initialize_sockets())
+		{
+			return false;
+		}
+		addrinfo hints{};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		addrinfo* result = nullptr;
+		if(getaddrinfo(host.c_str(),nullptr,&hints,&result) != 0 || !result)
+		{
+			return false;
+		}
+		address.ipv4 = ntohl(reinterpret_cast<const sockaddr_in*>(result->ai_addr)->sin_addr.s_addr);
+		address.port = port;
+		freeaddrinfo(result);
+		return true;
+	}
+
+	udp_socket::udp_socket(udp_socket&& _socket) noexcept
+	{
+		*this = std::move(_socket);
+	}
+
+	udp_socket& udp_socket::operator = (udp_socket&& _socket) noexcept
+	{
+		if(&_socket != this)
+		{
+			close();
+			handle = _socket.handle;
+			port = _socket.port;
+			_socket.handle = -1;
+			_socket.port = 0;
+		}
+		return *this;
+	}
+
+	udp_socket::~udp_socket()
+	{
+		close();
+	}
+
+	bool udp_socket::open(std::uint16_t _port)
+	{
+		close();
+		if(!initialize_sockets())
+		{
+			return false;
+		}
+		auto native = socket(AF_INET,SOCK_DGRAM,IPPROTO_UDP);
+#ifdef _WIN32
+		if(native == INVALID_SOCKET)
+		{
+			return false;
+		}
+#else
+		if(native < 0)
+		{
+			return false;
+		}
+#endif
+		handle = static_cast<std::intptr_t>(native);
+
+		int buffer_size = 4 * 1024 * 1024;
+		setsockopt(native,SOL_SOCKET,SO_RCVBUF,reinterpret_cast<const char*>(&buffer_size),sizeof(buffer_size));
+		setsockopt(native,SOL_SOCKET,SO_SNDBUF,reinterpret_cast<const char*>(&buffer_size),sizeof(buffer_size));
+
+		sockaddr_in address = make_sockaddr(network_address{INADDR_ANY,_port});
+		if(bind(native,reinterpret_cast<const sockaddr*>(&address),sizeof(address)) != 0)
+		{
+			close();
+			return false;
+		}
+#ifdef _WIN32
+		u_long non_blocking = 1;
+		if(ioctlsocket(native,FIONBIO,&non_blocking) != 0)
+#else
+		if(fcntl(native,F_SETFL,fcntl(native,F_GETFL,0) | O_NONBLOCK) != 0)
+#endif
+		{
+			close();
+			return false;
+		}
+
+		sockaddr_in bound{};
+		socklen_t bound_size = sizeof(bound);
+		getsockname(native,reinterpret_cast<sockaddr*>(&bound),&bound_size);
+		port = ntohs(bound.sin_port);
+		return true;
+	}
+
+	void udp_socket::close() noexcept
+	{
+		if(handle != -1)
+		{
+#ifdef _WIN32
+			closesocket(static_cast<SOCKET>(handle));
+#else
+			::close(static_cast<int>(handle));
+#endif
+			handle = -1;
+			port = 0;
+		}
+	}
+
+	bool udp_socket::is_open() const noexcept
+	{
+		return handle != -1;
+	}
+
+	std::uint16_t udp_socket::get_port() const noexcept
+	{
+		return port;
+	}
+
+	bool udp_socket::send_to(const network_address& address,const std::uint8_t* data,std::size_t size)
+	{
+		if(handle == -1 || size > MAX_DATAGRAM_SIZE)
+		{
+			return false;
+		}
+		sockaddr_in destination = make_sockaddr(address);
+#ifdef _WIN32
+		auto sent = sendto(static_cast<SOCKET>(handle),reinterpret_cast<const char*>(data),static_cast<int>(size),0,reinterpret_cast<const sockaddr*>(&destination),sizeof(destination));
+#else
+		auto sent = sendto(static_cast<int>(handle),data,size,0,reinterpret_cast<const sockaddr*>(&destination),sizeof(destination));
+#endif
+		return sent == static_cast<decltype(sent)>(size);
+	}
+
+	std::size_t udp_socket::receive_from(network_address& address,std::uint8_t* buffer,std::size_t capacity)
+	{
+		if(handle == -1)
+		{
+			return 0;
+		}
+		sockaddr_in source{};
+		socklen_t source_size = sizeof(source);
+#ifdef _WIN32
+		auto received = recvfrom(static_cast<SOCKET>(handle),reinterpret_cast<char*>(buffer),static_cast<int>(capacity),0,reinterpret_cast<sockaddr*>(&source),&source_size);
+#else
+		auto received = recvfrom(static_cast<int>(handle),buffer,capacity,0,reinterpret_cast<sockaddr*>(&source),&source_size);
+#endif
+		if(received <= 0)
+		{
+			return 0;
+		}
+		address.ipv4 = ntohl(source.sin_addr.s_addr);
+		address.port = ntohs(source.sin_port);
+		return static_cast<std::size_t>(received);
+	}
+}
\ No newline at end of file
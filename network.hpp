@@ -0,0 +1,49 @@
+#ifndef ASTEROIDS_NETWORK_HPP
+#define ASTEROIDS_NETWORK_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace asteroids
+{
+	inline constexpr std::uint16_t DEFAULT_SERVER_PORT = 27015;
+	inline constexpr std::size_t MAX_DATAGRAM_SIZE = 65507;
+
+	struct network_address
+	{
+		std::uint32_t ipv4{};
+		std::uint16_t port{};
+
+		bool operator == (const network_address& other) const noexcept;
+		bool operator != (const network_address& other) const noexcept;
+	};
+
+	bool resolve_address(const std::string& host,std::uint16_t port,network_address& address);
+
+	class udp_socket
+	{
+	public:
+		udp_socket() = default;
+		udp_socket(const udp_socket&) = delete;
+		udp_socket(udp_socket&& _socket) noexcept;
+		udp_socket& operator = (const udp_socket&) = delete;
+		udp_socket& operator = (udp_socket&& _socket) noexcept;
+		~udp_socket();
+
+		//Binds to 'port' on all interfaces (0 picks an ephemeral port) and makes the socket non-blocking.
+		bool open(std::uint16_t port);
+		void close() noexcept;
+		bool is_open() const noexcept;
+		std::uint16_t get_port() const noexcept;
+		bool send_to(const network_address& address,const std::uint8_t* data,std::size_t size);
+		//Returns the size of the received datagram or 0 when nothing is pending.
+		std::size_t receive_from(network_address& address,std::uint8_t* buffer,std::size_t capacity);
+
+	private:
+		std::intptr_t handle{-1};
+		std::uint16_t port{};
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include "particles.hpp"
+
+#include <cmath>
+#include "utility.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ASTEROIDS_PARTICLES_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr float PARTICLE_CULL_MARGIN = 15.0f;
+
+		std::size_t round_up_to_lanes(std::size_t value)
+		{
+			return (value + 3) & ~std::size_t{3};
+		}
+	}
+
+	particle_system::particle_system(std::size_t _capacity) : capacity(_capacity)
+	{
+		std::size_t storage = round_up_to_lanes(capacity);
+		x.resize(storage);
+		y.resize(storage);
+		velocity_x.resize(storage);
+		velocity_y.resize(storage);
+		direction_x.resize(storage);
+		direction_y.resize(storage);
+		ids.resize(storage);
+	}
+
+	std::size_t particle_system::spawn_burst(SDL_FPoint position,std::size_t burst_count,float speed,std::uint32_t first_id)
+	{
+		std::size_t spawned = 0;
+		for(std::size_t i = 0;i < burst_count;++i)
+		{
+			if(count >= capacity)
+			{
+				dropped_count += burst_count - i;
+				break;
+			}
+			float angle = CONSTANT_PI * 2.0f * (1.0f / burst_count) * i;
+			float c = std::cos(angle);
+			float s = std::sin(angle);
+			x[count] = position.x;
+			y[count] = position.y;
+			velocity_x[count] = c * speed;
+			velocity_y[count] = s * speed;
+			direction_x[count] = c;
+			direction_y[count] = s;
+			ids[count] = first_id + static_cast<std::uint32_t>(i);
+			++count;
+			++spawned;
+		}
+		return spawned;
+	}
+
+	void particle_system::update(float delta_time)
+	{
+		std::size_t lanes = round_up_to_lanes(count);
+#ifdef ASTEROIDS_PARTICLES_SSE2
+		const __m128 dt = _mm_set1_ps(delta_time);
+		for(std::size_t i = 0;i < lanes;i += 4)
+		{
+			__m128 px = _mm_loadu_ps(&x[i]);
+			__m128 py = _mm_loadu_ps(&y[i]);
+			__m128 vx = _mm_loadu_ps(&velocity_x[i]);
+			__m128 vy = _mm_loadu_ps(&velocity_y[i]);
+			_mm_storeu_ps(&x[i],_mm_add_ps(px,_mm_mul_ps(vx,dt)));
+			_mm_storeu_ps(&y[i],_mm_add_ps(py,_mm_mul_ps(vy,dt)));
+		}
+#else
+		for(std::size_t i = 0;i < lanes;++i)
+		{
+			x[i] += velocity_x[i] * delta_time;
+			y[i] += velocity_y[i] * delta_time;
+		}
+#endif
+
+		for(std::size_t i = 0;i < count;)
+		{
+			if(	x[i] < -PARTICLE_CULL_MARGIN || x[i] > (1024 + PARTICLE_CULL_MARGIN) ||
+				y[i] < -PARTICLE_CULL_MARGIN || y[i] > (768 + PARTICLE_CULL_MARGIN) )
+			{
+				remove(i);
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
+	void particle_system::clear() noexcept
+	{
+		count = 0;
+	}
+
+	std::size_t particle_system::size() const noexcept
+	{
+		return count;
+	}
+
+	std::size_t particle_system::get_capacity() const noexcept
+	{
+		return capacity;
+	}
+
+	std::size_t particle_system::get_dropped_count() const noexcept
+	{
+		return dropped_count;
+	}
+
+	SDL_FPoint particle_system::get_position(std::size_t index) const noexcept
+	{
+		return {x[index],y[index]};
+	}
+
+	SDL_FPoint particle_system::get_direction(std::size_t index) const noexcept
+	{
+		return {direction_x[index],direction_y[index]};
+	}
+
+	SDL_FPoint particle_system::get_velocity(std::size_t index) const noexcept
+	{
+		return {velocity_x[index],velocity_y[index]};
+	}
+
+	std::uint32_t particle_system::get_id(std::size_t index) const noexcept
+	{
+		return ids[index];
+	}
+
+	void particle_system::build_outlines(const std::vector<SDL_FPoint>& shape,std::vector<SDL_FPoint>& output,float extrapolation) const
+	{
+		if(shape.empty())
+		{
+			return;
+		}
+		output.reserve(output.size() + count * (shape.size() + 1));
+		for(std::size_t i = 0;i < count;++i)
+		{
+			float c = direction_x[i];
+			float s = direction_y[i];
+			float px = x[i] + velocity_x[i] * extrapolation;
+			float py = y[i] + velocity_y[i] * extrapolation;
+			for(const auto& vertex : shape)
+			{
+				output.push_back({c * vertex.x - s * vertex.y + px,s * vertex.x + c * vertex.y + py});
+			}
+			output.push_back(output[output.size() - shape.size()]);
+		}
+	}
+
+	void particle_system::save_state(binary_writer& writer) const
+	{
+		writer.write(static_cast<std::uint32_t>(count));
+		for(std::size_t i = 0;i < count;++i)
+		{
+			writer.write(x[i]);
+			writer.write(y[i]);
+			writer.write(velocity_x[i]);
+			writer.write(velocity_y[i]);
+			writer.write(direction_x[i]);
+			writer.write(direction_y[i]);
+			writer.write(ids[i]);
+		}
+	}
+
+	bool particle_system::load_state(binary_reader& reader)
+	{
+		std::uint32_t loaded_count{};
+		if(!reader.read(loaded_count) || loaded_count > capacity)
+		{
+			return false;
+		}
+		count = loaded_count;
+		for(std::size_t i = 0;i < count;++i)
+		{
+			if(!(reader.read(x[i]) && reader.read(y[i]) && reader.read(velocity_x[i]) && reader.read(velocity_y[i]) &&
+				reader.read(direction_x[i]) && reader.read(direction_y[i]) && reader.read(ids[i])))
+			{
+				count = 0;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void particle_system::remove(std::size_t index) noexcept
+	{
+		std::size_t last = --count;
+		x[index] = x[last];
+		y[index] = y[last];
+		velocity_x[index] = velocity_x[last];
+		velocity_y[index] = velocity_y[last];
+		direction_x[index] = direction_x[last];
+		direction_y[index] = direction_y[last];
+		ids[index] = ids[last];
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef ASTEROIDS_PARTICLES_HPP
+#define ASTEROIDS_PARTICLES_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <SDL_rect.h>
+#include "serialization.hpp"
+
+namespace asteroids
+{
+	inline constexpr std::size_t DEFAULT_PARTICLE_CAPACITY = 4096;
+
+	//Fixed-capacity pool of cosmetic particles stored as separate arrays so the integration runs four particles at a time.
+	//Particles are never collision-tested and live until they leave the screen, spawns beyond the capacity are dropped.
+	class particle_system
+	{
+	public:
+		explicit particle_system(std::size_t _capacity = DEFAULT_PARTICLE_CAPACITY);
+
+		//Spawns 'count' particles flying out of 'position' in evenly spaced directions, returns how many fit into the pool.
+		std::size_t spawn_burst(SDL_FPoint position,std::size_t count,float speed,std::uint32_t first_id);
+		void update(float delta_time);
+		void clear() noexcept;
+		std::size_t size() const noexcept;
+		std::size_t get_capacity() const noexcept;
+		std::size_t get_dropped_count() const noexcept;
+
+		SDL_FPoint get_position(std::size_t index) const noexcept;
+		SDL_FPoint get_direction(std::size_t index) const noexcept;
+		SDL_FPoint get_velocity(std::size_t index) const noexcept;
+		std::uint32_t get_id(std::size_t index) const noexcept;
+		//Appends the closed outline of every particle, shape.size() + 1 points each with the first vertex repeated.
+		//Particles are drawn 'extrapolation' seconds further along their velocity, for particles integrated less often than drawn.
+		void build_outlines(const std::vector<SDL_FPoint>& shape,std::vector<SDL_FPoint>& output,float extrapolation = 0.0f) const;
+
+		void save_state(binary_writer& writer) const;
+		bool load_state(binary_reader& reader);
+
+	private:
+		void remove(std::size_t index) noexcept;
+
+		std::size_t capacity;
+		std::size_t count{};
+		std::size_t dropped_count{};
+		std::vector<float> x{};
+		std::vector<float> y{};
+		std::vector<float> velocity_x{};
+		std::vector<float> velocity_y{};
+		std::vector<float> direction_x{};
+		std::vector<float> direction_y{};
+		std::vector<std::uint32_t> ids{};
+	};
+}
+
+#endif
\ No newline at end of file
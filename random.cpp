@@ -0,0 +1,145 @@
+#include "random.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ASTEROIDS_RANDOM_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr std::uint32_t PHILOX_MULTIPLIER_0 = 0xD2511F53u;
+		constexpr std::uint32_t PHILOX_MULTIPLIER_1 = 0xCD9E8D57u;
+		constexpr std::uint32_t PHILOX_WEYL_0 = 0x9E3779B9u;
+		constexpr std::uint32_t PHILOX_WEYL_1 = 0xBB67AE85u;
+		constexpr int PHILOX_ROUNDS = 10;
+		//Every Philox block yields four draws, the block number takes the low 24 bits of the last counter word and the stream the high 8.
+		constexpr std::uint32_t DRAWS_PER_BLOCK = 4;
+		constexpr int STREAM_SHIFT = 24;
+
+		std::array<std::uint32_t,4> make_counter(std::uint64_t tick,std::uint32_t entity_id,random_stream stream,std::uint32_t block) noexcept
+		{
+			return {static_cast<std::uint32_t>(tick),static_cast<std::uint32_t>(tick >> 32),entity_id,(static_cast<std::uint32_t>(stream) << STREAM_SHIFT) | (block & ((1u << STREAM_SHIFT) - 1))};
+		}
+
+		std::array<std::uint32_t,2> make_key(std::uint64_t seed) noexcept
+		{
+			return {static_cast<std::uint32_t>(seed),static_cast<std::uint32_t>(seed >> 32)};
+		}
+
+#ifdef ASTEROIDS_RANDOM_SSE2
+		//32x32->64 bit products of all four lanes, _mm_mul_epu32 only handles the even ones so the odd lanes are shifted down first.
+		void multiply_wide(__m128i a,__m128i multiplier,__m128i& high,__m128i& low) noexcept
+		{
+			__m128i even = _mm_mul_epu32(a,multiplier);
+			__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a,32),multiplier);
+			low = _mm_unpacklo_epi32(_mm_shuffle_epi32(even,_MM_SHUFFLE(0,0,2,0)),_mm_shuffle_epi32(odd,_MM_SHUFFLE(0,0,2,0)));
+			high = _mm_unpacklo_epi32(_mm_shuffle_epi32(even,_MM_SHUFFLE(0,0,3,1)),_mm_shuffle_epi32(odd,_MM_SHUFFLE(0,0,3,1)));
+		}
+
+		//Four consecutive blocks at once, lane i of every register belongs to the block numbered 'counter[3] + i'.
+		void philox4x32_blocks(std::array<std::uint32_t,4> counter,std::array<std::uint32_t,2> key,std::uint32_t* output) noexcept
+		{
+			__m128i c0 = _mm_set1_epi32(static_cast<int>(counter[0]));
+			__m128i c1 = _mm_set1_epi32(static_cast<int>(counter[1]));
+			__m128i c2 = _mm_set1_epi32(static_cast<int>(counter[2]));
+			__m128i c3 = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(counter[3])),_mm_set_epi32(3,2,1,0));
+			const __m128i multiplier_0 = _mm_set1_epi32(static_cast<int>(PHILOX_MULTIPLIER_0));
+			const __m128i multiplier_1 = _mm_set1_epi32(static_cast<int>(PHILOX_MULTIPLIER_1));
+			std::uint32_t k0 = key[0];
+			std::uint32_t k1 = key[1];
+			for(int round = 0;round < PHILOX_ROUNDS;++round)
+			{
+				__m128i high_0{},low_0{},high_1{},low_1{};
+				multiply_wide(c0,multiplier_0,high_0,low_0);
+				multiply_wide(c2,multiplier_1,high_1,low_1);
+				c0 = _mm_xor_si128(_mm_xor_si128(high_1,c1),_mm_set1_epi32(static_cast<int>(k0)));
+				c1 = low_1;
+				c2 = _mm_xor_si128(_mm_xor_si128(high_0,c3),_mm_set1_epi32(static_cast<int>(k1)));
+				c3 = low_0;
+				k0 += PHILOX_WEYL_0;
+				k1 += PHILOX_WEYL_1;
+			}
+			//Transpose so every block's four words end up next to each other.
+			__m128i t0 = _mm_unpacklo_epi32(c0,c1);
+			__m128i t1 = _mm_unpacklo_epi32(c2,c3);
+			__m128i t2 = _mm_unpackhi_epi32(c0,c1);
+			__m128i t3 = _mm_unpackhi_epi32(c2,c3);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output),_mm_unpacklo_epi64(t0,t1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 4),_mm_unpackhi_epi64(t0,t1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 8),_mm_unpacklo_epi64(t2,t3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 12),_mm_unpackhi_epi64(t2,t3));
+		}
+#endif
+	}
+
+	counter_rng::counter_rng(std::uint64_t _seed) noexcept : seed(_seed)
+	{}
+
+	std::uint32_t counter_rng::bits(std::uint64_t tick,std::uint32_t entity_id,random_stream stream,std::uint32_t index) const noexcept
+	{
+		return philox4x32(make_counter(tick,entity_id,stream,index / DRAWS_PER_BLOCK),make_key(seed))[index % DRAWS_PER_BLOCK];
+	}
+
+	void counter_rng::fill_bits(std::uint64_t tick,std::uint32_t entity_id,random_stream stream,std::uint32_t first_index,std::uint32_t* output,std::size_t count) const noexcept
+	{
+		std::size_t i = 0;
+		for(;i < count && ((first_index + i) % DRAWS_PER_BLOCK) != 0;++i)
+		{
+			output[i] = bits(tick,entity_id,stream,static_cast<std::uint32_t>(first_index + i));
+		}
+#ifdef ASTEROIDS_RANDOM_SSE2
+		for(;i + DRAWS_PER_BLOCK * 4 <= count;i += DRAWS_PER_BLOCK * 4)
+		{
+			std::uint32_t block = static_cast<std::uint32_t>(first_index + i) / DRAWS_PER_BLOCK;
+			//The block number must not carry into the stream bits inside the vector add.
+			if((block & ((1u << STREAM_SHIFT) - 1)) > ((1u << STREAM_SHIFT) - 4))
+			{
+				break;
+			}
+			philox4x32_blocks(make_counter(tick,entity_id,stream,block),make_key(seed),output + i);
+		}
+#endif
+		for(;i + DRAWS_PER_BLOCK <= count;i += DRAWS_PER_BLOCK)
+		{
+			auto block = philox4x32(make_counter(tick,entity_id,stream,static_cast<std::uint32_t>(first_index + i) / DRAWS_PER_BLOCK),make_key(seed));
+			for(std::uint32_t j = 0;j < DRAWS_PER_BLOCK;++j)
+			{
+				output[i + j] = block[j];
+			}
+		}
+		for(;i < count;++i)
+		{
+			output[i] = bits(tick,entity_id,stream,static_cast<std::uint32_t>(first_index + i));
+		}
+	}
+
+	std::uint64_t counter_rng::get_seed() const noexcept
+	{
+		return seed;
+	}
+
+	std::array<std::uint32_t,4> philox4x32(std::array<std::uint32_t,4> counter,std::array<std::uint32_t,2> key) noexcept
+	{
+		for(int round = 0;round < PHILOX_ROUNDS;++round)
+		{
+			std::uint64_t product_0 = std::uint64_t{PHILOX_MULTIPLIER_0} * counter[0];
+			std::uint64_t product_1 = std::uint64_t{PHILOX_MULTIPLIER_1} * counter[2];
+			counter = {
+				static_cast<std::uint32_t>(product_1 >> 32) ^ counter[1] ^ key[0],
+				static_cast<std::uint32_t>(product_1),
+				static_cast<std::uint32_t>(product_0 >> 32) ^ counter[3] ^ key[1],
+				static_cast<std::uint32_t>(product_0)
+			};
+			key[0] += PHILOX_WEYL_0;
+			key[1] += PHILOX_WEYL_1;
+		}
+		return counter;
+	}
+
+	std::size_t random_bits_to_index(std::uint32_t bits,std::size_t count) noexcept
+	{
+		return static_cast<std::size_t>((std::uint64_t{bits} * count) >> 32);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef ASTEROIDS_RANDOM_HPP
+#define ASTEROIDS_RANDOM_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace asteroids
+{
+	//Separates draws that share a tick and an entity id.
+	enum class random_stream : std::uint8_t
+	{
+		rock_wave,
+		split_rock
+	};
+
+	//Philox4x32-10 counter-based generator. A draw is a pure function of the seed, the tick, the entity id, the stream and the draw index,
+	//so results don't depend on how many draws happened before or on which thread asks for them.
+	class counter_rng
+	{
+	public:
+		explicit counter_rng(std::uint64_t _seed = 0) noexcept;
+
+		std::uint32_t bits(std::uint64_t tick,std::uint32_t entity_id,random_stream stream,std::uint32_t index) const noexcept;
+		//Writes the draws 'first_index' ... 'first_index + count - 1', identical to calling bits() for each of them.
+		void fill_bits(std::uint64_t tick,std::uint32_t entity_id,random_stream stream,std::uint32_t first_index,std::uint32_t* output,std::size_t count) const noexcept;
+		std::uint64_t get_seed() const noexcept;
+
+	private:
+		std::uint64_t seed{};
+	};
+
+	std::array<std::uint32_t,4> philox4x32(std::array<std::uint32_t,4> counter,std::array<std::uint32_t,2> key) noexcept;
+	//Maps 32 random bits to [0,count) with a multiply and a shift, which unlike std::uniform_int_distribution is the same everywhere.
+	std::size_t random_bits_to_index(std::uint32_t bits,std::size_t count) noexcept;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,356 @@
+#include "replay.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iterator>
+#include <algorithm>
+#include "serialization.hpp"
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr char REPLAY_MAGIC[8] = {'A','S','T','R','R','P','L','1'};
+		constexpr char INDEX_MAGIC[8] = {'A','S','T','R','I','D','X','1'};
+		constexpr std::uint32_t REPLAY_VERSION = 1;
+		constexpr std::size_t HEADER_SIZE = sizeof(REPLAY_MAGIC) + sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(std::uint32_t);
+		constexpr std::size_t TRAILER_SIZE = sizeof(std::uint32_t) + sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(INDEX_MAGIC);
+		constexpr std::size_t INDEX_ENTRY_SIZE = sizeof(std::uint32_t) + sizeof(std::uint64_t);
+
+		enum class record_type : std::uint8_t
+		{
+			tick = 1,
+			keyframe = 2
+		};
+	}
+
+	replay_writer::~replay_writer()
+	{
+		close();
+	}
+
+	bool replay_writer::open(const std::string& path,std::uint64_t seed,std::uint32_t _keyframe_interval)
+	{
+		close();
+		file.open(path,std::ios::binary | std::ios::trunc);
+		if(!file)
+		{
+			return false;
+		}
+		keyframe_interval = std::max<std::uint32_t>(_keyframe_interval,1);
+		tick = 0;
+		index.clear();
+
+		buffer.clear();
+		binary_writer writer{buffer};
+		writer.write_bytes(REPLAY_MAGIC,sizeof(REPLAY_MAGIC));
+		writer.write(REPLAY_VERSION);
+		writer.write(seed);
+		writer.write(keyframe_interval);
+		file.write(reinterpret_cast<const char*>(buffer.data()),static_cast<std::streamsize>(buffer.size()));
+		offset = buffer.size();
+		return static_cast<bool>(file);
+	}
+
+	void replay_writer::record_tick(const scene& scene,const player_input& input,float delta_time)
+	{
+		if(!file.is_open())
+		{
+			return;
+		}
+		buffer.clear();
+		binary_writer writer{buffer};
+		if((tick % keyframe_interval) == 0)
+		{
+			index.push_back(index_entry{tick,offset});
+			writer.write(record_type::keyframe);
+			writer.write(tick);
+			std::size_t size_offset = buffer.size();
+			writer.write(std::uint32_t{});
+			scene.save_state(buffer);
+			std::uint32_t state_size = static_cast<std::uint32_t>(buffer.size() - size_offset - sizeof(std::uint32_t));
+			std::memcpy(buffer.data() + size_offset,&state_size,sizeof(state_size));
+		}
+		writer.write(record_type::tick);
+		writer.write(pack_player_input(input));
+		writer.write(delta_time);
+		file.write(reinterpret_cast<const char*>(buffer.data()),static_cast<std::streamsize>(buffer.size()));
+		offset += buffer.size();
+		tick += 1;
+	}
+
+	bool replay_writer::close()
+	{
+		if(!file.is_open())
+		{
+			return false;
+		}
+		buffer.clear();
+		binary_writer writer{buffer};
+		for(const auto& entry : index)
+		{
+			writer.write(entry.tick);
+			writer.write(entry.offset);
+		}
+		writer.write(static_cast<std::uint32_t>(index.size()));
+		writer.write(tick);
+		writer.write(offset);
+		writer.write_bytes(INDEX_MAGIC,sizeof(INDEX_MAGIC));
+		file.write(reinterpret_cast<const char*>(buffer.data()),static_cast<std::streamsize>(buffer.size()));
+		bool good = static_cast<bool>(file);
+		file.close();
+		return good;
+	}
+
+	bool replay_writer::is_open() const noexcept
+	{
+		return file.is_open();
+	}
+
+	bool replay_reader::open(const std::string& path)
+	{
+		std::ifstream file{path,std::ios::binary};
+		if(!file)
+		{
+			return false;
+		}
+		data.assign(std::istreambuf_iterator<char>(file),std::istreambuf_iterator<char>());
+		keyframes.clear();
+		current_tick = 0;
+
+		binary_reader reader{data.data(),data.size()};
+		char magic[sizeof(REPLAY_MAGIC)]{};
+		std::uint32_t version{};
+		if(!reader.read_bytes(magic,sizeof(magic)) || std::memcmp(magic,REPLAY_MAGIC,sizeof(magic)) != 0 ||
+			!reader.read(version) || version != REPLAY_VERSION || !reader.read(seed) || !reader.read(keyframe_interval))
+		{
+			return false;
+		}
+		cursor = HEADER_SIZE;
+
+		if(data.size() >= HEADER_SIZE + TRAILER_SIZE)
+		{
+			binary_reader trailer{data.data() + data.size() - TRAILER_SIZE,TRAILER_SIZE};
+			std::uint32_t entry_count{};
+			std::uint64_t index_offset{};
+			char index_magic[sizeof(INDEX_MAGIC)]{};
+			trailer.read(entry_count);
+			trailer.read(tick_count);
+			trailer.read(index_offset);
+			trailer.read_bytes(index_magic,sizeof(index_magic));
+			if(std::memcmp(index_magic,INDEX_MAGIC,sizeof(index_magic)) == 0 && index_offset >= HEADER_SIZE && index_offset <= data.size() - TRAILER_SIZE &&
+				data.size() - TRAILER_SIZE - index_offset == static_cast<std::uint64_t>(entry_count) * INDEX_ENTRY_SIZE)
+			{
+				//Every keyframe has to start inside the records and come after the previous one, otherwise the index is damaged and the records are scanned instead.
+				bool valid = entry_count > 0;
+				binary_reader entries{data.data() + index_offset,entry_count * INDEX_ENTRY_SIZE};
+				for(std::uint32_t i = 0;valid && i < entry_count;++i)
+				{
+					keyframe entry{};
+					entries.read(entry.tick);
+					entries.read(entry.offset);
+					valid = entry.offset >= HEADER_SIZE && entry.offset < index_offset && entry.tick < tick_count &&
+							(keyframes.empty() || (entry.tick > keyframes.back().tick && entry.offset > keyframes.back().offset));
+					keyframes.push_back(entry);
+				}
+				if(valid)
+				{
+					records_end = index_offset;
+					return true;
+				}
+				keyframes.clear();
+			}
+		}
+		return scan_records();
+	}
+
+	std::uint64_t replay_reader::get_seed() const noexcept
+	{
+		return seed;
+	}
+
+	std::uint32_t replay_reader::get_keyframe_interval() const noexcept
+	{
+		return keyframe_interval;
+	}
+
+	std::uint32_t replay_reader::get_tick_count() const noexcept
+	{
+		return tick_count;
+	}
+
+	std::uint32_t replay_reader::get_current_tick() const noexcept
+	{
+		return current_tick;
+	}
+
+	bool replay_reader::seek(scene& scene,std::uint32_t tick)
+	{
+		tick = std::min(tick,tick_count);
+		auto found = std::upper_bound(keyframes.begin(),keyframes.end(),tick,[](std::uint32_t tick,const keyframe& keyframe){
+			return tick < keyframe.tick;
+		});
+		if(found == keyframes.begin())
+		{
+			return false;
+		}
+		const keyframe& keyframe = *(found - 1);
+		if(keyframe.offset >= records_end)
+		{
+			return false;
+		}
+
+		binary_reader reader{data.data() + keyframe.offset,static_cast<std::size_t>(records_end - keyframe.offset)};
+		record_type type{};
+		std::uint32_t keyframe_tick{};
+		std::uint32_t state_size{};
+		if(!reader.read(type) || type != record_type::keyframe || !reader.read(keyframe_tick) || !reader.read(state_size) || state_size > reader.get_remaining())
+		{
+			return false;
+		}
+		std::uint64_t state_offset = keyframe.offset + reader.get_offset();
+		if(!scene.load_state(data.data() + state_offset,state_size))
+		{
+			return false;
+		}
+		cursor = state_offset + state_size;
+		current_tick = keyframe_tick;
+		while(current_tick < tick)
+		{
+			if(!step(scene))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool replay_reader::step(scene& scene)
+	{
+		binary_reader reader{data.data() + cursor,static_cast<std::size_t>(records_end - cursor)};
+		record_type type{};
+		while(reader.read(type))
+		{
+			if(type == record_type::keyframe)
+			{
+				std::uint32_t keyframe_tick{};
+				std::uint32_t state_size{};
+				if(!reader.read(keyframe_tick) || !reader.read(state_size) || !reader.skip(state_size))
+				{
+					return false;
+				}
+				continue;
+			}
+			std::uint8_t input{};
+			float delta_time{};
+			if(type != record_type::tick || !reader.read(input) || !reader.read(delta_time))
+			{
+				return false;
+			}
+			scene.update(delta_time,unpack_player_input(input));
+			cursor += reader.get_offset();
+			current_tick += 1;
+			return true;
+		}
+		return false;
+	}
+
+	float replay_reader::peek_delta_time() const
+	{
+		binary_reader reader{data.data() + cursor,static_cast<std::size_t>(records_end - cursor)};
+		record_type type{};
+		while(reader.read(type))
+		{
+			if(type == record_type::keyframe)
+			{
+				std::uint32_t keyframe_tick{};
+				std::uint32_t state_size{};
+				if(!reader.read(keyframe_tick) || !reader.read(state_size) || !reader.skip(state_size))
+				{
+					break;
+				}
+				continue;
+			}
+			std::uint8_t input{};
+			float delta_time{};
+			if(reader.read(input) && reader.read(delta_time))
+			{
+				return delta_time;
+			}
+			break;
+		}
+		return 0.0f;
+	}
+
+	bool replay_reader::scan_records()
+	{
+		records_end = data.size();
+		tick_count = 0;
+		binary_reader reader{data.data() + HEADER_SIZE,data.size() - HEADER_SIZE};
+		while(reader.get_remaining() > 0)
+		{
+			std::uint64_t record_offset = HEADER_SIZE + reader.get_offset();
+			record_type type{};
+			reader.read(type);
+			if(type == record_type::keyframe)
+			{
+				std::uint32_t keyframe_tick{};
+				std::uint32_t state_size{};
+				if(!reader.read(keyframe_tick) || !reader.read(state_size) || !reader.skip(state_size))
+				{
+					records_end = record_offset;
+					break;
+				}
+				keyframes.push_back(keyframe{keyframe_tick,record_offset});
+			}
+			else if(type == record_type::tick && reader.skip(sizeof(std::uint8_t) + sizeof(float)))
+			{
+				tick_count += 1;
+			}
+			else
+			{
+				records_end = record_offset;
+				break;
+			}
+		}
+		return !keyframes.empty();
+	}
+
+	int run_replay_headless(const std::string& path,std::ostream& log,state_hash_log_writer* hashes)
+	{
+		replay_reader reader{};
+		if(!reader.open(path))
+		{
+			log << "Couldn't read replay " << path << "." << std::endl;
+			return 1;
+		}
+		scene scene{reader.get_seed()};
+		auto start = std::chrono::steady_clock::now();
+		if(!reader.seek(scene,0))
+		{
+			log << "Replay " << path << " has no initial keyframe." << std::endl;
+			return 1;
+		}
+		double recorded_seconds = 0.0;
+		while(reader.get_current_tick() < reader.get_tick_count())
+		{
+			recorded_seconds += reader.peek_delta_time();
+			if(!reader.step(scene))
+			{
+				log << "Replay " << path << " is truncated at tick " << reader.get_current_tick() << "." << std::endl;
+				break;
+			}
+			if(hashes)
+			{
+				scene.write_state_hashes(*hashes);
+			}
+		}
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		log << std::fixed << std::setprecision(3) << "Simulated " << reader.get_current_tick() << " ticks (" << recorded_seconds << " s of play) in "
+			<< elapsed * 1000.0 << " ms, " << std::setprecision(1) << ((elapsed > 0.0) ? recorded_seconds / elapsed : 0.0) << "x real time. "
+			<< "Final score: " << scene.get_player().points << std::endl;
+		log.unsetf(std::ios_base::floatfield);
+		return 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef ASTEROIDS_REPLAY_HPP
+#define ASTEROIDS_REPLAY_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <fstream>
+#include "scene.hpp"
+
+namespace asteroids
+{
+	inline constexpr std::uint32_t DEFAULT_KEYFRAME_INTERVAL = 300;
+
+	class replay_writer
+	{
+	public:
+		replay_writer() = default;
+		replay_writer(const replay_writer&) = delete;
+		replay_writer& operator = (const replay_writer&) = delete;
+		~replay_writer();
+
+		bool open(const std::string& path,std::uint64_t seed,std::uint32_t _keyframe_interval = DEFAULT_KEYFRAME_INTERVAL);
+		//Has to be called right before 'scene' is updated with 'input', keyframes hold the state the tick starts from.
+		void record_tick(const scene& scene,const player_input& input,float delta_time);
+		//Writes the keyframe index, a replay without it is still readable but has to be scanned on open.
+		bool close();
+		bool is_open() const noexcept;
+
+	private:
+		struct index_entry
+		{
+			std::uint32_t tick;
+			std::uint64_t offset;
+		};
+
+		std::ofstream file{};
+		std::uint32_t keyframe_interval{};
+		std::uint32_t tick{};
+		std::uint64_t offset{};
+		std::vector<index_entry> index{};
+		std::vector<std::uint8_t> buffer{};
+	};
+
+	class replay_reader
+	{
+	public:
+		bool open(const std::string& path);
+		std::uint64_t get_seed() const noexcept;
+		std::uint32_t get_keyframe_interval() const noexcept;
+		std::uint32_t get_tick_count() const noexcept;
+		std::uint32_t get_current_tick() const noexcept;
+		//Restores the closest keyframe at or before 'tick' and simulates from there, so seeking costs at most one keyframe interval of ticks.
+		bool seek(scene& scene,std::uint32_t tick);
+		//Simulates the next recorded tick, returns false at the end of the replay.
+		bool step(scene& scene);
+		//Delta time of the next tick 'step' would simulate.
+		float peek_delta_time() const;
+
+	private:
+		struct keyframe
+		{
+			std::uint32_t tick;
+			std::uint64_t offset;
+		};
+
+		bool scan_records();
+
+		std::vector<std::uint8_t> data{};
+		std::vector<keyframe> keyframes{};
+		std::uint64_t seed{};
+		std::uint32_t keyframe_interval{};
+		std::uint32_t tick_count{};
+		std::uint64_t records_end{};
+		std::uint64_t cursor{};
+		std::uint32_t current_tick{};
+	};
+
+	//'hashes' gets the state hashes of every replayed tick when it isn't nullptr.
+	int run_replay_headless(const std::string& path,std::ostream& log,state_hash_log_writer* hashes = nullptr);
+}
+
+#endif
\ No newline at end of file
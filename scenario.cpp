@@ -0,0 +1,355 @@
+#include "scenario.hpp"
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include "utility.hpp"
+#include "serialization.hpp"
+
+namespace asteroids
+{
+	namespace
+	{
+		static_assert(std::is_trivially_copyable_v<scenario_header> && sizeof(scenario_header) == 56);
+		static_assert(std::is_trivially_copyable_v<scenario_rock> && sizeof(scenario_rock) == 16);
+		static_assert(std::is_trivially_copyable_v<scenario_projectile> && sizeof(scenario_projectile) == 20);
+		static_assert(std::is_trivially_copyable_v<scenario_ufo> && sizeof(scenario_ufo) == 16);
+
+		//Offsets are 32 bits wide, so that is as large as a compiled scenario gets.
+		constexpr std::uint64_t MAX_SCENARIO_SIZE = UINT32_MAX;
+
+		struct rock_prototype_name
+		{
+			std::string_view name;
+			prototype_id prototype;
+		};
+
+		constexpr std::array<rock_prototype_name,4> ROCK_PROTOTYPE_NAMES{
+			rock_prototype_name{"big_rock_0",prototype_id::big_rock_0},
+			rock_prototype_name{"big_rock_1",prototype_id::big_rock_1},
+			rock_prototype_name{"small_rock_0",prototype_id::small_rock_0},
+			rock_prototype_name{"small_rock_1",prototype_id::small_rock_1}
+		};
+
+		std::optional<prototype_id> find_rock_prototype(std::string_view name)
+		{
+			for(const auto& entry : ROCK_PROTOTYPE_NAMES)
+			{
+				if(entry.name == name)
+				{
+					return entry.prototype;
+				}
+			}
+			return std::nullopt;
+		}
+
+		bool is_rock_prototype(prototype_id prototype)
+		{
+			for(const auto& entry : ROCK_PROTOTYPE_NAMES)
+			{
+				if(entry.prototype == prototype)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool is_finite(const scenario_rock& rock)
+		{
+			return std::isfinite(rock.x) && std::isfinite(rock.y) && std::isfinite(rock.rotation);
+		}
+
+		bool is_finite(const scenario_projectile& projectile)
+		{
+			return std::isfinite(projectile.x) && std::isfinite(projectile.y) && std::isfinite(projectile.rotation) && std::isfinite(projectile.speed);
+		}
+
+		bool is_finite(const scenario_ufo& ufo)
+		{
+			return std::isfinite(ufo.x) && std::isfinite(ufo.y) && std::isfinite(ufo.direction_x) && std::isfinite(ufo.direction_y);
+		}
+
+		template<typename T>
+		bool all_finite(std::span<const T> records)
+		{
+			for(const auto& record : records)
+			{
+				if(!is_finite(record))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		float degrees_to_radians(float degrees)
+		{
+			return degrees * CONSTANT_PI / 180.0f;
+		}
+
+		template<typename T>
+		bool get_section(const std::uint8_t* data,std::size_t size,std::uint32_t offset,std::uint32_t count,std::span<const T>& section)
+		{
+			if((offset % alignof(T)) != 0 || offset > size || count > (size - offset) / sizeof(T))
+			{
+				return false;
+			}
+			section = {reinterpret_cast<const T*>(data + offset),count};
+			return true;
+		}
+
+		template<typename T>
+		void write_section(binary_writer& writer,const std::vector<T>& records)
+		{
+			if(!records.empty())
+			{
+				writer.write_bytes(records.data(),records.size() * sizeof(T));
+			}
+		}
+	}
+
+	bool scenario_view::open(const std::uint8_t* data,std::size_t size)
+	{
+		if(!data || size < sizeof(scenario_header) || (reinterpret_cast<std::uintptr_t>(data) % alignof(scenario_header)) != 0)
+		{
+			return false;
+		}
+		const auto* candidate = reinterpret_cast<const scenario_header*>(data);
+		if(candidate->magic != SCENARIO_MAGIC || candidate->version != SCENARIO_VERSION)
+		{
+			return false;
+		}
+		if(!std::isfinite(candidate->player_x) || !std::isfinite(candidate->player_y) || !std::isfinite(candidate->player_rotation))
+		{
+			return false;
+		}
+		if(!get_section(data,size,candidate->rocks_offset,candidate->rock_count,rocks) ||
+			!get_section(data,size,candidate->projectiles_offset,candidate->projectile_count,projectiles) ||
+			!get_section(data,size,candidate->ufos_offset,candidate->ufo_count,ufos))
+		{
+			return false;
+		}
+		for(const auto& rock : rocks)
+		{
+			if(!is_rock_prototype(rock.prototype) || !is_finite(rock))
+			{
+				return false;
+			}
+		}
+		if(!all_finite(projectiles) || !all_finite(ufos))
+		{
+			return false;
+		}
+		header = candidate;
+		return true;
+	}
+
+	std::uint64_t scenario_view::get_seed() const noexcept
+	{
+		return header->seed;
+	}
+
+	SDL_FPoint scenario_view::get_player_position() const noexcept
+	{
+		return {header->player_x,header->player_y};
+	}
+
+	float scenario_view::get_player_rotation() const noexcept
+	{
+		return header->player_rotation;
+	}
+
+	std::span<const scenario_rock> scenario_view::get_rocks() const noexcept
+	{
+		return rocks;
+	}
+
+	std::span<const scenario_projectile> scenario_view::get_projectiles() const noexcept
+	{
+		return projectiles;
+	}
+
+	std::span<const scenario_ufo> scenario_view::get_ufos() const noexcept
+	{
+		return ufos;
+	}
+
+	bool compile_scenario(std::istream& input,std::vector<std::uint8_t>& output,std::ostream& errors)
+	{
+		scenario_header header{};
+		header.magic = SCENARIO_MAGIC;
+		header.version = SCENARIO_VERSION;
+		header.player_x = 512;
+		header.player_y = 384;
+		std::vector<scenario_rock> rocks{};
+		std::vector<scenario_projectile> projectiles{};
+		std::vector<scenario_ufo> ufos{};
+
+		std::string line{};
+		std::size_t line_number = 0;
+		bool succeeded = true;
+		std::uint64_t scenario_size = sizeof(scenario_header);
+		//Every directive accounts for its records before pushing them, so a huge count fails its line instead of exhausting memory.
+		auto add_records = [&](std::uint64_t count,std::size_t record_size){
+			if(count > (MAX_SCENARIO_SIZE - scenario_size) / record_size)
+			{
+				errors << "Line " << line_number << ": the scenario would be larger than 4 GiB." << std::endl;
+				return false;
+			}
+			scenario_size += count * record_size;
+			return true;
+		};
+		while(std::getline(input,line))
+		{
+			line_number += 1;
+			line = line.substr(0,line.find('#'));
+			std::istringstream tokens{line};
+			std::string directive{};
+			if(!(tokens >> directive))
+			{
+				continue;
+			}
+
+			bool valid = false;
+			std::string prototype_name{};
+			std::size_t first_rock = rocks.size();
+			std::size_t first_projectile = projectiles.size();
+			std::size_t first_ufo = ufos.size();
+			if(directive == "seed")
+			{
+				valid = static_cast<bool>(tokens >> header.seed);
+			}
+			else if(directive == "player")
+			{
+				float rotation{};
+				valid = (tokens >> header.player_x >> header.player_y >> rotation) && std::isfinite(header.player_x) && std::isfinite(header.player_y) && std::isfinite(rotation);
+				header.player_rotation = degrees_to_radians(rotation);
+			}
+			else if(directive == "rock")
+			{
+				float x{},y{},rotation{};
+				std::optional<prototype_id> prototype{};
+				valid = (tokens >> prototype_name >> x >> y >> rotation) && (prototype = find_rock_prototype(prototype_name));
+				if(valid)
+				{
+					if(!add_records(1,sizeof(scenario_rock)))
+					{
+						return false;
+					}
+					rocks.push_back(scenario_rock{*prototype,{},x,y,degrees_to_radians(rotation)});
+				}
+			}
+			else if(directive == "rock_grid")
+			{
+				std::uint32_t columns{},rows{};
+				float x{},y{},spacing_x{},spacing_y{},rotation{};
+				std::optional<prototype_id> prototype{};
+				valid = (tokens >> prototype_name >> columns >> rows >> x >> y >> spacing_x >> spacing_y >> rotation) && (prototype = find_rock_prototype(prototype_name));
+				if(valid && !add_records(static_cast<std::uint64_t>(columns) * rows,sizeof(scenario_rock)))
+				{
+					return false;
+				}
+				for(std::uint32_t row = 0;valid && row < rows;++row)
+				{
+					for(std::uint32_t column = 0;column < columns;++column)
+					{
+						rocks.push_back(scenario_rock{*prototype,{},x + spacing_x * column,y + spacing_y * row,degrees_to_radians(rotation)});
+					}
+				}
+			}
+			else if(directive == "rock_ring")
+			{
+				//Rocks are spread evenly on the circle and all head for its centre.
+				std::uint32_t count{};
+				float center_x{},center_y{},radius{};
+				std::optional<prototype_id> prototype{};
+				valid = (tokens >> prototype_name >> count >> center_x >> center_y >> radius) && (prototype = find_rock_prototype(prototype_name));
+				if(valid && !add_records(count,sizeof(scenario_rock)))
+				{
+					return false;
+				}
+				for(std::uint32_t i = 0;valid && i < count;++i)
+				{
+					float angle = CONSTANT_PI * 2.0f * static_cast<float>(i) / static_cast<float>(count);
+					rocks.push_back(scenario_rock{*prototype,{},center_x + std::cos(angle) * radius,center_y + std::sin(angle) * radius,angle + CONSTANT_PI});
+				}
+			}
+			else if(directive == "projectile")
+			{
+				float x{},y{},rotation{},speed{};
+				std::string owner{};
+				valid = (tokens >> x >> y >> rotation >> speed >> owner) && (owner == "friendly" || owner == "hostile");
+				if(valid)
+				{
+					if(!add_records(1,sizeof(scenario_projectile)))
+					{
+						return false;
+					}
+					projectiles.push_back(scenario_projectile{x,y,degrees_to_radians(rotation),speed,static_cast<std::uint8_t>(owner == "friendly"),{}});
+				}
+			}
+			else if(directive == "ufo")
+			{
+				scenario_ufo ufo{};
+				valid = static_cast<bool>(tokens >> ufo.x >> ufo.y >> ufo.direction_x >> ufo.direction_y);
+				if(valid)
+				{
+					if(!add_records(1,sizeof(scenario_ufo)))
+					{
+						return false;
+					}
+					ufos.push_back(ufo);
+				}
+			}
+			else if(directive == "ufo_line")
+			{
+				std::uint32_t count{};
+				float x{},y{},spacing_x{},spacing_y{},direction_x{},direction_y{};
+				valid = static_cast<bool>(tokens >> count >> x >> y >> spacing_x >> spacing_y >> direction_x >> direction_y);
+				if(valid && !add_records(count,sizeof(scenario_ufo)))
+				{
+					return false;
+				}
+				for(std::uint32_t i = 0;valid && i < count;++i)
+				{
+					ufos.push_back(scenario_ufo{x + spacing_x * i,y + spacing_y * i,direction_x,direction_y});
+				}
+			}
+
+			//Spacings and radii can push the generated coordinates past the float range.
+			valid = valid && all_finite(std::span<const scenario_rock>{rocks}.subspan(first_rock)) &&
+					all_finite(std::span<const scenario_projectile>{projectiles}.subspan(first_projectile)) &&
+					all_finite(std::span<const scenario_ufo>{ufos}.subspan(first_ufo));
+			std::string trailing{};
+			if(!valid || (tokens >> trailing))
+			{
+				errors << "Line " << line_number << ": invalid '" << directive << "' directive." << std::endl;
+				succeeded = false;
+			}
+		}
+		if(!succeeded)
+		{
+			return false;
+		}
+		header.rock_count = static_cast<std::uint32_t>(rocks.size());
+		header.projectile_count = static_cast<std::uint32_t>(projectiles.size());
+		header.ufo_count = static_cast<std::uint32_t>(ufos.size());
+		header.rocks_offset = sizeof(scenario_header);
+		header.projectiles_offset = static_cast<std::uint32_t>(header.rocks_offset + rocks.size() * sizeof(scenario_rock));
+		header.ufos_offset = static_cast<std::uint32_t>(header.projectiles_offset + projectiles.size() * sizeof(scenario_projectile));
+
+		output.clear();
+		binary_writer writer{output};
+		writer.write(header);
+		write_section(writer,rocks);
+		write_section(writer,projectiles);
+		write_section(writer,ufos);
+		return true;
+	}
+}
\ No newline at end of file
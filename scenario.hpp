@@ -0,0 +1,86 @@
+#ifndef ASTEROIDS_SCENARIO_HPP
+#define ASTEROIDS_SCENARIO_HPP
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include "entities.hpp"
+
+namespace asteroids
+{
+	inline constexpr std::uint32_t SCENARIO_MAGIC = 0x4E435341;
+	inline constexpr std::uint32_t SCENARIO_VERSION = 1;
+
+	//Compiled scenarios are the header followed by the rock, projectile and UFO record arrays. Every field is naturally aligned,
+	//so a scenario mapped into memory is used in place without parsing or copying.
+	struct scenario_header
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint64_t seed;
+		float player_x;
+		float player_y;
+		float player_rotation;
+		std::uint32_t rock_count;
+		std::uint32_t projectile_count;
+		std::uint32_t ufo_count;
+		std::uint32_t rocks_offset;
+		std::uint32_t projectiles_offset;
+		std::uint32_t ufos_offset;
+		std::uint32_t reserved;
+	};
+
+	struct scenario_rock
+	{
+		prototype_id prototype;
+		std::uint8_t reserved[3];
+		float x;
+		float y;
+		float rotation;
+	};
+
+	struct scenario_projectile
+	{
+		float x;
+		float y;
+		float rotation;
+		float speed;
+		std::uint8_t player_friendly;
+		std::uint8_t reserved[3];
+	};
+
+	struct scenario_ufo
+	{
+		float x;
+		float y;
+		float direction_x;
+		float direction_y;
+	};
+
+	//Validated view of a compiled scenario, the memory has to outlive the view.
+	class scenario_view
+	{
+	public:
+		bool open(const std::uint8_t* data,std::size_t size);
+		std::uint64_t get_seed() const noexcept;
+		SDL_FPoint get_player_position() const noexcept;
+		float get_player_rotation() const noexcept;
+		std::span<const scenario_rock> get_rocks() const noexcept;
+		std::span<const scenario_projectile> get_projectiles() const noexcept;
+		std::span<const scenario_ufo> get_ufos() const noexcept;
+
+	private:
+		const scenario_header* header{};
+		std::span<const scenario_rock> rocks{};
+		std::span<const scenario_projectile> projectiles{};
+		std::span<const scenario_ufo> ufos{};
+	};
+
+	//Translates the text format described in README.md, problems are reported with their line number to 'errors'.
+	bool compile_scenario(std::istream& input,std::vector<std::uint8_t>& output,std::ostream& errors);
+}
+
+#endif
\ No newline at end of file
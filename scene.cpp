@@ -1,268 +1,1141 @@
 #include "scene.hpp"
 
+#include <cmath>
 #include <chrono>
 #include <utility>
+#include <variant>
+#include <optional>
 #include <iostream>
+#include <algorithm>
 
 namespace asteroids
 {
-	scene::scene() : $player({512,384},0,400,7,PLAYER_MESH),max_rock_spawn_timer(1.25f),max_ufo_spawn_timer(15.0f)
+	namespace
 	{
-		ufo_spawn_timer = max_ufo_spawn_timer;
+		template<typename T>
+		void initialize_fixed_pose(T& entity,fixed_vector position,binary_angle rotation)
+		{
+			entity.fixed_position = position;
+			entity.fixed_rotation = rotation;
+			entity.entity::update_fixed();
+			entity.sync_float_pose();
+		}
+
+		fixed_vector to_fixed_vector(const SDL_FPoint& point)
+		{
+			return {to_fixed(point.x),to_fixed(point.y)};
+		}
+	}
+
+	const mesh& get_prototype_mesh(prototype_id prototype)
+	{
+		switch(prototype)
+		{
+			case prototype_id::destruction_fragment:
+				return DESTRUCTION_FRAGMENT_MESH;
+			case prototype_id::big_rock_0:
+				return BIG_ROCK_MESHES[0];
+			case prototype_id::big_rock_1:
+				return BIG_ROCK_MESHES[1];
+			case prototype_id::small_rock_0:
+				return SMALL_ROCK_MESHES[0];
+			case prototype_id::small_rock_1:
+				return SMALL_ROCK_MESHES[1];
+			case prototype_id::bullet:
+				return BULLET_MESH;
+			case prototype_id::ufo:
+				return UFO_MESH;
+			default:
+				return PLAYER_MESH;
+		}
+	}
+
+	player_input make_player_input(const std::array<bool,SDL_NUM_SCANCODES>& keyboard_keys,const std::array<bool,SDL_NUM_SCANCODES>& once_keyboard_keys)
+	{
+		player_input input{};
+		input.accelerate = keyboard_keys[SDL_SCANCODE_UP];
+		input.decelerate = keyboard_keys[SDL_SCANCODE_DOWN];
+		input.turn_left = keyboard_keys[SDL_SCANCODE_LEFT];
+		input.turn_right = keyboard_keys[SDL_SCANCODE_RIGHT];
+		input.shoot = once_keyboard_keys[SDL_SCANCODE_X];
+		return input;
+	}
+
+	std::uint8_t pack_player_input(const player_input& input) noexcept
+	{
+		return static_cast<std::uint8_t>((input.accelerate ? 1 : 0) | (input.decelerate ? 2 : 0) | (input.turn_left ? 4 : 0) | (input.turn_right ? 8 : 0) | (input.shoot ? 16 : 0));
+	}
+
+	player_input unpack_player_input(std::uint8_t bits) noexcept
+	{
+		player_input input{};
+		input.accelerate = (bits & 1) != 0;
+		input.decelerate = (bits & 2) != 0;
+		input.turn_left = (bits & 4) != 0;
+		input.turn_right = (bits & 8) != 0;
+		input.shoot = (bits & 16) != 0;
+		return input;
+	}
+
+	scene::scene() : scene(static_cast<std::uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count()))
+	{}
+
+	scene::scene(std::uint64_t seed,simulation_mode _mode)
+		: mode(_mode),random_generator(seed),$player({512,384},0,400,7,PLAYER_MESH),max_rock_spawn_timer(1.25f),max_ufo_spawn_timer(15.0f)
+	{
+		if(mode == simulation_mode::fixed_point)
+		{
+			initialize_fixed_pose($player,{to_fixed(512),to_fixed(384)},0);
+		}
 		$player.max_invulnerability_timer = 3.0f;
 		$player.max_respawn_timer = 3.0f;
 		$player.max_shoot_timer = 0.2f;
+		$player.prototype = prototype_id::player;
 		$player.make_invulnerable();
-		random_engine = std::mt19937_64(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+		timers.schedule_seconds($player.max_invulnerability_timer,{timer_kind::player_invulnerability_end});
+		scripts.start(run_rock_wave(),script_kind::rock_wave);
+		scripts.start(run_ufo_wave(),script_kind::ufo_wave);
 	}
 
 	void scene::update(float delta_time,const std::array<bool,SDL_NUM_SCANCODES>& keyboard_keys,const std::array<bool,SDL_NUM_SCANCODES>& once_keyboard_keys)
 	{
+		update(delta_time,make_player_input(keyboard_keys,once_keyboard_keys));
+	}
+
+	void scene::update(float delta_time,const player_input& input)
+	{
+		if(untransformed_entities)
+		{
+			transform_adopted_entities();
+		}
+		advance_timers(delta_time);
+		scripts.run_tick();
 		if(!$player.is_dead())
 		{
-			SDL_FPoint $player_forward = $player.get_forward();
-			if(keyboard_keys[SDL_SCANCODE_UP])
+			if(mode == simulation_mode::fixed_point)
 			{
-				$player.velocity.x += $player_forward.x * $player.move_speed * delta_time;
-				$player.velocity.y += $player_forward.y * $player.move_speed * delta_time;
+				update_player_fixed(to_fixed(delta_time),input);
 			}
-			if(keyboard_keys[SDL_SCANCODE_DOWN])
-			{
-				$player.velocity.x -= $player_forward.x * $player.move_speed * delta_time;
-				$player.velocity.y -= $player_forward.y * $player.move_speed * delta_time;
-			}
-			if(keyboard_keys[SDL_SCANCODE_LEFT])
+			else
 			{
-				$player.rotation -= $player.rotation_speed * delta_time;
+				update_player(delta_time,input);
 			}
-			if(keyboard_keys[SDL_SCANCODE_RIGHT])
+		}
+		if(mode == simulation_mode::fixed_point)
+		{
+			$player.update_fixed();
+		}
+		else
+		{
+			$player.update();
+		}
+		for(auto& bucket : collision_buckets)
+		{
+			bucket.clear();
+		}
+		if($player.is_dead())
+		{
+			spatial.remove($player.layer,{});
+		}
+		else
+		{
+			spatial.update($player.layer,{},$player.get_mesh().get_transformed_bounding_box());
+		}
+		//A dead or invulnerable player keeps its layer but collides with nothing.
+		collision_mask player_mask = ($player.is_dead() || $player.is_invulnerable()) ? 0 : $player.mask;
+		collision_buckets[static_cast<std::size_t>($player.layer)].push_back({0,player_mask,&$player.get_mesh()});
+		fused_pass_context context{delta_time,to_fixed(delta_time),commands,collision_buckets,spatial,tick,schedule,update_costs,entity_hashes};
+		run_fused_pass(mode,context,rocks,ufos,projectiles);
+		resolve_collisions(~collision_mask{0});
+		//Later substeps only move projectiles, everything else stays where the first one left it.
+		for(std::uint32_t step = 1;step < schedule.projectile_substeps;++step)
+		{
+			//An entity is hit in one substep at most, so a bullet can't score twice on its way through a rock.
+			for(collider* hit : hit_colliders)
 			{
-				$player.rotation += $player.rotation_speed * delta_time;
+				hit->mask = 0;
 			}
-			if(once_keyboard_keys[SDL_SCANCODE_X] && $player.can_shoot())
+			hit_colliders.clear();
+			run_substep_pass(mode,context,projectiles);
+			resolve_collisions(get_layer_bit(collision_layer::friendly_projectile) | get_layer_bit(collision_layer::hostile_projectile));
+		}
+		hit_colliders.clear();
+
+		particle_lag += delta_time;
+		if(schedule.particle_interval <= 1 || (tick % schedule.particle_interval) == 0)
+		{
+			auto start = std::chrono::steady_clock::now();
+			update_cost& cost = update_costs[static_cast<std::size_t>(update_class::particle)];
+			cost.updates += particles.size();
+			particles.update(particle_lag);
+			particle_lag = 0.0f;
+			cost.nanoseconds += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+		spawn_deferred_particle_bursts();
+		apply_commands();
+		tick += 1;
+	}
+
+	simulation_mode scene::get_simulation_mode() const noexcept
+	{
+		return mode;
+	}
+
+	std::uint64_t scene::get_tick() const noexcept
+	{
+		return tick;
+	}
+
+	const player& scene::get_player() const
+	{
+		return $player;
+	}
+
+	const std::vector<rock>& scene::get_rocks() const
+	{
+		return rocks.get_values();
+	}
+
+	const std::vector<projectile>& scene::get_projectiles() const
+	{
+		return projectiles.get_values();
+	}
+
+	const std::vector<ufo>& scene::get_ufos() const
+	{
+		return ufos.get_values();
+	}
+
+	const particle_system& scene::get_particles() const
+	{
+		return particles;
+	}
+
+	const rock* scene::find_rock(entity_handle handle) const
+	{
+		return rocks.find(handle);
+	}
+
+	const projectile* scene::find_projectile(entity_handle handle) const
+	{
+		return projectiles.find(handle);
+	}
+
+	const ufo* scene::find_ufo(entity_handle handle) const
+	{
+		return ufos.find(handle);
+	}
+
+	void scene::set_sound_queue(sound_event_queue* queue) noexcept
+	{
+		sound_events = queue;
+	}
+
+	void scene::set_load_shedding(const load_shedding& _shedding) noexcept
+	{
+		shedding = _shedding;
+	}
+
+	const load_shedding& scene::get_load_shedding() const noexcept
+	{
+		return shedding;
+	}
+
+	std::uint64_t scene::get_shed_particle_count() const noexcept
+	{
+		return shed_particle_count;
+	}
+
+	std::uint64_t scene::get_deferred_particle_burst_count() const noexcept
+	{
+		return deferred_particle_burst_count;
+	}
+
+	std::uint64_t scene::get_rejected_collision_pair_count(collision_layer layer) const noexcept
+	{
+		return rejected_collision_pair_counts[static_cast<std::size_t>(layer)];
+	}
+
+	std::uint64_t scene::get_tested_collision_pair_count() const noexcept
+	{
+		return tested_collision_pair_count;
+	}
+
+	void scene::set_update_schedule(const update_schedule& _schedule) noexcept
+	{
+		schedule = _schedule;
+	}
+
+	const update_schedule& scene::get_update_schedule() const noexcept
+	{
+		return schedule;
+	}
+
+	const update_cost& scene::get_update_cost(update_class $class) const noexcept
+	{
+		return update_costs[static_cast<std::size_t>($class)];
+	}
+
+	float scene::get_particle_lag() const noexcept
+	{
+		return particle_lag;
+	}
+
+	void scene::query_rect(const SDL_FRect& rect,collision_mask layers,std::vector<spatial_hit>& output) const
+	{
+		spatial.query_rect(rect,layers,output);
+	}
+
+	void scene::query_radius(SDL_FPoint center,float radius,collision_mask layers,std::vector<spatial_hit>& output) const
+	{
+		spatial.query_radius(center,radius,layers,output);
+	}
+
+	void scene::query_nearest(SDL_FPoint point,std::size_t count,collision_mask layers,std::vector<spatial_hit>& output) const
+	{
+		spatial.query_nearest(point,count,layers,output);
+	}
+
+	bool scene::raycast(SDL_FPoint origin,SDL_FPoint direction,float max_distance,collision_mask layers,spatial_hit& hit) const
+	{
+		return spatial.raycast(origin,direction,max_distance,layers,hit);
+	}
+
+	state_hash_array scene::get_state_hashes() const noexcept
+	{
+		state_hash_array parts{};
+		//counter_rng has no state besides its seed, every draw is keyed by the entity id and tick it is for.
+		parts[static_cast<std::size_t>(state_hash_part::rng)] = hash_value(hash_value(hash_value(hash_value(STATE_HASH_SEED,mode),random_generator.get_seed()),tick),next_entity_id);
+		parts[static_cast<std::size_t>(state_hash_part::player)] = $player.get_state_hash();
+		parts[static_cast<std::size_t>(state_hash_part::rocks)] = entity_hashes[static_cast<std::size_t>(entity_kind::rock)].get_combined();
+		parts[static_cast<std::size_t>(state_hash_part::projectiles)] = entity_hashes[static_cast<std::size_t>(entity_kind::projectile)].get_combined();
+		parts[static_cast<std::size_t>(state_hash_part::ufos)] = entity_hashes[static_cast<std::size_t>(entity_kind::ufo)].get_combined();
+		std::uint64_t timer_hash = hash_value(hash_value(STATE_HASH_SEED,timers.get_current_tick()),timers.get_pending_hash());
+		timer_hash = hash_value(hash_value(timer_hash,timer_accumulator),fixed_timer_accumulator);
+		parts[static_cast<std::size_t>(state_hash_part::timers)] = hash_value(hash_value(timer_hash,max_rock_spawn_timer),max_ufo_spawn_timer);
+		return parts;
+	}
+
+	void scene::collect_entity_hashes(std::vector<entity_hash_record>& output) const
+	{
+		auto add_pool = [this,&output](const auto& pool,entity_kind kind,state_hash_part part){
+			const entity_state_hash& hashes = entity_hashes[static_cast<std::size_t>(kind)];
+			for(std::size_t i = 0;i < pool.size();++i)
 			{
-				projectiles.push_back(projectile{$player.position,$player.rotation,600,true,true,BULLET_MESH});
-				$player.make_it_shoot();
+				output.push_back({part,pool[i].id,hashes.get(pool.get_handle(i))});
 			}
-			$player.position.x += $player.velocity.x * delta_time;
-			$player.position.y += $player.velocity.y * delta_time;
+		};
+		add_pool(rocks,entity_kind::rock,state_hash_part::rocks);
+		add_pool(projectiles,entity_kind::projectile,state_hash_part::projectiles);
+		add_pool(ufos,entity_kind::ufo,state_hash_part::ufos);
+	}
 
-			SDL_FRect $player_bounding_box = $player.get_mesh().get_transformed_bounding_box();
-			if(($player_bounding_box.x + $player_bounding_box.w) <= 0 && $player.velocity.x < 0)
+	void scene::write_state_hashes(state_hash_log_writer& writer) const
+	{
+		std::vector<entity_hash_record> entities{};
+		if(writer.is_detailed())
+		{
+			entities.reserve(rocks.size() + projectiles.size() + ufos.size());
+			collect_entity_hashes(entities);
+		}
+		writer.write_tick(tick,get_state_hashes(),entities);
+	}
+
+	//Every insertion and removal goes through these two, so neither the spatial index nor the state hashes hold a stale handle.
+	template<typename T>
+	entity_handle scene::insert_entity(entity_pool<T>& pool,T&& value)
+	{
+		SDL_FRect bounds = value.get_mesh().get_transformed_bounding_box();
+		collision_layer layer = value.layer;
+		std::uint64_t hash = value.get_state_hash();
+		entity_handle handle = pool.insert(std::move(value));
+		spatial.update(layer,handle,bounds);
+		entity_hashes[static_cast<std::size_t>(fused_pass_traits<T>::KIND)].update(handle,hash);
+		return handle;
+	}
+
+	template<typename T>
+	void scene::remove_entity(entity_pool<T>& pool,entity_handle handle)
+	{
+		if(const T* value = pool.find(handle))
+		{
+			spatial.remove(value->layer,handle);
+			entity_hashes[static_cast<std::size_t>(fused_pass_traits<T>::KIND)].remove(handle);
+			pool.remove(handle);
+		}
+	}
+
+	void scene::rebuild_entity_indexes()
+	{
+		spatial.clear();
+		spatial.reserve(rocks.size() + projectiles.size() + ufos.size() + 1);
+		for(auto& hashes : entity_hashes)
+		{
+			hashes.clear();
+		}
+		if(!$player.is_dead())
+		{
+			spatial.update($player.layer,{},$player.get_mesh().get_transformed_bounding_box());
+		}
+		auto add_pool = [this](const auto& pool,entity_kind kind){
+			entity_state_hash& hashes = entity_hashes[static_cast<std::size_t>(kind)];
+			for(std::size_t i = 0;i < pool.size();++i)
 			{
-				$player.position.x = 1024 + $player_bounding_box.w;
+				spatial.update(pool[i].layer,pool.get_handle(i),pool[i].get_mesh().get_transformed_bounding_box());
+				hashes.update(pool.get_handle(i),pool[i].get_state_hash());
 			}
-			if($player_bounding_box.x >= 1024 && $player.velocity.x > 0)
+		};
+		add_pool(rocks,entity_kind::rock);
+		add_pool(projectiles,entity_kind::projectile);
+		add_pool(ufos,entity_kind::ufo);
+	}
+
+	void scene::transform_adopted_entities()
+	{
+		auto transform_pool = [this](auto& pool){
+			for(std::size_t i = 0;i < pool.size();++i)
 			{
-				$player.position.x = -$player_bounding_box.w;
+				if(mode == simulation_mode::fixed_point)
+				{
+					initialize_fixed_pose(pool[i],pool[i].fixed_position,pool[i].fixed_rotation);
+				}
+				else
+				{
+					pool[i].entity::update();
+				}
 			}
-			if(($player_bounding_box.y + $player_bounding_box.h) <= 0 && $player.velocity.y < 0)
+		};
+		transform_pool(rocks);
+		transform_pool(projectiles);
+		transform_pool(ufos);
+		rebuild_entity_indexes();
+		untransformed_entities = false;
+	}
+
+	SDL_FPoint scene::find_respawn_point() const
+	{
+		//Whatever kills the player is a hazard.
+		const collision_mask hazards = get_collision_mask(collision_layer::player);
+		std::vector<spatial_hit> nearest{};
+		SDL_FPoint best_point = RESPAWN_POINTS[0];
+		float best_distance = -1.0f;
+		for(const auto& point : RESPAWN_POINTS)
+		{
+			nearest.clear();
+			spatial.query_nearest(point,1,hazards,nearest);
+			float distance = nearest.empty() ? SAFE_RESPAWN_DISTANCE : nearest[0].distance;
+			if(distance >= SAFE_RESPAWN_DISTANCE)
 			{
-				$player.position.y = 768 + $player_bounding_box.h;
+				return point;
 			}
-			if($player_bounding_box.y >= 768 && $player.velocity.y > 0)
+			if(distance > best_distance)
 			{
-				$player.position.y = -$player_bounding_box.h;
+				best_point = point;
+				best_distance = distance;
 			}
 		}
-		$player.update(delta_time);
+		return best_point;
+	}
 
-		rock_spawn_timer -= delta_time;
-		if(rock_spawn_timer < 0.0f)
+	entity_handle scene::add_rock(rock _rock)
+	{
+		_rock.id = allocate_entity_id();
+		if(mode == simulation_mode::fixed_point)
 		{
-			auto spawn_points = ROCK_SPAWN_POINTS;
-			std::sort(spawn_points.begin(),spawn_points.end(),[&](const SDL_FPoint& a,const SDL_FPoint& b){
-				return distance($player.position,a) > distance($player.position,b);
-			});
-
-			static_assert(ROCK_SPAWN_POINTS.size() > 2);
-			auto random_spawn_range = std::uniform_int_distribution<std::size_t>(0,2);
-			SDL_FPoint spawn_point = spawn_points[random_spawn_range(random_engine)];
-			float angle_to_$player = std::atan2($player.position.y - spawn_point.y,$player.position.x - spawn_point.x);
-
-			std::uniform_int_distribution<std::size_t> rock_mesh_random_range{0,ROCK_TEMPLATES.size() - 1};
-			const rock_template& rock_template = ROCK_TEMPLATES[rock_mesh_random_range(random_engine)];
-			rocks.push_back(rock{spawn_point,angle_to_$player,rock_template.speed,rock_template.aword_points,rock_template.spawns_smaller_rocks_on_desstruction,rock_template.$mesh});
-			rock_spawn_timer = max_rock_spawn_timer;
+			initialize_fixed_pose(_rock,to_fixed_vector(_rock.position),radians_to_angle(_rock.rotation));
 		}
+		return insert_entity(rocks,std::move(_rock));
+	}
 
-		ufo_spawn_timer -= delta_time;
-		if(ufo_spawn_timer < 0.0f)
+	entity_handle scene::add_projectile(projectile _projectile)
+	{
+		_projectile.id = allocate_entity_id();
+		if(mode == simulation_mode::fixed_point)
 		{
-			SDL_FPoint spawn_point = (($player.position.y > 384) ? SDL_FPoint{1024,192} : SDL_FPoint{0,576});
-			SDL_FPoint direction = (($player.position.y > 384) ? SDL_FPoint{-1,0} : SDL_FPoint{1,0});
-			ufos.push_back(ufo{spawn_point,100,2000,3.0f,direction,UFO_MESH});
-			ufo_spawn_timer = max_ufo_spawn_timer;
+			initialize_fixed_pose(_projectile,to_fixed_vector(_projectile.position),radians_to_angle(_projectile.rotation));
 		}
+		return insert_entity(projectiles,std::move(_projectile));
+	}
 
-		for(auto& rock : rocks)
+	entity_handle scene::add_ufo(ufo _ufo)
+	{
+		_ufo.id = allocate_entity_id();
+		if(mode == simulation_mode::fixed_point)
 		{
-			SDL_FPoint rock_forward_copy = rock.get_forward();
-			SDL_FRect rock_bounding_box = rock.get_mesh().get_transformed_bounding_box();
+			initialize_fixed_pose(_ufo,to_fixed_vector(_ufo.position),radians_to_angle(_ufo.rotation));
+		}
+		entity_handle handle = insert_entity(ufos,std::move(_ufo));
+		scripts.start(run_ufo_behavior(handle),script_kind::ufo_behavior,handle);
+		return handle;
+	}
 
-			if(	((rock_bounding_box.x + rock_bounding_box.w) <= 0) || 
-				(rock_bounding_box.x >= 1024) ||
-				((rock_bounding_box.y + rock_bounding_box.h) <= 0) ||
-				(rock_bounding_box.y >= 768) )
+	bool scene::load_scenario(const scenario_view& scenario)
+	{
+		auto find_template = [](prototype_id prototype) -> const rock_template* {
+			for(const auto& rock_template : ROCK_TEMPLATES)
 			{
-				rock.destroyed = true;
+				if(rock_template.prototype == prototype)
+				{
+					return &rock_template;
+				}
 			}
-			else
+			return nullptr;
+		};
+		for(const auto& record : scenario.get_rocks())
+		{
+			if(!find_template(record.prototype))
 			{
-				rock.update(delta_time);
-				if(!$player.is_dead() && !$player.is_invulnerable())
+				return false;
+			}
+		}
+
+		//Cleared pools retire their handles, so the behaviour scripts of removed UFOs end on their next wake-up.
+		rocks.clear();
+		projectiles.clear();
+		ufos.clear();
+		commands.clear();
+		deferred_particle_bursts.clear();
+		$player.position = scenario.get_player_position();
+		$player.rotation = scenario.get_player_rotation();
+		$player.velocity = {};
+		$player.fixed_velocity = {};
+		if(mode == simulation_mode::fixed_point)
+		{
+			initialize_fixed_pose($player,to_fixed_vector($player.position),radians_to_angle($player.rotation));
+		}
+
+		//Records are adopted as they are, the transforms and the indexes are built once for all of them by the next update.
+		auto adopt = [this](auto& pool,std::size_t count,auto make){
+			return pool.append(count,[&](std::size_t i){
+				auto entity = make(i);
+				entity.id = allocate_entity_id();
+				if(mode == simulation_mode::fixed_point)
 				{
-					if(rock.get_mesh().check_collision_with($player.get_mesh()))
-					{
-						$player.kill();
-						spawn_destruction_particles($player.position,6);
-					}
+					entity.set_fixed_pose(to_fixed_vector(entity.position),radians_to_angle(entity.rotation));
 				}
-			}
+				return entity;
+			});
+		};
+		const auto rock_records = scenario.get_rocks();
+		adopt(rocks,rock_records.size(),[&](std::size_t i){
+			const auto& record = rock_records[i];
+			const rock_template& rock_template = *find_template(record.prototype);
+			rock rock{{record.x,record.y},record.rotation,rock_template.speed,rock_template.aword_points,rock_template.spawns_smaller_rocks_on_desstruction,rock_template.$mesh,deferred_transform};
+			rock.prototype = record.prototype;
+			return rock;
+		});
+		const auto projectile_records = scenario.get_projectiles();
+		adopt(projectiles,projectile_records.size(),[&](std::size_t i){
+			const auto& record = projectile_records[i];
+			projectile projectile{{record.x,record.y},record.rotation,record.speed,true,record.player_friendly != 0,BULLET_MESH,deferred_transform};
+			projectile.prototype = prototype_id::bullet;
+			return projectile;
+		});
+		const auto ufo_records = scenario.get_ufos();
+		std::size_t first_ufo = adopt(ufos,ufo_records.size(),[&](std::size_t i){
+			const auto& record = ufo_records[i];
+			ufo ufo{{record.x,record.y},100,2000,3.0f,{record.direction_x,record.direction_y},UFO_MESH,deferred_transform};
+			ufo.prototype = prototype_id::ufo;
+			return ufo;
+		});
+		for(std::size_t i = first_ufo;i < ufos.size();++i)
+		{
+			entity_handle handle = ufos.get_handle(i);
+			scripts.start(run_ufo_behavior(handle),script_kind::ufo_behavior,handle);
 		}
+		untransformed_entities = true;
+		return true;
+	}
+
+	void scene::save_state(std::vector<std::uint8_t>& output) const
+	{
+		binary_writer writer{output};
+		writer.write(random_generator.get_seed());
+		writer.write(tick);
+		writer.write(mode);
+		$player.save_state(writer);
+		writer.write(max_rock_spawn_timer);
+		writer.write(max_ufo_spawn_timer);
+		writer.write(timer_accumulator);
+		writer.write(fixed_timer_accumulator);
+		timers.save_state(writer);
+		writer.write(next_entity_id);
+
+		auto save_entities = [&](const auto& entities){
+			entities.save_state(writer,[](binary_writer& writer,const auto& entity){
+				writer.write(entity.prototype);
+				entity.save_state(writer);
+			});
+		};
+		save_entities(rocks);
+		save_entities(projectiles);
+		save_entities(ufos);
+		particles.save_state(writer);
+		scripts.save_state(writer);
+	}
 
-		for(auto& ufo : ufos)
+	bool scene::load_state(const std::uint8_t* data,std::size_t size)
+	{
+		binary_reader reader{data,size};
+		std::uint64_t seed{};
+		if(!reader.read(seed))
+		{
+			return false;
+		}
+		random_generator = counter_rng{seed};
+		if(!(reader.read(tick) && reader.read(mode) && $player.load_state(reader) && reader.read(max_rock_spawn_timer) && reader.read(max_ufo_spawn_timer) &&
+			reader.read(timer_accumulator) && reader.read(fixed_timer_accumulator) && timers.load_state(reader) && reader.read(next_entity_id)))
 		{
-			SDL_FPoint ufo_forward_copy = ufo.direction;
-			SDL_FRect ufo_bounding_box = ufo.get_mesh().get_transformed_bounding_box();
+			return false;
+		}
 
-			if(	((ufo_bounding_box.x + ufo_bounding_box.w) <= 0 && ufo_forward_copy.x < 0) || 
-				(ufo_bounding_box.x >= 1024 && ufo_forward_copy.x > 0) ||
-				((ufo_bounding_box.y + ufo_bounding_box.h) <= 0 && ufo_forward_copy.y < 0) ||
-				(ufo_bounding_box.y >= 768 && ufo_forward_copy.y > 0) )
-			{
-				ufo.destroyed = true;
-			}
-			else
-			{
-				ufo.update(delta_time);
-				if(!$player.is_dead() && !$player.is_invulnerable())
+		auto load_entities = [&](auto& entities,auto make_entity){
+			return entities.load_state(reader,[&](binary_reader& reader){
+				prototype_id prototype{};
+				std::optional<decltype(make_entity(PLAYER_MESH))> entity{};
+				if(reader.read(prototype))
 				{
-					if(ufo.get_mesh().check_collision_with($player.get_mesh()))
+					entity.emplace(make_entity(get_prototype_mesh(prototype)));
+					if(!entity->load_state(reader))
 					{
-						$player.kill();
-						spawn_destruction_particles($player.position,6);
+						entity.reset();
 					}
 				}
-				if(!$player.is_dead() && ufo.can_shoot())
-				{
-					float angle_to_$player = std::atan2($player.position.y - ufo.position.y,$player.position.x - ufo.position.x);
-					projectiles.push_back(projectile{ufo.position,angle_to_$player,400,true,false,BULLET_MESH});
-					ufo.make_it_shoot();
-				}
-			}
+				return entity;
+			});
+		};
+		commands.clear();
+		deferred_particle_bursts.clear();
+		//Saved particles are already integrated up to the saved tick.
+		particle_lag = 0.0f;
+		bool loaded = load_entities(rocks,[](const mesh& mesh){ return rock{{},0,0,0,false,mesh}; }) &&
+				load_entities(projectiles,[](const mesh& mesh){ return projectile{{},0,0,false,false,mesh}; }) &&
+				load_entities(ufos,[](const mesh& mesh){ return ufo{{},0,0,0,{},mesh}; }) &&
+				particles.load_state(reader) &&
+				scripts.load_state(reader,[this](script_kind kind,entity_handle target){
+					return make_script(kind,target);
+				});
+		//The index and the hashes aren't saved, pool handles survive a load so they can be rebuilt from the pools.
+		rebuild_entity_indexes();
+		untransformed_entities = false;
+		return loaded;
+	}
+
+	void scene::spawn_destruction_particles(SDL_FPoint position,std::size_t count)
+	{
+		std::size_t requested = count;
+		if(shedding.particle_fraction < 1.0f)
+		{
+			count = std::max<std::size_t>(1,static_cast<std::size_t>(static_cast<float>(count) * shedding.particle_fraction + 0.5f));
+		}
+		if(shedding.particle_cap > 0)
+		{
+			count = std::min(count,(particles.size() < shedding.particle_cap) ? (shedding.particle_cap - particles.size()) : 0);
 		}
+		shed_particle_count += requested - std::min(requested,count);
+		next_entity_id += static_cast<std::uint32_t>(particles.spawn_burst(position,count,DESTRUCTION_PARTICLE_SPEED,next_entity_id));
+	}
+
+	std::uint32_t scene::allocate_entity_id() noexcept
+	{
+		return next_entity_id++;
+	}
 
-		std::vector<SDL_FPoint> additional_rock_spawn_positions{};
-		for(auto& projectile : projectiles)
+	void scene::update_player(float delta_time,const player_input& input)
+	{
+		SDL_FPoint $player_forward = $player.get_forward();
+		if(input.accelerate)
 		{
-			SDL_FRect fragment_bounding_box = projectile.get_mesh().get_transformed_bounding_box();
-			if(	((fragment_bounding_box.x + fragment_bounding_box.w) <= 0) || 
-				(fragment_bounding_box.x >= 1024) ||
-				((fragment_bounding_box.y + fragment_bounding_box.h) <= 0) ||
-				(fragment_bounding_box.y >= 768) )
-			{
-				projectile.destroyed = true;
-			}
-			else
+			$player.velocity.x += $player_forward.x * $player.move_speed * delta_time;
+			$player.velocity.y += $player_forward.y * $player.move_speed * delta_time;
+		}
+		if(input.decelerate)
+		{
+			$player.velocity.x -= $player_forward.x * $player.move_speed * delta_time;
+			$player.velocity.y -= $player_forward.y * $player.move_speed * delta_time;
+		}
+		if(input.turn_left)
+		{
+			$player.rotation -= $player.rotation_speed * delta_time;
+		}
+		if(input.turn_right)
+		{
+			$player.rotation += $player.rotation_speed * delta_time;
+		}
+		if(input.shoot && $player.can_shoot())
+		{
+			commands.push(spawn_projectile_command{$player.position,$player.rotation,600,true,$player.fixed_position,$player.fixed_rotation});
+			commands.push(play_sound_command{sound_effect::shot});
+			$player.make_it_shoot();
+			timers.schedule_seconds($player.max_shoot_timer,{timer_kind::player_shoot_ready});
+		}
+		$player.position.x += $player.velocity.x * delta_time;
+		$player.position.y += $player.velocity.y * delta_time;
+
+		SDL_FRect $player_bounding_box = $player.get_mesh().get_transformed_bounding_box();
+		if(($player_bounding_box.x + $player_bounding_box.w) <= 0 && $player.velocity.x < 0)
+		{
+			$player.position.x = 1024 + $player_bounding_box.w;
+		}
+		if($player_bounding_box.x >= 1024 && $player.velocity.x > 0)
+		{
+			$player.position.x = -$player_bounding_box.w;
+		}
+		if(($player_bounding_box.y + $player_bounding_box.h) <= 0 && $player.velocity.y < 0)
+		{
+			$player.position.y = 768 + $player_bounding_box.h;
+		}
+		if($player_bounding_box.y >= 768 && $player.velocity.y > 0)
+		{
+			$player.position.y = -$player_bounding_box.h;
+		}
+	}
+
+	void scene::update_player_fixed(fixed delta_time,const player_input& input)
+	{
+		fixed_vector $player_forward = $player.get_fixed_forward();
+		fixed $player_speed = to_fixed($player.move_speed);
+		std::int64_t $player_angular_speed = to_angular_speed($player.rotation_speed);
+		if(input.accelerate)
+		{
+			$player.fixed_velocity.x += fixed_multiply(fixed_multiply($player_forward.x,$player_speed),delta_time);
+			$player.fixed_velocity.y += fixed_multiply(fixed_multiply($player_forward.y,$player_speed),delta_time);
+		}
+		if(input.decelerate)
+		{
+			$player.fixed_velocity.x -= fixed_multiply(fixed_multiply($player_forward.x,$player_speed),delta_time);
+			$player.fixed_velocity.y -= fixed_multiply(fixed_multiply($player_forward.y,$player_speed),delta_time);
+		}
+		if(input.turn_left)
+		{
+			$player.fixed_rotation = advance_angle($player.fixed_rotation,-$player_angular_speed,delta_time);
+		}
+		if(input.turn_right)
+		{
+			$player.fixed_rotation = advance_angle($player.fixed_rotation,$player_angular_speed,delta_time);
+		}
+		if(input.shoot && $player.can_shoot())
+		{
+			commands.push(spawn_projectile_command{$player.position,$player.rotation,600,true,$player.fixed_position,$player.fixed_rotation});
+			commands.push(play_sound_command{sound_effect::shot});
+			$player.make_it_shoot();
+			timers.schedule_seconds($player.max_shoot_timer,{timer_kind::player_shoot_ready});
+		}
+		$player.fixed_position.x += fixed_multiply($player.fixed_velocity.x,delta_time);
+		$player.fixed_position.y += fixed_multiply($player.fixed_velocity.y,delta_time);
+
+		fixed_rect $player_bounding_box = $player.get_mesh().get_fixed_bounding_box();
+		screen_exit $player_exit = get_screen_exit($player.get_mesh(),mode);
+		if($player_exit.left && $player.fixed_velocity.x < 0)
+		{
+			$player.fixed_position.x = to_fixed(1024) + $player_bounding_box.w;
+		}
+		if($player_exit.right && $player.fixed_velocity.x > 0)
+		{
+			$player.fixed_position.x = -$player_bounding_box.w;
+		}
+		if($player_exit.top && $player.fixed_velocity.y < 0)
+		{
+			$player.fixed_position.y = to_fixed(768) + $player_bounding_box.h;
+		}
+		if($player_exit.bottom && $player.fixed_velocity.y > 0)
+		{
+			$player.fixed_position.y = -$player_bounding_box.h;
+		}
+		$player.sync_float_pose();
+	}
+
+	bool scene::check_collision(const mesh& a,const mesh& b) const
+	{
+		return (mode == simulation_mode::fixed_point) ? a.check_collision_with_fixed(b) : a.check_collision_with(b);
+	}
+
+	//Only pairs of buckets involving one of 'layers' are walked.
+	void scene::resolve_collisions(collision_mask layers)
+	{
+		for(std::size_t a = 0;a < COLLISION_LAYER_COUNT;++a)
+		{
+			for(std::size_t b = a;b < COLLISION_LAYER_COUNT;++b)
 			{
-				projectile.update(delta_time);
-				if(projectile.physical)
+				collision_layer a_layer = static_cast<collision_layer>(a);
+				collision_layer b_layer = static_cast<collision_layer>(b);
+				if((layers & (get_layer_bit(a_layer) | get_layer_bit(b_layer))) == 0)
+				{
+					continue;
+				}
+				const auto& a_bucket = collision_buckets[a];
+				const auto& b_bucket = collision_buckets[b];
+				//Particles never enter a bucket, they only show up in the rejection counts.
+				std::uint64_t a_size = (a_layer == collision_layer::particle) ? particles.size() : a_bucket.size();
+				std::uint64_t b_size = (b_layer == collision_layer::particle) ? particles.size() : b_bucket.size();
+				std::uint64_t pair_count = (a != b) ? (a_size * b_size) : ((a_size > 0) ? (a_size * (a_size - 1) / 2) : 0);
+				if(pair_count == 0)
+				{
+					continue;
+				}
+				if(!layers_collide(a_layer,b_layer))
+				{
+					rejected_collision_pair_counts[a] += pair_count;
+					if(b != a)
+					{
+						rejected_collision_pair_counts[b] += pair_count;
+					}
+					continue;
+				}
+				for(std::size_t i = 0;i < a_bucket.size();++i)
 				{
-					if(projectile.player_friendly)
+					const collider& a_collider = a_bucket[i];
+					for(std::size_t j = (a == b) ? (i + 1) : 0;j < b_bucket.size();++j)
 					{
-						for(auto& rock : rocks)
+						const collider& b_collider = b_bucket[j];
+						if(!filter_collision_pair(a_layer,a_collider.mask,b_layer,b_collider.mask))
 						{
-							if(rock.get_mesh().check_collision_with(projectile.get_mesh()))
+							rejected_collision_pair_counts[a] += 1;
+							if(b != a)
 							{
-								projectile.destroyed = true;
-								rock.destroyed = true;
-								$player.points += rock.award_points;
-								if(rock.spawns_smaller_rocks_on_destruction)
-								{
-									additional_rock_spawn_positions.push_back(rock.position);
-									spawn_destruction_particles(rock.position,4);
-								}
-								else
-								{
-									spawn_destruction_particles(rock.position,3);
-								}
+								rejected_collision_pair_counts[b] += 1;
 							}
+							continue;
 						}
-						for(auto& ufo : ufos)
+						tested_collision_pair_count += 1;
+						if(check_collision(*b_collider.shape,*a_collider.shape))
 						{
-							if(ufo.get_mesh().check_collision_with(projectile.get_mesh()))
+							handle_collision(a_layer,a_collider.index,b_layer,b_collider.index);
+							if(schedule.projectile_substeps > 1)
 							{
-								projectile.destroyed = true;
-								ufo.destroyed = true;
-								$player.points += ufo.award_points;
-								spawn_destruction_particles(ufo.position,3);
+								hit_colliders.push_back(&collision_buckets[a][i]);
+								hit_colliders.push_back(&collision_buckets[b][j]);
 							}
 						}
 					}
-					else if(!$player.is_dead() && !$player.is_invulnerable())
-					{
-						if(projectile.get_mesh().check_collision_with($player.get_mesh()))
-						{
-							$player.kill();
-							spawn_destruction_particles($player.position,6);
-							projectile.destroyed = true;
-						}
-					}
 				}
 			}
 		}
+	}
+
+	//'a_layer' is never greater than 'b_layer', the layer matrix makes sure only the pairs below get here.
+	void scene::handle_collision(collision_layer a_layer,std::size_t a_index,collision_layer b_layer,std::size_t b_index)
+	{
+		if(a_layer == collision_layer::player)
+		{
+			commands.push(kill_player_command{});
+			if(b_layer == collision_layer::hostile_projectile)
+			{
+				commands.push(destroy_command{entity_kind::projectile,projectiles.get_handle(b_index)});
+			}
+		}
+		else if(a_layer == collision_layer::rock)
+		{
+			const auto& rock = rocks[a_index];
+			commands.push(destroy_command{entity_kind::projectile,projectiles.get_handle(b_index)});
+			commands.push(destroy_command{entity_kind::rock,rocks.get_handle(a_index)});
+			commands.push(add_points_command{rock.award_points});
+			commands.push(play_sound_command{sound_effect::rock_break});
+			if(rock.spawns_smaller_rocks_on_destruction)
+			{
+				commands.push(split_rock_command{rock.position,rock.id,rock.fixed_position});
+				commands.push(spawn_particles_command{rock.position,4});
+			}
+			else
+			{
+				commands.push(spawn_particles_command{rock.position,3});
+			}
+		}
+		else if(a_layer == collision_layer::ufo)
+		{
+			const auto& ufo = ufos[a_index];
+			commands.push(destroy_command{entity_kind::projectile,projectiles.get_handle(b_index)});
+			commands.push(destroy_command{entity_kind::ufo,ufos.get_handle(a_index)});
+			commands.push(add_points_command{ufo.award_points});
+			commands.push(play_sound_command{sound_effect::ufo_kill});
+			commands.push(spawn_particles_command{ufo.position,3});
+		}
+	}
+
+	std::size_t scene::random_index(random_stream stream,std::uint32_t entity_id,std::uint32_t index,std::size_t count) const noexcept
+	{
+		return random_bits_to_index(random_generator.bits(tick,entity_id,stream,index),count);
+	}
+
+	void scene::advance_timers(float delta_time)
+	{
+		std::uint64_t ticks = 0;
+		if(mode == simulation_mode::fixed_point)
+		{
+			fixed_timer_accumulator += static_cast<std::int64_t>(to_fixed(delta_time)) * TIMER_WHEEL_TICKS_PER_SECOND;
+			ticks = static_cast<std::uint64_t>(fixed_timer_accumulator >> FIXED_SHIFT);
+			fixed_timer_accumulator -= static_cast<std::int64_t>(ticks) << FIXED_SHIFT;
+		}
+		else
+		{
+			timer_accumulator += delta_time;
+			ticks = static_cast<std::uint64_t>(timer_accumulator / TIMER_WHEEL_RESOLUTION);
+			timer_accumulator -= ticks * TIMER_WHEEL_RESOLUTION;
+		}
+		timers.advance(ticks,[this](const timer_event& event){
+			handle_timer(event);
+		});
+	}
+
+	void scene::handle_timer(const timer_event& event)
+	{
+		switch(event.kind)
+		{
+			case timer_kind::player_shoot_ready:
+				$player.make_ready_to_shoot();
+			break;
+			case timer_kind::player_invulnerability_end:
+				$player.end_invulnerability();
+			break;
+			case timer_kind::player_respawn:
+				$player.respawn(find_respawn_point());
+				timers.schedule_seconds($player.max_invulnerability_timer,{timer_kind::player_invulnerability_end});
+			break;
+			case timer_kind::script_resume:
+				scripts.resume(event.handle);
+			break;
+		}
+	}
+
+	script_task scene::make_script(script_kind kind,entity_handle target)
+	{
+		switch(kind)
+		{
+			case script_kind::rock_wave:
+				return run_rock_wave();
+			case script_kind::ufo_wave:
+				return run_ufo_wave();
+			default:
+				return run_ufo_behavior(target);
+		}
+	}
+
+	script_task scene::run_rock_wave()
+	{
+		script_wait wait = next_tick();
+		while(true)
+		{
+			co_await wait;
+			//stable_sort keeps ties in the same order with every standard library.
+			auto spawn_points = ROCK_SPAWN_POINTS;
+			if(mode == simulation_mode::fixed_point)
+			{
+				std::stable_sort(spawn_points.begin(),spawn_points.end(),[&](const SDL_FPoint& a,const SDL_FPoint& b){
+					return fixed_distance_squared($player.fixed_position,to_fixed_vector(a)) > fixed_distance_squared($player.fixed_position,to_fixed_vector(b));
+				});
+			}
+			else
+			{
+				std::stable_sort(spawn_points.begin(),spawn_points.end(),[&](const SDL_FPoint& a,const SDL_FPoint& b){
+					return distance($player.position,a) > distance($player.position,b);
+				});
+			}
+
+			static_assert(ROCK_SPAWN_POINTS.size() > 2);
+			//Only one rock wave exists, entity id 0 keeps its draws apart from the per-rock ones.
+			SDL_FPoint spawn_point = spawn_points[random_index(random_stream::rock_wave,0,0,3)];
+			fixed_vector fixed_spawn_point = to_fixed_vector(spawn_point);
+			const rock_template* rock_template = &ROCK_TEMPLATES[random_index(random_stream::rock_wave,0,1,ROCK_TEMPLATES.size())];
+			if(mode == simulation_mode::fixed_point)
+			{
+				binary_angle angle_to_$player = fixed_atan2($player.fixed_position.y - fixed_spawn_point.y,$player.fixed_position.x - fixed_spawn_point.x);
+				commands.push(spawn_rock_command{spawn_point,angle_to_radians(angle_to_$player),rock_template,fixed_spawn_point,angle_to_$player});
+			}
+			else
+			{
+				float angle_to_$player = std::atan2($player.position.y - spawn_point.y,$player.position.x - spawn_point.x);
+				commands.push(spawn_rock_command{spawn_point,angle_to_$player,rock_template});
+			}
+			wait = seconds(max_rock_spawn_timer);
+		}
+	}
+
+	script_task scene::run_ufo_wave()
+	{
+		script_wait wait = seconds(max_ufo_spawn_timer);
+		while(true)
+		{
+			co_await wait;
+			bool $player_in_lower_half = (mode == simulation_mode::fixed_point) ? ($player.fixed_position.y > to_fixed(384)) : ($player.position.y > 384);
+			SDL_FPoint spawn_point = ($player_in_lower_half ? SDL_FPoint{1024,192} : SDL_FPoint{0,576});
+			SDL_FPoint direction = ($player_in_lower_half ? SDL_FPoint{-1,0} : SDL_FPoint{1,0});
+			commands.push(spawn_ufo_command{spawn_point,direction,to_fixed_vector(spawn_point)});
+			wait = seconds(max_ufo_spawn_timer);
+		}
+	}
+
+	script_task scene::run_ufo_behavior(entity_handle handle)
+	{
+		script_wait wait = next_tick();
+		while(true)
+		{
+			co_await wait;
+			const ufo* ufo = ufos.find(handle);
+			if(!ufo)
+			{
+				co_return;
+			}
+			wait = next_tick();
+			if(!$player.is_dead())
+			{
+				if(mode == simulation_mode::fixed_point)
+				{
+					binary_angle angle_to_$player = fixed_atan2($player.fixed_position.y - ufo->fixed_position.y,$player.fixed_position.x - ufo->fixed_position.x);
+					commands.push(spawn_projectile_command{ufo->position,angle_to_radians(angle_to_$player),400,false,ufo->fixed_position,angle_to_$player});
+				}
+				else
+				{
+					float angle_to_$player = std::atan2($player.position.y - ufo->position.y,$player.position.x - ufo->position.x);
+					commands.push(spawn_projectile_command{ufo->position,angle_to_$player,400,false});
+				}
+				wait = seconds(ufo->max_shoot_timer);
+			}
+		}
+	}
 
-		rocks.erase(std::remove_if(rocks.begin(),rocks.end(),[](rock rock){
-			return rock.destroyed;
-		}),rocks.end());
+	void scene::spawn_deferred_particle_bursts()
+	{
+		particle_bursts_this_tick = 0;
+		std::size_t spawned = 0;
+		while(spawned < deferred_particle_bursts.size() && (shedding.particle_bursts_per_tick == 0 || particle_bursts_this_tick < shedding.particle_bursts_per_tick))
+		{
+			const auto& burst = deferred_particle_bursts[spawned++];
+			spawn_destruction_particles(burst.position,burst.count);
+			particle_bursts_this_tick += 1;
+		}
+		deferred_particle_bursts.erase(deferred_particle_bursts.begin(),deferred_particle_bursts.begin() + static_cast<std::ptrdiff_t>(spawned));
+	}
 
-		projectiles.erase(std::remove_if(projectiles.begin(),projectiles.end(),[](projectile projectile){
-			return projectile.destroyed;
-		}),projectiles.end());
+	void scene::apply_commands()
+	{
+		rocks.reserve(rocks.size() + commands.get_pending_rock_count());
+		projectiles.reserve(projectiles.size() + commands.get_pending_projectile_count());
+		ufos.reserve(ufos.size() + commands.get_pending_ufo_count());
+
+		for(const auto& command : commands.get_commands())
+		{
+			std::visit([this](const auto& command){
+				apply_command(command);
+			},command);
+		}
+		commands.clear();
+	}
 
-		ufos.erase(std::remove_if(ufos.begin(),ufos.end(),[](ufo ufo){
-			return ufo.destroyed;
-		}),ufos.end());
+	void scene::apply_command(const spawn_rock_command& command)
+	{
+		const rock_template& rock_template = *command.$template;
+		rock rock{command.position,command.rotation,rock_template.speed,rock_template.aword_points,rock_template.spawns_smaller_rocks_on_desstruction,rock_template.$mesh};
+		rock.id = allocate_entity_id();
+		rock.prototype = rock_template.prototype;
+		if(mode == simulation_mode::fixed_point)
+		{
+			initialize_fixed_pose(rock,command.fixed_position,command.fixed_rotation);
+		}
+		insert_entity(rocks,std::move(rock));
+	}
 
-		for(const auto& additional_rock_spawn_position : additional_rock_spawn_positions)
+	void scene::apply_command(const split_rock_command& command)
+	{
+		//Keyed by the id of the rock that broke, so the fragments don't depend on the order rocks were hit in.
+		std::array<std::uint32_t,SPLIT_ROCK_FRAGMENT_COUNT> template_bits{};
+		random_generator.fill_bits(tick,command.rock_id,random_stream::split_rock,0,template_bits.data(),template_bits.size());
+		for(std::size_t i = 0;i < SPLIT_ROCK_FRAGMENT_COUNT;++i)
 		{
-			auto rock_mesh_random_range = std::uniform_int_distribution<std::size_t>(0ULL,SMALL_ROCK_TEMPLATES.size() - 1);
-			constexpr std::size_t frag_count = 4;
-			for(std::size_t i = 0;i < frag_count;++i)
+			const rock_template& rock_template = SMALL_ROCK_TEMPLATES[random_bits_to_index(template_bits[i],SMALL_ROCK_TEMPLATES.size())];
+			rock rock{command.position,CONSTANT_PI * 2.0f * (1.0f / SPLIT_ROCK_FRAGMENT_COUNT) * i,rock_template.speed,rock_template.aword_points,false,rock_template.$mesh};
+			rock.id = allocate_entity_id();
+			rock.prototype = rock_template.prototype;
+			if(mode == simulation_mode::fixed_point)
 			{
-				const rock_template& rock_template = SMALL_ROCK_TEMPLATES[rock_mesh_random_range(random_engine)];
-				rocks.push_back(rock{additional_rock_spawn_position,CONSTANT_PI * 2.0f * (1.0f / frag_count) * i,rock_template.speed,rock_template.aword_points,false,rock_template.$mesh});
+				initialize_fixed_pose(rock,command.fixed_position,static_cast<binary_angle>((std::uint64_t{1} << 32) / SPLIT_ROCK_FRAGMENT_COUNT * i));
 			}
+			insert_entity(rocks,std::move(rock));
 		}
-		additional_rock_spawn_positions.clear();
 	}
 
-	const player& scene::get_player() const
+	void scene::apply_command(const spawn_projectile_command& command)
 	{
-		return $player;
+		projectile projectile{command.position,command.rotation,command.move_speed,true,command.player_friendly,BULLET_MESH};
+		projectile.id = allocate_entity_id();
+		projectile.prototype = prototype_id::bullet;
+		if(mode == simulation_mode::fixed_point)
+		{
+			initialize_fixed_pose(projectile,command.fixed_position,command.fixed_rotation);
+		}
+		insert_entity(projectiles,std::move(projectile));
 	}
 
-	const std::vector<rock>& scene::get_rocks() const
+	void scene::apply_command(const spawn_ufo_command& command)
 	{
-		return rocks;
+		ufo ufo{command.position,100,2000,3.0f,command.direction,UFO_MESH};
+		ufo.id = allocate_entity_id();
+		ufo.prototype = prototype_id::ufo;
+		if(mode == simulation_mode::fixed_point)
+		{
+			initialize_fixed_pose(ufo,command.fixed_position,0);
+		}
+		entity_handle handle = insert_entity(ufos,std::move(ufo));
+		scripts.start(run_ufo_behavior(handle),script_kind::ufo_behavior,handle);
 	}
 
-	const std::vector<projectile>& scene::get_projectiles() const
+	void scene::apply_command(const spawn_particles_command& command)
 	{
-		return projectiles;
+		if(shedding.particle_bursts_per_tick > 0 && particle_bursts_this_tick >= shedding.particle_bursts_per_tick)
+		{
+			//Bursts are cosmetic, when too many are waiting the oldest is dropped instead of growing the queue.
+			if(deferred_particle_bursts.size() >= MAX_DEFERRED_PARTICLE_BURSTS)
+			{
+				shed_particle_count += deferred_particle_bursts.front().count;
+				deferred_particle_bursts.erase(deferred_particle_bursts.begin());
+			}
+			deferred_particle_bursts.push_back(command);
+			deferred_particle_burst_count += 1;
+			return;
+		}
+		spawn_destruction_particles(command.position,command.count);
+		particle_bursts_this_tick += 1;
 	}
 
-	const std::vector<ufo>& scene::get_ufos() const
+	void scene::apply_command(const destroy_command& command)
 	{
-		return ufos;
+		switch(command.kind)
+		{
+			case entity_kind::rock:
+				remove_entity(rocks,command.handle);
+			break;
+			case entity_kind::projectile:
+				remove_entity(projectiles,command.handle);
+			break;
+			case entity_kind::ufo:
+				remove_entity(ufos,command.handle);
+			break;
+		}
 	}
 
-	void scene::spawn_destruction_particles(SDL_FPoint position,std::size_t count)
+	void scene::apply_command(const add_points_command& command)
+	{
+		$player.points += command.points;
+	}
+
+	void scene::apply_command(const kill_player_command&)
+	{
+		if(!$player.is_dead())
+		{
+			$player.kill();
+			timers.schedule_seconds($player.max_respawn_timer,{timer_kind::player_respawn});
+			spawn_destruction_particles($player.position,PLAYER_DEATH_PARTICLE_COUNT);
+			if(sound_events)
+			{
+				sound_events->try_push(sound_effect::player_death);
+			}
+		}
+	}
+
+	void scene::apply_command(const play_sound_command& command)
 	{
-		for(std::size_t i = 0;i < count;++i)
+		if(sound_events)
 		{
-			projectiles.push_back(projectile{position,CONSTANT_PI * 2.0f * (1.0f / count) * i,200,false,true,DESTRUCTION_FRAGMENT_MESH});
+			sound_events->try_push(command.effect);
 		}
 	}
 }
\ No newline at end of file
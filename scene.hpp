@@ -2,11 +2,18 @@
 #define ASTEROIDS_SCENE_HPP
 
 #include <array>
-#include <random>
 #include <cstdint>
 #include <SDL_keycode.h>
+#include "random.hpp"
 #include "utility.hpp"
+#include "commands.hpp"
 #include "entities.hpp"
+#include "particles.hpp"
+#include "entity_pool.hpp"
+#include "timer_wheel.hpp"
+#include "scripting.hpp"
+#include "scenario.hpp"
+#include "fused_pass.hpp"
 
 namespace asteroids
 {
@@ -81,24 +88,27 @@ namespace asteroids
 		}
 	};
 
+	inline constexpr float DESTRUCTION_PARTICLE_SPEED = 200.0f;
+
 	struct rock_template
 	{
 		mesh $mesh;
 		float speed;
 		std::uintmax_t aword_points;
 		bool spawns_smaller_rocks_on_desstruction;
+		prototype_id prototype;
 	};
 
 	inline const std::array<rock_template,4> ROCK_TEMPLATES{
-		rock_template{BIG_ROCK_MESHES[0],300,100,true},
-		rock_template{BIG_ROCK_MESHES[1],300,100,true},
-		rock_template{SMALL_ROCK_MESHES[0],350,150,false},
-		rock_template{SMALL_ROCK_MESHES[1],350,150,false}
+		rock_template{BIG_ROCK_MESHES[0],300,100,true,prototype_id::big_rock_0},
+		rock_template{BIG_ROCK_MESHES[1],300,100,true,prototype_id::big_rock_1},
+		rock_template{SMALL_ROCK_MESHES[0],350,150,false,prototype_id::small_rock_0},
+		rock_template{SMALL_ROCK_MESHES[1],350,150,false,prototype_id::small_rock_1}
 	};
 
 	inline const std::array<rock_template,2> SMALL_ROCK_TEMPLATES{
-		rock_template{SMALL_ROCK_MESHES[0],300,150,false},
-		rock_template{SMALL_ROCK_MESHES[1],300,150,false}
+		rock_template{SMALL_ROCK_MESHES[0],300,150,false,prototype_id::small_rock_0},
+		rock_template{SMALL_ROCK_MESHES[1],300,150,false,prototype_id::small_rock_1}
 	};
 
 	inline constexpr std::array<SDL_FPoint,8> ROCK_SPAWN_POINTS{
@@ -112,29 +122,173 @@ namespace asteroids
 		SDL_FPoint{-25,384}
 	};
 
+	//Tried in order, the first one without a hazard within SAFE_RESPAWN_DISTANCE pixels is where the player respawns.
+	inline constexpr std::array<SDL_FPoint,5> RESPAWN_POINTS{
+		SDL_FPoint{512,384},
+		SDL_FPoint{256,192},
+		SDL_FPoint{768,192},
+		SDL_FPoint{256,576},
+		SDL_FPoint{768,576}
+	};
+
+	inline constexpr float SAFE_RESPAWN_DISTANCE = 150.0f;
+
+	struct player_input
+	{
+		bool accelerate{};
+		bool decelerate{};
+		bool turn_left{};
+		bool turn_right{};
+		bool shoot{};
+	};
+
+	//Optional work the scene may skip when a frame runs over budget, the defaults skip nothing.
+	struct load_shedding
+	{
+		//Share of every destruction burst that is spawned, at least one particle per burst survives.
+		float particle_fraction{1.0f};
+		//Live particle limit, 0 means the particle system's capacity.
+		std::size_t particle_cap{};
+		//Destruction bursts spawned per tick, later ones wait for the next ticks. 0 means no limit.
+		std::size_t particle_bursts_per_tick{};
+	};
+
+	inline constexpr std::size_t MAX_DEFERRED_PARTICLE_BURSTS = 64;
+
+	const mesh& get_prototype_mesh(prototype_id prototype);
+	player_input make_player_input(const std::array<bool,SDL_NUM_SCANCODES>& keyboard_keys,const std::array<bool,SDL_NUM_SCANCODES>& once_keyboard_keys);
+	std::uint8_t pack_player_input(const player_input& input) noexcept;
+	player_input unpack_player_input(std::uint8_t bits) noexcept;
+
 	class scene
 	{
 		void spawn_destruction_particles(SDL_FPoint position,std::size_t count);
+		std::uint32_t allocate_entity_id() noexcept;
+		void update_player(float delta_time,const player_input& input);
+		void update_player_fixed(fixed delta_time,const player_input& input);
+		bool check_collision(const mesh& a,const mesh& b) const;
+		void resolve_collisions(collision_mask layers);
+		template<typename T>
+		entity_handle insert_entity(entity_pool<T>& pool,T&& value);
+		template<typename T>
+		void remove_entity(entity_pool<T>& pool,entity_handle handle);
+		void rebuild_entity_indexes();
+		void transform_adopted_entities();
+		SDL_FPoint find_respawn_point() const;
+		void handle_collision(collision_layer a_layer,std::size_t a_index,collision_layer b_layer,std::size_t b_index);
+		std::size_t random_index(random_stream stream,std::uint32_t entity_id,std::uint32_t index,std::size_t count) const noexcept;
+		void advance_timers(float delta_time);
+		void handle_timer(const timer_event& event);
+		script_task make_script(script_kind kind,entity_handle target);
+		script_task run_rock_wave();
+		script_task run_ufo_wave();
+		script_task run_ufo_behavior(entity_handle handle);
+		void spawn_deferred_particle_bursts();
+		void apply_commands();
+		void apply_command(const spawn_rock_command& command);
+		void apply_command(const split_rock_command& command);
+		void apply_command(const spawn_projectile_command& command);
+		void apply_command(const spawn_ufo_command& command);
+		void apply_command(const spawn_particles_command& command);
+		void apply_command(const destroy_command& command);
+		void apply_command(const add_points_command& command);
+		void apply_command(const kill_player_command& command);
+		void apply_command(const play_sound_command& command);
 	public:
 		scene();
+		explicit scene(std::uint64_t seed,simulation_mode _mode = simulation_mode::floating_point);
 		scene(const scene&) = delete;
 		scene& operator = (const scene&) = delete;
 
+		void update(float delta_time,const player_input& input);
 		void update(float delta_time,const std::array<bool,SDL_NUM_SCANCODES>& keyboard_keys,const std::array<bool,SDL_NUM_SCANCODES>& once_keyboard_keys);
+		simulation_mode get_simulation_mode() const noexcept;
+		//Updates run since the scene was created, a loaded state brings its own count.
+		std::uint64_t get_tick() const noexcept;
 		const player& get_player() const;
 		const std::vector<rock>& get_rocks() const;
 		const std::vector<projectile>& get_projectiles() const;
 		const std::vector<ufo>& get_ufos() const;
+		const particle_system& get_particles() const;
+		const rock* find_rock(entity_handle handle) const;
+		const projectile* find_projectile(entity_handle handle) const;
+		const ufo* find_ufo(entity_handle handle) const;
+		//Sound effects triggered by gameplay are pushed into 'queue' at the end of every update, nullptr keeps the scene silent.
+		void set_sound_queue(sound_event_queue* queue) noexcept;
+		//Shedding changes particle ids and with them the ids of later entities, so it has to stay off while recording or in lockstep.
+		void set_load_shedding(const load_shedding& _shedding) noexcept;
+		const load_shedding& get_load_shedding() const noexcept;
+		//Particles that weren't spawned or were spawned late because of load shedding.
+		std::uint64_t get_shed_particle_count() const noexcept;
+		std::uint64_t get_deferred_particle_burst_count() const noexcept;
+		//Pairs involving 'layer' that were skipped by the layer matrix or the entities' masks before any geometry test.
+		std::uint64_t get_rejected_collision_pair_count(collision_layer layer) const noexcept;
+		std::uint64_t get_tested_collision_pair_count() const noexcept;
+		void set_update_schedule(const update_schedule& _schedule) noexcept;
+		const update_schedule& get_update_schedule() const noexcept;
+		//Work and time spent updating 'update_class' since the scene was created, collision tests aren't included.
+		const update_cost& get_update_cost(update_class $class) const noexcept;
+		//Time the particles haven't been integrated over yet, they are drawn this much further along.
+		float get_particle_lag() const noexcept;
+		//Queries over the bounding boxes of the player (while alive), rocks, projectiles and UFOs as of the end of the last update.
+		//Only layers in 'layers' are returned, results are appended to 'output'.
+		void query_rect(const SDL_FRect& rect,collision_mask layers,std::vector<spatial_hit>& output) const;
+		void query_radius(SDL_FPoint center,float radius,collision_mask layers,std::vector<spatial_hit>& output) const;
+		void query_nearest(SDL_FPoint point,std::size_t count,collision_mask layers,std::vector<spatial_hit>& output) const;
+		bool raycast(SDL_FPoint origin,SDL_FPoint direction,float max_distance,collision_mask layers,spatial_hit& hit) const;
+		//Hashes of the simulation state as of the end of the last update, kept up to date as entities change rather than recomputed.
+		//Two runs of the same input have the same hashes on every tick as long as they haven't diverged.
+		state_hash_array get_state_hashes() const noexcept;
+		//Appends one record per rock, projectile and UFO, identified by its entity id.
+		void collect_entity_hashes(std::vector<entity_hash_record>& output) const;
+		//Writes the hashes of the tick that just ran to 'writer', with the entity records if it is a detailed log.
+		void write_state_hashes(state_hash_log_writer& writer) const;
+		entity_handle add_rock(rock _rock);
+		entity_handle add_projectile(projectile _projectile);
+		entity_handle add_ufo(ufo _ufo);
+		//Replaces the player pose, rocks, projectiles and UFOs with the ones in 'scenario', timers and waves keep running.
+		//The adopted entities share their prototype's geometry and are transformed and indexed by the next update,
+		//so until then collision queries and state hashes don't see them.
+		bool load_scenario(const scenario_view& scenario);
+		void save_state(std::vector<std::uint8_t>& output) const;
+		bool load_state(const std::uint8_t* data,std::size_t size);
 	private:
-		std::mt19937_64 random_engine{};
+		simulation_mode mode{};
+		counter_rng random_generator;
+		std::uint64_t tick{};
 		player $player;
-		std::vector<rock> rocks{};
+		entity_pool<rock> rocks{};
 		float max_rock_spawn_timer{};
-		float rock_spawn_timer{};
-		std::vector<projectile> projectiles{};
+		entity_pool<projectile> projectiles{};
 		float max_ufo_spawn_timer{};
-		float ufo_spawn_timer{};
-		std::vector<ufo> ufos{};
+		entity_pool<ufo> ufos{};
+		particle_system particles{};
+		timer_wheel timers{};
+		float timer_accumulator{};
+		std::int64_t fixed_timer_accumulator{};
+		script_scheduler scripts{timers};
+		command_buffer commands{};
+		std::uint32_t next_entity_id{1};
+		//Set by load_scenario, the entities it adopted have no transformed meshes and aren't in the spatial index or the hashes yet.
+		bool untransformed_entities{};
+		sound_event_queue* sound_events{};
+		load_shedding shedding{};
+		std::vector<spawn_particles_command> deferred_particle_bursts{};
+		std::size_t particle_bursts_this_tick{};
+		std::uint64_t shed_particle_count{};
+		std::uint64_t deferred_particle_burst_count{};
+		//This tick's collision candidates per layer, the vectors keep their capacity between ticks.
+		collision_bucket_array collision_buckets{};
+		spatial_index spatial{};
+		//One per entity_kind, indexed by the pool slot like the pools themselves.
+		std::array<entity_state_hash,ENTITY_KIND_COUNT> entity_hashes{};
+		update_schedule schedule{};
+		update_cost_array update_costs{};
+		float particle_lag{};
+		//Colliders that hit something in the current substep, they are left out of the following ones.
+		std::vector<collider*> hit_colliders{};
+		std::array<std::uint64_t,COLLISION_LAYER_COUNT> rejected_collision_pair_counts{};
+		std::uint64_t tested_collision_pair_count{};
 	};
 }
 
@@ -0,0 +1,275 @@
+#include "scripting.hpp"
+
+#include <array>
+#include <new>
+#include <utility>
+#include <exception>
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr std::size_t SCRIPT_FRAME_GRANULARITY = 64;
+		constexpr std::size_t SCRIPT_FRAME_SIZE_CLASSES = 16;
+
+		struct free_frame
+		{
+			free_frame* next;
+		};
+
+		class script_frame_pool
+		{
+		public:
+			script_frame_pool() = default;
+			script_frame_pool(const script_frame_pool&) = delete;
+			script_frame_pool& operator = (const script_frame_pool&) = delete;
+
+			~script_frame_pool()
+			{
+				for(auto& head : free_lists)
+				{
+					while(head)
+					{
+						free_frame* next = head->next;
+						::operator delete(head);
+						head = next;
+					}
+				}
+			}
+
+			void* allocate(std::size_t size)
+			{
+				std::size_t size_class = (size + SCRIPT_FRAME_GRANULARITY - 1) / SCRIPT_FRAME_GRANULARITY;
+				if(size_class >= SCRIPT_FRAME_SIZE_CLASSES)
+				{
+					return ::operator new(size);
+				}
+				if(free_frame* frame = free_lists[size_class])
+				{
+					free_lists[size_class] = frame->next;
+					return frame;
+				}
+				return ::operator new(size_class * SCRIPT_FRAME_GRANULARITY);
+			}
+
+			void deallocate(void* frame,std::size_t size) noexcept
+			{
+				std::size_t size_class = (size + SCRIPT_FRAME_GRANULARITY - 1) / SCRIPT_FRAME_GRANULARITY;
+				if(size_class >= SCRIPT_FRAME_SIZE_CLASSES)
+				{
+					::operator delete(frame);
+					return;
+				}
+				auto* node = ::new(frame) free_frame{free_lists[size_class]};
+				free_lists[size_class] = node;
+			}
+
+		private:
+			std::array<free_frame*,SCRIPT_FRAME_SIZE_CLASSES> free_lists{};
+		};
+
+		thread_local script_frame_pool frame_pool{};
+	}
+
+	void* allocate_script_frame(std::size_t size)
+	{
+		return frame_pool.allocate(size);
+	}
+
+	void deallocate_script_frame(void* frame,std::size_t size) noexcept
+	{
+		frame_pool.deallocate(frame,size);
+	}
+
+	void* script_task::promise_type::operator new(std::size_t size)
+	{
+		return allocate_script_frame(size);
+	}
+
+	void script_task::promise_type::operator delete(void* frame,std::size_t size) noexcept
+	{
+		deallocate_script_frame(frame,size);
+	}
+
+	script_task script_task::promise_type::get_return_object() noexcept
+	{
+		return script_task{std::coroutine_handle<promise_type>::from_promise(*this)};
+	}
+
+	std::suspend_always script_task::promise_type::initial_suspend() const noexcept
+	{
+		return {};
+	}
+
+	std::suspend_always script_task::promise_type::final_suspend() const noexcept
+	{
+		return {};
+	}
+
+	void script_task::promise_type::return_void() const noexcept
+	{}
+
+	void script_task::promise_type::unhandled_exception() const noexcept
+	{
+		std::terminate();
+	}
+
+	script_task::script_task(std::coroutine_handle<promise_type> _coroutine) noexcept : coroutine(_coroutine)
+	{}
+
+	script_task::script_task(script_task&& _task) noexcept : coroutine(std::exchange(_task.coroutine,{}))
+	{}
+
+	script_task& script_task::operator = (script_task&& _task) noexcept
+	{
+		if(&_task != this)
+		{
+			if(coroutine)
+			{
+				coroutine.destroy();
+			}
+			coroutine = std::exchange(_task.coroutine,{});
+		}
+		return *this;
+	}
+
+	script_task::~script_task()
+	{
+		if(coroutine)
+		{
+			coroutine.destroy();
+		}
+	}
+
+	std::coroutine_handle<script_task::promise_type> script_task::release() noexcept
+	{
+		return std::exchange(coroutine,{});
+	}
+
+	bool script_wait::await_ready() const noexcept
+	{
+		return false;
+	}
+
+	void script_wait::await_suspend(std::coroutine_handle<script_task::promise_type> coroutine) const
+	{
+		auto& promise = coroutine.promise();
+		promise.scheduler->wait(promise.handle,ticks);
+	}
+
+	void script_wait::await_resume() const noexcept
+	{}
+
+	script_wait next_tick() noexcept
+	{
+		return {0};
+	}
+
+	script_wait seconds(float duration) noexcept
+	{
+		return {seconds_to_timer_ticks(duration)};
+	}
+
+	script_scheduler::script_scheduler(timer_wheel& _timers) : timers(_timers)
+	{}
+
+	script_scheduler::~script_scheduler()
+	{
+		clear();
+	}
+
+	entity_handle script_scheduler::start(script_task task,script_kind kind,entity_handle target)
+	{
+		entity_handle handle = scripts.insert(script_slot{kind,target,{},false});
+		attach(handle,std::move(task));
+		resume(handle);
+		return handle;
+	}
+
+	void script_scheduler::resume(entity_handle script)
+	{
+		script_slot* slot = scripts.find(script);
+		if(!slot)
+		{
+			return;
+		}
+		auto coroutine = slot->coroutine;
+		coroutine.resume();
+		if(coroutine.done())
+		{
+			coroutine.destroy();
+			scripts.remove(script);
+		}
+	}
+
+	void script_scheduler::run_tick()
+	{
+		resuming.swap(next_tick_queue);
+		for(auto handle : resuming)
+		{
+			resume(handle);
+		}
+		resuming.clear();
+	}
+
+	void script_scheduler::clear()
+	{
+		for(std::size_t i = 0;i < scripts.size();++i)
+		{
+			if(scripts[i].coroutine)
+			{
+				scripts[i].coroutine.destroy();
+			}
+		}
+		scripts.clear();
+		next_tick_queue.clear();
+	}
+
+	std::size_t script_scheduler::size() const noexcept
+	{
+		return scripts.size();
+	}
+
+	void script_scheduler::wait(entity_handle script,std::uint64_t ticks)
+	{
+		script_slot* slot = scripts.find(script);
+		if(!slot)
+		{
+			return;
+		}
+		if(slot->restored)
+		{
+			slot->restored = false;
+			return;
+		}
+		if(ticks == 0)
+		{
+			next_tick_queue.push_back(script);
+		}
+		else
+		{
+			timers.schedule(ticks,{timer_kind::script_resume,script});
+		}
+	}
+
+	void script_scheduler::save_state(binary_writer& writer) const
+	{
+		scripts.save_state(writer,[](binary_writer& writer,const script_slot& slot){
+			writer.write(slot.kind);
+			writer.write(slot.target);
+		});
+		writer.write(static_cast<std::uint32_t>(next_tick_queue.size()));
+		for(auto handle : next_tick_queue)
+		{
+			writer.write(handle);
+		}
+	}
+
+	void script_scheduler::attach(entity_handle handle,script_task task)
+	{
+		auto coroutine = task.release();
+		coroutine.promise().scheduler = this;
+		coroutine.promise().handle = handle;
+		scripts.find(handle)->coroutine = coroutine;
+	}
+}
\ No newline at end of file
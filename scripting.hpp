@@ -0,0 +1,159 @@
+#ifndef ASTEROIDS_SCRIPTING_HPP
+#define ASTEROIDS_SCRIPTING_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <coroutine>
+#include "entity_pool.hpp"
+#include "timer_wheel.hpp"
+#include "serialization.hpp"
+
+namespace asteroids
+{
+	class script_scheduler;
+
+	enum class script_kind : std::uint8_t
+	{
+		none,
+		rock_wave,
+		ufo_wave,
+		ufo_behavior
+	};
+
+	//Frames come from per-size free lists, so once a script of a given size has finished, starting the next one doesn't touch the heap.
+	void* allocate_script_frame(std::size_t size);
+	void deallocate_script_frame(void* frame,std::size_t size) noexcept;
+
+	class script_task
+	{
+	public:
+		struct promise_type
+		{
+			script_scheduler* scheduler{};
+			entity_handle handle{};
+
+			static void* operator new(std::size_t size);
+			static void operator delete(void* frame,std::size_t size) noexcept;
+
+			script_task get_return_object() noexcept;
+			std::suspend_always initial_suspend() const noexcept;
+			std::suspend_always final_suspend() const noexcept;
+			void return_void() const noexcept;
+			void unhandled_exception() const noexcept;
+		};
+
+		explicit script_task(std::coroutine_handle<promise_type> _coroutine) noexcept;
+		script_task(const script_task&) = delete;
+		script_task(script_task&& _task) noexcept;
+		script_task& operator = (const script_task&) = delete;
+		script_task& operator = (script_task&& _task) noexcept;
+		~script_task();
+
+		std::coroutine_handle<promise_type> release() noexcept;
+
+	private:
+		std::coroutine_handle<promise_type> coroutine{};
+	};
+
+	//Zero ticks waits for the next scene tick, anything else waits on the timer wheel.
+	struct script_wait
+	{
+		std::uint64_t ticks{};
+
+		bool await_ready() const noexcept;
+		void await_suspend(std::coroutine_handle<script_task::promise_type> coroutine) const;
+		void await_resume() const noexcept;
+	};
+
+	script_wait next_tick() noexcept;
+	script_wait seconds(float duration) noexcept;
+
+	//Coroutines can't be serialized, so a saved script is restarted from the top and its first wait is skipped because the pending wake up
+	//is already stored in the timer wheel or the next tick queue. Scripts therefore have to suspend exactly once per loop iteration,
+	//at the top of the loop, and keep everything else they need in the scene.
+	class script_scheduler
+	{
+	public:
+		explicit script_scheduler(timer_wheel& _timers);
+		script_scheduler(const script_scheduler&) = delete;
+		script_scheduler& operator = (const script_scheduler&) = delete;
+		~script_scheduler();
+
+		//Runs the script until it first suspends.
+		entity_handle start(script_task task,script_kind kind,entity_handle target = {});
+		void resume(entity_handle script);
+		void run_tick();
+		void clear();
+		std::size_t size() const noexcept;
+
+		void wait(entity_handle script,std::uint64_t ticks);
+
+		void save_state(binary_writer& writer) const;
+		//'make_task' is called with the kind and target of every saved script and has to recreate the same coroutine.
+		template<typename F>
+		bool load_state(binary_reader& reader,F&& make_task)
+		{
+			clear();
+			bool loaded = scripts.load_state(reader,[](binary_reader& reader){
+				std::optional<script_slot> slot{};
+				script_kind kind{};
+				entity_handle target{};
+				if(reader.read(kind) && reader.read(target))
+				{
+					slot.emplace(script_slot{kind,target,{},true});
+				}
+				return slot;
+			});
+			std::uint32_t queued_count{};
+			if(!loaded || !reader.read(queued_count) || queued_count > scripts.size())
+			{
+				clear();
+				return false;
+			}
+			next_tick_queue.resize(queued_count);
+			for(auto& handle : next_tick_queue)
+			{
+				if(!reader.read(handle))
+				{
+					clear();
+					return false;
+				}
+			}
+			for(std::size_t i = 0;i < scripts.size();++i)
+			{
+				entity_handle handle = scripts.get_handle(i);
+				attach(handle,make_task(scripts[i].kind,scripts[i].target));
+			}
+			for(std::size_t i = 0;i < scripts.size();)
+			{
+				entity_handle handle = scripts.get_handle(i);
+				resume(handle);
+				if(scripts.is_valid(handle))
+				{
+					++i;
+				}
+			}
+			return true;
+		}
+
+	private:
+		struct script_slot
+		{
+			script_kind kind{};
+			entity_handle target{};
+			std::coroutine_handle<script_task::promise_type> coroutine{};
+			bool restored{};
+		};
+
+		void attach(entity_handle handle,script_task task);
+
+		timer_wheel& timers;
+		entity_pool<script_slot> scripts{};
+		std::vector<entity_handle> next_tick_queue{};
+		std::vector<entity_handle> resuming{};
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef ASTEROIDS_SERIALIZATION_HPP
+#define ASTEROIDS_SERIALIZATION_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace asteroids
+{
+	class binary_writer
+	{
+	public:
+		explicit binary_writer(std::vector<std::uint8_t>& _output) : output(_output)
+		{}
+
+		template<typename T>
+		void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			write_bytes(&value,sizeof(T));
+		}
+
+		void write_bytes(const void* data,std::size_t size)
+		{
+			//Resized and copied into the tail, GCC 12 reports false buffer overflows for a range insert here.
+			if(size == 0)
+			{
+				return;
+			}
+			std::size_t offset = output.size();
+			output.resize(offset + size);
+			std::memcpy(output.data() + offset,data,size);
+		}
+
+		std::size_t get_size() const noexcept
+		{
+			return output.size();
+		}
+
+	private:
+		std::vector<std::uint8_t>& output;
+	};
+
+	class binary_reader
+	{
+	public:
+		binary_reader(const std::uint8_t* _data,std::size_t _size) : data(_data),size(_size)
+		{}
+
+		template<typename T>
+		bool read(T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			return read_bytes(&value,sizeof(T));
+		}
+
+		bool read_bytes(void* destination,std::size_t count)
+		{
+			if(count > (size - offset))
+			{
+				return false;
+			}
+			std::memcpy(destination,data + offset,count);
+			offset += count;
+			return true;
+		}
+
+		bool skip(std::size_t count)
+		{
+			if(count > (size - offset))
+			{
+				return false;
+			}
+			offset += count;
+			return true;
+		}
+
+		std::size_t get_offset() const noexcept
+		{
+			return offset;
+		}
+
+		std::size_t get_remaining() const noexcept
+		{
+			return size - offset;
+		}
+
+	private:
+		const std::uint8_t* data;
+		std::size_t size;
+		std::size_t offset{};
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,505 @@
+#include "server.hpp"
+
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+#include "utility.hpp"
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr std::uint32_t CLIENT_TIMEOUT_TICKS = static_cast<std::uint32_t>(SERVER_TICK_RATE * 5);
+		constexpr std::uint8_t INPUT_SHOOT_BIT = 16;
+		//Every snapshot datagram starts with the packet type, the tick and the part's index and the number of parts.
+		//A snapshot whose encoding doesn't fit one datagram is split into parts that fill whole datagrams but the last.
+		constexpr std::size_t SNAPSHOT_PART_HEADER_SIZE = 9;
+		constexpr std::size_t MAX_SNAPSHOT_PART_PAYLOAD = MAX_DATAGRAM_SIZE - SNAPSHOT_PART_HEADER_SIZE;
+		constexpr std::size_t MAX_SNAPSHOT_PARTS = 256;
+
+		double milliseconds_since(std::chrono::steady_clock::time_point start)
+		{
+			return std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		void write_u32(std::vector<std::uint8_t>& output,std::uint32_t value)
+		{
+			for(int i = 0;i < 4;++i)
+			{
+				output.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+			}
+		}
+
+		void write_u16(std::vector<std::uint8_t>& output,std::uint16_t value)
+		{
+			output.push_back(static_cast<std::uint8_t>(value));
+			output.push_back(static_cast<std::uint8_t>(value >> 8));
+		}
+
+		std::uint16_t read_u16(const std::uint8_t* data)
+		{
+			return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+		}
+
+		std::uint32_t read_u32(const std::uint8_t* data)
+		{
+			return static_cast<std::uint32_t>(data[0]) | (static_cast<std::uint32_t>(data[1]) << 8) |
+					(static_cast<std::uint32_t>(data[2]) << 16) | (static_cast<std::uint32_t>(data[3]) << 24);
+		}
+
+		void print_statistics(std::ostream& log,const server_statistics& statistics)
+		{
+			log << std::fixed << std::setprecision(3)
+				<< "tick " << statistics.average_tick_milliseconds << " ms (max " << statistics.max_tick_milliseconds << " ms)"
+				<< " | clients " << statistics.clients << " | entities " << statistics.entities
+				<< " | per client " << std::setprecision(1) << statistics.bytes_per_client_per_second / 1024.0 << " KiB/s"
+				<< " | snapshot " << statistics.average_snapshot_bytes << " B (full " << statistics.full_snapshot_bytes << " B)"
+				<< " | split " << statistics.split_snapshots << " | oversized " << statistics.oversized_snapshots
+				<< " | failed sends " << statistics.failed_sends << std::endl;
+			log.unsetf(std::ios_base::floatfield);
+		}
+	}
+
+	game_server::game_server(std::uint64_t seed) : $scene(seed),receive_buffer(MAX_DATAGRAM_SIZE)
+	{}
+
+	bool game_server::start(std::uint16_t port)
+	{
+		return socket.open(port);
+	}
+
+	void game_server::tick()
+	{
+		auto start = std::chrono::steady_clock::now();
+		receive_packets();
+
+		player_input input{};
+		if(!clients.empty())
+		{
+			input = unpack_player_input(clients.front().input);
+			clients.front().input &= static_cast<std::uint8_t>(~INPUT_SHOOT_BIT);
+		}
+		$scene.update(1.0f / SERVER_TICK_RATE,input);
+		++tick_counter;
+
+		snapshot& current = history[tick_counter % SNAPSHOT_HISTORY_SIZE];
+		current = capture_snapshot($scene,tick_counter);
+		broadcast_snapshot();
+
+		double elapsed = milliseconds_since(start);
+		statistics_ticks += 1;
+		statistics_tick_milliseconds += elapsed;
+		statistics_max_tick_milliseconds = std::max(statistics_max_tick_milliseconds,elapsed);
+		statistics_client_ticks += clients.size();
+	}
+
+	scene& game_server::get_scene() noexcept
+	{
+		return $scene;
+	}
+
+	std::uint16_t game_server::get_port() const noexcept
+	{
+		return socket.get_port();
+	}
+
+	server_statistics game_server::take_statistics()
+	{
+		server_statistics statistics{};
+		statistics.clients = clients.size();
+		statistics.entities = history[tick_counter % SNAPSHOT_HISTORY_SIZE].entities.size();
+		statistics.ticks = statistics_ticks;
+		if(statistics_ticks > 0)
+		{
+			statistics.average_tick_milliseconds = statistics_tick_milliseconds / statistics_ticks;
+			statistics.max_tick_milliseconds = statistics_max_tick_milliseconds;
+		}
+		if(statistics_client_ticks > 0)
+		{
+			statistics.bytes_per_client_per_second = static_cast<double>(statistics_bytes_sent) / statistics_client_ticks * SERVER_TICK_RATE;
+		}
+		if(statistics_snapshots_sent > 0)
+		{
+			statistics.average_snapshot_bytes = static_cast<double>(statistics_bytes_sent) / statistics_snapshots_sent;
+		}
+		std::vector<std::uint8_t> full{};
+		encode_snapshot(nullptr,history[tick_counter % SNAPSHOT_HISTORY_SIZE],full);
+		std::size_t full_parts = std::max<std::size_t>((full.size() + MAX_SNAPSHOT_PART_PAYLOAD - 1) / MAX_SNAPSHOT_PART_PAYLOAD,1);
+		statistics.full_snapshot_bytes = full.size() + full_parts * SNAPSHOT_PART_HEADER_SIZE;
+		statistics.split_snapshots = statistics_split_snapshots;
+		statistics.oversized_snapshots = statistics_oversized_snapshots;
+		statistics.failed_sends = statistics_failed_sends;
+
+		statistics_ticks = 0;
+		statistics_tick_milliseconds = 0.0;
+		statistics_max_tick_milliseconds = 0.0;
+		statistics_bytes_sent = 0;
+		statistics_snapshots_sent = 0;
+		statistics_client_ticks = 0;
+		statistics_split_snapshots = 0;
+		statistics_oversized_snapshots = 0;
+		statistics_failed_sends = 0;
+		return statistics;
+	}
+
+	void game_server::receive_packets()
+	{
+		network_address address{};
+		while(std::size_t size = socket.receive_from(address,receive_buffer.data(),receive_buffer.size()))
+		{
+			auto found = std::find_if(clients.begin(),clients.end(),[&](const client& client){
+				return client.address == address;
+			});
+			auto type = static_cast<packet_type>(receive_buffer[0]);
+			if(type == packet_type::disconnect)
+			{
+				if(found != clients.end())
+				{
+					clients.erase(found);
+				}
+				continue;
+			}
+			if(type != packet_type::input || size < 6)
+			{
+				continue;
+			}
+			if(found == clients.end())
+			{
+				clients.push_back(client{address});
+				found = clients.end() - 1;
+			}
+
+			std::uint8_t shoot = found->input & INPUT_SHOOT_BIT;
+			found->input = receive_buffer[1] | shoot;
+			std::uint32_t ack = read_u32(&receive_buffer[2]);
+			if(ack != 0 && (!found->has_ack || ack > found->acked_tick))
+			{
+				found->acked_tick = ack;
+				found->has_ack = true;
+			}
+			found->last_seen_tick = tick_counter;
+		}
+
+		clients.erase(std::remove_if(clients.begin(),clients.end(),[&](const client& client){
+			return (tick_counter - client.last_seen_tick) > CLIENT_TIMEOUT_TICKS;
+		}),clients.end());
+	}
+
+	void game_server::broadcast_snapshot()
+	{
+		const snapshot& current = history[tick_counter % SNAPSHOT_HISTORY_SIZE];
+		for(auto& client : clients)
+		{
+			const snapshot* baseline = nullptr;
+			if(client.has_ack && (tick_counter - client.acked_tick) < SNAPSHOT_HISTORY_SIZE)
+			{
+				const snapshot& candidate = history[client.acked_tick % SNAPSHOT_HISTORY_SIZE];
+				if(candidate.tick == client.acked_tick)
+				{
+					baseline = &candidate;
+				}
+			}
+
+			encoded.clear();
+			encode_snapshot(baseline,current,encoded);
+			std::size_t part_count = std::max<std::size_t>((encoded.size() + MAX_SNAPSHOT_PART_PAYLOAD - 1) / MAX_SNAPSHOT_PART_PAYLOAD,1);
+			if(part_count > MAX_SNAPSHOT_PARTS)
+			{
+				statistics_oversized_snapshots += 1;
+				continue;
+			}
+			if(part_count > 1)
+			{
+				statistics_split_snapshots += 1;
+			}
+
+			bool sent = true;
+			for(std::size_t part = 0;part < part_count && sent;++part)
+			{
+				std::size_t offset = part * MAX_SNAPSHOT_PART_PAYLOAD;
+				std::size_t length = std::min(MAX_SNAPSHOT_PART_PAYLOAD,encoded.size() - offset);
+				packet.clear();
+				packet.push_back(static_cast<std::uint8_t>(packet_type::snapshot));
+				write_u32(packet,current.tick);
+				write_u16(packet,static_cast<std::uint16_t>(part));
+				write_u16(packet,static_cast<std::uint16_t>(part_count));
+				packet.resize(SNAPSHOT_PART_HEADER_SIZE + length);
+				std::memcpy(packet.data() + SNAPSHOT_PART_HEADER_SIZE,encoded.data() + offset,length);
+				sent = socket.send_to(client.address,packet.data(),packet.size());
+				if(sent)
+				{
+					client.bytes_sent += packet.size();
+					statistics_bytes_sent += packet.size();
+				}
+			}
+			//The client can't use a snapshot with a part missing, so the remaining parts aren't sent.
+			if(sent)
+			{
+				statistics_snapshots_sent += 1;
+			}
+			else
+			{
+				statistics_failed_sends += 1;
+			}
+		}
+	}
+
+	bool game_client::connect(const network_address& _server_address)
+	{
+		server_address = _server_address;
+		receive_buffer.resize(MAX_DATAGRAM_SIZE);
+		return socket.open(0);
+	}
+
+	void game_client::send_input(const player_input& input)
+	{
+		packet.clear();
+		packet.push_back(static_cast<std::uint8_t>(packet_type::input));
+		packet.push_back(pack_player_input(input));
+		write_u32(packet,has_latest ? latest_tick : 0);
+		socket.send_to(server_address,packet.data(),packet.size());
+	}
+
+	void game_client::poll(double now_seconds)
+	{
+		network_address address{};
+		while(std::size_t size = socket.receive_from(address,receive_buffer.data(),receive_buffer.size()))
+		{
+			if(address != server_address || size < SNAPSHOT_PART_HEADER_SIZE || static_cast<packet_type>(receive_buffer[0]) != packet_type::snapshot)
+			{
+				continue;
+			}
+			bytes_received += size;
+
+			std::uint32_t tick = read_u32(&receive_buffer[1]);
+			std::size_t part = read_u16(&receive_buffer[5]);
+			std::size_t part_count = read_u16(&receive_buffer[7]);
+			const std::uint8_t* payload = &receive_buffer[SNAPSHOT_PART_HEADER_SIZE];
+			std::size_t payload_size = size - SNAPSHOT_PART_HEADER_SIZE;
+			if(part >= part_count || part_count > MAX_SNAPSHOT_PARTS || (has_latest && tick <= latest_tick))
+			{
+				continue;
+			}
+			if(part_count == 1)
+			{
+				receive_snapshot(payload,payload_size,now_seconds);
+				continue;
+			}
+			if((part + 1 < part_count) ? payload_size != MAX_SNAPSHOT_PART_PAYLOAD : payload_size > MAX_SNAPSHOT_PART_PAYLOAD)
+			{
+				continue;
+			}
+
+			//Parts of an older snapshot still in flight are dropped, a newer one replaces the one being assembled.
+			if(assembly_parts.empty() || tick != assembly_tick || part_count != assembly_parts.size())
+			{
+				if(!assembly_parts.empty() && tick < assembly_tick)
+				{
+					continue;
+				}
+				assembly.resize(part_count * MAX_SNAPSHOT_PART_PAYLOAD);
+				assembly_parts.assign(part_count,false);
+				assembly_missing = part_count;
+				assembly_size = 0;
+				assembly_tick = tick;
+			}
+			if(assembly_parts[part])
+			{
+				continue;
+			}
+			std::memcpy(assembly.data() + part * MAX_SNAPSHOT_PART_PAYLOAD,payload,payload_size);
+			assembly_parts[part] = true;
+			assembly_missing -= 1;
+			if(part + 1 == part_count)
+			{
+				assembly_size = part * MAX_SNAPSHOT_PART_PAYLOAD + payload_size;
+			}
+			if(assembly_missing == 0)
+			{
+				assembly_parts.clear();
+				receive_snapshot(assembly.data(),assembly_size,now_seconds);
+			}
+		}
+	}
+
+	void game_client::receive_snapshot(const std::uint8_t* data,std::size_t size,double now_seconds)
+	{
+		std::uint32_t tick{};
+		std::uint32_t baseline_tick{};
+		bool has_baseline{};
+		if(!read_snapshot_header(data,size,tick,baseline_tick,has_baseline) || (has_latest && tick <= latest_tick))
+		{
+			return;
+		}
+		const snapshot* baseline = has_baseline ? find_snapshot(baseline_tick) : nullptr;
+		if(has_baseline && !baseline)
+		{
+			return;
+		}
+
+		snapshot decoded{};
+		if(!decode_snapshot(baseline,data,size,decoded))
+		{
+			return;
+		}
+		std::size_t slot = tick % SNAPSHOT_HISTORY_SIZE;
+		received[slot] = std::move(decoded);
+		received_valid[slot] = true;
+		latest_tick = tick;
+		latest_receive_time = now_seconds;
+		has_latest = true;
+	}
+
+	bool game_client::has_snapshot() const noexcept
+	{
+		return has_latest;
+	}
+
+	snapshot game_client::get_interpolated_snapshot(double now_seconds) const
+	{
+		if(!has_latest)
+		{
+			return {};
+		}
+		double estimated_tick = latest_tick + (now_seconds - latest_receive_time) * SERVER_TICK_RATE;
+		double render_tick = std::min(estimated_tick - INTERPOLATION_DELAY_TICKS,static_cast<double>(latest_tick));
+
+		const snapshot* from = nullptr;
+		const snapshot* to = nullptr;
+		for(std::size_t i = 0;i < SNAPSHOT_HISTORY_SIZE;++i)
+		{
+			if(!received_valid[i])
+			{
+				continue;
+			}
+			const snapshot& candidate = received[i];
+			if(candidate.tick <= render_tick && (!from || candidate.tick > from->tick))
+			{
+				from = &candidate;
+			}
+			if(candidate.tick > render_tick && (!to || candidate.tick < to->tick))
+			{
+				to = &candidate;
+			}
+		}
+		if(!from)
+		{
+			return *to;
+		}
+		if(!to)
+		{
+			return *from;
+		}
+		float alpha = static_cast<float>((render_tick - from->tick) / static_cast<double>(to->tick - from->tick));
+		return interpolate_snapshots(*from,*to,alpha);
+	}
+
+	std::uint64_t game_client::get_bytes_received() const noexcept
+	{
+		return bytes_received;
+	}
+
+	const snapshot* game_client::find_snapshot(std::uint32_t tick) const
+	{
+		std::size_t slot = tick % SNAPSHOT_HISTORY_SIZE;
+		if(received_valid[slot] && received[slot].tick == tick)
+		{
+			return &received[slot];
+		}
+		return nullptr;
+	}
+
+	int run_server(std::uint16_t port,std::ostream& log)
+	{
+		game_server server{static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())};
+		if(!server.start(port))
+		{
+			log << "Couldn't open UDP port " << port << "." << std::endl;
+			return 1;
+		}
+		log << "Server listening on UDP port " << server.get_port() << "." << std::endl;
+
+		auto tick_duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / SERVER_TICK_RATE));
+		auto next_tick = std::chrono::steady_clock::now();
+		for(std::uint64_t tick = 1;;++tick)
+		{
+			server.tick();
+			if((tick % static_cast<std::uint64_t>(SERVER_TICK_RATE)) == 0)
+			{
+				print_statistics(log,server.take_statistics());
+			}
+			next_tick += tick_duration;
+			std::this_thread::sleep_until(next_tick);
+		}
+	}
+
+	int run_loopback_test(std::size_t client_count,std::size_t entity_count,double seconds,std::ostream& log)
+	{
+		game_server server{0x10091ac};
+		if(!server.start(0))
+		{
+			log << "Couldn't open a UDP port for the server." << std::endl;
+			return 1;
+		}
+
+		std::mt19937_64 random_engine{0x10091ac};
+		std::uniform_real_distribution<float> x_range{64.0f,960.0f};
+		std::uniform_real_distribution<float> y_range{64.0f,704.0f};
+		std::uniform_real_distribution<float> angle_range{0.0f,CONSTANT_PI * 2.0f};
+		std::uniform_int_distribution<std::size_t> template_range{0,ROCK_TEMPLATES.size() - 1};
+		for(std::size_t i = 0;i < entity_count;++i)
+		{
+			const rock_template& rock_template = ROCK_TEMPLATES[template_range(random_engine)];
+			rock rock{{x_range(random_engine),y_range(random_engine)},angle_range(random_engine),20,rock_template.aword_points,false,rock_template.$mesh};
+			rock.prototype = rock_template.prototype;
+			server.get_scene().add_rock(rock);
+		}
+
+		network_address server_address{};
+		resolve_address("127.0.0.1",server.get_port(),server_address);
+		std::vector<game_client> clients(client_count);
+		for(auto& client : clients)
+		{
+			if(!client.connect(server_address))
+			{
+				log << "Couldn't open a UDP port for a client." << std::endl;
+				return 1;
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		std::uint32_t total_ticks = static_cast<std::uint32_t>(seconds * SERVER_TICK_RATE);
+		for(std::uint32_t tick = 0;tick < total_ticks;++tick)
+		{
+			double now = tick / static_cast<double>(SERVER_TICK_RATE);
+			for(auto& client : clients)
+			{
+				client.send_input(player_input{});
+			}
+			server.tick();
+			for(auto& client : clients)
+			{
+				client.poll(now);
+			}
+			if(((tick + 1) % static_cast<std::uint32_t>(SERVER_TICK_RATE)) == 0)
+			{
+				print_statistics(log,server.take_statistics());
+			}
+		}
+
+		double elapsed = milliseconds_since(start);
+		std::uint64_t bytes_received = 0;
+		for(const auto& client : clients)
+		{
+			bytes_received += client.get_bytes_received();
+		}
+		log << std::fixed << std::setprecision(1) << "Simulated " << total_ticks << " ticks with " << client_count << " clients in " << elapsed << " ms, "
+			<< "clients received " << (bytes_received / std::max<std::size_t>(client_count,1)) / seconds / 1024.0 << " KiB/s each." << std::endl;
+		log.unsetf(std::ios_base::floatfield);
+		return 0;
+	}
+}
\ No newline at end of file
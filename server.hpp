@@ -0,0 +1,126 @@
+#ifndef ASTEROIDS_SERVER_HPP
+#define ASTEROIDS_SERVER_HPP
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include "scene.hpp"
+#include "network.hpp"
+#include "snapshot.hpp"
+
+namespace asteroids
+{
+	inline constexpr float SERVER_TICK_RATE = 60.0f;
+	inline constexpr std::size_t SNAPSHOT_HISTORY_SIZE = 64;
+	inline constexpr float INTERPOLATION_DELAY_TICKS = 6.0f;
+
+	enum class packet_type : std::uint8_t
+	{
+		input = 1,
+		snapshot = 2,
+		disconnect = 3
+	};
+
+	struct server_statistics
+	{
+		std::size_t clients{};
+		std::size_t entities{};
+		std::uint32_t ticks{};
+		double average_tick_milliseconds{};
+		double max_tick_milliseconds{};
+		double bytes_per_client_per_second{};
+		double average_snapshot_bytes{};
+		std::size_t full_snapshot_bytes{};
+		//Snapshots sent in several datagrams, snapshots too large to send even then and sends the socket refused.
+		std::size_t split_snapshots{};
+		std::size_t oversized_snapshots{};
+		std::size_t failed_sends{};
+	};
+
+	class game_server
+	{
+	public:
+		explicit game_server(std::uint64_t seed);
+		game_server(const game_server&) = delete;
+		game_server& operator = (const game_server&) = delete;
+
+		bool start(std::uint16_t port);
+		//Reads client packets, advances the scene by one fixed tick and sends every client a snapshot delta.
+		void tick();
+		scene& get_scene() noexcept;
+		std::uint16_t get_port() const noexcept;
+		//Returns the statistics gathered since the previous call.
+		server_statistics take_statistics();
+
+	private:
+		struct client
+		{
+			network_address address{};
+			std::uint32_t acked_tick{};
+			bool has_ack{};
+			std::uint8_t input{};
+			std::uint32_t last_seen_tick{};
+			std::uint64_t bytes_sent{};
+		};
+
+		void receive_packets();
+		void broadcast_snapshot();
+
+		udp_socket socket{};
+		scene $scene;
+		std::uint32_t tick_counter{};
+		std::vector<client> clients{};
+		std::array<snapshot,SNAPSHOT_HISTORY_SIZE> history{};
+		std::vector<std::uint8_t> encoded{};
+		std::vector<std::uint8_t> packet{};
+		std::vector<std::uint8_t> receive_buffer{};
+		std::uint32_t statistics_ticks{};
+		double statistics_tick_milliseconds{};
+		double statistics_max_tick_milliseconds{};
+		std::uint64_t statistics_bytes_sent{};
+		std::uint64_t statistics_snapshots_sent{};
+		std::uint64_t statistics_client_ticks{};
+		std::uint64_t statistics_split_snapshots{};
+		std::uint64_t statistics_oversized_snapshots{};
+		std::uint64_t statistics_failed_sends{};
+	};
+
+	class game_client
+	{
+	public:
+		bool connect(const network_address& _server_address);
+		void send_input(const player_input& input);
+		//'now_seconds' is any monotonic clock, it is only used to place received snapshots on the timeline.
+		void poll(double now_seconds);
+		bool has_snapshot() const noexcept;
+		snapshot get_interpolated_snapshot(double now_seconds) const;
+		std::uint64_t get_bytes_received() const noexcept;
+
+	private:
+		void receive_snapshot(const std::uint8_t* data,std::size_t size,double now_seconds);
+		const snapshot* find_snapshot(std::uint32_t tick) const;
+
+		udp_socket socket{};
+		network_address server_address{};
+		std::array<snapshot,SNAPSHOT_HISTORY_SIZE> received{};
+		std::array<bool,SNAPSHOT_HISTORY_SIZE> received_valid{};
+		bool has_latest{};
+		std::uint32_t latest_tick{};
+		double latest_receive_time{};
+		//Parts of the newest snapshot that arrived split, placed at their offsets as they come in.
+		std::vector<std::uint8_t> assembly{};
+		std::vector<bool> assembly_parts{};
+		std::size_t assembly_missing{};
+		std::size_t assembly_size{};
+		std::uint32_t assembly_tick{};
+		std::vector<std::uint8_t> packet{};
+		std::vector<std::uint8_t> receive_buffer{};
+		std::uint64_t bytes_received{};
+	};
+
+	int run_server(std::uint16_t port,std::ostream& log);
+	int run_loopback_test(std::size_t client_count,std::size_t entity_count,double seconds,std::ostream& log);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,471 @@
+#include "snapshot.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "utility.hpp"
+
+namespace asteroids
+{
+	namespace
+	{
+		enum entity_change_mask : std::uint8_t
+		{
+			CHANGE_PROTOTYPE = 1,
+			CHANGE_FLAGS = 2,
+			CHANGE_X = 4,
+			CHANGE_Y = 8,
+			CHANGE_ROTATION = 16
+		};
+
+		void write_varint(std::vector<std::uint8_t>& output,std::uint64_t value)
+		{
+			while(value >= 0x80)
+			{
+				output.push_back(static_cast<std::uint8_t>(value | 0x80));
+				value >>= 7;
+			}
+			output.push_back(static_cast<std::uint8_t>(value));
+		}
+
+		void write_zigzag(std::vector<std::uint8_t>& output,std::int32_t value)
+		{
+			write_varint(output,(static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31));
+		}
+
+		class byte_reader
+		{
+		public:
+			byte_reader(const std::uint8_t* _data,std::size_t _size) : data(_data),size(_size)
+			{}
+
+			bool read_u8(std::uint8_t& value)
+			{
+				if(offset >= size)
+				{
+					return false;
+				}
+				value = data[offset++];
+				return true;
+			}
+
+			bool read_varint(std::uint64_t& value)
+			{
+				value = 0;
+				for(unsigned shift = 0;shift < 64;shift += 7)
+				{
+					std::uint8_t byte{};
+					if(!read_u8(byte))
+					{
+						return false;
+					}
+					value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+					if((byte & 0x80) == 0)
+					{
+						return true;
+					}
+				}
+				return false;
+			}
+
+			bool read_zigzag(std::int32_t& value)
+			{
+				std::uint64_t raw{};
+				if(!read_varint(raw))
+				{
+					return false;
+				}
+				std::uint32_t bits = static_cast<std::uint32_t>(raw);
+				value = static_cast<std::int32_t>((bits >> 1) ^ (~(bits & 1) + 1));
+				return true;
+			}
+
+		private:
+			const std::uint8_t* data;
+			std::size_t size;
+			std::size_t offset{};
+		};
+
+		std::int16_t quantize_coordinate(float value)
+		{
+			float scaled = std::round(value * SNAPSHOT_POSITION_SCALE);
+			return static_cast<std::int16_t>(std::clamp(scaled,-32768.0f,32767.0f));
+		}
+
+		std::uint16_t quantize_rotation(float rotation)
+		{
+			float turns = rotation / (CONSTANT_PI * 2.0f);
+			turns -= std::floor(turns);
+			return static_cast<std::uint16_t>(static_cast<std::uint32_t>(turns * 65536.0f) & 0xFFFF);
+		}
+
+		entity_state make_entity_state(const entity& entity,std::uint8_t flags)
+		{
+			entity_state state{};
+			state.id = entity.id;
+			state.prototype = entity.prototype;
+			state.flags = flags;
+			state.x = quantize_coordinate(entity.position.x);
+			state.y = quantize_coordinate(entity.position.y);
+			state.rotation = quantize_rotation(entity.rotation);
+			return state;
+		}
+
+		bool read_header(byte_reader& reader,std::uint32_t& tick,std::uint32_t& baseline_tick,bool& has_baseline)
+		{
+			std::uint64_t raw_tick{};
+			std::uint64_t raw_baseline{};
+			if(!reader.read_varint(raw_tick) || !reader.read_varint(raw_baseline))
+			{
+				return false;
+			}
+			tick = static_cast<std::uint32_t>(raw_tick);
+			has_baseline = raw_baseline != 0;
+			baseline_tick = has_baseline ? static_cast<std::uint32_t>(raw_baseline - 1) : 0;
+			return true;
+		}
+	}
+
+	SDL_FPoint entity_state::get_position() const noexcept
+	{
+		return {x / SNAPSHOT_POSITION_SCALE,y / SNAPSHOT_POSITION_SCALE};
+	}
+
+	float entity_state::get_rotation() const noexcept
+	{
+		return (rotation / 65536.0f) * CONSTANT_PI * 2.0f;
+	}
+
+	snapshot capture_snapshot(const scene& scene,std::uint32_t tick)
+	{
+		snapshot result{};
+		result.tick = tick;
+		result.points = scene.get_player().points;
+		result.entities.resize(1 + scene.get_rocks().size() + scene.get_projectiles().size() + scene.get_ufos().size() + scene.get_particles().size());
+		write_entity_states(scene,result.entities.data(),result.entities.size());
+		std::sort(result.entities.begin(),result.entities.end(),[](const entity_state& a,const entity_state& b){
+			return a.id < b.id;
+		});
+		return result;
+	}
+
+	std::size_t write_entity_states(const scene& scene,entity_state* output,std::size_t capacity)
+	{
+		std::size_t count = 0;
+		auto add = [&](const entity_state& state){
+			if(count < capacity)
+			{
+				output[count] = state;
+			}
+			count += 1;
+		};
+
+		const player& player = scene.get_player();
+		std::uint8_t player_flags = (player.is_invulnerable() ? ENTITY_STATE_INVULNERABLE : 0) | (player.is_dead() ? ENTITY_STATE_DEAD : 0);
+		entity_state player_state = make_entity_state(player,player_flags);
+		player_state.id = PLAYER_ENTITY_ID;
+		add(player_state);
+		for(const auto& rock : scene.get_rocks())
+		{
+			add(make_entity_state(rock,0));
+		}
+		for(const auto& projectile : scene.get_projectiles())
+		{
+			add(make_entity_state(projectile,projectile.player_friendly ? 0 : ENTITY_STATE_HOSTILE));
+		}
+		for(const auto& ufo : scene.get_ufos())
+		{
+			add(make_entity_state(ufo,ENTITY_STATE_HOSTILE));
+		}
+		const particle_system& particles = scene.get_particles();
+		for(std::size_t i = 0;i < particles.size();++i)
+		{
+			SDL_FPoint position = particles.get_position(i);
+			SDL_FPoint direction = particles.get_direction(i);
+			entity_state state{};
+			state.id = particles.get_id(i);
+			state.prototype = prototype_id::destruction_fragment;
+			state.x = quantize_coordinate(position.x);
+			state.y = quantize_coordinate(position.y);
+			state.rotation = quantize_rotation(std::atan2(direction.y,direction.x));
+			add(state);
+		}
+		return count;
+	}
+
+	void encode_snapshot(const snapshot* baseline,const snapshot& current,std::vector<std::uint8_t>& output)
+	{
+		static const std::vector<entity_state> empty{};
+		const std::vector<entity_state>& previous = baseline ? baseline->entities : empty;
+
+		write_varint(output,current.tick);
+		write_varint(output,baseline ? (static_cast<std::uint64_t>(baseline->tick) + 1) : 0);
+		write_varint(output,current.points);
+
+		std::vector<std::uint32_t> removed{};
+		std::size_t changed_count = 0;
+		std::size_t i = 0;
+		std::size_t j = 0;
+		while(i < previous.size() || j < current.entities.size())
+		{
+			if(j >= current.entities.size() || (i < previous.size() && previous[i].id < current.entities[j].id))
+			{
+				removed.push_back(previous[i++].id);
+			}
+			else if(i >= previous.size() || current.entities[j].id < previous[i].id)
+			{
+				++changed_count;
+				++j;
+			}
+			else
+			{
+				const entity_state& a = previous[i++];
+				const entity_state& b = current.entities[j++];
+				if(a.prototype != b.prototype || a.flags != b.flags || a.x != b.x || a.y != b.y || a.rotation != b.rotation)
+				{
+					++changed_count;
+				}
+			}
+		}
+
+		write_varint(output,removed.size());
+		std::uint32_t last_id = 0;
+		for(std::uint32_t id : removed)
+		{
+			write_varint(output,id - last_id);
+			last_id = id;
+		}
+
+		write_varint(output,changed_count);
+		last_id = 0;
+		i = 0;
+		for(const auto& state : current.entities)
+		{
+			while(i < previous.size() && previous[i].id < state.id)
+			{
+				++i;
+			}
+			entity_state reference{};
+			reference.id = state.id;
+			if(i < previous.size() && previous[i].id == state.id)
+			{
+				reference = previous[i];
+			}
+
+			std::uint8_t mask = 0;
+			mask |= (reference.prototype != state.prototype) ? CHANGE_PROTOTYPE : 0;
+			mask |= (reference.flags != state.flags) ? CHANGE_FLAGS : 0;
+			mask |= (reference.x != state.x) ? CHANGE_X : 0;
+			mask |= (reference.y != state.y) ? CHANGE_Y : 0;
+			mask |= (reference.rotation != state.rotation) ? CHANGE_ROTATION : 0;
+			bool is_new = !(i < previous.size() && previous[i].id == state.id);
+			if(mask == 0 && !is_new)
+			{
+				continue;
+			}
+			if(is_new)
+			{
+				mask |= CHANGE_PROTOTYPE;
+			}
+
+			write_varint(output,state.id - last_id);
+			last_id = state.id;
+			output.push_back(mask);
+			if(mask & CHANGE_PROTOTYPE)
+			{
+				output.push_back(static_cast<std::uint8_t>(state.prototype));
+			}
+			if(mask & CHANGE_FLAGS)
+			{
+				output.push_back(state.flags);
+			}
+			if(mask & CHANGE_X)
+			{
+				write_zigzag(output,static_cast<std::int32_t>(state.x) - reference.x);
+			}
+			if(mask & CHANGE_Y)
+			{
+				write_zigzag(output,static_cast<std::int32_t>(state.y) - reference.y);
+			}
+			if(mask & CHANGE_ROTATION)
+			{
+				write_zigzag(output,static_cast<std::int16_t>(static_cast<std::uint16_t>(state.rotation - reference.rotation)));
+			}
+		}
+	}
+
+	bool read_snapshot_header(const std::uint8_t* data,std::size_t size,std::uint32_t& tick,std::uint32_t& baseline_tick,bool& has_baseline)
+	{
+		byte_reader reader{data,size};
+		return read_header(reader,tick,baseline_tick,has_baseline);
+	}
+
+	bool decode_snapshot(const snapshot* baseline,const std::uint8_t* data,std::size_t size,snapshot& output)
+	{
+		byte_reader reader{data,size};
+		std::uint32_t baseline_tick{};
+		bool has_baseline{};
+		std::uint64_t points{};
+		if(!read_header(reader,output.tick,baseline_tick,has_baseline) || !reader.read_varint(points))
+		{
+			return false;
+		}
+		if(has_baseline && (!baseline || baseline->tick != baseline_tick))
+		{
+			return false;
+		}
+		output.points = points;
+
+		std::uint64_t removed_count{};
+		if(!reader.read_varint(removed_count))
+		{
+			return false;
+		}
+		std::vector<std::uint32_t> removed{};
+		std::uint32_t last_id = 0;
+		for(std::uint64_t i = 0;i < removed_count;++i)
+		{
+			std::uint64_t delta{};
+			if(!reader.read_varint(delta))
+			{
+				return false;
+			}
+			last_id += static_cast<std::uint32_t>(delta);
+			removed.push_back(last_id);
+		}
+
+		std::uint64_t changed_count{};
+		if(!reader.read_varint(changed_count))
+		{
+			return false;
+		}
+
+		const std::vector<entity_state> empty{};
+		const std::vector<entity_state>& previous = has_baseline ? baseline->entities : empty;
+		std::vector<entity_state> entities{};
+		entities.reserve(previous.size() + static_cast<std::size_t>(std::min<std::uint64_t>(changed_count,size)));
+
+		std::size_t previous_index = 0;
+		std::size_t removed_index = 0;
+		auto copy_unchanged_until = [&](std::uint32_t id){
+			while(previous_index < previous.size() && previous[previous_index].id < id)
+			{
+				const entity_state& state = previous[previous_index++];
+				while(removed_index < removed.size() && removed[removed_index] < state.id)
+				{
+					++removed_index;
+				}
+				if(removed_index < removed.size() && removed[removed_index] == state.id)
+				{
+					continue;
+				}
+				entities.push_back(state);
+			}
+		};
+
+		last_id = 0;
+		for(std::uint64_t i = 0;i < changed_count;++i)
+		{
+			std::uint64_t delta{};
+			std::uint8_t mask{};
+			if(!reader.read_varint(delta) || !reader.read_u8(mask))
+			{
+				return false;
+			}
+			last_id += static_cast<std::uint32_t>(delta);
+			copy_unchanged_until(last_id);
+
+			entity_state state{};
+			state.id = last_id;
+			if(previous_index < previous.size() && previous[previous_index].id == last_id)
+			{
+				state = previous[previous_index++];
+			}
+
+			std::uint8_t byte{};
+			std::int32_t value{};
+			if(mask & CHANGE_PROTOTYPE)
+			{
+				if(!reader.read_u8(byte))
+				{
+					return false;
+				}
+				state.prototype = static_cast<prototype_id>(byte);
+			}
+			if(mask & CHANGE_FLAGS)
+			{
+				if(!reader.read_u8(state.flags))
+				{
+					return false;
+				}
+			}
+			if(mask & CHANGE_X)
+			{
+				if(!reader.read_zigzag(value))
+				{
+					return false;
+				}
+				state.x = static_cast<std::int16_t>(state.x + value);
+			}
+			if(mask & CHANGE_Y)
+			{
+				if(!reader.read_zigzag(value))
+				{
+					return false;
+				}
+				state.y = static_cast<std::int16_t>(state.y + value);
+			}
+			if(mask & CHANGE_ROTATION)
+			{
+				if(!reader.read_zigzag(value))
+				{
+					return false;
+				}
+				state.rotation = static_cast<std::uint16_t>(state.rotation + value);
+			}
+			entities.push_back(state);
+		}
+		copy_unchanged_until(std::numeric_limits<std::uint32_t>::max());
+
+		output.entities = std::move(entities);
+		return true;
+	}
+
+	snapshot interpolate_snapshots(const snapshot& from,const snapshot& to,float alpha)
+	{
+		snapshot result{};
+		result.tick = (alpha < 0.5f) ? from.tick : to.tick;
+		result.points = to.points;
+		result.entities.reserve(from.entities.size());
+
+		std::size_t j = 0;
+		for(const auto& a : from.entities)
+		{
+			while(j < to.entities.size() && to.entities[j].id < a.id)
+			{
+				++j;
+			}
+			if(j >= to.entities.size() || to.entities[j].id != a.id)
+			{
+				continue;
+			}
+			const entity_state& b = to.entities[j];
+			entity_state state = (alpha < 0.5f) ? a : b;
+			state.x = static_cast<std::int16_t>(std::lround(a.x + (b.x - a.x) * alpha));
+			state.y = static_cast<std::int16_t>(std::lround(a.y + (b.y - a.y) * alpha));
+			std::int16_t rotation_delta = static_cast<std::int16_t>(static_cast<std::uint16_t>(b.rotation - a.rotation));
+			state.rotation = static_cast<std::uint16_t>(a.rotation + static_cast<std::int32_t>(std::lround(rotation_delta * alpha)));
+			result.entities.push_back(state);
+		}
+		return result;
+	}
+
+	mesh make_entity_state_mesh(const entity_state& state)
+	{
+		mesh result = get_prototype_mesh(state.prototype);
+		result.position = state.get_position();
+		result.rotation = state.get_rotation();
+		result.update();
+		return result;
+	}
+}
\ No newline at end of file
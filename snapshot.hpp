@@ -0,0 +1,54 @@
+#ifndef ASTEROIDS_SNAPSHOT_HPP
+#define ASTEROIDS_SNAPSHOT_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "scene.hpp"
+#include "entities.hpp"
+
+namespace asteroids
+{
+	inline constexpr float SNAPSHOT_POSITION_SCALE = 16.0f;
+	inline constexpr std::uint32_t PLAYER_ENTITY_ID = 0;
+
+	enum entity_state_flags : std::uint8_t
+	{
+		ENTITY_STATE_INVULNERABLE = 1,
+		ENTITY_STATE_HOSTILE = 2,
+		ENTITY_STATE_DEAD = 4
+	};
+
+	struct entity_state
+	{
+		std::uint32_t id{};
+		prototype_id prototype{};
+		std::uint8_t flags{};
+		std::int16_t x{};
+		std::int16_t y{};
+		std::uint16_t rotation{};
+
+		SDL_FPoint get_position() const noexcept;
+		float get_rotation() const noexcept;
+	};
+
+	struct snapshot
+	{
+		std::uint32_t tick{};
+		std::uint64_t points{};
+		std::vector<entity_state> entities{};
+	};
+
+	snapshot capture_snapshot(const scene& scene,std::uint32_t tick);
+	//Writes the states of the player and every rock, projectile, UFO and particle in pool order, up to 'capacity' of them.
+	//Returns how many there are, which is more than were written when they don't fit.
+	std::size_t write_entity_states(const scene& scene,entity_state* output,std::size_t capacity);
+	//'baseline' may be null, the snapshot is then encoded in full.
+	void encode_snapshot(const snapshot* baseline,const snapshot& current,std::vector<std::uint8_t>& output);
+	bool read_snapshot_header(const std::uint8_t* data,std::size_t size,std::uint32_t& tick,std::uint32_t& baseline_tick,bool& has_baseline);
+	bool decode_snapshot(const snapshot* baseline,const std::uint8_t* data,std::size_t size,snapshot& output);
+	snapshot interpolate_snapshots(const snapshot& from,const snapshot& to,float alpha);
+	mesh make_entity_state_mesh(const entity_state& state);
+}
+
+#endif
\ No newline at end of file
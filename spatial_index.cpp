@@ -0,0 +1,457 @@
+#include "spatial_index.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr float GRID_LEFT = -SPATIAL_GRID_MARGIN;
+		constexpr float GRID_TOP = -SPATIAL_GRID_MARGIN;
+		constexpr float GRID_RIGHT = 1024 + SPATIAL_GRID_MARGIN;
+		constexpr float GRID_BOTTOM = 768 + SPATIAL_GRID_MARGIN;
+
+		constexpr float INVERSE_CELL_SIZE = 1.0f / SPATIAL_CELL_SIZE;
+
+		//Clamping before the conversion keeps it in range and makes truncation act like floor.
+		int get_column(float x) noexcept
+		{
+			return static_cast<int>(std::clamp((x - GRID_LEFT) * INVERSE_CELL_SIZE,0.0f,static_cast<float>(SPATIAL_GRID_COLUMNS - 1)));
+		}
+
+		int get_row(float y) noexcept
+		{
+			return static_cast<int>(std::clamp((y - GRID_TOP) * INVERSE_CELL_SIZE,0.0f,static_cast<float>(SPATIAL_GRID_ROWS - 1)));
+		}
+
+		float get_distance_to_bounds(SDL_FPoint point,const SDL_FRect& bounds) noexcept
+		{
+			float dx = std::max({bounds.x - point.x,0.0f,point.x - (bounds.x + bounds.w)});
+			float dy = std::max({bounds.y - point.y,0.0f,point.y - (bounds.y + bounds.h)});
+			return std::sqrt(dx * dx + dy * dy);
+		}
+
+		bool is_closer(const spatial_hit& a,const spatial_hit& b) noexcept
+		{
+			if(a.distance != b.distance)
+			{
+				return a.distance < b.distance;
+			}
+			if(a.layer != b.layer)
+			{
+				return a.layer < b.layer;
+			}
+			return a.handle.slot < b.handle.slot;
+		}
+
+		//Slab test of the ray against 'bounds', 'distance' is where the ray enters them (0 when it starts inside).
+		bool intersect_ray(SDL_FPoint origin,SDL_FPoint direction,float max_distance,const SDL_FRect& bounds,float& distance) noexcept
+		{
+			float enter = 0.0f;
+			float exit = max_distance;
+			auto clip_axis = [&](float start,float step,float min,float max){
+				if(step == 0.0f)
+				{
+					return start >= min && start <= max;
+				}
+				float near = (min - start) / step;
+				float far = (max - start) / step;
+				if(near > far)
+				{
+					std::swap(near,far);
+				}
+				enter = std::max(enter,near);
+				exit = std::min(exit,far);
+				return enter <= exit;
+			};
+			if(!clip_axis(origin.x,direction.x,bounds.x,bounds.x + bounds.w) || !clip_axis(origin.y,direction.y,bounds.y,bounds.y + bounds.h))
+			{
+				return false;
+			}
+			distance = enter;
+			return true;
+		}
+	}
+
+	template<typename F>
+	void spatial_index::for_each_entry(const cell_range& range,F&& function) const
+	{
+		for(int y = range.top;y <= range.bottom;++y)
+		{
+			for(int x = range.left;x <= range.right;++x)
+			{
+				for(const cell_link& link : cells[get_cell_index(x,y)])
+				{
+					//An entry is reported from the first cell it shares with the range only.
+					const entry& entry = entries[link.entry_index];
+					if(x == std::max(entry.cells.left,range.left) && y == std::max(entry.cells.top,range.top))
+					{
+						function(entry);
+					}
+				}
+			}
+		}
+		for(const cell_link& link : oversized_entries)
+		{
+			function(entries[link.entry_index]);
+		}
+	}
+
+	void spatial_index::clear() noexcept
+	{
+		entries.clear();
+		for(auto& slots : slot_entries)
+		{
+			slots.clear();
+		}
+		for(auto& cell : cells)
+		{
+			cell.clear();
+		}
+		oversized_entries.clear();
+		outside_grid_count = 0;
+	}
+
+	void spatial_index::reserve(std::size_t count)
+	{
+		entries.reserve(count);
+	}
+
+	void spatial_index::update(collision_layer layer,entity_handle handle,const SDL_FRect& bounds)
+	{
+		auto& slots = slot_entries[static_cast<std::size_t>(layer)];
+		if(handle.slot >= slots.size())
+		{
+			slots.resize(handle.slot + 1,0);
+		}
+		bool outside_grid = bounds.x < GRID_LEFT || bounds.y < GRID_TOP || (bounds.x + bounds.w) > GRID_RIGHT || (bounds.y + bounds.h) > GRID_BOTTOM;
+		cell_range range = get_cell_range(bounds);
+		std::uint32_t& slot = slots[handle.slot];
+		if(slot == 0)
+		{
+			entries.push_back({layer,handle,bounds,range,outside_grid,false,{}});
+			slot = static_cast<std::uint32_t>(entries.size());
+			link(slot - 1);
+			outside_grid_count += outside_grid ? 1 : 0;
+			return;
+		}
+
+		entry& current = entries[slot - 1];
+		current.handle = handle;
+		current.bounds = bounds;
+		outside_grid_count += (outside_grid ? 1 : 0) - (current.outside_grid ? 1 : 0);
+		current.outside_grid = outside_grid;
+		//Most entities move a few pixels per tick and stay in the same cells.
+		if(range.left != current.cells.left || range.top != current.cells.top || range.right != current.cells.right || range.bottom != current.cells.bottom)
+		{
+			unlink(slot - 1);
+			current.cells = range;
+			link(slot - 1);
+		}
+	}
+
+	bool spatial_index::remove(collision_layer layer,entity_handle handle)
+	{
+		std::uint32_t* slot = find_slot(layer,handle);
+		if(!slot || *slot == 0)
+		{
+			return false;
+		}
+		std::uint32_t index = *slot - 1;
+		std::uint32_t last_index = static_cast<std::uint32_t>(entries.size() - 1);
+		unlink(index);
+		outside_grid_count -= entries[index].outside_grid ? 1 : 0;
+		*slot = 0;
+		if(index != last_index)
+		{
+			//The last entry fills the hole, its cells and slot have to point at its new index.
+			unlink(last_index);
+			entries[index] = entries[last_index];
+			*find_slot(entries[index].layer,entries[index].handle) = index + 1;
+			entries.pop_back();
+			link(index);
+		}
+		else
+		{
+			entries.pop_back();
+		}
+		return true;
+	}
+
+	std::size_t spatial_index::size() const noexcept
+	{
+		return entries.size();
+	}
+
+	void spatial_index::query_rect(const SDL_FRect& rect,collision_mask layers,std::vector<spatial_hit>& output) const
+	{
+		for_each_entry(get_cell_range(rect),[&](const entry& entry){
+			if((layers & get_layer_bit(entry.layer)) != 0 &&
+				entry.bounds.x <= (rect.x + rect.w) && rect.x <= (entry.bounds.x + entry.bounds.w) &&
+				entry.bounds.y <= (rect.y + rect.h) && rect.y <= (entry.bounds.y + entry.bounds.h))
+			{
+				output.push_back({entry.layer,entry.handle,entry.bounds,0.0f});
+			}
+		});
+	}
+
+	void spatial_index::query_radius(SDL_FPoint center,float radius,collision_mask layers,std::vector<spatial_hit>& output) const
+	{
+		for_each_entry(get_cell_range({center.x - radius,center.y - radius,radius * 2,radius * 2}),[&](const entry& entry){
+			if((layers & get_layer_bit(entry.layer)) != 0 && get_distance_to_bounds(center,entry.bounds) <= radius)
+			{
+				output.push_back({entry.layer,entry.handle,entry.bounds,0.0f});
+			}
+		});
+	}
+
+	//Walks square rings of cells around the point and stops once the k-th best hit is closer than anything outside the rings walked so far.
+	void spatial_index::query_nearest(SDL_FPoint point,std::size_t count,collision_mask layers,std::vector<spatial_hit>& output) const
+	{
+		if(count == 0 || entries.empty())
+		{
+			return;
+		}
+		const std::size_t first = output.size();
+		const int column = get_column(point.x);
+		const int row = get_row(point.y);
+		auto consider = [&](const entry& entry){
+			if((layers & get_layer_bit(entry.layer)) == 0)
+			{
+				return;
+			}
+			spatial_hit hit{entry.layer,entry.handle,entry.bounds,get_distance_to_bounds(point,entry.bounds)};
+			if((output.size() - first) == count && !is_closer(hit,output.back()))
+			{
+				return;
+			}
+			//Entries spanning several rings are met more than once.
+			for(std::size_t i = first;i < output.size();++i)
+			{
+				if(output[i].layer == hit.layer && output[i].handle.slot == hit.handle.slot)
+				{
+					return;
+				}
+			}
+			auto position = std::upper_bound(output.begin() + static_cast<std::ptrdiff_t>(first),output.end(),hit,is_closer);
+			output.insert(position,hit);
+			if((output.size() - first) > count)
+			{
+				output.pop_back();
+			}
+		};
+
+		for(const cell_link& link : oversized_entries)
+		{
+			consider(entries[link.entry_index]);
+		}
+		for(int ring = 0;;++ring)
+		{
+			int left = column - ring;
+			int top = row - ring;
+			int right = column + ring;
+			int bottom = row + ring;
+			auto consider_cell = [&](int x,int y){
+				if(x >= 0 && x < SPATIAL_GRID_COLUMNS && y >= 0 && y < SPATIAL_GRID_ROWS)
+				{
+					for(const cell_link& link : cells[get_cell_index(x,y)])
+					{
+						consider(entries[link.entry_index]);
+					}
+				}
+			};
+			for(int x = left;x <= right;++x)
+			{
+				consider_cell(x,top);
+				if(bottom != top)
+				{
+					consider_cell(x,bottom);
+				}
+			}
+			for(int y = top + 1;y < bottom;++y)
+			{
+				consider_cell(left,y);
+				if(right != left)
+				{
+					consider_cell(right,y);
+				}
+			}
+			if(left <= 0 && top <= 0 && right >= (SPATIAL_GRID_COLUMNS - 1) && bottom >= (SPATIAL_GRID_ROWS - 1))
+			{
+				break;
+			}
+			if((output.size() - first) == count)
+			{
+				//Border cells also hold everything beyond the grid, so a side of the walked block at the grid border bounds nothing.
+				float bound = std::numeric_limits<float>::max();
+				if(left > 0)
+				{
+					bound = std::min(bound,point.x - (GRID_LEFT + static_cast<float>(left * SPATIAL_CELL_SIZE)));
+				}
+				if(top > 0)
+				{
+					bound = std::min(bound,point.y - (GRID_TOP + static_cast<float>(top * SPATIAL_CELL_SIZE)));
+				}
+				if(right < (SPATIAL_GRID_COLUMNS - 1))
+				{
+					bound = std::min(bound,(GRID_LEFT + static_cast<float>((right + 1) * SPATIAL_CELL_SIZE)) - point.x);
+				}
+				if(bottom < (SPATIAL_GRID_ROWS - 1))
+				{
+					bound = std::min(bound,(GRID_TOP + static_cast<float>((bottom + 1) * SPATIAL_CELL_SIZE)) - point.y);
+				}
+				if(bound >= output.back().distance)
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	//Steps through the cells the ray crosses (Amanatides-Woo) and stops once the best hit is nearer than the exit of the current cell.
+	bool spatial_index::raycast(SDL_FPoint origin,SDL_FPoint direction,float max_distance,collision_mask layers,spatial_hit& hit) const
+	{
+		float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+		if(length == 0.0f || max_distance < 0.0f || entries.empty())
+		{
+			return false;
+		}
+		direction = {direction.x / length,direction.y / length};
+
+		bool found = false;
+		auto consider = [&](const entry& entry){
+			float distance = 0.0f;
+			if((layers & get_layer_bit(entry.layer)) != 0 && intersect_ray(origin,direction,max_distance,entry.bounds,distance))
+			{
+				spatial_hit candidate{entry.layer,entry.handle,entry.bounds,distance};
+				if(!found || is_closer(candidate,hit))
+				{
+					hit = candidate;
+					found = true;
+				}
+			}
+		};
+
+		bool origin_inside = origin.x >= GRID_LEFT && origin.x <= GRID_RIGHT && origin.y >= GRID_TOP && origin.y <= GRID_BOTTOM;
+		if(outside_grid_count > 0 || !origin_inside)
+		{
+			//Hits beyond the grid can't be found by walking it, this case is rare enough to test every entry.
+			for(const auto& entry : entries)
+			{
+				consider(entry);
+			}
+			return found;
+		}
+		for(const cell_link& link : oversized_entries)
+		{
+			consider(entries[link.entry_index]);
+		}
+		int column = get_column(origin.x);
+		int row = get_row(origin.y);
+		const int step_x = (direction.x > 0.0f) ? 1 : ((direction.x < 0.0f) ? -1 : 0);
+		const int step_y = (direction.y > 0.0f) ? 1 : ((direction.y < 0.0f) ? -1 : 0);
+		const float infinity = std::numeric_limits<float>::infinity();
+		float next_x = (step_x == 0) ? infinity : ((GRID_LEFT + static_cast<float>((column + (step_x > 0 ? 1 : 0)) * SPATIAL_CELL_SIZE) - origin.x) / direction.x);
+		float next_y = (step_y == 0) ? infinity : ((GRID_TOP + static_cast<float>((row + (step_y > 0 ? 1 : 0)) * SPATIAL_CELL_SIZE) - origin.y) / direction.y);
+		const float delta_x = (step_x == 0) ? infinity : (SPATIAL_CELL_SIZE / std::abs(direction.x));
+		const float delta_y = (step_y == 0) ? infinity : (SPATIAL_CELL_SIZE / std::abs(direction.y));
+		while(true)
+		{
+			for(const cell_link& link : cells[get_cell_index(column,row)])
+			{
+				consider(entries[link.entry_index]);
+			}
+			float cell_exit = std::min(next_x,next_y);
+			if((found && hit.distance <= cell_exit) || cell_exit > max_distance)
+			{
+				break;
+			}
+			if(next_x < next_y)
+			{
+				column += step_x;
+				next_x += delta_x;
+			}
+			else
+			{
+				row += step_y;
+				next_y += delta_y;
+			}
+			if(column < 0 || column >= SPATIAL_GRID_COLUMNS || row < 0 || row >= SPATIAL_GRID_ROWS)
+			{
+				break;
+			}
+		}
+		return found;
+	}
+
+	spatial_index::cell_range spatial_index::get_cell_range(const SDL_FRect& bounds) noexcept
+	{
+		return {get_column(bounds.x),get_row(bounds.y),get_column(bounds.x + bounds.w),get_row(bounds.y + bounds.h)};
+	}
+
+	std::size_t spatial_index::get_cell_index(int column,int row) noexcept
+	{
+		return static_cast<std::size_t>(row * SPATIAL_GRID_COLUMNS + column);
+	}
+
+	std::uint32_t* spatial_index::find_slot(collision_layer layer,entity_handle handle) noexcept
+	{
+		auto& slots = slot_entries[static_cast<std::size_t>(layer)];
+		return (handle.slot < slots.size()) ? &slots[handle.slot] : nullptr;
+	}
+
+	void spatial_index::link(std::uint32_t entry_index)
+	{
+		entry& linked = entries[entry_index];
+		const cell_range& range = linked.cells;
+		linked.oversized = static_cast<std::size_t>((range.right - range.left + 1) * (range.bottom - range.top + 1)) > MAX_SPATIAL_ENTRY_CELLS;
+		if(linked.oversized)
+		{
+			linked.positions[0] = static_cast<std::uint32_t>(oversized_entries.size());
+			oversized_entries.push_back({entry_index,0});
+			return;
+		}
+		std::uint32_t position_index = 0;
+		for(int y = range.top;y <= range.bottom;++y)
+		{
+			for(int x = range.left;x <= range.right;++x)
+			{
+				auto& cell = cells[get_cell_index(x,y)];
+				linked.positions[position_index] = static_cast<std::uint32_t>(cell.size());
+				cell.push_back({entry_index,position_index});
+				position_index += 1;
+			}
+		}
+	}
+
+	void spatial_index::unlink(std::uint32_t entry_index)
+	{
+		//The last link of a cell fills the hole and its entry is told where it went.
+		auto remove_link = [this](std::vector<cell_link>& links,std::uint32_t position){
+			links[position] = links.back();
+			links.pop_back();
+			if(position < links.size())
+			{
+				entries[links[position].entry_index].positions[links[position].position_index] = position;
+			}
+		};
+		const entry& unlinked = entries[entry_index];
+		if(unlinked.oversized)
+		{
+			remove_link(oversized_entries,unlinked.positions[0]);
+			return;
+		}
+		const cell_range& range = unlinked.cells;
+		std::uint32_t position_index = 0;
+		for(int y = range.top;y <= range.bottom;++y)
+		{
+			for(int x = range.left;x <= range.right;++x)
+			{
+				remove_link(cells[get_cell_index(x,y)],unlinked.positions[position_index]);
+				position_index += 1;
+			}
+		}
+	}
+}
\ No newline at end of file
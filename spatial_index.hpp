@@ -0,0 +1,99 @@
+#ifndef ASTEROIDS_SPATIAL_INDEX_HPP
+#define ASTEROIDS_SPATIAL_INDEX_HPP
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <SDL_rect.h>
+#include "collision.hpp"
+#include "entity_pool.hpp"
+
+namespace asteroids
+{
+	inline constexpr int SPATIAL_CELL_SIZE = 64;
+	//Entities spawn and leave past the screen edges, the grid reaches this far beyond them. Anything farther lands in the border cells.
+	inline constexpr int SPATIAL_GRID_MARGIN = 128;
+	inline constexpr int SPATIAL_GRID_COLUMNS = (1024 + SPATIAL_GRID_MARGIN * 2) / SPATIAL_CELL_SIZE;
+	inline constexpr int SPATIAL_GRID_ROWS = (768 + SPATIAL_GRID_MARGIN * 2) / SPATIAL_CELL_SIZE;
+	//Entries covering more cells than this (bounds over 3 cells wide or tall) are kept in a separate list every query checks.
+	inline constexpr std::size_t MAX_SPATIAL_ENTRY_CELLS = 16;
+
+	//'distance' is how far the bounds are from the query point (nearest queries) or along the ray (raycasts), 0 for other queries.
+	struct spatial_hit
+	{
+		collision_layer layer;
+		entity_handle handle;
+		SDL_FRect bounds;
+		float distance;
+	};
+
+	//Uniform grid over the bounding boxes of the scene's entities. An entity is relinked only when it moves into different cells.
+	//Entities are identified by their layer and pool handle, the player is the only entry of its layer and uses a default handle.
+	class spatial_index
+	{
+	public:
+		void clear() noexcept;
+		//Inserts the entity or moves it to 'bounds'.
+		void update(collision_layer layer,entity_handle handle,const SDL_FRect& bounds);
+		bool remove(collision_layer layer,entity_handle handle);
+		std::size_t size() const noexcept;
+		//Room for 'count' entries, so rebuilding the index over a whole scene doesn't grow it entity by entity.
+		void reserve(std::size_t count);
+
+		//Queries only return entities whose layer is in 'layers', results are appended to 'output'.
+		void query_rect(const SDL_FRect& rect,collision_mask layers,std::vector<spatial_hit>& output) const;
+		void query_radius(SDL_FPoint center,float radius,collision_mask layers,std::vector<spatial_hit>& output) const;
+		//Up to 'count' entities closest to 'point', nearest first. Ties are broken by layer and handle, so the result is deterministic.
+		void query_nearest(SDL_FPoint point,std::size_t count,collision_mask layers,std::vector<spatial_hit>& output) const;
+		//First bounding box 'direction' hits from 'origin' within 'max_distance' pixels, 'direction' doesn't need to be normalized.
+		bool raycast(SDL_FPoint origin,SDL_FPoint direction,float max_distance,collision_mask layers,spatial_hit& hit) const;
+	private:
+		//Inclusive cell coordinates.
+		struct cell_range
+		{
+			int left;
+			int top;
+			int right;
+			int bottom;
+		};
+
+		struct entry
+		{
+			collision_layer layer;
+			entity_handle handle;
+			SDL_FRect bounds;
+			cell_range cells;
+			//The bounds reach past the grid, only possible for entities far off screen.
+			bool outside_grid;
+			bool oversized;
+			//Where the entry sits in each of its cells (row by row), or in 'oversized_entries', so unlinking never searches.
+			std::array<std::uint32_t,MAX_SPATIAL_ENTRY_CELLS> positions;
+		};
+
+		struct cell_link
+		{
+			std::uint32_t entry_index;
+			std::uint32_t position_index;
+		};
+
+		static cell_range get_cell_range(const SDL_FRect& bounds) noexcept;
+		static std::size_t get_cell_index(int column,int row) noexcept;
+		std::uint32_t* find_slot(collision_layer layer,entity_handle handle) noexcept;
+		void link(std::uint32_t entry_index);
+		void unlink(std::uint32_t entry_index);
+		//Calls 'function' once per entry linked to a cell of 'range', even for entries spanning several of them, and once per oversized entry.
+		template<typename F>
+		void for_each_entry(const cell_range& range,F&& function) const;
+
+		std::vector<entry> entries{};
+		//Index of the entry + 1 for every pool slot of every layer, 0 when the slot isn't indexed.
+		std::array<std::vector<std::uint32_t>,COLLISION_LAYER_COUNT> slot_entries{};
+		std::array<std::vector<cell_link>,static_cast<std::size_t>(SPATIAL_GRID_COLUMNS * SPATIAL_GRID_ROWS)> cells{};
+		std::vector<cell_link> oversized_entries{};
+		//Raycasts can only walk the grid when no entry is outside it.
+		std::size_t outside_grid_count{};
+	};
+}
+
+#endif
\ No newline at end of file
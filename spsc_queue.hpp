@@ -0,0 +1,89 @@
+#ifndef ASTEROIDS_SPSC_QUEUE_HPP
+#define ASTEROIDS_SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+namespace asteroids
+{
+	//Bounded queue for exactly one producer thread and one consumer thread. Both ends are wait-free: a push into a full queue
+	//or a pop from an empty one fails immediately instead of blocking, and nothing is allocated after construction.
+	template<typename T,std::size_t Capacity>
+	class spsc_queue
+	{
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,"Capacity has to be a power of two.");
+		static_assert(std::is_trivially_copyable_v<T>);
+	public:
+		//Producer side.
+		bool try_push(const T& value) noexcept
+		{
+			std::size_t tail = write_index.load(std::memory_order_relaxed);
+			if((tail - cached_read_index) == Capacity)
+			{
+				cached_read_index = read_index.load(std::memory_order_acquire);
+				if((tail - cached_read_index) == Capacity)
+				{
+					dropped_count += 1;
+					return false;
+				}
+			}
+			values[tail & (Capacity - 1)] = value;
+			write_index.store(tail + 1,std::memory_order_release);
+			return true;
+		}
+
+		//Consumer side.
+		bool try_pop(T& value) noexcept
+		{
+			std::size_t head = read_index.load(std::memory_order_relaxed);
+			if(head == cached_write_index)
+			{
+				cached_write_index = write_index.load(std::memory_order_acquire);
+				if(head == cached_write_index)
+				{
+					return false;
+				}
+			}
+			value = values[head & (Capacity - 1)];
+			read_index.store(head + 1,std::memory_order_release);
+			return true;
+		}
+
+		//Only meaningful on the producer thread.
+		std::uint64_t get_dropped_count() const noexcept
+		{
+			return dropped_count;
+		}
+
+		static constexpr std::size_t get_capacity() noexcept
+		{
+			return Capacity;
+		}
+
+	private:
+		//Each index shares a cache line only with the copy of the other index its own thread keeps, so the threads don't false share.
+		alignas(64) std::atomic<std::size_t> write_index{};
+		std::size_t cached_read_index{};
+		std::uint64_t dropped_count{};
+		alignas(64) std::atomic<std::size_t> read_index{};
+		std::size_t cached_write_index{};
+		alignas(64) std::array<T,Capacity> values{};
+	};
+
+	enum class sound_effect : std::uint8_t
+	{
+		shot,
+		rock_break,
+		ufo_kill,
+		player_death
+	};
+
+	inline constexpr std::size_t SOUND_EFFECT_COUNT = 4;
+
+	using sound_event_queue = spsc_queue<sound_effect,256>;
+}
+
+#endif
\ No newline at end of file
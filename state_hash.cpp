@@ -0,0 +1,357 @@
+#include "state_hash.hpp"
+
+#include <iomanip>
+#include <iterator>
+#include <algorithm>
+#include "serialization.hpp"
+
+namespace asteroids
+{
+	namespace
+	{
+		constexpr char STATE_HASH_LOG_MAGIC[8] = {'A','S','T','R','H','S','H','1'};
+		constexpr std::uint32_t STATE_HASH_LOG_VERSION = 1;
+		constexpr std::size_t STATE_HASH_LOG_FLUSH_SIZE = 64 * 1024;
+		//Entities listed for the first divergent tick, the rest are only counted.
+		constexpr std::size_t MAX_REPORTED_ENTITIES = 32;
+
+		struct tick_record
+		{
+			std::uint64_t tick{};
+			state_hash_array parts{};
+			std::vector<entity_hash_record> entities{};
+		};
+
+		struct log_file
+		{
+			std::vector<std::uint8_t> data{};
+			bool detailed{};
+		};
+
+		bool by_part_and_id(const entity_hash_record& a,const entity_hash_record& b) noexcept
+		{
+			return (a.part != b.part) ? (a.part < b.part) : (a.id < b.id);
+		}
+
+		bool read_log(const std::string& path,log_file& output,std::size_t& header_size)
+		{
+			std::ifstream file{path,std::ios::binary};
+			if(!file)
+			{
+				return false;
+			}
+			output.data.assign(std::istreambuf_iterator<char>{file},std::istreambuf_iterator<char>{});
+			binary_reader reader{output.data.data(),output.data.size()};
+			char magic[sizeof(STATE_HASH_LOG_MAGIC)]{};
+			std::uint32_t version{};
+			std::uint8_t detailed{};
+			if(!reader.read_bytes(magic,sizeof(magic)) || std::memcmp(magic,STATE_HASH_LOG_MAGIC,sizeof(magic)) != 0 ||
+				!reader.read(version) || version != STATE_HASH_LOG_VERSION || !reader.read(detailed) || detailed > 1)
+			{
+				return false;
+			}
+			output.detailed = detailed != 0;
+			header_size = output.data.size() - reader.get_remaining();
+			return true;
+		}
+
+		bool read_tick(binary_reader& reader,bool detailed,tick_record& record)
+		{
+			if(!reader.read(record.tick))
+			{
+				return false;
+			}
+			for(auto& part : record.parts)
+			{
+				if(!reader.read(part))
+				{
+					return false;
+				}
+			}
+			record.entities.clear();
+			if(!detailed)
+			{
+				return true;
+			}
+			std::uint32_t count{};
+			if(!reader.read(count) || count > reader.get_remaining() / (sizeof(std::uint8_t) + sizeof(std::uint32_t) + sizeof(std::uint64_t)))
+			{
+				return false;
+			}
+			record.entities.resize(count);
+			for(auto& entity : record.entities)
+			{
+				if(!reader.read(entity.part) || !reader.read(entity.id) || !reader.read(entity.hash) || static_cast<std::size_t>(entity.part) >= STATE_HASH_PART_COUNT)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void write_hash(std::ostream& log,std::uint64_t hash)
+		{
+			log << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec << std::setfill(' ');
+		}
+
+		//Both lists are sorted by part and id, one merge walk pairs up the entities of both runs.
+		void report_entities(const tick_record& a,const tick_record& b,std::ostream& log)
+		{
+			std::size_t reported = 0;
+			std::size_t different = 0;
+			auto report = [&](const entity_hash_record& entity,const entity_hash_record* a_entity,const entity_hash_record* b_entity){
+				different += 1;
+				if(reported == MAX_REPORTED_ENTITIES)
+				{
+					return;
+				}
+				reported += 1;
+				log << "  " << get_state_hash_part_name(entity.part) << " id " << entity.id << ": ";
+				if(a_entity && b_entity)
+				{
+					log << "a ";
+					write_hash(log,a_entity->hash);
+					log << " b ";
+					write_hash(log,b_entity->hash);
+				}
+				else
+				{
+					log << (a_entity ? "only in a" : "only in b");
+				}
+				log << std::endl;
+			};
+			std::size_t i = 0;
+			std::size_t j = 0;
+			while(i < a.entities.size() || j < b.entities.size())
+			{
+				if(j == b.entities.size() || (i < a.entities.size() && by_part_and_id(a.entities[i],b.entities[j])))
+				{
+					report(a.entities[i],&a.entities[i],nullptr);
+					i += 1;
+				}
+				else if(i == a.entities.size() || by_part_and_id(b.entities[j],a.entities[i]))
+				{
+					report(b.entities[j],nullptr,&b.entities[j]);
+					j += 1;
+				}
+				else
+				{
+					if(a.entities[i].hash != b.entities[j].hash)
+					{
+						report(a.entities[i],&a.entities[i],&b.entities[j]);
+					}
+					i += 1;
+					j += 1;
+				}
+			}
+			if(different > reported)
+			{
+				log << "  ... and " << (different - reported) << " more entities." << std::endl;
+			}
+			else if(different == 0)
+			{
+				log << "  Every entity matches." << std::endl;
+			}
+		}
+	}
+
+	std::uint64_t combine_state_hashes(const state_hash_array& parts) noexcept
+	{
+		std::uint64_t hash = STATE_HASH_SEED;
+		for(std::uint64_t part : parts)
+		{
+			hash = hash_combine(hash,part);
+		}
+		return hash;
+	}
+
+	void entity_state_hash::clear() noexcept
+	{
+		slot_hashes.clear();
+		combined = 0;
+	}
+
+	void entity_state_hash::update(entity_handle handle,std::uint64_t hash)
+	{
+		if(handle.slot >= slot_hashes.size())
+		{
+			slot_hashes.resize(handle.slot + 1,0);
+		}
+		hash = (hash == 0) ? 1 : hash;
+		combined ^= slot_hashes[handle.slot] ^ hash;
+		slot_hashes[handle.slot] = hash;
+	}
+
+	void entity_state_hash::remove(entity_handle handle) noexcept
+	{
+		if(handle.slot < slot_hashes.size())
+		{
+			combined ^= slot_hashes[handle.slot];
+			slot_hashes[handle.slot] = 0;
+		}
+	}
+
+	std::uint64_t entity_state_hash::get(entity_handle handle) const noexcept
+	{
+		return (handle.slot < slot_hashes.size()) ? slot_hashes[handle.slot] : 0;
+	}
+
+	std::uint64_t entity_state_hash::get_combined() const noexcept
+	{
+		return combined;
+	}
+
+	state_hash_log_writer::~state_hash_log_writer()
+	{
+		close();
+	}
+
+	bool state_hash_log_writer::open(const std::string& path,bool _detailed)
+	{
+		close();
+		file.open(path,std::ios::binary | std::ios::trunc);
+		if(!file)
+		{
+			return false;
+		}
+		detailed = _detailed;
+		buffer.clear();
+		binary_writer writer{buffer};
+		writer.write_bytes(STATE_HASH_LOG_MAGIC,sizeof(STATE_HASH_LOG_MAGIC));
+		writer.write(STATE_HASH_LOG_VERSION);
+		writer.write(static_cast<std::uint8_t>(detailed));
+		flush();
+		return static_cast<bool>(file);
+	}
+
+	void state_hash_log_writer::write_tick(std::uint64_t tick,const state_hash_array& parts,const std::vector<entity_hash_record>& entities)
+	{
+		if(!file.is_open())
+		{
+			return;
+		}
+		binary_writer writer{buffer};
+		writer.write(tick);
+		for(std::uint64_t part : parts)
+		{
+			writer.write(part);
+		}
+		if(detailed)
+		{
+			//Sorted, so the diff can pair up the entities of two runs in one walk.
+			sorted_entities.assign(entities.begin(),entities.end());
+			std::sort(sorted_entities.begin(),sorted_entities.end(),by_part_and_id);
+			writer.write(static_cast<std::uint32_t>(sorted_entities.size()));
+			for(const auto& entity : sorted_entities)
+			{
+				writer.write(entity.part);
+				writer.write(entity.id);
+				writer.write(entity.hash);
+			}
+		}
+		if(buffer.size() >= STATE_HASH_LOG_FLUSH_SIZE)
+		{
+			flush();
+		}
+	}
+
+	bool state_hash_log_writer::close()
+	{
+		if(!file.is_open())
+		{
+			return true;
+		}
+		flush();
+		bool written = static_cast<bool>(file);
+		file.close();
+		return written;
+	}
+
+	bool state_hash_log_writer::is_open() const noexcept
+	{
+		return file.is_open();
+	}
+
+	bool state_hash_log_writer::is_detailed() const noexcept
+	{
+		return detailed;
+	}
+
+	void state_hash_log_writer::flush()
+	{
+		file.write(reinterpret_cast<const char*>(buffer.data()),static_cast<std::streamsize>(buffer.size()));
+		buffer.clear();
+	}
+
+	int diff_state_hash_logs(const std::string& path_a,const std::string& path_b,std::ostream& log)
+	{
+		log_file a{};
+		log_file b{};
+		std::size_t a_header_size = 0;
+		std::size_t b_header_size = 0;
+		if(!read_log(path_a,a,a_header_size))
+		{
+			log << "Couldn't read state hash log " << path_a << "." << std::endl;
+			return 2;
+		}
+		if(!read_log(path_b,b,b_header_size))
+		{
+			log << "Couldn't read state hash log " << path_b << "." << std::endl;
+			return 2;
+		}
+		binary_reader a_reader{a.data.data() + a_header_size,a.data.size() - a_header_size};
+		binary_reader b_reader{b.data.data() + b_header_size,b.data.size() - b_header_size};
+		tick_record a_tick{};
+		tick_record b_tick{};
+		std::uint64_t compared = 0;
+		while(true)
+		{
+			bool a_read = a_reader.get_remaining() > 0 && read_tick(a_reader,a.detailed,a_tick);
+			bool b_read = b_reader.get_remaining() > 0 && read_tick(b_reader,b.detailed,b_tick);
+			if(!a_read || !b_read)
+			{
+				break;
+			}
+			if(a_tick.tick == b_tick.tick && a_tick.parts == b_tick.parts)
+			{
+				compared += 1;
+				continue;
+			}
+			if(a_tick.tick != b_tick.tick)
+			{
+				log << "Record " << compared << " is tick " << a_tick.tick << " in a but tick " << b_tick.tick << " in b." << std::endl;
+				return 1;
+			}
+			log << "First divergence at tick " << a_tick.tick << " after " << compared << " matching ticks." << std::endl;
+			for(std::size_t i = 0;i < STATE_HASH_PART_COUNT;++i)
+			{
+				if(a_tick.parts[i] != b_tick.parts[i])
+				{
+					log << "  " << get_state_hash_part_name(static_cast<state_hash_part>(i)) << ": a ";
+					write_hash(log,a_tick.parts[i]);
+					log << " b ";
+					write_hash(log,b_tick.parts[i]);
+					log << std::endl;
+				}
+			}
+			if(a.detailed && b.detailed)
+			{
+				report_entities(a_tick,b_tick,log);
+			}
+			else
+			{
+				log << "  Record both runs with detailed logs to see which entities differ." << std::endl;
+			}
+			return 1;
+		}
+		if(a_reader.get_remaining() > 0 || b_reader.get_remaining() > 0)
+		{
+			log << "Logs agree on the " << compared << " ticks both cover, " << ((a_reader.get_remaining() > 0) ? path_a : path_b) << " is longer or truncated." << std::endl;
+		}
+		else
+		{
+			log << "Logs agree on all " << compared << " ticks." << std::endl;
+		}
+		return 0;
+	}
+}
\ No newline at end of file
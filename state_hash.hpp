@@ -0,0 +1,131 @@
+#ifndef ASTEROIDS_STATE_HASH_HPP
+#define ASTEROIDS_STATE_HASH_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <type_traits>
+#include <SDL_rect.h>
+#include "fixed_point.hpp"
+#include "entity_pool.hpp"
+
+namespace asteroids
+{
+	inline constexpr std::uint64_t STATE_HASH_SEED = 0x243F6A8885A308D3ull;
+
+	//One multiply-xorshift round per word, a few cycles per field and enough to tell two states apart.
+	constexpr std::uint64_t hash_combine(std::uint64_t hash,std::uint64_t value) noexcept
+	{
+		hash = (hash ^ value) * 0x9E3779B97F4A7C15ull;
+		return hash ^ (hash >> 29);
+	}
+
+	//Scalars are hashed by their bits, so -0.0f and 0.0f or two NaNs with different payloads count as different states.
+	template<typename T>
+	std::uint64_t hash_value(std::uint64_t hash,const T& value) noexcept
+	{
+		static_assert((std::is_arithmetic_v<T> || std::is_enum_v<T>) && sizeof(T) <= sizeof(std::uint64_t));
+		std::uint64_t bits{};
+		std::memcpy(&bits,&value,sizeof(T));
+		return hash_combine(hash,bits);
+	}
+
+	inline std::uint64_t hash_value(std::uint64_t hash,const SDL_FPoint& value) noexcept
+	{
+		return hash_value(hash_value(hash,value.x),value.y);
+	}
+
+	inline std::uint64_t hash_value(std::uint64_t hash,const fixed_vector& value) noexcept
+	{
+		return hash_value(hash_value(hash,value.x),value.y);
+	}
+
+	inline std::uint64_t hash_value(std::uint64_t hash,const entity_handle& value) noexcept
+	{
+		return hash_value(hash_value(hash,value.slot),value.generation);
+	}
+
+	//Parts of the scene hashed separately, so a divergence can be narrowed down to one of them.
+	enum class state_hash_part : std::uint8_t
+	{
+		rng,
+		player,
+		rocks,
+		projectiles,
+		ufos,
+		timers
+	};
+
+	inline constexpr std::size_t STATE_HASH_PART_COUNT = 6;
+
+	constexpr const char* get_state_hash_part_name(state_hash_part part) noexcept
+	{
+		constexpr std::array<const char*,STATE_HASH_PART_COUNT> NAMES{"rng","player","rocks","projectiles","ufos","timers"};
+		return NAMES[static_cast<std::size_t>(part)];
+	}
+
+	using state_hash_array = std::array<std::uint64_t,STATE_HASH_PART_COUNT>;
+
+	std::uint64_t combine_state_hashes(const state_hash_array& parts) noexcept;
+
+	//XOR of one hash per live entity of a pool, kept per pool slot so the old hash of an entity can be taken out again
+	//when it changes or goes away. Updating one entity is O(1) whatever the pool size.
+	class entity_state_hash
+	{
+	public:
+		void clear() noexcept;
+		void update(entity_handle handle,std::uint64_t hash);
+		void remove(entity_handle handle) noexcept;
+		std::uint64_t get(entity_handle handle) const noexcept;
+		std::uint64_t get_combined() const noexcept;
+
+	private:
+		//0 marks an empty slot, a hash that happens to be 0 is stored as 1.
+		std::vector<std::uint64_t> slot_hashes{};
+		std::uint64_t combined{};
+	};
+
+	struct entity_hash_record
+	{
+		state_hash_part part;
+		std::uint32_t id;
+		std::uint64_t hash;
+	};
+
+	//Per tick hashes of a run, two logs of the same input are compared with diff_state_hash_logs().
+	//A detailed log also lists the hash of every entity, so a divergence can be traced to the entities involved.
+	class state_hash_log_writer
+	{
+	public:
+		state_hash_log_writer() = default;
+		state_hash_log_writer(const state_hash_log_writer&) = delete;
+		state_hash_log_writer& operator = (const state_hash_log_writer&) = delete;
+		~state_hash_log_writer();
+
+		bool open(const std::string& path,bool _detailed);
+		//'entities' is only written to detailed logs.
+		void write_tick(std::uint64_t tick,const state_hash_array& parts,const std::vector<entity_hash_record>& entities);
+		bool close();
+		bool is_open() const noexcept;
+		bool is_detailed() const noexcept;
+
+	private:
+		void flush();
+
+		std::ofstream file{};
+		bool detailed{};
+		std::vector<std::uint8_t> buffer{};
+		std::vector<entity_hash_record> sorted_entities{};
+	};
+
+	//Reports the first tick at which the logs differ, which parts differ and, for detailed logs, which entities.
+	//Returns 0 when the logs agree on every tick both cover, 1 when they diverge and 2 when one can't be read.
+	int diff_state_hash_logs(const std::string& path_a,const std::string& path_b,std::ostream& log);
+}
+
+#endif
\ No newline at end of file
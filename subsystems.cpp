@@ -0,0 +1,87 @@
+#include "subsystems.hpp"
+
+#include <iomanip>
+#include <SDL_image.h>
+
+namespace asteroids
+{
+	namespace
+	{
+		bool image_library_initialized = false;
+
+		double counter_to_milliseconds(Uint64 counter)
+		{
+			return static_cast<double>(counter) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+		}
+	}
+
+	startup_profiler::startup_profiler() : start_counter(SDL_GetPerformanceCounter())
+	{
+		last_counter = start_counter;
+	}
+
+	void startup_profiler::mark(const char* phase)
+	{
+		Uint64 counter = SDL_GetPerformanceCounter();
+		phases.push_back(phase_timing{phase,counter_to_milliseconds(counter - last_counter)});
+		last_counter = counter;
+	}
+
+	double startup_profiler::get_elapsed_milliseconds() const
+	{
+		return counter_to_milliseconds(last_counter - start_counter);
+	}
+
+	void startup_profiler::report(std::ostream& stream,double target_milliseconds) const
+	{
+		stream << "Startup phases:" << std::endl;
+		for(const auto& phase : phases)
+		{
+			stream << "  " << std::left << std::setw(24) << phase.name << std::right << std::fixed << std::setprecision(3) << phase.milliseconds << " ms" << std::endl;
+		}
+		double total = get_elapsed_milliseconds();
+		stream << "Launch to first present: " << std::fixed << std::setprecision(3) << total << " ms (target " << target_milliseconds << " ms, "
+				<< ((total <= target_milliseconds) ? "met" : "exceeded") << ")" << std::endl;
+		stream.unsetf(std::ios_base::floatfield);
+	}
+
+	bool require_subsystems(Uint32 flags)
+	{
+		if(SDL_WasInit(flags) == flags)
+		{
+			return true;
+		}
+		return SDL_InitSubSystem(flags) == 0;
+	}
+
+	bool require_image_library()
+	{
+		if(!image_library_initialized)
+		{
+			image_library_initialized = (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != 0;
+		}
+		return image_library_initialized;
+	}
+
+	std::string get_preference_path()
+	{
+		char* path = SDL_GetPrefPath("TheHyper45","Asteroids Clone");
+		if(!path)
+		{
+			return {};
+		}
+		std::string result{path};
+		SDL_free(path);
+		return result;
+	}
+
+	void shutdown_subsystems()
+	{
+		if(image_library_initialized)
+		{
+			IMG_Quit();
+			image_library_initialized = false;
+		}
+		SDL_Quit();
+	}
+}
\ No newline at end of file
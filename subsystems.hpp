@@ -0,0 +1,39 @@
+#ifndef ASTEROIDS_SUBSYSTEMS_HPP
+#define ASTEROIDS_SUBSYSTEMS_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <SDL.h>
+
+namespace asteroids
+{
+	class startup_profiler
+	{
+	public:
+		startup_profiler();
+
+		void mark(const char* phase);
+		double get_elapsed_milliseconds() const;
+		void report(std::ostream& stream,double target_milliseconds) const;
+
+	private:
+		struct phase_timing
+		{
+			const char* name;
+			double milliseconds;
+		};
+
+		Uint64 start_counter{};
+		Uint64 last_counter{};
+		std::vector<phase_timing> phases{};
+	};
+
+	bool require_subsystems(Uint32 flags);
+	bool require_image_library();
+	//Per-user directory for files the game keeps between runs, ending in a path separator. Empty when SDL can't provide one.
+	std::string get_preference_path();
+	void shutdown_subsystems();
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "texture_atlas.hpp"
+
+#include <cmath>
+#include <vector>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <SDL_image.h>
+#include "scene.hpp"
+#include "utility.hpp"
+#include "state_hash.hpp"
+#include "subsystems.hpp"
+
+namespace asteroids
+{
+	namespace
+	{
+		//Part of the cache file name, bump it when the way sprites are rasterized changes.
+		constexpr std::uint32_t ATLAS_VERSION = 1;
+		constexpr float ATLAS_ROTATION_STEP = CONSTANT_PI * 2.0f / static_cast<float>(ATLAS_ROTATIONS);
+
+		constexpr std::size_t get_prototype_index(prototype_id prototype) noexcept
+		{
+			return static_cast<std::size_t>(prototype);
+		}
+
+		bool is_drawn_prototype(std::size_t index) noexcept
+		{
+			return index != get_prototype_index(prototype_id::none) && index < ATLAS_PROTOTYPE_COUNT;
+		}
+	}
+
+	texture_atlas::~texture_atlas()
+	{
+		destroy();
+	}
+
+	bool texture_atlas::create(SDL_Renderer* renderer,const std::string& cache_directory,std::ostream& log)
+	{
+		destroy();
+		Uint64 start = SDL_GetPerformanceCounter();
+		SDL_RendererInfo info{};
+		int max_width = ATLAS_MAX_WIDTH;
+		int max_height = ATLAS_MAX_WIDTH * 2;
+		//0 means the renderer has no limit, the software renderer reports that.
+		if(SDL_GetRendererInfo(renderer,&info) == 0 && info.max_texture_width > 0 && info.max_texture_height > 0)
+		{
+			max_width = std::min(max_width,info.max_texture_width);
+			max_height = std::min(max_height,info.max_texture_height);
+		}
+		if(!layout(max_width,max_height))
+		{
+			log << "The texture atlas doesn't fit into a " << max_width << "x" << max_height << " texture." << std::endl;
+			return false;
+		}
+
+		std::string cache_path = cache_directory.empty() ? std::string{} : get_cache_path(cache_directory);
+		bool cached = false;
+		SDL_Surface* surface = nullptr;
+		if(!cache_path.empty() && require_image_library())
+		{
+			surface = IMG_Load(cache_path.c_str());
+			if(surface && (surface->w != width || surface->h != height))
+			{
+				SDL_FreeSurface(surface);
+				surface = nullptr;
+			}
+			cached = surface != nullptr;
+		}
+		if(!surface)
+		{
+			surface = rasterize();
+			if(!surface)
+			{
+				log << "Couldn't rasterize the texture atlas: " << SDL_GetError() << std::endl;
+				return false;
+			}
+			if(!cache_path.empty() && (!require_image_library() || IMG_SavePNG(surface,cache_path.c_str()) != 0))
+			{
+				log << "Couldn't cache the texture atlas in " << cache_path << "." << std::endl;
+			}
+		}
+		texture = SDL_CreateTextureFromSurface(renderer,surface);
+		SDL_FreeSurface(surface);
+		if(!texture)
+		{
+			log << "Couldn't create the texture atlas: " << SDL_GetError() << std::endl;
+			return false;
+		}
+		SDL_SetTextureBlendMode(texture,SDL_BLENDMODE_BLEND);
+		double milliseconds = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+		log << "Texture atlas (" << width << "x" << height << ") " << (cached ? "loaded from " + cache_path : std::string{"rasterized"}) << " in "
+			<< std::fixed << std::setprecision(3) << milliseconds << " ms." << std::endl;
+		log.unsetf(std::ios_base::floatfield);
+		return true;
+	}
+
+	void texture_atlas::destroy() noexcept
+	{
+		if(texture)
+		{
+			SDL_DestroyTexture(texture);
+			texture = nullptr;
+		}
+	}
+
+	bool texture_atlas::is_created() const noexcept
+	{
+		return texture != nullptr;
+	}
+
+	bool texture_atlas::draw(SDL_Renderer* renderer,prototype_id prototype,SDL_FPoint position,float rotation,SDL_Color color) const
+	{
+		std::size_t index = get_prototype_index(prototype);
+		if(!texture || !is_drawn_prototype(index))
+		{
+			return false;
+		}
+		const sprite_block& block = blocks[index];
+		long step = std::lround(rotation / ATLAS_ROTATION_STEP);
+		float remaining_rotation = rotation - static_cast<float>(step) * ATLAS_ROTATION_STEP;
+		auto cell = static_cast<std::size_t>(((step % static_cast<long>(ATLAS_ROTATIONS)) + static_cast<long>(ATLAS_ROTATIONS)) % static_cast<long>(ATLAS_ROTATIONS));
+		SDL_Rect source{block.x + static_cast<int>(cell % ATLAS_COLUMNS) * block.cell_size,block.y + static_cast<int>(cell / ATLAS_COLUMNS) * block.cell_size,block.cell_size,block.cell_size};
+		float half_size = static_cast<float>(block.cell_size) * 0.5f;
+		SDL_FRect destination{position.x - half_size,position.y - half_size,static_cast<float>(block.cell_size),static_cast<float>(block.cell_size)};
+		SDL_SetTextureColorMod(texture,color.r,color.g,color.b);
+		SDL_SetTextureAlphaMod(texture,color.a);
+		//Both the meshes and SDL turn clockwise on screen, SDL takes degrees and turns around the destination's center.
+		return SDL_RenderCopyExF(renderer,texture,&source,&destination,remaining_rotation * 180.0f / CONSTANT_PI,nullptr,SDL_FLIP_NONE) == 0;
+	}
+
+	bool texture_atlas::layout(int max_width,int max_height)
+	{
+		constexpr int ROWS = static_cast<int>((ATLAS_ROTATIONS + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS);
+		std::vector<std::size_t> order{};
+		for(std::size_t i = 0;i < ATLAS_PROTOTYPE_COUNT;++i)
+		{
+			if(!is_drawn_prototype(i))
+			{
+				continue;
+			}
+			float radius = 0.0f;
+			for(const auto& vertex : get_prototype_mesh(static_cast<prototype_id>(i)).get_vertices())
+			{
+				radius = std::max(radius,std::sqrt(vertex.x * vertex.x + vertex.y * vertex.y));
+			}
+			//Two pixels of margin keep the lines of neighbouring cells from bleeding into each other when sprites are turned.
+			blocks[i] = {0,0,static_cast<int>(std::ceil(radius)) * 2 + 4};
+			order.push_back(i);
+		}
+		//Shelf packing, tallest blocks first.
+		std::sort(order.begin(),order.end(),[this](std::size_t a,std::size_t b){ return blocks[a].cell_size > blocks[b].cell_size; });
+		int shelf_x = 0;
+		int shelf_y = 0;
+		int shelf_height = 0;
+		width = 0;
+		for(std::size_t index : order)
+		{
+			sprite_block& block = blocks[index];
+			int block_width = block.cell_size * static_cast<int>(ATLAS_COLUMNS);
+			int block_height = block.cell_size * ROWS;
+			if(block_width > max_width)
+			{
+				return false;
+			}
+			if(shelf_x + block_width > max_width)
+			{
+				shelf_y += shelf_height;
+				shelf_x = 0;
+				shelf_height = 0;
+			}
+			block.x = shelf_x;
+			block.y = shelf_y;
+			shelf_x += block_width;
+			shelf_height = std::max(shelf_height,block_height);
+			width = std::max(width,shelf_x);
+		}
+		height = shelf_y + shelf_height;
+		return width > 0 && height <= max_height;
+	}
+
+	SDL_Surface* texture_atlas::rasterize() const
+	{
+		SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0,width,height,32,SDL_PIXELFORMAT_RGBA32);
+		if(!surface)
+		{
+			return nullptr;
+		}
+		SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(surface);
+		if(!renderer)
+		{
+			SDL_FreeSurface(surface);
+			return nullptr;
+		}
+		//Transparent white, so filtering at the edges of a line doesn't darken it.
+		SDL_SetRenderDrawBlendMode(renderer,SDL_BLENDMODE_NONE);
+		SDL_SetRenderDrawColor(renderer,255,255,255,0);
+		SDL_RenderClear(renderer);
+		SDL_SetRenderDrawColor(renderer,255,255,255,255);
+		std::vector<SDL_FPoint> outline{};
+		for(std::size_t i = 0;i < ATLAS_PROTOTYPE_COUNT;++i)
+		{
+			if(!is_drawn_prototype(i))
+			{
+				continue;
+			}
+			const sprite_block& block = blocks[i];
+			const auto& vertices = get_prototype_mesh(static_cast<prototype_id>(i)).get_vertices();
+			float half_size = static_cast<float>(block.cell_size) * 0.5f;
+			for(std::size_t cell = 0;cell < ATLAS_ROTATIONS;++cell)
+			{
+				float cosine = std::cos(static_cast<float>(cell) * ATLAS_ROTATION_STEP);
+				float sine = std::sin(static_cast<float>(cell) * ATLAS_ROTATION_STEP);
+				SDL_FPoint center{
+					static_cast<float>(block.x + static_cast<int>(cell % ATLAS_COLUMNS) * block.cell_size) + half_size,
+					static_cast<float>(block.y + static_cast<int>(cell / ATLAS_COLUMNS) * block.cell_size) + half_size
+				};
+				outline.clear();
+				for(const auto& vertex : vertices)
+				{
+					outline.push_back({cosine * vertex.x - sine * vertex.y + center.x,sine * vertex.x + cosine * vertex.y + center.y});
+				}
+				outline.push_back(outline.front());
+				SDL_RenderDrawLinesF(renderer,outline.data(),static_cast<int>(outline.size()));
+			}
+		}
+		SDL_RenderFlush(renderer);
+		SDL_DestroyRenderer(renderer);
+		return surface;
+	}
+
+	std::string texture_atlas::get_cache_path(const std::string& directory) const
+	{
+		std::uint64_t hash = hash_value(hash_value(hash_value(STATE_HASH_SEED,ATLAS_VERSION),ATLAS_ROTATIONS),ATLAS_COLUMNS);
+		for(std::size_t i = 0;i < ATLAS_PROTOTYPE_COUNT;++i)
+		{
+			if(!is_drawn_prototype(i))
+			{
+				continue;
+			}
+			for(const auto& vertex : get_prototype_mesh(static_cast<prototype_id>(i)).get_vertices())
+			{
+				hash = hash_value(hash,vertex);
+			}
+		}
+		std::ostringstream name{};
+		name << directory << "texture_atlas_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".png";
+		return name.str();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef ASTEROIDS_TEXTURE_ATLAS_HPP
+#define ASTEROIDS_TEXTURE_ATLAS_HPP
+
+#include <array>
+#include <string>
+#include <cstddef>
+#include <ostream>
+#include <SDL.h>
+#include "entities.hpp"
+
+namespace asteroids
+{
+	//Rotations rasterized per prototype, a sprite is turned by what is left of its rotation (at most half a step) when drawn.
+	inline constexpr std::size_t ATLAS_ROTATIONS = 32;
+	inline constexpr std::size_t ATLAS_COLUMNS = 8;
+	inline constexpr int ATLAS_MAX_WIDTH = 2048;
+	inline constexpr std::size_t ATLAS_PROTOTYPE_COUNT = static_cast<std::size_t>(prototype_id::ufo) + 1;
+
+	//Outline of every prototype mesh rasterized once per rotation into a single texture, in white so draws can tint them.
+	//The atlas is cached as a PNG named after a hash of the meshes, later starts load it instead of rasterizing.
+	class texture_atlas
+	{
+	public:
+		texture_atlas() = default;
+		texture_atlas(const texture_atlas&) = delete;
+		texture_atlas& operator = (const texture_atlas&) = delete;
+		~texture_atlas();
+
+		//An empty 'cache_directory' always rasterizes and doesn't save the result.
+		bool create(SDL_Renderer* renderer,const std::string& cache_directory,std::ostream& log);
+		void destroy() noexcept;
+		bool is_created() const noexcept;
+		//Returns false when 'prototype' isn't in the atlas, the caller draws the outline itself then.
+		bool draw(SDL_Renderer* renderer,prototype_id prototype,SDL_FPoint position,float rotation,SDL_Color color) const;
+
+	private:
+		//ATLAS_ROTATIONS cells of 'cell_size' pixels, ATLAS_COLUMNS to a row, with the mesh's origin at the center of each cell.
+		struct sprite_block
+		{
+			int x;
+			int y;
+			int cell_size;
+		};
+
+		bool layout(int max_width,int max_height);
+		SDL_Surface* rasterize() const;
+		std::string get_cache_path(const std::string& directory) const;
+
+		std::array<sprite_block,ATLAS_PROTOTYPE_COUNT> blocks{};
+		int width{};
+		int height{};
+		SDL_Texture* texture{};
+	};
+}
+
+#endif
\ No newline at end of file
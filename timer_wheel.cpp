@@ -0,0 +1,162 @@
+#include "timer_wheel.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace asteroids
+{
+	std::uint64_t seconds_to_timer_ticks(float seconds) noexcept
+	{
+		if(!(seconds > 0.0f))
+		{
+			return 0;
+		}
+		double ticks = std::ceil(static_cast<double>(seconds) / TIMER_WHEEL_RESOLUTION);
+		return (ticks >= static_cast<double>(TIMER_WHEEL_MAX_DELAY)) ? TIMER_WHEEL_MAX_DELAY : static_cast<std::uint64_t>(ticks);
+	}
+
+	void timer_wheel::schedule(std::uint64_t delay_ticks,const timer_event& event)
+	{
+		delay_ticks = std::clamp<std::uint64_t>(delay_ticks,1,TIMER_WHEEL_MAX_DELAY);
+		timer_entry entry{current_tick + delay_ticks,event};
+		insert(entry);
+		pending_hash ^= hash_entry(entry);
+		++count;
+	}
+
+	void timer_wheel::schedule_seconds(float seconds,const timer_event& event)
+	{
+		schedule(seconds_to_timer_ticks(seconds),event);
+	}
+
+	void timer_wheel::clear() noexcept
+	{
+		for(auto& level : levels)
+		{
+			for(auto& slot : level)
+			{
+				slot.clear();
+			}
+		}
+		count = 0;
+		pending_hash = 0;
+	}
+
+	std::uint64_t timer_wheel::get_current_tick() const noexcept
+	{
+		return current_tick;
+	}
+
+	std::size_t timer_wheel::size() const noexcept
+	{
+		return count;
+	}
+
+	std::uint64_t timer_wheel::get_pending_hash() const noexcept
+	{
+		return pending_hash;
+	}
+
+	void timer_wheel::save_state(binary_writer& writer) const
+	{
+		writer.write(current_tick);
+		std::uint32_t used_slots = 0;
+		for(const auto& level : levels)
+		{
+			used_slots += static_cast<std::uint32_t>(std::count_if(level.begin(),level.end(),[](const auto& slot){ return !slot.empty(); }));
+		}
+		writer.write(used_slots);
+		//Slots are written verbatim so timers expiring on the same tick keep their firing order after a load.
+		for(std::size_t level = 0;level < TIMER_WHEEL_LEVELS;++level)
+		{
+			for(std::size_t slot = 0;slot < TIMER_WHEEL_SLOTS;++slot)
+			{
+				const auto& entries = levels[level][slot];
+				if(entries.empty())
+				{
+					continue;
+				}
+				writer.write(static_cast<std::uint8_t>(level));
+				writer.write(static_cast<std::uint8_t>(slot));
+				writer.write(static_cast<std::uint32_t>(entries.size()));
+				for(const auto& entry : entries)
+				{
+					writer.write(entry.expiry);
+					writer.write(entry.event.kind);
+					writer.write(entry.event.handle);
+				}
+			}
+		}
+	}
+
+	bool timer_wheel::load_state(binary_reader& reader)
+	{
+		clear();
+		std::uint32_t used_slots{};
+		if(!reader.read(current_tick) || !reader.read(used_slots))
+		{
+			return false;
+		}
+		for(std::uint32_t i = 0;i < used_slots;++i)
+		{
+			std::uint8_t level{};
+			std::uint8_t slot{};
+			std::uint32_t entry_count{};
+			if(!reader.read(level) || !reader.read(slot) || !reader.read(entry_count) || level >= TIMER_WHEEL_LEVELS || slot >= TIMER_WHEEL_SLOTS ||
+				entry_count > reader.get_remaining() / sizeof(std::uint64_t))
+			{
+				return false;
+			}
+			auto& entries = levels[level][slot];
+			entries.resize(entry_count);
+			for(auto& entry : entries)
+			{
+				if(!reader.read(entry.expiry) || !reader.read(entry.event.kind) || !reader.read(entry.event.handle))
+				{
+					return false;
+				}
+				pending_hash ^= hash_entry(entry);
+			}
+			count += entry_count;
+		}
+		return true;
+	}
+
+	//Expiry ticks are unique enough per event that two identical pending timers, which would cancel out, don't occur in practice.
+	std::uint64_t timer_wheel::hash_entry(const timer_entry& entry) noexcept
+	{
+		return hash_value(hash_value(hash_value(STATE_HASH_SEED,entry.expiry),entry.event.kind),entry.event.handle);
+	}
+
+	void timer_wheel::insert(const timer_entry& entry)
+	{
+		std::uint64_t delta = entry.expiry - current_tick;
+		std::size_t level = 0;
+		while(level + 1 < TIMER_WHEEL_LEVELS && delta >= (std::uint64_t{1} << (TIMER_WHEEL_SLOT_BITS * (level + 1))))
+		{
+			++level;
+		}
+		std::size_t slot = static_cast<std::size_t>(entry.expiry >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+		levels[level][slot].push_back(entry);
+	}
+
+	void timer_wheel::cascade()
+	{
+		//Whenever a lower level wraps around, the matching slot of the level above is redistributed into the finer levels.
+		for(std::size_t level = 1;level < TIMER_WHEEL_LEVELS;++level)
+		{
+			std::uint64_t mask = (std::uint64_t{1} << (TIMER_WHEEL_SLOT_BITS * level)) - 1;
+			if((current_tick & mask) != 0)
+			{
+				break;
+			}
+			auto& slot = levels[level][(current_tick >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1)];
+			cascading.swap(slot);
+			for(const auto& entry : cascading)
+			{
+				insert(entry);
+			}
+			cascading.clear();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef ASTEROIDS_TIMER_WHEEL_HPP
+#define ASTEROIDS_TIMER_WHEEL_HPP
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include "entity_pool.hpp"
+#include "state_hash.hpp"
+#include "serialization.hpp"
+
+namespace asteroids
+{
+	//Length of one wheel tick in seconds, gameplay timers are rounded up to it.
+	inline constexpr std::uint64_t TIMER_WHEEL_TICKS_PER_SECOND = 240;
+	inline constexpr float TIMER_WHEEL_RESOLUTION = 1.0f / TIMER_WHEEL_TICKS_PER_SECOND;
+	inline constexpr std::size_t TIMER_WHEEL_LEVELS = 4;
+	inline constexpr std::size_t TIMER_WHEEL_SLOT_BITS = 6;
+	inline constexpr std::size_t TIMER_WHEEL_SLOTS = std::size_t{1} << TIMER_WHEEL_SLOT_BITS;
+	inline constexpr std::uint64_t TIMER_WHEEL_MAX_DELAY = (std::uint64_t{1} << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+	enum class timer_kind : std::uint8_t
+	{
+		player_shoot_ready,
+		player_invulnerability_end,
+		player_respawn,
+		script_resume
+	};
+
+	//Timers can't be cancelled, events aimed at entities carry a handle and are dropped by the receiver once it goes stale.
+	struct timer_event
+	{
+		timer_kind kind{};
+		entity_handle handle{};
+	};
+
+	std::uint64_t seconds_to_timer_ticks(float seconds) noexcept;
+
+	class timer_wheel
+	{
+	public:
+		//Delays are clamped to [1,TIMER_WHEEL_MAX_DELAY] ticks, a zero delay fires on the next tick.
+		void schedule(std::uint64_t delay_ticks,const timer_event& event);
+		void schedule_seconds(float seconds,const timer_event& event);
+		void clear() noexcept;
+		std::uint64_t get_current_tick() const noexcept;
+		std::size_t size() const noexcept;
+		//XOR of a hash per pending timer, kept up to date as timers are scheduled and expire.
+		std::uint64_t get_pending_hash() const noexcept;
+
+		//Calls 'on_expire' for every event that expires during the next 'ticks' ticks, the callback may schedule new timers.
+		template<typename F>
+		void advance(std::uint64_t ticks,F&& on_expire)
+		{
+			for(std::uint64_t i = 0;i < ticks;++i)
+			{
+				++current_tick;
+				cascade();
+				auto& slot = levels[0][current_tick & (TIMER_WHEEL_SLOTS - 1)];
+				if(slot.empty())
+				{
+					continue;
+				}
+				expired.swap(slot);
+				count -= expired.size();
+				for(const auto& entry : expired)
+				{
+					pending_hash ^= hash_entry(entry);
+					on_expire(entry.event);
+				}
+				expired.clear();
+			}
+		}
+
+		void save_state(binary_writer& writer) const;
+		bool load_state(binary_reader& reader);
+
+	private:
+		struct timer_entry
+		{
+			std::uint64_t expiry{};
+			timer_event event{};
+		};
+
+		static std::uint64_t hash_entry(const timer_entry& entry) noexcept;
+		void insert(const timer_entry& entry);
+		void cascade();
+
+		std::array<std::array<std::vector<timer_entry>,TIMER_WHEEL_SLOTS>,TIMER_WHEEL_LEVELS> levels{};
+		std::vector<timer_entry> expired{};
+		std::vector<timer_entry> cascading{};
+		std::uint64_t current_tick{};
+		std::size_t count{};
+		std::uint64_t pending_hash{};
+	};
+}
+
+#endif
\ No newline at end of file